@@ -0,0 +1,525 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "nn_test_util.h"
+#include "nn_batch.hpp"
+#include <chrono>
+#include <thread>
+#include <string>
+#include <algorithm>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+/* ============================ [ MACROS    ] ====================================================== */
+#define BENCH_MODEL_PATH(name, type) \
+	(std::string(BUILD_DIR RAW_P) + name + "/" LIBFIX + name + "_" + type + DLLFIX)
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct {
+	std::string path;
+	runtime_type_t runtime;
+} bench_case_t;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static const char* const rte_names[] =
+{
+#define RTE_DEF(rte) #rte,
+	#include "rtedef.h"
+#undef RTE_DEF
+};
+
+static const char* const op_names[] =
+{
+#define OP_DEF(op) #op,
+	#include "opdef.h"
+#undef OP_DEF
+};
+
+static int warmup = 10;
+static int iterations = 100;
+static std::vector<int> threads = { 1 };
+static int profile = FALSE;
+/* the threads sending one sample each through a batcher, 0 skips it */
+static int clients = 0;
+static int batch_timeout = 1000;
+/* ============================ [ LOCALS    ] ====================================================== */
+static void usage(const char* prog)
+{
+	printf("usage: %s [-w warmup] [-n iterations] [-t 1,2,4] [-r CPU,OPENCL] [-o out.json] [-l]\n"
+		"\t[-c clients] [-b timeout_us] [-m model_name]... [-f path/to/model.so]...\n"
+		"  -m: bench the q8/s8/q16/float build of a model from " BUILD_DIR RAW_P "\n"
+		"  -f: bench one model library\n"
+		"  -r: runtimes to use, default all, the quantized ones only run on CPU\n"
+		"  -t: thread counts to sweep\n"
+		"  -l: add the per-layer average time of each case\n"
+		"  -c: also send iterations requests of one sample from each of that many threads\n"
+		"      through a batcher, which fills the batch of the network\n"
+		"  -b: how long a request may wait for its batch to fill, default 1000\n", prog);
+}
+
+static int parse_runtime(const char* name, runtime_type_t* runtime)
+{
+	int r = -1;
+
+	for(size_t i=0; i<ARRAY_SIZE(rte_names); i++)
+	{
+		if(0 == strcmp(name, rte_names[i]))
+		{
+			*runtime = (runtime_type_t)i;
+			r = 0;
+		}
+	}
+
+	return r;
+}
+
+static std::vector<std::string> split(const char* s)
+{
+	std::vector<std::string> items;
+	std::string str(s);
+	size_t start = 0;
+	size_t end;
+
+	while(start <= str.size())
+	{
+		end = str.find(',', start);
+		if(std::string::npos == end)
+		{
+			end = str.size();
+		}
+		if(end > start)
+		{
+			items.push_back(str.substr(start, end-start));
+		}
+		start = end + 1;
+	}
+
+	return items;
+}
+
+static size_t get_type_size(layer_data_type_t dtype)
+{
+	size_t sz = sizeof(float);
+
+	if((L_DT_INT8 == dtype) || (L_DT_UINT8 == dtype))
+	{
+		sz = 1;
+	}
+	else if((L_DT_INT16 == dtype) || (L_DT_UINT16 == dtype))
+	{
+		sz = 2;
+	}
+
+	return sz;
+}
+
+/* the time doesn't depend on the values, small random ones keep the activations sane */
+static int fill_inputs(const nn_t* nn)
+{
+	int r = 0;
+	const network_t* network = nn->network;
+
+	for(const nn_input_t* const* in=network->inputs; ((*in) != NULL) && (0 == r); in++)
+	{
+		const layer_t* layer = (*in)->layer;
+		size_t sz = layer_get_context_size(nn, layer);
+
+		if((L_DT_STRING == layer->dtype) || (L_OP_MFCC == layer->op))
+		{
+			fprintf(stderr, "%s: input %s is not supported\n", network->name, layer->name);
+			r = -1;
+		}
+		else if(L_DT_FLOAT == layer->dtype)
+		{
+			float* data = (float*)(*in)->data;
+			for(size_t i=0; i<sz; i++)
+			{
+				data[i] = static_cast<float>(std::rand())/RAND_MAX - 0.5f;
+			}
+		}
+		else
+		{
+			uint8_t* data = (uint8_t*)(*in)->data;
+			for(size_t i=0; i<sz*get_type_size(layer->dtype); i++)
+			{
+				data[i] = std::rand() & 0x3F;
+			}
+		}
+	}
+
+	return r;
+}
+
+static double percentile(const std::vector<double>& sorted, double p)
+{
+	size_t rank = (size_t)std::ceil(p*sorted.size()/100.0);
+
+	if(rank > 0)
+	{
+		rank --;
+	}
+
+	return sorted[std::min(rank, sorted.size()-1)];
+}
+
+/* the high-water mark of the whole process, so a case only shows by how much it
+ * raised it, nothing when an earlier case went higher */
+static long get_peak_rss_kb(void)
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+
+	if(FALSE == GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+	{
+		return 0;
+	}
+
+	return (long)(counters.PeakWorkingSetSize/1024);
+#else
+	struct rusage usage;
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	return usage.ru_maxrss;
+#endif
+}
+
+#ifndef DISABLE_NN_THREAD
+/* the samples are the first ones of the inputs of the network, which the batcher only reads */
+static void bench_client(lwnn::Batcher* batcher, nn_t* nn, std::vector<double>* latency, int* result)
+{
+	std::vector<const void*> inputs;
+	std::vector<void*> outputs;
+
+	for(const nn_input_t* const* in=nn->network->inputs; (*in) != NULL; in++)
+	{
+		inputs.push_back((*in)->data);
+	}
+	for(const nn_output_t* const* out=nn->network->outputs; (*out) != NULL; out++)
+	{
+		outputs.push_back(nn_allocate_output(nn, (*out)->layer));
+	}
+
+	for(int i=0; (i<iterations) && (0 == *result); i++)
+	{
+		auto trun_s = std::chrono::high_resolution_clock::now();
+		*result = batcher->predict(inputs, outputs);
+		auto trun_e = std::chrono::high_resolution_clock::now();
+		latency->push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(trun_e-trun_s).count()/1000000.0);
+	}
+
+	for(auto out: outputs)
+	{
+		nn_free_output(out);
+	}
+}
+
+static int bench_batcher(FILE* fp, nn_t* nn)
+{
+	int r = 0;
+	lwnn::Batcher batcher(nn, 0, batch_timeout);
+	std::vector<std::thread> workers;
+	std::vector<std::vector<double>> latencies(clients);
+	std::vector<int> results(clients, 0);
+	std::vector<double> latency;
+	double sum = 0;
+
+	if(false == batcher.valid())
+	{
+		fprintf(stderr, "%s: can't be batched\n", nn->network->name);
+		fprintf(fp, ",\n   \"batcher\": {\"error\": %d}", -1);
+		return -1;
+	}
+
+	auto ts = std::chrono::high_resolution_clock::now();
+	for(int i=0; i<clients; i++)
+	{
+		workers.emplace_back(bench_client, &batcher, nn, &latencies[i], &results[i]);
+	}
+	for(auto& worker: workers)
+	{
+		worker.join();
+	}
+	auto te = std::chrono::high_resolution_clock::now();
+	double ms = std::chrono::duration_cast<std::chrono::nanoseconds>(te-ts).count()/1000000.0;
+
+	for(int i=0; i<clients; i++)
+	{
+		if(0 != results[i])
+		{
+			r = results[i];
+		}
+		latency.insert(latency.end(), latencies[i].begin(), latencies[i].end());
+	}
+
+	if((0 == r) && (false == latency.empty()))
+	{
+		std::sort(latency.begin(), latency.end());
+		for(auto v: latency)
+		{
+			sum += v;
+		}
+		nn_batcher_stats_t stats = batcher.stats();
+		fprintf(fp, ",\n   \"batcher\": {\"clients\": %d, \"timeout_us\": %d, \"requests\": %d, \"batches\": %d, \"full_batches\": %d,\n"
+			"    \"latency_ms\": {\"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n"
+			"    \"throughput\": %.3f}",
+			clients, batch_timeout, (int)stats.requests, (int)stats.batches, (int)stats.full_batches,
+			sum/latency.size(), latency.front(), percentile(latency, 50), percentile(latency, 90),
+			percentile(latency, 99), latency.back(), 1000.0*latency.size()/ms);
+	}
+	else
+	{
+		fprintf(stderr, "%s: batcher failed with %d\n", nn->network->name, r);
+		fprintf(fp, ",\n   \"batcher\": {\"error\": %d}", r);
+	}
+
+	return r;
+}
+#endif
+
+/* *first is cleared once the record of the case is written, even if the batcher then fails */
+static int bench(FILE* fp, const bench_case_t& c, const network_t* network, int num, int* first)
+{
+	int r = 0;
+	std::vector<double> latency;
+	double sum = 0;
+	int batch = 1;
+	long peak_rss = get_peak_rss_kb();
+
+	auto tcreate_s = std::chrono::high_resolution_clock::now();
+	nn_t* nn = nn_create(network, c.runtime);
+	auto tcreate_e = std::chrono::high_resolution_clock::now();
+
+	if(NULL == nn)
+	{
+		fprintf(stderr, "%s: create on %s failed\n", network->name, rte_names[c.runtime]);
+		return -1;
+	}
+
+	r = fill_inputs(nn);
+
+	if(0 == r)
+	{
+		r = nn_set_num_threads(nn, num);
+	}
+
+	for(int i=0; (i<warmup) && (0 == r); i++)
+	{
+		r = nn_predict(nn);
+	}
+
+#ifndef DISABLE_NN_PROFILE
+	if(profile && (0 == r))
+	{
+		r = nn_set_profile(nn, TRUE);
+	}
+#endif
+
+	for(int i=0; (i<iterations) && (0 == r); i++)
+	{
+		auto trun_s = std::chrono::high_resolution_clock::now();
+		r = nn_predict(nn);
+		auto trun_e = std::chrono::high_resolution_clock::now();
+		double ms = std::chrono::duration_cast<std::chrono::nanoseconds>(trun_e-trun_s).count()/1000000.0;
+		latency.push_back(ms);
+		sum += ms;
+	}
+
+	if((0 == r) && (false == latency.empty()))
+	{
+		std::sort(latency.begin(), latency.end());
+		if(network->inputs[0]->layer->dims[0] > 0)
+		{
+			batch = network->inputs[0]->layer->dims[0];
+		}
+
+		fprintf(fp, "%s  {\"network\": \"%s\", \"model\": \"%s\", \"runtime\": \"%s\", \"threads\": %d,\n"
+			"   \"warmup\": %d, \"iterations\": %d, \"batch\": %d, \"create_ms\": %.3f,\n"
+			"   \"latency_ms\": {\"mean\": %.3f, \"min\": %.3f, \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f},\n"
+			"   \"throughput\": %.3f, \"peak_rss_growth_kb\": %ld",
+			(*first) ? "" : ",\n", network->name, c.path.c_str(), rte_names[c.runtime], num,
+			warmup, iterations, batch,
+			std::chrono::duration_cast<std::chrono::nanoseconds>(tcreate_e-tcreate_s).count()/1000000.0,
+			sum/latency.size(), latency.front(), percentile(latency, 50), percentile(latency, 90),
+			percentile(latency, 99), latency.back(),
+			batch*1000.0*latency.size()/sum, get_peak_rss_kb()-peak_rss);
+		*first = FALSE;
+
+#ifndef DISABLE_NN_PROFILE
+		const nn_profile_t* prof = nn_get_profile(nn);
+		if(NULL != prof)
+		{
+			fprintf(fp, ",\n   \"layers\": [");
+			for(size_t i=0; i<prof->layer_number; i++)
+			{
+				fprintf(fp, "%s\n    {\"name\": \"%s\", \"op\": \"%s\", \"bytes\": %d, \"avg_ms\": %.4f}",
+					(0 == i) ? "" : ",", prof->layers[i].layer->name, op_names[prof->layers[i].layer->op],
+					(int)prof->layers[i].out_bytes, prof->layers[i].total/1000000.0/prof->runs);
+			}
+			fprintf(fp, "]");
+		}
+#endif
+#ifndef DISABLE_NN_THREAD
+		if(clients > 0)
+		{
+			r = bench_batcher(fp, nn);
+		}
+#endif
+		fprintf(fp, "}");
+	}
+	else
+	{
+		fprintf(stderr, "%s: run on %s with %d threads failed with %d\n", network->name, rte_names[c.runtime], num, r);
+	}
+
+	nn_destory(nn);
+
+	return r;
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int main(int argc, char **argv)
+{
+	int ch;
+	int r = 0;
+	int first = TRUE;
+	FILE* fp = stdout;
+	const char* output = NULL;
+	std::vector<runtime_type_t> runtimes;
+	std::vector<std::string> models;
+	std::vector<std::string> files;
+	std::vector<bench_case_t> cases;
+
+	while((ch = getopt(argc, argv, "b:c:f:hlm:n:o:r:t:w:")) != -1)
+	{
+		switch(ch)
+		{
+			case 'b':
+				batch_timeout = atoi(optarg);
+				break;
+			case 'c':
+				clients = atoi(optarg);
+				break;
+			case 'f':
+				files.push_back(optarg);
+				break;
+			case 'l':
+				profile = TRUE;
+				break;
+			case 'm':
+				models.push_back(optarg);
+				break;
+			case 'n':
+				iterations = atoi(optarg);
+				break;
+			case 'o':
+				output = optarg;
+				break;
+			case 'r':
+				for(auto& name: split(optarg))
+				{
+					runtime_type_t runtime;
+					if(0 != parse_runtime(name.c_str(), &runtime))
+					{
+						fprintf(stderr, "unknown runtime %s\n", name.c_str());
+						return -1;
+					}
+					runtimes.push_back(runtime);
+				}
+				break;
+			case 't':
+				threads.clear();
+				for(auto& num: split(optarg))
+				{
+					threads.push_back(atoi(num.c_str()));
+				}
+				break;
+			case 'w':
+				warmup = atoi(optarg);
+				break;
+			default:
+				usage(argv[0]);
+				return -1;
+		}
+	}
+
+	if((models.empty() && files.empty()) || (iterations <= 0) || threads.empty())
+	{
+		usage(argv[0]);
+		return -1;
+	}
+
+	if(runtimes.empty())
+	{
+		for(size_t i=0; i<ARRAY_SIZE(rte_names); i++)
+		{
+			runtimes.push_back((runtime_type_t)i);
+		}
+	}
+
+	for(auto& name: models)
+	{
+		for(auto runtime: runtimes)
+		{
+			if(RUNTIME_CPU == runtime)
+			{
+				cases.push_back({BENCH_MODEL_PATH(name, "q8"), runtime});
+				cases.push_back({BENCH_MODEL_PATH(name, "s8"), runtime});
+				cases.push_back({BENCH_MODEL_PATH(name, "q16"), runtime});
+			}
+			cases.push_back({BENCH_MODEL_PATH(name, "float"), runtime});
+		}
+	}
+
+	for(auto& path: files)
+	{
+		for(auto runtime: runtimes)
+		{
+			cases.push_back({path, runtime});
+		}
+	}
+
+	if(NULL != output)
+	{
+		fp = fopen(output, "w");
+		if(NULL == fp)
+		{
+			fprintf(stderr, "can't open %s\n", output);
+			return -1;
+		}
+	}
+
+	nn_set_log_level(NN_ERROR);
+	fprintf(fp, "{\"results\": [\n");
+	for(auto& c: cases)
+	{
+		void* dll = NULL;
+		const network_t* network = nnt_load_network(c.path.c_str(), &dll);
+		if(NULL == network)
+		{
+			r = -1;
+			continue;
+		}
+
+		for(auto num: threads)
+		{
+			if(0 != bench(fp, c, network, num, &first))
+			{
+				r = -1;
+			}
+		}
+
+		dlclose(dll);
+	}
+	fprintf(fp, "\n]}\n");
+
+	if(stdout != fp)
+	{
+		fclose(fp);
+	}
+
+	return r;
+}
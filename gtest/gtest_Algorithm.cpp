@@ -5,6 +5,11 @@
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include "nn_test_util.h"
 #include "algorithm.h"
+#include "thread_pool.h"
+#include "gemm.h"
+#include "fastmath.h"
+#include <cmath>
+#include <atomic>
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct alg_transpose_case {
@@ -45,6 +50,50 @@ void TestTransposeFromNHWC2NCHW(const char* input, const char* output, const NHW
 	free(IN);
 	free(G);
 }
+static void TestThreadPoolTask(void* param, size_t start, size_t end)
+{
+	int* marks = (int*)param;
+	for(size_t i=start; i<end; i++)
+	{
+		marks[i] ++;
+	}
+}
+
+typedef struct {
+	std::atomic<int> order;
+	int at[6];
+} thread_pool_graph_test_t;
+
+static int TestThreadPoolNode(void* param, int id)
+{
+	thread_pool_graph_test_t* t = (thread_pool_graph_test_t*)param;
+	t->at[id] = t->order++;
+	return 0;
+}
+static void TestSGEMMRef(int M, int N, int K, const float* A, const float* B,
+		const float* bias, float* C, layer_activation_type_t act)
+{
+	for(int i=0; i<M; i++)
+	{
+		for(int j=0; j<N; j++)
+		{
+			float sum = (NULL != bias) ? bias[j] : 0;
+			for(int k=0; k<K; k++)
+			{
+				sum += A[i*K+k]*B[j*K+k];
+			}
+			if((L_ACT_RELU == act) && (sum < 0))
+			{
+				sum = 0;
+			}
+			else if((L_ACT_LEAKY == act) && (sum < 0))
+			{
+				sum = 0.1*sum;
+			}
+			C[i*N+j] = sum;
+		}
+	}
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 TEST(Algorighm, Transpose)
 {
@@ -56,3 +105,172 @@ TEST(Algorighm, Transpose)
 				&alg_transpose_cases[i].nhwc);
 	}
 }
+
+#ifndef DISABLE_NN_THREAD
+TEST(Algorighm, ThreadPool)
+{
+	const size_t totals[] = { 0, 1, 3, 7, 64, 1000 };
+	std::vector<int> marks;
+
+	for(int num=1; num<=8; num++)
+	{
+		thread_pool_t* pool = thread_pool_create(num);
+		if(num > 1)
+		{
+			ASSERT_NE(pool, nullptr);
+		}
+		EXPECT_EQ(num, thread_pool_get_num_threads(pool));
+		for(int i=0; i<ARRAY_SIZE(totals); i++)
+		{
+			marks.assign(totals[i]+1, 0);
+			/* run twice to check the workers are reusable */
+			thread_pool_parallel_for(pool, totals[i], TestThreadPoolTask, marks.data());
+			thread_pool_parallel_for(pool, totals[i], TestThreadPoolTask, marks.data());
+			for(size_t j=0; j<totals[i]; j++)
+			{
+				EXPECT_EQ(2, marks[j]);
+			}
+			EXPECT_EQ(0, marks[totals[i]]);
+		}
+		thread_pool_destory(pool);
+	}
+}
+
+TEST(Algorighm, ThreadPoolGraph)
+{
+	/* 0 -> {1, 2, 3} -> 4, 2 -> 5 */
+	const int npreds[] = { 0, 1, 1, 1, 3, 1 };
+	const int succ_start[] = { 0, 3, 4, 6, 7, 7, 7 };
+	const int succs[] = { 1, 2, 3, 4, 4, 5, 4 };
+	int pending[6], ready[6];
+	thread_pool_graph_t graph = { 6, npreds, succ_start, succs, pending, ready };
+	thread_pool_graph_test_t t;
+
+	for(int num=1; num<=4; num++)
+	{
+		thread_pool_t* pool = thread_pool_create(num);
+		for(int loop=0; loop<100; loop++)
+		{
+			t.order = 0;
+			EXPECT_EQ(0, thread_pool_run_graph(pool, &graph, TestThreadPoolNode, &t));
+			EXPECT_EQ(6, t.order);
+			EXPECT_EQ(0, t.at[0]);
+			EXPECT_GT(t.at[4], t.at[1]);
+			EXPECT_GT(t.at[4], t.at[2]);
+			EXPECT_GT(t.at[4], t.at[3]);
+			EXPECT_GT(t.at[5], t.at[2]);
+		}
+		thread_pool_destory(pool);
+	}
+}
+#endif
+
+TEST(Algorighm, SGEMM)
+{
+	/* odd sizes to hit the edge tiles, K over one block to check the accumulation */
+	const int shapes[][3] = { {1,1,1}, {3,5,7}, {17,33,9}, {64,64,64}, {37,19,300}, {130,70,513} };
+	const layer_activation_type_t acts[] = { L_ACT_NONE, L_ACT_RELU, L_ACT_LEAKY };
+
+	/* the best kernel first, then all the ones this CPU can run */
+	EXPECT_EQ(alg_sgemm_kernel(NULL), alg_isa_select(alg_sgemm_kernels, alg_isa_detect()));
+	for(const alg_isa_kernel_t* k=alg_sgemm_kernels; NULL != k->kernel; k++)
+	{
+		const alg_sgemm_kernel_t* kernel = (const alg_sgemm_kernel_t*)k->kernel;
+		if(!alg_isa_supported(k->isa))
+		{
+			continue;
+		}
+		EXPECT_EQ(kernel, alg_isa_select(alg_sgemm_kernels, k->isa));
+		for(int i=0; i<ARRAY_SIZE(shapes); i++)
+		{
+			int M = shapes[i][0], N = shapes[i][1], K = shapes[i][2];
+			std::vector<float> A(M*K), B(N*K), bias(N), C(M*N), G(M*N);
+			for(auto& v: A) v = static_cast<float>(std::rand())/RAND_MAX - 0.5f;
+			for(auto& v: B) v = static_cast<float>(std::rand())/RAND_MAX - 0.5f;
+			for(auto& v: bias) v = static_cast<float>(std::rand())/RAND_MAX - 0.5f;
+			for(int j=0; j<ARRAY_SIZE(acts); j++)
+			{
+				const float* b = (0 == j) ? NULL : bias.data();
+				TestSGEMMRef(M, N, K, A.data(), B.data(), b, G.data(), acts[j]);
+				EXPECT_EQ(0, alg_sgemm_nt(kernel, M, N, K, A.data(), K, B.data(), K, b, C.data(), N, acts[j]));
+				EXPECT_EQ(0, nnt_is_equal(C.data(), G.data(), M*N, 1.0/1000));
+			}
+
+			float* packed = (float*)alg_sgemm_malloc(sizeof(float)*alg_sgemm_packed_size(kernel, N, K));
+			ASSERT_NE(packed, nullptr);
+			alg_sgemm_pack_nt(kernel, N, K, B.data(), K, packed);
+			TestSGEMMRef(M, N, K, A.data(), B.data(), bias.data(), G.data(), L_ACT_RELU);
+			EXPECT_EQ(0, alg_sgemm_nt_packed(kernel, M, N, K, A.data(), K, packed, bias.data(), C.data(), N, L_ACT_RELU));
+			EXPECT_EQ(0, nnt_is_equal(C.data(), G.data(), M*N, 1.0/1000));
+			/* the first row of A as a vector */
+			EXPECT_EQ(0, alg_sgemv_packed(kernel, N, K, A.data(), packed, bias.data(), C.data(), L_ACT_RELU));
+			EXPECT_EQ(0, nnt_is_equal(C.data(), G.data(), N, 1.0/1000));
+			alg_sgemm_free(packed);
+		}
+	}
+}
+
+TEST(Algorighm, FastMath)
+{
+	/* odd size to hit the scalar tail of the vector loops */
+	const int n = 1001;
+	std::vector<float> x(n), y(n);
+	double e;
+
+	/* the best kernel first, then all the ones this CPU can run */
+	EXPECT_EQ(alg_fastmath_kernel(NULL), alg_isa_select(alg_fastmath_kernels, alg_isa_detect()));
+	for(const alg_isa_kernel_t* k=alg_fastmath_kernels; NULL != k->kernel; k++)
+	{
+		const alg_fastmath_kernel_t* kernel = (const alg_fastmath_kernel_t*)k->kernel;
+		if(!alg_isa_supported(k->isa))
+		{
+			continue;
+		}
+		EXPECT_EQ(kernel, alg_isa_select(alg_fastmath_kernels, k->isa));
+
+		for(int i=0; i<n; i++) x[i] = -80.0f + 160.0f*i/(n-1);
+		kernel->vexpf(x.data(), y.data(), n);
+		for(int i=0; i<n; i++)
+		{
+			double g = std::exp((double)x[i]);
+			e = std::fabs(y[i]-g)/g;
+			EXPECT_LT(e, 1e-6) << kernel->name;
+			EXPECT_LT(std::fabs(alg_expf(x[i])-g)/g, 1e-6);
+		}
+
+		for(int i=0; i<n; i++) x[i] = -12.0f + 24.0f*i/(n-1);
+		kernel->vtanhf(x.data(), y.data(), n);
+		for(int i=0; i<n; i++)
+		{
+			double g = std::tanh((double)x[i]);
+			e = std::fabs(y[i]-g)/(std::fabs(g)+1e-30);
+			EXPECT_LT(e, 2e-6) << kernel->name;
+		}
+		kernel->vsigmoidf(x.data(), y.data(), n);
+		for(int i=0; i<n; i++)
+		{
+			double g = 1.0/(1.0+std::exp(-(double)x[i]));
+			e = std::fabs(y[i]-g)/g;
+			EXPECT_LT(e, 1e-6) << kernel->name;
+		}
+	}
+
+	/* the public ones go to the best kernel */
+	for(int i=0; i<n; i++) x[i] = -12.0f + 24.0f*i/(n-1);
+	alg_vsigmoidf(x.data(), y.data(), n);
+	for(int i=0; i<n; i++)
+	{
+		double g = 1.0/(1.0+std::exp(-(double)x[i]));
+		e = std::fabs(y[i]-g)/g;
+		EXPECT_LT(e, 1e-6);
+	}
+
+	for(int i=0; i<n; i++) x[i] = std::pow(10.0f, -30.0f + 60.0f*i/(n-1));
+	alg_vlogf(x.data(), y.data(), n);
+	for(int i=0; i<n; i++)
+	{
+		double g = std::log((double)x[i]);
+		e = std::fabs(y[i]-g)/std::fmax(std::fabs(g), 1.0);
+		EXPECT_LT(e, 1e-6);
+	}
+}
@@ -0,0 +1,188 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "nn_test_util.h"
+#include "nn_batch.hpp"
+#include <thread>
+/* ============================ [ MACROS    ] ====================================================== */
+#define NNT_BATCH 8
+#define NNT_BATCH_CLASSES 10
+#define NNT_BATCH_THREADS 16
+#define NNT_BATCH_REQUESTS 50
+
+/* a softmax over the classes of each sample, a mixed up row shows at once */
+#define batch_input_DIMS NNT_BATCH,1,1,NNT_BATCH_CLASSES
+#define l_blobs_batch_input NULL
+#define batch_softmax_DIMS NNT_BATCH,1,1,NNT_BATCH_CLASSES
+#define l_blobs_batch_softmax NULL
+#define batch_output_DIMS NNT_BATCH,1,1,NNT_BATCH_CLASSES
+#define l_blobs_batch_output NULL
+
+/* the same with a batch only known at the run */
+#define dynamic_input_DIMS -1,1,1,NNT_BATCH_CLASSES
+#define l_blobs_dynamic_input NULL
+#define dynamic_softmax_DIMS -1,1,1,NNT_BATCH_CLASSES
+#define l_blobs_dynamic_softmax NULL
+#define dynamic_output_DIMS -1,1,1,NNT_BATCH_CLASSES
+#define l_blobs_dynamic_output NULL
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+L_INPUT (batch_input, L_DT_FLOAT);
+L_SOFTMAX (batch_softmax, batch_input);
+L_OUTPUT (batch_output, batch_softmax);
+
+static float batch_input_buffer[NNT_BATCH*NNT_BATCH_CLASSES];
+static const nn_input_t batch_input_input = { L_REF(batch_input), batch_input_buffer };
+static const nn_input_t* const batch_inputs[] = { &batch_input_input, NULL };
+static float batch_output_buffer[NNT_BATCH*NNT_BATCH_CLASSES];
+static const nn_output_t batch_output_output = { L_REF(batch_output), batch_output_buffer };
+static const nn_output_t* const batch_outputs[] = { &batch_output_output, NULL };
+static const layer_t* const batch_layers[] = {
+	L_REF(batch_input), L_REF(batch_softmax), L_REF(batch_output), NULL };
+static const network_t batch_network = {
+	"batch", batch_layers, batch_inputs, batch_outputs, NETWORK_TYPE_FLOAT };
+
+L_INPUT (dynamic_input, L_DT_FLOAT);
+L_SOFTMAX (dynamic_softmax, dynamic_input);
+L_OUTPUT (dynamic_output, dynamic_softmax);
+
+static const nn_input_t dynamic_input_input = { L_REF(dynamic_input), batch_input_buffer };
+static const nn_input_t* const dynamic_inputs[] = { &dynamic_input_input, NULL };
+static const nn_output_t dynamic_output_output = { L_REF(dynamic_output), batch_output_buffer };
+static const nn_output_t* const dynamic_outputs[] = { &dynamic_output_output, NULL };
+static const layer_t* const dynamic_layers[] = {
+	L_REF(dynamic_input), L_REF(dynamic_softmax), L_REF(dynamic_output), NULL };
+static const network_t dynamic_network = {
+	"dynamic", dynamic_layers, dynamic_inputs, dynamic_outputs, NETWORK_TYPE_FLOAT };
+/* ============================ [ LOCALS    ] ====================================================== */
+static void TestBatchSoftmaxRef(const float* in, float* out)
+{
+	float base = in[0];
+	float sum = 0;
+
+	for(int i=1; i<NNT_BATCH_CLASSES; i++)
+	{
+		base = std::max(base, in[i]);
+	}
+	for(int i=0; i<NNT_BATCH_CLASSES; i++)
+	{
+		out[i] = std::exp(in[i]-base);
+		sum += out[i];
+	}
+	for(int i=0; i<NNT_BATCH_CLASSES; i++)
+	{
+		out[i] /= sum;
+	}
+}
+
+#ifndef DISABLE_NN_THREAD
+/* each thread sends its own inputs and checks it gets its own results back */
+static void TestBatchClient(lwnn::Batcher* batcher, int id, int* failures)
+{
+	float in[NNT_BATCH_CLASSES];
+	float out[NNT_BATCH_CLASSES];
+	float golden[NNT_BATCH_CLASSES];
+	unsigned int seed = id;
+
+	for(int n=0; n<NNT_BATCH_REQUESTS; n++)
+	{
+		for(int i=0; i<NNT_BATCH_CLASSES; i++)
+		{
+			seed = seed*1103515245 + 12345;
+			in[i] = ((seed>>16)&0x7fff)/4096.0f - 4.0f;
+		}
+		TestBatchSoftmaxRef(in, golden);
+		if((0 != batcher->predict({ in }, { out })) ||
+			(0 != nnt_is_equal(out, golden, NNT_BATCH_CLASSES, 1.0/1000)))
+		{
+			(*failures) ++;
+		}
+	}
+}
+#endif
+/* ============================ [ FUNCTIONS ] ====================================================== */
+#if !defined(DISABLE_RUNTIME_CPU_FLOAT) && !defined(DISABLE_NN_THREAD)
+TEST(Batcher, ManyThreads)
+{
+	nn_t* nn = nn_create(&batch_network, RUNTIME_CPU);
+	ASSERT_NE(nn, nullptr);
+	{
+		lwnn::Batcher batcher(nn, 0, 2000);
+		std::vector<std::thread> clients;
+		std::vector<int> failures(NNT_BATCH_THREADS, 0);
+		ASSERT_TRUE(batcher.valid());
+
+		for(int i=0; i<NNT_BATCH_THREADS; i++)
+		{
+			clients.emplace_back(TestBatchClient, &batcher, i+1, &failures[i]);
+		}
+		for(auto& client: clients)
+		{
+			client.join();
+		}
+
+		for(int i=0; i<NNT_BATCH_THREADS; i++)
+		{
+			EXPECT_EQ(0, failures[i]);
+		}
+		nn_batcher_stats_t stats = batcher.stats();
+		EXPECT_EQ(NNT_BATCH_THREADS*NNT_BATCH_REQUESTS, stats.requests);
+		/* the requests of the waiting threads come together */
+		EXPECT_LT(stats.batches, stats.requests);
+		EXPECT_GE(stats.batches*NNT_BATCH, stats.requests);
+	}
+	nn_destory(nn);
+}
+#endif
+
+#ifndef DISABLE_RUNTIME_CPU_FLOAT
+TEST(Batcher, Timeout)
+{
+	nn_t* nn = nn_create(&batch_network, RUNTIME_CPU);
+	ASSERT_NE(nn, nullptr);
+	/* more than the network can take is cut to its batch */
+	nn_batcher_config_t config = { NNT_BATCH*2, 100 };
+	nn_batcher_t* batcher = nn_batcher_create(nn, &config);
+	ASSERT_NE(batcher, nullptr);
+
+	float in[NNT_BATCH_CLASSES], out[NNT_BATCH_CLASSES], golden[NNT_BATCH_CLASSES];
+	const void* inputs[] = { in };
+	void* outputs[] = { out };
+	nn_batcher_stats_t stats;
+	for(int n=0; n<3; n++)
+	{
+		for(int i=0; i<NNT_BATCH_CLASSES; i++)
+		{
+			in[i] = n + i*0.1f;
+		}
+		TestBatchSoftmaxRef(in, golden);
+		/* alone it runs once the timeout is over */
+		EXPECT_EQ(0, nn_batcher_predict(batcher, inputs, outputs));
+		EXPECT_EQ(0, nnt_is_equal(out, golden, NNT_BATCH_CLASSES, 1.0/1000));
+	}
+	EXPECT_EQ(0, nn_batcher_get_stats(batcher, &stats));
+	EXPECT_EQ(3, stats.requests);
+	EXPECT_EQ(3, stats.batches);
+	EXPECT_EQ(0, stats.full_batches);
+	nn_batcher_destory(batcher);
+
+	/* the inputs of the network are its own again */
+	EXPECT_EQ(batch_input_buffer, nn_get_input_data(nn, L_REF(batch_input)));
+	nn_destory(nn);
+}
+#endif
+
+#if !defined(DISABLE_RUNTIME_CPU_FLOAT) && !defined(DISABLE_DYNAMIC_SHAPE)
+TEST(Batcher, DynamicBatch)
+{
+	nn_t* nn = nn_create(&dynamic_network, RUNTIME_CPU);
+	ASSERT_NE(nn, nullptr);
+	nn_batcher_config_t config = { 0, 100 };
+	/* there is no batch to fill */
+	EXPECT_EQ(nullptr, nn_batcher_create(nn, &config));
+	nn_destory(nn);
+}
+#endif
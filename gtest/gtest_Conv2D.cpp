@@ -8,6 +8,13 @@
 #define NNT_Conv2D_MAX_DIFF 5.0/100
 #define NNT_Conv2D_MAX_QDIFF 0.15
 /* ============================ [ TYPES     ] ====================================================== */
+typedef struct {
+	int N, H, W, C;
+	/* top, left, bottom and right of a PAD in front of the CONV2D, all 0 for none */
+	int pad[4];
+	int Cout, knlY, knlX, padY, padX, strideY, strideX;
+	layer_activation_type_t act;
+} nnt_conv2d_case_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 NNT_CASE_DEF(Conv2D) =
@@ -17,5 +24,146 @@ NNT_CASE_DEF(Conv2D) =
 	NNT_CASE_DESC(conv2d_3)
 };
 /* ============================ [ LOCALS    ] ====================================================== */
+static float TestConv2DRandom(void)
+{
+	return static_cast<float>(std::rand())/RAND_MAX - 0.5f;
+}
+
+/* input -> [PAD ->] CONV2D -> output built at runtime on the float CPU runtime, its
+ * output must be the one of convolve_HWC_ref_nonsquare over the padded input */
+static void TestConv2DCase(const nnt_conv2d_case_t* c, int threads)
+{
+	const int* pad = c->pad;
+	const bool with_pad = (0 != (pad[0]|pad[1]|pad[2]|pad[3]));
+	const int H = c->H + pad[0] + pad[2];
+	const int W = c->W + pad[1] + pad[3];
+	const int oH = (H + 2*c->padY - c->knlY)/c->strideY + 1;
+	const int oW = (W + 2*c->padX - c->knlX)/c->strideX + 1;
+	std::vector<float> IN(c->N*c->H*c->W*c->C), O(c->N*oH*oW*c->Cout), G(O.size());
+	std::vector<float> weights(c->Cout*c->knlY*c->knlX*c->C), bias(c->Cout), padded(c->N*H*W*c->C, 0);
+	int32_t pads[8] = { 0, pad[0], pad[1], 0, 0, pad[2], pad[3], 0 };
+	int32_t conv[7] = { c->padY, c->padX, c->padY, c->padX, c->strideY, c->strideX, c->act };
+	float value = 0;
+
+	for(auto& v: IN) v = TestConv2DRandom();
+	for(auto& v: weights) v = TestConv2DRandom();
+	for(auto& v: bias) v = TestConv2DRandom();
+
+	const int in_dims[] = { c->N, c->H, c->W, c->C, 0 };
+	const int pad_dims[] = { c->N, H, W, c->C, 0 };
+	const int conv_dims[] = { c->N, oH, oW, c->Cout, 0 };
+	const int w_dims[] = { c->Cout, c->knlY, c->knlX, c->C, 0 };
+	const int b_dims[] = { c->Cout, 0 };
+	const int pads_dims[] = { 8, 0 };
+	const int conv_M_dims[] = { 7, 0 };
+	const int value_dims[] = { 1, 0 };
+	layer_blob_t pad_M = { pads_dims, L_DT_INT32, pads };
+	layer_blob_t pad_P = { value_dims, L_DT_FLOAT, &value };
+	const layer_blob_t* pad_blobs[] = { &pad_M, &pad_P, NULL };
+	layer_blob_t conv_W = { w_dims, L_DT_FLOAT, weights.data() };
+	layer_blob_t conv_B = { b_dims, L_DT_FLOAT, bias.data() };
+	layer_blob_t conv_M = { conv_M_dims, L_DT_INT32, conv };
+	const layer_blob_t* conv_blobs[] = { &conv_W, &conv_B, &conv_M, NULL };
+
+	layer_t input = { "input", NULL, NULL, in_dims, L_OP_INPUT, L_DT_FLOAT };
+	layer_t* pad_inputs[] = { &input, NULL };
+	layer_t padding = { "pad", pad_inputs, pad_blobs, pad_dims, L_OP_PAD, L_DT_AUTO };
+	layer_t* conv_inputs[] = { with_pad ? &padding : &input, NULL };
+	layer_t conv2d = { "conv2d", conv_inputs, conv_blobs, conv_dims, L_OP_CONV2D, L_DT_AUTO };
+	layer_t* output_inputs[] = { &conv2d, NULL };
+	layer_t output = { "output", output_inputs, NULL, conv_dims, L_OP_OUTPUT, L_DT_AUTO };
+	const layer_t* layers_pad[] = { &input, &padding, &conv2d, &output, NULL };
+	const layer_t* layers[] = { &input, &conv2d, &output, NULL };
+	nn_input_t net_input = { &input, IN.data() };
+	const nn_input_t* const inputs[] = { &net_input, NULL };
+	nn_output_t net_output = { &output, O.data() };
+	const nn_output_t* const outputs[] = { &net_output, NULL };
+	network_t network = { "conv2d", with_pad ? layers_pad : layers, inputs, outputs, NETWORK_TYPE_FLOAT };
+
+	for(int n=0; n<c->N; n++)
+	{
+		for(int y=0; y<c->H; y++)
+		{
+			memcpy(&padded[((n*H+y+pad[0])*W+pad[1])*c->C], &IN[((n*c->H+y)*c->W)*c->C], sizeof(float)*c->W*c->C);
+		}
+		convolve_HWC_ref_nonsquare(&padded[n*H*W*c->C], W, H, c->C, weights.data(), c->Cout,
+				c->knlX, c->knlY, c->padX, c->padY, c->strideX, c->strideY, bias.data(),
+				&G[n*oH*oW*c->Cout], oW, oH, c->act);
+	}
+
+	nn_t* nn = nn_create(&network, RUNTIME_CPU);
+	ASSERT_NE(nn, nullptr);
+	EXPECT_EQ(0, nn_set_num_threads(nn, threads));
+	EXPECT_EQ(0, nn_predict(nn));
+	EXPECT_EQ(0, nnt_is_equal(O.data(), G.data(), O.size(), 1.0/1000))
+		<< "N=" << c->N << " H=" << c->H << " W=" << c->W << " C=" << c->C
+		<< " pad=" << pad[0] << "," << pad[1] << "," << pad[2] << "," << pad[3]
+		<< " Cout=" << c->Cout << " kernel=" << c->knlY << "x" << c->knlX
+		<< " pads=" << c->padY << "," << c->padX << " strides=" << c->strideY << "," << c->strideX;
+	nn_destory(nn);
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 NNT_TEST_ALL(Conv2D)
+
+#ifndef DISABLE_RUNTIME_CPU_FLOAT
+TEST(RuntimeCPU, Conv2DFusedPad)
+{
+	const nnt_conv2d_case_t cases[] = {
+		/* only the bottom and right grow, the 1x1 must not take the input as the GEMM A */
+		{ 1, 6, 7, 5, { 0, 0, 1, 1 }, 4, 1, 1, 0, 0, 1, 1, L_ACT_NONE },
+		{ 2, 6, 7, 5, { 1, 2, 0, 0 }, 4, 1, 1, 0, 0, 1, 1, L_ACT_RELU },
+		{ 1, 9, 8, 3, { 1, 0, 2, 1 }, 6, 3, 3, 0, 0, 1, 1, L_ACT_NONE },
+		{ 1, 9, 11, 4, { 0, 1, 1, 0 }, 5, 3, 3, 1, 1, 2, 2, L_ACT_NONE },
+	};
+
+	for(int i=0; i<ARRAY_SIZE(cases); i++)
+	{
+		TestConv2DCase(&cases[i], g_NumThreads);
+	}
+}
+
+/* the im2col GEMM against the plain convolution it replaces */
+TEST(RuntimeCPU, Conv2DGemm)
+{
+	const nnt_conv2d_case_t cases[] = {
+		{ 1, 10, 12, 3, { 0, 0, 0, 0 }, 8, 3, 3, 1, 1, 2, 2, L_ACT_NONE },
+		{ 2, 9, 11, 5, { 0, 0, 0, 0 }, 6, 1, 1, 0, 0, 2, 2, L_ACT_RELU },
+		/* non square kernels, pads and strides */
+		{ 1, 15, 13, 4, { 0, 0, 0, 0 }, 7, 3, 5, 1, 2, 1, 1, L_ACT_NONE },
+		{ 1, 16, 9, 6, { 0, 0, 0, 0 }, 5, 5, 1, 2, 0, 2, 1, L_ACT_LEAKY },
+		{ 2, 11, 17, 3, { 0, 0, 0, 0 }, 4, 1, 7, 0, 3, 1, 3, L_ACT_NONE },
+		{ 1, 23, 19, 17, { 0, 0, 0, 0 }, 33, 5, 5, 2, 2, 2, 2, L_ACT_RELU },
+		{ 1, 8, 8, 9, { 0, 0, 0, 0 }, 3, 2, 2, 0, 0, 2, 2, L_ACT_NONE },
+	};
+
+	for(int threads: { 1, 3 })
+	{
+		for(int i=0; i<ARRAY_SIZE(cases); i++)
+		{
+			TestConv2DCase(&cases[i], threads);
+		}
+	}
+}
+
+/* the 3x3 stride 1 convolutions go the F(4x4,3x3) winograd way */
+TEST(RuntimeCPU, Conv2DWinograd)
+{
+	const nnt_conv2d_case_t cases[] = {
+		{ 1, 8, 8, 4, { 0, 0, 0, 0 }, 8, 3, 3, 0, 0, 1, 1, L_ACT_NONE },
+		{ 2, 12, 16, 8, { 0, 0, 0, 0 }, 16, 3, 3, 1, 1, 1, 1, L_ACT_RELU },
+		/* odd H, W and C leave partial tiles on the bottom and right */
+		{ 1, 13, 11, 7, { 0, 0, 0, 0 }, 5, 3, 3, 1, 1, 1, 1, L_ACT_NONE },
+		{ 3, 9, 7, 3, { 0, 0, 0, 0 }, 9, 3, 3, 0, 0, 1, 1, L_ACT_LEAKY },
+		{ 1, 31, 29, 33, { 0, 0, 0, 0 }, 17, 3, 3, 1, 1, 1, 1, L_ACT_NONE },
+	};
+
+	/* a buffer set per thread, more threads than tiles leave some sets idle */
+	for(int threads: { 1, 3, 8 })
+	{
+		for(int i=0; i<ARRAY_SIZE(cases); i++)
+		{
+			TestConv2DCase(&cases[i], threads);
+		}
+	}
+}
+#endif
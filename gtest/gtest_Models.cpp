@@ -252,7 +252,7 @@ static void* load_ssd_input(nn_t* nn, const char* path, int id, size_t* sz)
 {
 	image_t* im;
 	image_t* resized_im;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 
 	EXPECT_EQ(context->nhwc.C, 3);
 
@@ -286,7 +286,7 @@ static void* load_yolov3_input(nn_t* nn, const char* path, int id, size_t* sz)
 {
 	image_t* im;
 	image_t* resized_im;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 
 	EXPECT_EQ(context->nhwc.C, 3);
 
@@ -319,7 +319,7 @@ static void* load_vehicle_attributes_recognition_barrier_0039_input(nn_t* nn, co
 {
 	image_t* im;
 	image_t* resized_im;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 
 	EXPECT_EQ(context->nhwc.C, 3);
 
@@ -347,7 +347,7 @@ static void* load_enet_input(nn_t* nn, const char* path, int id, size_t* sz)
 {
 	image_t* im;
 	image_t* resized_im;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 
 	EXPECT_EQ(context->nhwc.C, 3);
 
@@ -424,11 +424,11 @@ static void* load_ds_input(nn_t* nn, const char* path, int id, size_t* sz)
 				auto trun_sum = std::chrono::duration_cast<std::chrono::nanoseconds>(trun_e-trun_s).count();
 				EXPECT_EQ(r, 0);
 				if(0 == r) {
-					size_t bs = NHWC_SIZE(network->outputs[0]->layer->C->context->nhwc);
+					size_t bs = NHWC_SIZE(LAYER_CONTEXT(dsnn, network->outputs[0]->layer)->nhwc);
 					*sz = bs*sizeof(float);
 					outputs = (float*)malloc(*sz);
 					if(NULL != outputs) {
-						memcpy(outputs, network->outputs[0]->layer->C->context->out[0], *sz);
+						memcpy(outputs, LAYER_CONTEXT(dsnn, network->outputs[0]->layer)->out[0], *sz);
 					}
 					printf("Feature extraction cost total %.3fms\n",(float)trun_sum/1000000);
 				}
@@ -447,7 +447,7 @@ static void* load_maskrcnn_input(nn_t* nn, const char* path, int id, size_t* sz)
 {
 	image_t* im;
 	image_t* resized_im;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 	char* pos;
 	float* input;
 
@@ -484,7 +484,7 @@ static void* load_maskrcnn_input(nn_t* nn, const char* path, int id, size_t* sz)
 static void* load_facenet_input(nn_t* nn, const char* path, int id, size_t* sz)
 {
 	image_t* im;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 	float* input = NULL;
 	void *dllP=NULL,*dllR=NULL,*dllO=NULL;
 	const network_t* network;
@@ -569,7 +569,7 @@ static void* load_facenet_input(nn_t* nn, const char* path, int id, size_t* sz)
 	printf("loading %s for %s\n", g_InputImagePath, nn->network->name);
 
 	if(FDN!=NULL) {
-		context = (layer_context_t*)FDN->network->inputs[0]->layer->C->context;
+		context = (layer_context_t*)LAYER_CONTEXT(FDN, FDN->network->inputs[0]->layer);
 		im = image_open(g_InputImagePath);
 		assert(im != NULL);
 		resized_im = image_resize(im, context->nhwc.W, context->nhwc.H);
@@ -584,11 +584,11 @@ static void* load_facenet_input(nn_t* nn, const char* path, int id, size_t* sz)
 
 		int r = nn_predict(FDN);
 		EXPECT_EQ(0, r);
-		int num_det = FDN->network->outputs[0]->layer->C->context->nhwc.N;
+		int num_det = LAYER_CONTEXT(FDN, FDN->network->outputs[0]->layer)->nhwc.N;
 		float* output = (float*)FDN->network->outputs[0]->data;
 
 		NHWC_t inhwc = {1, im->h, im->w, im->c};
-		NHWC_t onhwc = nn->network->inputs[0]->layer->C->context->nhwc;
+		NHWC_t onhwc = LAYER_CONTEXT(nn, nn->network->inputs[0]->layer)->nhwc;
 		assert(3 == onhwc.C);
 
 		*sz = num_det*NHWC_BATCH_SIZE(onhwc)*sizeof(float);
@@ -650,7 +650,7 @@ static int ssd_compare(nn_t* nn, int id, float* output, size_t szo, float* glode
 	int r = 0;
 	int i;
 	float IoU;
-	int num_det = nn->network->outputs[0]->layer->C->context->nhwc.N;
+	int num_det = LAYER_CONTEXT(nn, nn->network->outputs[0]->layer)->nhwc.N;
 	image_t* im;
 
 	if(g_InputImagePath != NULL)
@@ -740,7 +740,7 @@ static int yolov3_compare(nn_t* nn, int id, float* output, size_t szo, float* gl
 {
 	int r = 0;
 	image_t* im;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 
 	int netw = context->nhwc.W;
 	int neth = context->nhwc.H;
@@ -750,7 +750,7 @@ static int yolov3_compare(nn_t* nn, int id, float* output, size_t szo, float* gl
 	{
 		im = image_open(g_InputImagePath);
 		assert(im != NULL);
-		int num_det = nn->network->outputs[0]->layer->C->context->nhwc.N;
+		int num_det = LAYER_CONTEXT(nn, nn->network->outputs[0]->layer)->nhwc.N;
 
 		for(int i=0; i<num_det; i++)
 		{
@@ -838,7 +838,7 @@ static int vehicle_attributes_recognition_barrier_0039_compare(nn_t* nn, int id,
 
 static int enet_compare(nn_t* nn, int id, float* output, size_t szo, float* gloden, size_t szg)
 {
-	NHWC_t* nhwc = &(nn->network->outputs[0]->layer->C->context->nhwc);
+	NHWC_t* nhwc = &(LAYER_CONTEXT(nn, nn->network->outputs[0]->layer)->nhwc);
 	const char* labels = "gtest/models/enet/cityscapes19.png";
 	image_t* color_im = image_open(labels);
 	if(color_im != NULL) {
@@ -888,7 +888,7 @@ static int kws_compare(nn_t* nn, int id, float * output, size_t szo, float* glod
 static int ds_compare(nn_t* nn, int id, float * output, size_t szo, float* gloden, size_t szg)
 {
 	static const char* alphabet[] = {" ", "a", "b", "c", "d", "e", "f", "g", "h", "i", "j", "k", "l", "m", "n", "o", "p", "q", "r", "s", "t", "u", "v", "w", "x", "y", "z", "'"};
-	int classes = NHWC_BATCH_SIZE(nn->network->outputs[0]->layer->C->context->nhwc);
+	int classes = NHWC_BATCH_SIZE(LAYER_CONTEXT(nn, nn->network->outputs[0]->layer)->nhwc);
 	int n = szo / classes;
 	printf("stt %d/%d:", n, classes);
 	for(int i=0; i<n; i++) {
@@ -913,11 +913,11 @@ static int ds_compare(nn_t* nn, int id, float * output, size_t szo, float* glode
 static int maskrcnn_compare(nn_t* nn, int id, float * output, size_t szo, float* gloden, size_t szg)
 {
 	image_t* im = NULL;
-	layer_context_t* context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 	char* pos;
 	float* mrcnn_detection = (float*)nn->network->outputs[1]->data;
 	float* mrcnn_mask = (float*)nn->network->outputs[3]->data;
-	int num_det = nn->network->outputs[1]->layer->C->context->nhwc.N;
+	int num_det = LAYER_CONTEXT(nn, nn->network->outputs[1]->layer)->nhwc.N;
 	static const char* class_names[] = {"BG", "person", "bicycle", "car", "motorcycle", "airplane",
 			"bus", "train", "truck", "boat", "traffic light",
 			"fire hydrant", "stop sign", "parking meter", "bench", "bird",
@@ -933,11 +933,11 @@ static int maskrcnn_compare(nn_t* nn, int id, float * output, size_t szo, float*
 			"keyboard", "cell phone", "microwave", "oven", "toaster",
 			"sink", "refrigerator", "book", "clock", "vase", "scissors",
 			"teddy bear", "hair drier", "toothbrush"};
-	int H = nn->network->inputs[0]->layer->C->context->nhwc.H;
-	int W = nn->network->inputs[0]->layer->C->context->nhwc.W;
-	int mH = nn->network->outputs[3]->layer->C->context->nhwc.H;
-	int mW = nn->network->outputs[3]->layer->C->context->nhwc.W;
-	int mC = nn->network->outputs[3]->layer->C->context->nhwc.C;
+	int H = LAYER_CONTEXT(nn, nn->network->inputs[0]->layer)->nhwc.H;
+	int W = LAYER_CONTEXT(nn, nn->network->inputs[0]->layer)->nhwc.W;
+	int mH = LAYER_CONTEXT(nn, nn->network->outputs[3]->layer)->nhwc.H;
+	int mW = LAYER_CONTEXT(nn, nn->network->outputs[3]->layer)->nhwc.W;
+	int mC = LAYER_CONTEXT(nn, nn->network->outputs[3]->layer)->nhwc.C;
 	assert(mC == ARRAY_SIZE(class_names));
 	pos = strstr((char*)g_InputImagePath, ".raw");
 	if(NULL != pos) {
@@ -1038,7 +1038,7 @@ static float euclidean_distances(float *a, float *b, int size) {
 }
 static int facenet_compare(nn_t* nn, int id, float * output, size_t szo, float* gloden, size_t szg)
 {
-	int features = NHWC_BATCH_SIZE(nn->network->outputs[0]->layer->C->context->nhwc);
+	int features = NHWC_BATCH_SIZE(LAYER_CONTEXT(nn, nn->network->outputs[0]->layer)->nhwc);
 	int n = szo / features;
 	const float threshold = 1.05;
 
@@ -1077,6 +1077,11 @@ void ModelTestMain(runtime_type_t runtime,
 	auto tcreate_s = std::chrono::high_resolution_clock::now();
 	nn_t* nn = nn_create(network, runtime);
 	ASSERT_TRUE(nn != NULL);
+	EXPECT_EQ(0, nn_set_num_threads(nn, g_NumThreads));
+	if(NULL != g_ProfilePath)
+	{
+		EXPECT_EQ(0, nn_set_profile(nn, TRUE));
+	}
 	auto tcreate_e = std::chrono::high_resolution_clock::now();
 	double tcreate = std::chrono::duration_cast<std::chrono::nanoseconds>(tcreate_e-tcreate_s).count();
 
@@ -1088,10 +1093,10 @@ void ModelTestMain(runtime_type_t runtime,
 		return;
 	}
 	/* This demo code is really a mess, didn't care about memory leak issue, just for test */
-	H = inputs[0]->layer->C->context->nhwc.H;
-	W = inputs[0]->layer->C->context->nhwc.W;
-	C = inputs[0]->layer->C->context->nhwc.C;
-	classes = NHWC_BATCH_SIZE(outputs[0]->layer->C->context->nhwc);
+	H = LAYER_CONTEXT(nn, inputs[0]->layer)->nhwc.H;
+	W = LAYER_CONTEXT(nn, inputs[0]->layer)->nhwc.W;
+	C = LAYER_CONTEXT(nn, inputs[0]->layer)->nhwc.C;
+	classes = NHWC_BATCH_SIZE(LAYER_CONTEXT(nn, outputs[0]->layer)->nhwc);
 	if(NULL == args)
 	{
 		x_test = (float*)nnt_load(input, &x_test_sz);
@@ -1283,6 +1288,7 @@ void ModelTestMain(runtime_type_t runtime,
 		printf("LWNN TOP1 is %f\n", (float)top1/B);
 		EXPECT_GT(top1, B*mintop1);
 	}
+	nnt_dump_profile(nn);
 	nn_destory(nn);
 
 	if(NULL != x_test)
@@ -17,7 +17,7 @@ int main(int argc, char **argv)
 	::testing::InitGoogleTest(&argc, argv);
 
 	opterr = 0;
-	while((ch = getopt(argc, argv, "di:m:")) != -1)
+	while((ch = getopt(argc, argv, "di:m:p:t:")) != -1)
 	{
 		switch(ch)
 		{
@@ -31,6 +31,12 @@ int main(int argc, char **argv)
 			case 'm':
 				g_CaseNumber = atoi(optarg);
 				break;
+			case 'p':
+				g_ProfilePath = optarg;
+				break;
+			case 't':
+				g_NumThreads = atoi(optarg);
+				break;
 			default:
 				break;
 		}
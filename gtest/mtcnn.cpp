@@ -55,9 +55,9 @@ int mtcnn_predict(nn_t* PNet, nn_t* RNet, nn_t* ONet, image_t* im, float** p_poi
 	nn_input_t* PNet_In = (nn_input_t*)PNet->network->inputs[0];
 
 	const layer_t* RPL = &l_layer_PNet_PROPOSAL;
-	RPL->C->context = new layer_context_t;
-	if(NULL != RPL->C->context) {
-		r = layer_get_NHWC(RPL, &(RPL->C->context->nhwc));
+	layer_context_t* RPL_context = new layer_context_t;
+	if(NULL != RPL_context) {
+		r = layer_get_NHWC(RPL, &(RPL_context->nhwc));
 	} else {
 		r = NN_E_NO_MEMORY;
 	}
@@ -101,26 +101,26 @@ int mtcnn_predict(nn_t* PNet, nn_t* RNet, nn_t* ONet, image_t* im, float** p_poi
 				}
 			}
 			PNet_In->data = img_y;
-			PNet_In->layer->C->context->nhwc.H = ws;
-			PNet_In->layer->C->context->nhwc.W = hs;
+			LAYER_CONTEXT(PNet, PNet_In->layer)->nhwc.H = ws;
+			LAYER_CONTEXT(PNet, PNet_In->layer)->nhwc.W = hs;
 			r = nn_predict(PNet);
 			if(0 == r) {
-				float* scores = (float*)PNet->network->outputs[0]->layer->C->context->out[0];
-				float* locations = (float*)PNet->network->outputs[1]->layer->C->context->out[0];
-				int W = PNet->network->outputs[0]->layer->C->context->nhwc.H;
-				int H = PNet->network->outputs[0]->layer->C->context->nhwc.W;
+				float* scores = (float*)LAYER_CONTEXT(PNet, PNet->network->outputs[0]->layer)->out[0];
+				float* locations = (float*)LAYER_CONTEXT(PNet, PNet->network->outputs[1]->layer)->out[0];
+				int W = LAYER_CONTEXT(PNet, PNet->network->outputs[0]->layer)->nhwc.H;
+				int H = LAYER_CONTEXT(PNet, PNet->network->outputs[0]->layer)->nhwc.W;
 				float* anchors = generate_anchors(scores, H, W, scale, im->h, im->w);
 				const float var_data[4] = { (float)im->w, (float)im->h, (float)im->w, (float)im->h };
 
 				if(anchors != NULL) {
 					NNLOG(NN_DEBUG, ("  prob: %dx%dx%dx%d, bbox: %dx%dx%dx%d\n",
-											L_SHAPES(PNet->network->outputs[0]->layer),
-											L_SHAPES(PNet->network->outputs[1]->layer)));
-					layer_get_NHWC(RPL, &RPL->C->context->nhwc);
+											L_SHAPES(PNet, PNet->network->outputs[0]->layer),
+											L_SHAPES(PNet, PNet->network->outputs[1]->layer)));
+					layer_get_NHWC(RPL, &RPL_context->nhwc);
 					r = ssd::detection_output_forward(locations, scores, anchors,
 							(const float*)&var_data, top_data, H*W, 1, 0.5, threshold[0], 2, true,
 							0, PNET_TOPK, PNET_TOPK, ssd::PriorBoxParameter_CodeType_SQUARE_SIZE,
-							false, 1.0, RPL);
+							false, 1.0, RPL, RPL_context);
 					delete [] anchors;
 				} else {
 					r = NN_E_NO_MEMORY;
@@ -135,7 +135,7 @@ int mtcnn_predict(nn_t* PNet, nn_t* RNet, nn_t* ONet, image_t* im, float** p_poi
 	}
 
 	if(top_data) delete [] top_data;
-	if(RPL->C->context) delete RPL->C->context;
+	if(RPL_context) delete RPL_context;
 
 	*p_number = number;
 	*p_points = points;
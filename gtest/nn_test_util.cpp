@@ -10,7 +10,41 @@
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 int g_CaseNumber = -1;
+int g_NumThreads = 1;
+const char* g_ProfilePath = NULL;
 /* ============================ [ LOCALS    ] ====================================================== */
+/* run again with the buffers of the caller bound, the output must be the same as the one
+ * already in the output buffer of the network, which must be left untouched */
+static void nnt_bind_run(const network_t* network, runtime_type_t runtime, size_t sz_in, size_t sz_out)
+{
+	const nn_input_t* const * inputs = network->inputs;
+	const nn_output_t* const * outputs = network->outputs;
+	std::vector<uint8_t> in((uint8_t*)inputs[0]->data, (uint8_t*)inputs[0]->data+sz_in);
+	std::vector<uint8_t> out(sz_out, 0);
+	std::vector<uint8_t> golden((uint8_t*)outputs[0]->data, (uint8_t*)outputs[0]->data+sz_out);
+
+	nn_t* nn = nn_create(network, runtime);
+	ASSERT_TRUE(nn != NULL);
+	EXPECT_EQ(0, nn_set_num_threads(nn, g_NumThreads));
+	EXPECT_EQ(0, nn_bind_input(nn, inputs[0]->layer, in.data()));
+	EXPECT_EQ(0, nn_bind_output(nn, outputs[0]->layer, out.data()));
+	EXPECT_EQ(NN_E_INVALID_LAYER, nn_bind_output(nn, inputs[0]->layer, out.data()));
+	memset(inputs[0]->data, 0, sz_in);
+	memset(outputs[0]->data, 0, sz_out);
+
+	EXPECT_EQ(0, nn_predict(nn));
+	EXPECT_EQ(0, memcmp(golden.data(), out.data(), sz_out));
+	EXPECT_EQ(std::vector<uint8_t>(sz_out, 0), std::vector<uint8_t>((uint8_t*)outputs[0]->data, (uint8_t*)outputs[0]->data+sz_out));
+
+	/* back to the buffers of the network */
+	EXPECT_EQ(0, nn_bind_input(nn, inputs[0]->layer, NULL));
+	EXPECT_EQ(0, nn_bind_output(nn, outputs[0]->layer, NULL));
+	memcpy(inputs[0]->data, in.data(), sz_in);
+	EXPECT_EQ(0, nn_predict(nn));
+	EXPECT_EQ(0, memcmp(golden.data(), outputs[0]->data, sz_out));
+
+	nn_destory(nn);
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int nnt_run(const network_t* network,
 			runtime_type_t runtime)
@@ -21,12 +55,18 @@ int nnt_run(const network_t* network,
 
 	if(nn != NULL)
 	{
+		EXPECT_EQ(0, nn_set_num_threads(nn, g_NumThreads));
+		if(NULL != g_ProfilePath)
+		{
+			EXPECT_EQ(0, nn_set_profile(nn, TRUE));
+		}
 		auto trun_s = std::chrono::high_resolution_clock::now();
 		r = nn_predict(nn);
 		auto trun_e = std::chrono::high_resolution_clock::now();
 		auto trun_sum = std::chrono::duration_cast<std::chrono::nanoseconds>(trun_e-trun_s).count();
 		printf(" cost %.3fms", (float)trun_sum/1000000);
 		EXPECT_EQ(0, r);
+		nnt_dump_profile(nn);
 		nn_destory(nn);
 	}
 	else
@@ -37,11 +77,39 @@ int nnt_run(const network_t* network,
 	return r;
 }
 
-void nnt_fill_inputs_with_random(nn_input_t** inputs, float lo, float hi)
+void nnt_dump_profile(const nn_t* nn)
+{
+	const nn_profile_t* profile = nn_get_profile(nn);
+	char path[256];
+	uint64_t sum = 0;
+
+	if(NULL == profile)
+	{
+		return;
+	}
+
+	ASSERT_EQ(nn->layer_number, profile->layer_number);
+	ASSERT_GT(profile->runs, 0);
+	for(size_t i=0; i<profile->layer_number; i++)
+	{
+		EXPECT_EQ(nn->network->layers[i], profile->layers[i].layer);
+		EXPECT_LE(profile->layers[i].start+profile->layers[i].duration, profile->duration);
+		sum += profile->layers[i].total;
+	}
+	if(g_NumThreads <= 1)
+	{	/* the layers run one after another */
+		EXPECT_LE(sum, profile->total);
+	}
+
+	snprintf(path, sizeof(path), "%s/%s.json", g_ProfilePath, nn->network->name);
+	EXPECT_EQ(0, nn_dump_profile(nn, path));
+}
+
+void nnt_fill_inputs_with_random(const nn_t* nn, nn_input_t** inputs, float lo, float hi)
 {
 	for(nn_input_t** in=inputs; (*in) != NULL; in++)
 	{
-		size_t sz = layer_get_size((*in)->layer);
+		size_t sz = layer_get_context_size(nn, (*in)->layer);
 		if(L_DT_FLOAT == (*in)->layer->dtype)
 		{
 			float* data = (float*) (*in)->data;
@@ -217,6 +285,21 @@ void nnt_siso_network_test(runtime_type_t runtime,
 
 	int r = nnt_run(network, runtime);
 
+	if(0 == r)
+	{
+		size_t sz_type = sizeof(float);
+		if(in8 != NULL)
+		{
+			sz_type = sizeof(int8_t);
+		}
+		else if(in16 != NULL)
+		{
+			sz_type = sizeof(int16_t);
+		}
+		nnt_bind_run(network, runtime, layer_get_size(inputs[0]->layer)*sz_type,
+				layer_get_size(outputs[0]->layer)*sz_type);
+	}
+
 	if(0 == r)
 	{
 		size_t sz_out;
@@ -330,18 +413,19 @@ const network_t* nnt_load_network(const char* netpath, void** dll)
 			snprintf(symbol, sizeof(symbol), "%s", netpath);
 			dname = dirname(symbol);
 			#ifdef _WIN32
-			snprintf(path, sizeof(path), "%s/%s/%s.bin", cwd, &dname[9], bname);
+			snprintf(path, sizeof(path), "%s/%s/%s", cwd, &dname[9], bname);
 			#else
-			snprintf(path, sizeof(path), "%s/%s/%s.bin", cwd, &dname[12], &bname[3]);
+			snprintf(path, sizeof(path), "%s/%s/%s", cwd, &dname[12], &bname[3]);
 			#endif
-			FILE* fb = fopen(path, "rb");
-			if(fb != NULL)
+			char* ext = &path[strlen(path)];
+			snprintf(ext, sizeof(path)-(ext-path), ".bundle");
+			FILE* fb;
+			if(0 == access(path, R_OK))
 			{
-				NNLOG(NN_DEBUG, ("load weights: %s\n", path));
-				r = nn_load(network, nn_blob_loader, (void*) fb);
-				if(r != 0)
+				NNLOG(NN_DEBUG, ("map weights: %s\n", path));
+				/* never unmapped, the blobs of the network point into it until the process ends */
+				if(NULL == nn_map(network, path))
 				{
-					fclose(fb);
 					network=NULL;
 					dlclose(*dll);
 					*dll = NULL;
@@ -349,10 +433,27 @@ const network_t* nnt_load_network(const char* netpath, void** dll)
 			}
 			else
 			{
-				printf("failed to load weights %s\n", path);
-				network=NULL;
-				dlclose(*dll);
-				*dll = NULL;
+				snprintf(ext, sizeof(path)-(ext-path), ".bin");
+				fb = fopen(path, "rb");
+				if(fb != NULL)
+				{
+					NNLOG(NN_DEBUG, ("load weights: %s\n", path));
+					r = nn_load(network, nn_blob_loader, (void*) fb);
+					if(r != 0)
+					{
+						network=NULL;
+						dlclose(*dll);
+						*dll = NULL;
+					}
+					fclose(fb);
+				}
+				else
+				{
+					printf("failed to load weights %s\n", path);
+					network=NULL;
+					dlclose(*dll);
+					*dll = NULL;
+				}
 			}
 		}
 #endif
@@ -197,6 +197,8 @@ typedef struct {
 } nnt_case_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 extern int g_CaseNumber; /* default -1 */
+extern int g_NumThreads; /* default 1 */
+extern const char* g_ProfilePath; /* default NULL, the directory to dump the profile */
 extern const char* g_InputImagePath;
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -205,10 +207,12 @@ int nnt_run(const network_t* network,
 			runtime_type_t runtime,
 			nn_input_t** inputs,
 			nn_output_t** outputs);
+/* checks the profile and dumps it to g_ProfilePath if profiling is on */
+void nnt_dump_profile(const nn_t* nn);
 /* 0 means close enough, else return numbers which are not equal */
 int nnt_is_equal(const float* A, const float* B, size_t sz, const float max_diff);
 
-void nnt_fill_inputs_with_random(nn_input_t** inputs, float lo, float hi);
+void nnt_fill_inputs_with_random(const nn_t* nn, nn_input_t** inputs, float lo, float hi);
 void* nnt_load(const char* inraw, size_t *sz);
 
 int8_t* nnt_quantize8(float* in, size_t sz, int32_t Q, int32_t Z=0, float scale=1.0);
@@ -235,4 +239,9 @@ void NNTModelTestGeneral(runtime_type_t runtime,
 		float not_found_okay);
 const network_t* nnt_load_network(const char* path, void** dll);
 extern "C" void rte_save_raw(const char* name, void* data, size_t sz);
+/* the plain float convolution of the CPU runtime, the reference of its faster paths */
+extern "C" void convolve_HWC_ref_nonsquare(const float* Im_in, const int dim_im_in_x, const int dim_im_in_y,
+		const int ch_im_in, const float* wt, const int ch_im_out, const int dim_kernel_x, const int dim_kernel_y,
+		const int padding_x, const int padding_y, const int stride_x, const int stride_y, const float* bias,
+		float* Im_out, const int dim_im_out_x, const int dim_im_out_y, layer_activation_type_t act);
 #endif /* GTEST_NN_TEST_UTIL_H_ */
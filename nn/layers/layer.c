@@ -197,14 +197,14 @@ size_t layer_get_size(const layer_t* layer)
 	int dim = 0;
 	size_t sz = 1;
 
-	if(NULL != layer->C->context)
-	{
-		dim = 4;
-		sz = NHWC_SIZE(layer->C->context->nhwc);
-	}
-	else if(NULL != layer->dims)
+	if(NULL != layer->dims)
 	{
 		while(layer->dims[dim] != 0) {
+			if(layer->dims[dim] < 0) {
+				NNLOG(NN_ERROR, ("%s layer size is dynamic, it is known by the nn\n", layer->name));
+				dim = 0;
+				break;
+			}
 			sz *= layer->dims[dim];
 			dim ++;
 		};
@@ -222,6 +222,29 @@ size_t layer_get_size(const layer_t* layer)
 	return sz;
 }
 
+size_t layer_get_context_size(const nn_t* nn, const layer_t* layer)
+{
+	size_t sz;
+	int id = nn_get_layer_id(nn, layer);
+	const NHWC_t* nhwc = NULL;
+
+	if((id >= 0) && (NULL != nn->contexts[id]))
+	{
+		nhwc = &nn->contexts[id]->nhwc;
+	}
+
+	if((NULL != nhwc) && (nhwc->N > 0) && (nhwc->H > 0) && (nhwc->W > 0) && (nhwc->C > 0))
+	{
+		sz = NHWC_SIZE(*nhwc);
+	}
+	else
+	{	/* an input with a dynamic shape only knows it once its data is there */
+		sz = layer_get_size(layer);
+	}
+
+	return sz;
+}
+
 #ifndef DISABLE_DYNAMIC_SHAPE
 int layer_get_dynamic_axis(const layer_t* layer)
 {
@@ -246,13 +269,14 @@ int layer_get_dynamic_axis(const layer_t* layer)
 	return axis;
 }
 
-void layer_set_dynamic_shape(const layer_t* layer, int axis, size_t total)
+void layer_set_dynamic_shape(const nn_t* nn, const layer_t* layer, int axis, size_t total)
 {
 	size_t bs;
-	int* dims = (int*)&(layer->C->context->nhwc);
+	layer_context_t* context = LAYER_CONTEXT(nn, layer);
+	int* dims = (int*)&(context->nhwc);
 	dims[axis] = 1;
 
-	bs = NHWC_SIZE(layer->C->context->nhwc);
+	bs = NHWC_SIZE(context->nhwc);
 	assert(bs > 0);
 	assert((total%bs) == 0);
 	dims[axis] = total/bs;
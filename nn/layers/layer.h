@@ -17,19 +17,20 @@ extern "C" {
 
 #ifndef L_BLOB_NOT_BUILTIN
 #define L_BLOB_DECLARE(type, name) static const type name[] = l_blob_def_##name
+#define L_BLOB_CONST const
 #else
 #define L_BLOB_DECLARE(type, name) static type name[l_blob_def_##name]
+/* nn_map points the blobs into the mapped weight bundle */
+#define L_BLOB_CONST
 #endif
 
 #define L_LAYER_I(name, dtype, op)						\
-	static layer_context_container_t l_context_##name;	\
 	static LCONST int l_dims_##name[] = { name##_DIMS, 0 };	\
 	static LCONST layer_t l_layer_##name = {			\
 		/* name */ #name,								\
 		/* inputs */ NULL,								\
 		/* blobs */ l_blobs_##name,						\
 		/* dims */ l_dims_##name,						\
-		/* context */ &l_context_##name,				\
 		/* op */ L_OP_##op,						\
 		/* dtype */ dtype								\
 	}
@@ -39,7 +40,6 @@ extern "C" {
 
 
 #define L_LAYER_SI(name, input, op)						\
-	static layer_context_container_t l_context_##name;	\
 	static LCONST layer_t* l_inputs_##name[] = {		\
 			L_REF(input), NULL };						\
 	static LCONST int l_dims_##name[] = { name##_DIMS, 0 };	\
@@ -48,20 +48,17 @@ extern "C" {
 		/* inputs */ l_inputs_##name,					\
 		/* blobs */ l_blobs_##name,						\
 		/* dims */ l_dims_##name,						\
-		/* context */ &l_context_##name,				\
 		/* op */ L_OP_##op,								\
 		/* dtype */ L_DT_AUTO							\
 	}
 
 #define L_LAYER_MI(name, op)							\
-	static layer_context_container_t l_context_##name;	\
 	static LCONST int l_dims_##name[] = { name##_DIMS, 0 };	\
 	static LCONST layer_t l_layer_##name = {			\
 		/* name */ #name,								\
 		/* inputs */ l_inputs_##name,					\
 		/* blobs */ l_blobs_##name,						\
 		/* dims */ l_dims_##name,						\
-		/* context */ &l_context_##name,				\
 		/* op */ L_OP_##op,								\
 		/* dtype */ L_DT_AUTO							\
 	}
@@ -129,14 +126,12 @@ extern "C" {
 	L_LAYER_MI(name, PYRAMID_ROI_ALIGN)
 
 #define L_CONST(name)									\
-	static layer_context_container_t l_context_##name;	\
 	static LCONST int l_dims_##name[] = { name##_DIMS, 0 };	\
 	static LCONST layer_t l_layer_##name = {			\
 		/* name */ #name,								\
 		/* inputs */ NULL,								\
 		/* blobs */ l_blobs_##name,						\
 		/* dims */ l_dims_##name,						\
-		/* context */ &l_context_##name,				\
 		/* op */ L_OP_CONST,							\
 		/* dtype */ L_DT_AUTO							\
 	}
@@ -182,7 +177,7 @@ extern "C" {
 
 #define NHWC_LIST(nhwc) (nhwc).N, (nhwc).H, (nhwc).W, (nhwc).C
 
-#define L_SHAPES(layer) NHWC_LIST(layer->C->context->nhwc)
+#define L_SHAPES(nn, layer) NHWC_LIST(LAYER_CONTEXT(nn, layer)->nhwc)
 
 #define UNSUPPORTED_LAYER_OPS(runtime, op)									\
 int layer_##runtime##_##op##_init(const nn_t* nn, const layer_t* layer)		\
@@ -290,18 +285,12 @@ typedef struct layer_context
 	LAYER_CONTEXT_MEMBER;
 } layer_context_t;
 
-typedef struct layer_context_container
-{
-	layer_context_t* context;
-} layer_context_container_t;
-
 typedef struct layer
 {
 	const char* name;
 	LCONST struct layer** inputs;
 	const layer_blob_t** blobs;
 	const layer_dimension_t dims;
-	layer_context_container_t* C;
 	layer_operation_t op;
 	layer_data_type_t dtype;
 } layer_t;
@@ -323,9 +312,12 @@ typedef struct
 int layer_get_blob_NHWC(const layer_blob_t* blob, NHWC_t* nhwc);
 int layer_get_NHWC(const layer_t* layer, NHWC_t* nhwc);
 size_t layer_get_size(const layer_t* layer);
+/* the size in this nn, which knows the dynamic dimension once the layer is created,
+ * 0 while it is not known yet (an input with a dynamic shape before any data) */
+size_t layer_get_context_size(const nn_t* nn, const layer_t* layer);
 #ifndef DISABLE_DYNAMIC_SHAPE
 int layer_get_dynamic_axis(const layer_t* layer);
-void layer_set_dynamic_shape(const layer_t* layer, int axis, size_t total);
+void layer_set_dynamic_shape(const nn_t* nn, const layer_t* layer, int axis, size_t total);
 #endif
 #ifdef __cplusplus
 }
@@ -4,13 +4,751 @@
  */
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include "nn.h"
+#include "thread_pool.h"
+#include "profile.h"
+#include "algorithm.h"
+#ifdef L_BLOB_NOT_BUILTIN
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#endif
 /* ============================ [ MACROS    ] ====================================================== */
+#define NN_LAYER_HASH(layer) ((((size_t)(layer))>>3)*2654435761u)
 
+#ifdef L_BLOB_NOT_BUILTIN
+#define NN_BUNDLE_MAGIC "LWNNBLOB"
+#define NN_BUNDLE_VERSION 1
+#define NN_BUNDLE_MAX_DIMS 7
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
+#ifdef L_BLOB_NOT_BUILTIN
+/* the weight bundle, all little endian:
+ *   header, then one entry per blob in the order of the network layers and
+ *   their blobs, then the data of each blob at an offset aligned to header.align */
+typedef struct {
+	char magic[8];
+	uint32_t version;
+	uint32_t number;
+	uint32_t align;
+	uint32_t reserved;
+} nn_bundle_header_t;
+
+typedef struct {
+	uint64_t offset;
+	uint64_t size;
+	int32_t dtype;
+	int32_t dims[NN_BUNDLE_MAX_DIMS]; /* 0 terminated if less than NN_BUNDLE_MAX_DIMS */
+} nn_bundle_entry_t;
+
+struct nn_mapping {
+	void* addr;
+	size_t size;
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE map;
+#endif
+};
+#endif
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 int nn_log_level = NN_INFO;
 /* ============================ [ LOCALS    ] ====================================================== */
+#if (!defined(DISABLE_NN_FUSE_PAD) || !defined(DISABLE_NN_ELIMINATE_TRANSPOSE)) && \
+	!defined(DISABLE_RUNTIME_CPU) && !defined(DISABLE_RUNTIME_CPU_FLOAT)
+/* the only layer that reads the output of layer id, as its first input, NULL if none.
+ * A pass may move the last_use of a layer past its reader, that one then doesn't
+ * take it as input and isn't returned */
+static const layer_t* nn_get_only_reader(const nn_t* nn, int id)
+{
+	const layer_t* reader = NULL;
+
+	if(1 == nn->readers[id])
+	{
+		reader = nn->network->layers[nn->last_use[id]];
+		if((NULL == reader->inputs) || (reader->inputs[0] != nn->network->layers[id]))
+		{
+			reader = NULL;
+		}
+	}
+
+	return reader;
+}
+#endif
+
+#ifndef DISABLE_NN_FOLD_BN
+/* the channel number of the output of a layer a BATCHNORM can be folded into, 0 if none */
+static int nn_get_foldable_channels(const layer_t* layer)
+{
+	int C = 0;
+
+	switch(layer->op)
+	{
+		case L_OP_CONV2D:
+			if(L_ACT_NONE == RTE_FETCH_INT32(layer->blobs[2]->blob, 6))
+			{
+				C = layer->blobs[0]->dims[0];
+			}
+			break;
+		case L_OP_DWCONV2D:
+			C = layer->blobs[0]->dims[3];
+			break;
+		case L_OP_DENSE:
+			C = layer->blobs[0]->dims[0];
+			break;
+		default:
+			break;
+	}
+
+	return C;
+}
+
+/* a BATCHNORM that is the only reader of a CONV2D, DWCONV2D or DENSE without
+ * activation becomes part of the weights and bias of that layer, it then only
+ * passes the output of that layer along, which has to live as long as its own */
+static void nn_fold_batchnorm(nn_t* nn)
+{
+	size_t i;
+	int id;
+	const layer_t* layer;
+	const layer_t* input;
+
+	for(i=0; i<nn->layer_number; i++)
+	{
+		nn->folds[i] = -1;
+	}
+
+#if !defined(DISABLE_RUNTIME_CPU_FLOAT) || \
+	!defined(DISABLE_RUNTIME_CL)
+	if(NETWORK_TYPE_FLOAT != nn->network->type)
+	{
+		return;
+	}
+
+	for(i=0; i<nn->layer_number; i++)
+	{
+		layer = nn->network->layers[i];
+		if(L_OP_BATCHNORM != layer->op)
+		{
+			continue;
+		}
+
+		input = layer->inputs[0];
+		id = nn_get_layer_id(nn, input);
+		if((nn_get_foldable_channels(input) == layer->blobs[0]->dims[0]) &&
+			(1 == nn->readers[id]))
+		{
+			nn->folds[id] = i;
+			nn->folds[i] = id;
+			nn->last_use[id] = nn->last_use[i];
+			NNLOG(NN_DEBUG, ("fold %s into %s\n", layer->name, input->name));
+		}
+	}
+#endif
+}
+#endif
+
+#ifndef DISABLE_NN_FUSE_PAD
+/* TRUE if the layer can take the padding of the PAD in front of it as its own: the
+ * outside of the input is zero for the convolutions and the average, for the max it
+ * is the value of the PAD if the pool has no padding of its own */
+static int nn_is_pad_fusable(const layer_t* layer, float value)
+{
+	int r = FALSE;
+	const int* ints;
+
+	switch(layer->op)
+	{
+		case L_OP_CONV2D:
+		case L_OP_DWCONV2D:
+		case L_OP_AVGPOOL:
+			r = (0.0f == value);
+			break;
+		case L_OP_MAXPOOL:
+			ints = (const int*)layer->blobs[0]->blob;
+			r = (0 == ints[2]) && (0 == ints[3]) && (0 == ints[6]);
+			break;
+		default:
+			break;
+	}
+
+	return r;
+}
+
+/* a PAD on H and W that is the only input of a float CONV2D, DWCONV2D, MAXPOOL or
+ * AVGPOOL becomes part of the padding of that layer, which then reads the input of
+ * the PAD, so that input has to live until that layer */
+static void nn_fuse_pad(nn_t* nn)
+{
+	size_t i;
+	int id;
+	const layer_t* layer;
+	const layer_t* reader;
+	const int* ints;
+	float value;
+
+	for(i=0; i<nn->layer_number; i++)
+	{
+		nn->pads[i] = -1;
+	}
+
+#if !defined(DISABLE_RUNTIME_CPU) && !defined(DISABLE_RUNTIME_CPU_FLOAT)
+	if((NETWORK_TYPE_FLOAT != nn->network->type) || (RUNTIME_CPU != nn->runtime_type))
+	{
+		return;
+	}
+
+	for(i=0; i<nn->layer_number; i++)
+	{
+		layer = nn->network->layers[i];
+		if(L_OP_PAD != layer->op)
+		{
+			continue;
+		}
+
+		reader = nn_get_only_reader(nn, i);
+
+		ints = (const int*)layer->blobs[0]->blob;
+		value = RTE_FETCH_FLOAT(layer->blobs[1]->blob, 0);
+		if((NULL != reader) && (NULL == reader->inputs[1]) && nn_is_pad_fusable(reader, value) &&
+			(8 == layer->blobs[0]->dims[0]) && (0 == ints[0]) && (0 == ints[3]) &&
+			(0 == ints[4]) && (0 == ints[7])
+#ifndef DISABLE_DYNAMIC_SHAPE
+			&& (layer_get_dynamic_axis(layer) < 0) && (layer_get_dynamic_axis(reader) < 0)
+#endif
+			)
+		{
+			id = nn_get_layer_id(nn, reader);
+			nn->pads[id] = i;
+			nn->pads[i] = id;
+			id = nn_get_layer_id(nn, layer->inputs[0]);
+			nn->last_use[id] = NN_MAX(nn->last_use[id], nn->last_use[i]);
+			NNLOG(NN_DEBUG, ("fuse %s into %s\n", layer->name, reader->name));
+		}
+	}
+#endif
+}
+#endif
+
+#ifndef DISABLE_NN_ELIMINATE_TRANSPOSE
+#if !defined(DISABLE_RUNTIME_CPU) && !defined(DISABLE_RUNTIME_CPU_FLOAT)
+/* the output is the same function of the input whatever the layout is */
+static int nn_is_layout_agnostic(const layer_t* layer)
+{
+	int r = FALSE;
+	const layer_t* const* inputs;
+	NHWC_t nhwc;
+	NHWC_t inhwc;
+
+	switch(layer->op)
+	{
+		case L_OP_RELU:
+		case L_OP_CLIP:
+		case L_OP_ADD:
+		case L_OP_MUL:
+		case L_OP_MAXIMUM:
+		case L_OP_MINIMUM:
+			r = (0 == layer_get_NHWC(layer, &nhwc));
+			for(inputs=layer->inputs; r && (NULL != (*inputs)); inputs++)
+			{	/* a broadcast depends on where the channels are */
+				r = (0 == layer_get_NHWC(*inputs, &inhwc)) && (NHWC_SIZE(inhwc) == NHWC_SIZE(nhwc));
+			}
+			break;
+		default:
+			break;
+	}
+
+	return r;
+}
+
+/* TRUE if layer is a TRANSPOSE of the order perm whose input has the shape nhwc */
+static int nn_is_transpose_of(const layer_t* layer, int perm, const NHWC_t* nhwc)
+{
+	int r = FALSE;
+	NHWC_t inhwc;
+
+	if((L_OP_TRANSPOSE == layer->op) && (perm == RTE_FETCH_INT32(layer->blobs[0]->blob, 0)) &&
+		(0 == layer_get_NHWC(layer->inputs[0], &inhwc)) && (0 == memcmp(&inhwc, nhwc, sizeof(NHWC_t)))
+#ifndef DISABLE_DYNAMIC_SHAPE
+		&& (layer_get_dynamic_axis(layer) < 0)
+#endif
+		)
+	{
+		r = TRUE;
+	}
+
+	return r;
+}
+
+/* grow the group of the TRANSPOSE i: the layout agnostic layers it feeds, the other
+ * TRANSPOSEs of the same order that feed them and the inverse TRANSPOSEs they feed.
+ * If nothing else reads or feeds the group, the inverse ones undo the first ones
+ * and both can be skipped, marks[id] is then 1 for the TRANSPOSEs */
+static int nn_group_transpose(nn_t* nn, size_t i, int* marks)
+{
+	const layer_t* const* layers = nn->network->layers;
+	const layer_t* const* inputs;
+	const layer_t* layer = layers[i];
+	int perm = RTE_FETCH_INT32(layer->blobs[0]->blob, 0);
+	int inverse = perm ^ ALG_TRANSPOSE_FROM_NCHW_TO_NHWC;
+	int r;
+	int nexit = 0;
+	int changed = TRUE;
+	size_t j;
+	NHWC_t nhwc;
+
+	memset(marks, 0, nn->layer_number*sizeof(int));
+	r = (0 == layer_get_NHWC(layer->inputs[0], &nhwc)) && nn_is_transpose_of(layer, perm, &nhwc);
+	marks[i] = 1;
+
+	/* 1: the TRANSPOSEs in and out, 2: the layers in between */
+	while(r && changed)
+	{
+		changed = FALSE;
+		for(j=0; r && (j<nn->layer_number); j++)
+		{
+			if(0 != marks[j])
+			{
+				continue;
+			}
+			for(inputs=layers[j]->inputs; (NULL != inputs) && (NULL != (*inputs)); inputs++)
+			{
+				if((0 == marks[nn_get_layer_id(nn, *inputs)]) ||
+					((L_OP_TRANSPOSE == (*inputs)->op) && (perm != RTE_FETCH_INT32((*inputs)->blobs[0]->blob, 0))))
+				{	/* out of the group, or the output of the group */
+					continue;
+				}
+				if(nn_is_transpose_of(layers[j], inverse, &nhwc))
+				{
+					marks[j] = 1;
+					nexit ++;
+				}
+				else
+				{
+					marks[j] = nn_is_layout_agnostic(layers[j]) ? 2 : -1;
+				}
+				break;
+			}
+			if(marks[j] < 0)
+			{
+				r = FALSE;
+			}
+			else if(marks[j] > 0)
+			{
+				changed = TRUE;
+			}
+		}
+
+		for(j=0; r && (j<nn->layer_number); j++)
+		{	/* all the inputs of the layers in between come in through the group */
+			for(inputs=layers[j]->inputs; (2 == marks[j]) && (NULL != (*inputs)); inputs++)
+			{
+				if(0 != marks[nn_get_layer_id(nn, *inputs)])
+				{
+					continue;
+				}
+				if(nn_is_transpose_of(*inputs, perm, &nhwc))
+				{
+					marks[nn_get_layer_id(nn, *inputs)] = 1;
+					changed = TRUE;
+				}
+				else
+				{
+					r = FALSE;
+				}
+			}
+		}
+	}
+
+	return r && (nexit > 0);
+}
+
+/* a TRANSPOSE whose output only goes into a DENSE, maybe through a RESHAPE, as the
+ * DENSE takes the input in the order of the TRANSPOSE input with its weights reordered */
+static const layer_t* nn_get_transpose_dense(nn_t* nn, const layer_t* layer)
+{
+	const layer_t* writer;
+	const layer_t* reader = layer;
+	NHWC_t nhwc;
+	const int* dims;
+
+	do
+	{
+		writer = reader;
+		reader = nn_get_only_reader(nn, nn_get_layer_id(nn, writer));
+	} while((NULL != reader) && (L_OP_RESHAPE == reader->op));
+
+	if((NULL != reader) && (L_OP_DENSE == reader->op) &&
+		(0 == layer_get_NHWC(layer->inputs[0], &nhwc)))
+	{
+		dims = reader->blobs[0]->dims;
+		if((dims[1] != NHWC_BATCH_SIZE(nhwc))
+#ifndef DISABLE_DYNAMIC_SHAPE
+			|| (layer_get_dynamic_axis(layer) >= 0)
+#endif
+			)
+		{
+			reader = NULL;
+		}
+	}
+	else
+	{
+		reader = NULL;
+	}
+
+	return reader;
+}
+#endif
+
+/* skip the TRANSPOSEs that cancel each other around layout agnostic layers, or
+ * whose order can go into the weights of the DENSE after them */
+static int nn_eliminate_transpose(nn_t* nn)
+{
+	int r = 0;
+	size_t i, j;
+	int* marks;
+	int id;
+	const layer_t* layer;
+	const layer_t* dense;
+
+	for(i=0; i<nn->layer_number; i++)
+	{
+		nn->transposes[i] = -1;
+	}
+
+#if !defined(DISABLE_RUNTIME_CPU) && !defined(DISABLE_RUNTIME_CPU_FLOAT)
+	if((NETWORK_TYPE_FLOAT != nn->network->type) || (RUNTIME_CPU != nn->runtime_type))
+	{
+		return r;
+	}
+
+	marks = malloc(nn->layer_number*sizeof(int));
+	if(NULL == marks)
+	{
+		r = NN_E_NO_MEMORY;
+	}
+
+	for(i=0; (0 == r) && (i<nn->layer_number); i++)
+	{
+		layer = nn->network->layers[i];
+		if((L_OP_TRANSPOSE != layer->op) || (nn->transposes[i] >= 0))
+		{
+			continue;
+		}
+
+		if(nn_group_transpose(nn, i, marks))
+		{
+			for(j=0; j<nn->layer_number; j++)
+			{
+				if(1 == marks[j])
+				{
+					nn->transposes[j] = i;
+					NNLOG(NN_DEBUG, ("skip %s, cancelled in the group of %s\n",
+							nn->network->layers[j]->name, layer->name));
+				}
+			}
+			continue;
+		}
+
+		dense = nn_get_transpose_dense(nn, layer);
+		if(NULL != dense)
+		{
+			id = nn_get_layer_id(nn, dense);
+			nn->transposes[i] = id;
+			nn->transposes[id] = i;
+			NNLOG(NN_DEBUG, ("skip %s, reorder the weights of %s\n", layer->name, dense->name));
+		}
+	}
+
+	if(NULL != marks)
+	{
+		free(marks);
+	}
+#endif
+
+	return r;
+}
+#endif
+
+static int nn_create_layer_map(nn_t* nn)
+{
+	int r = 0;
+	size_t i, sz;
+	int id;
+	const layer_t* const* layers = nn->network->layers;
+	const layer_t** inputs;
+
+	nn->layer_number = 0;
+	while(NULL != layers[nn->layer_number])
+	{
+		nn->layer_number ++;
+	}
+
+	/* power of 2 and at least half empty, so the probe sequence is short */
+	sz = 2;
+	while(sz < (2*nn->layer_number))
+	{
+		sz = sz << 1;
+	}
+
+	nn->lmap.mask = sz - 1;
+	nn->lmap.entries = malloc(sz*sizeof(nn_layer_map_t));
+	nn->contexts = malloc(nn->layer_number*sizeof(layer_context_t*));
+	nn->last_use = malloc(nn->layer_number*sizeof(int));
+	nn->readers = malloc(nn->layer_number*sizeof(int));
+	nn->bindings = malloc(nn->layer_number*sizeof(void*));
+#ifndef DISABLE_NN_FOLD_BN
+	nn->folds = malloc(nn->layer_number*sizeof(int));
+	if(NULL == nn->folds)
+	{
+		r = NN_E_NO_MEMORY;
+	}
+#endif
+#ifndef DISABLE_NN_FUSE_PAD
+	nn->pads = malloc(nn->layer_number*sizeof(int));
+	if(NULL == nn->pads)
+	{
+		r = NN_E_NO_MEMORY;
+	}
+#endif
+#ifndef DISABLE_NN_ELIMINATE_TRANSPOSE
+	nn->transposes = malloc(nn->layer_number*sizeof(int));
+	if(NULL == nn->transposes)
+	{
+		r = NN_E_NO_MEMORY;
+	}
+#endif
+
+	if((NULL == nn->lmap.entries) || (NULL == nn->contexts) ||
+		(NULL == nn->last_use) || (NULL == nn->readers) || (NULL == nn->bindings))
+	{
+		r = NN_E_NO_MEMORY;
+	}
+	else
+	{
+		memset(nn->lmap.entries, 0, sz*sizeof(nn_layer_map_t));
+		memset(nn->contexts, 0, nn->layer_number*sizeof(layer_context_t*));
+		memset(nn->bindings, 0, nn->layer_number*sizeof(void*));
+		memset(nn->readers, 0, nn->layer_number*sizeof(int));
+		for(i=0; i<nn->layer_number; i++)
+		{
+			sz = NN_LAYER_HASH(layers[i]) & nn->lmap.mask;
+			while(NULL != nn->lmap.entries[sz].layer)
+			{
+				sz = (sz+1) & nn->lmap.mask;
+			}
+			nn->lmap.entries[sz].layer = layers[i];
+			nn->lmap.entries[sz].id = i;
+		}
+
+		/* layers are in execution order, so the last reader seen is the last use */
+		for(i=0; i<nn->layer_number; i++)
+		{
+			nn->last_use[i] = i;
+			for(inputs=layers[i]->inputs; (NULL != inputs) && (NULL != (*inputs)); inputs++)
+			{
+				id = nn_get_layer_id(nn, *inputs);
+				nn->last_use[id] = i;
+				nn->readers[id] ++;
+			}
+		}
+	}
+
+#ifndef DISABLE_NN_FOLD_BN
+	if(0 == r)
+	{
+		nn_fold_batchnorm(nn);
+	}
+#endif
+#ifndef DISABLE_NN_FUSE_PAD
+	if(0 == r)
+	{
+		nn_fuse_pad(nn);
+	}
+#endif
+#ifndef DISABLE_NN_ELIMINATE_TRANSPOSE
+	if(0 == r)
+	{
+		r = nn_eliminate_transpose(nn);
+	}
+#endif
+
+	return r;
+}
+
+#ifdef L_BLOB_NOT_BUILTIN
+static size_t nn_get_element_size(layer_data_type_t dtype)
+{
+	size_t size;
+
+	switch(dtype) {
+		case L_DT_INT16:
+		case L_DT_UINT16:
+			size = sizeof(int16_t);
+			break;
+		case L_DT_INT32:
+		case L_DT_UINT32:
+			size = sizeof(int32_t);
+			break;
+		case L_DT_FLOAT:
+			size = sizeof(float);
+			break;
+		default:
+			size = 1;
+			break;
+	}
+
+	return size;
+}
+
+static size_t nn_get_blob_size(const layer_blob_t* blob)
+{
+	size_t size;
+	const int* dims;
+
+	dims = blob->dims;
+	size = *dims++;
+	while(*dims != 0) {
+		size *= *dims++;
+	}
+
+	return size*nn_get_element_size(blob->dtype);
+}
+
+/* the blobs are used in place, so the offset must also suit the element type */
+static int nn_check_bundle_entry(const nn_bundle_entry_t* entry, const layer_blob_t* blob,
+		size_t fsize, uint32_t align)
+{
+	int r = 0;
+	int i;
+
+	if((entry->dtype != (int32_t)blob->dtype) ||
+		(entry->size != nn_get_blob_size(blob)) ||
+		(entry->offset > fsize) || (entry->size > (fsize - entry->offset)) ||
+		(0 != (entry->offset % align)) ||
+		(0 != (entry->offset % nn_get_element_size(blob->dtype))))
+	{
+		r = NN_E_INVALID_WEIGHTS_LOADER;
+	}
+
+	for(i=0; (i<NN_BUNDLE_MAX_DIMS) && (0 == r); i++)
+	{
+		if(entry->dims[i] != blob->dims[i])
+		{
+			r = NN_E_INVALID_WEIGHTS_LOADER;
+		}
+		else if(0 == blob->dims[i])
+		{
+			break;
+		}
+	}
+
+	return r;
+}
+
+static int nn_map_file(nn_mapping_t* mapping, const char* path)
+{
+	int r = 0;
+#ifdef _WIN32
+	LARGE_INTEGER fsize;
+
+	mapping->map = NULL;
+	mapping->file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if((INVALID_HANDLE_VALUE == mapping->file) || (!GetFileSizeEx(mapping->file, &fsize)))
+	{
+		r = NN_E_INVALID_WEIGHTS_LOADER;
+	}
+	else
+	{
+		mapping->size = (size_t)fsize.QuadPart;
+		mapping->map = CreateFileMappingA(mapping->file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+		mapping->addr = (NULL != mapping->map) ? MapViewOfFile(mapping->map, FILE_MAP_COPY, 0, 0, 0) : NULL;
+		if(NULL == mapping->addr)
+		{
+			r = NN_E_NO_MEMORY;
+		}
+	}
+#else
+	struct stat st;
+	int fd = open(path, O_RDONLY);
+
+	if((fd < 0) || (0 != fstat(fd, &st)))
+	{
+		r = NN_E_INVALID_WEIGHTS_LOADER;
+	}
+	else
+	{
+		mapping->size = st.st_size;
+		/* private so that the pages stay shared in the page cache unless
+		 * somebody writes to them */
+		mapping->addr = mmap(NULL, mapping->size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+		if(MAP_FAILED == mapping->addr)
+		{
+			mapping->addr = NULL;
+			r = NN_E_NO_MEMORY;
+		}
+	}
+
+	if(fd >= 0)
+	{
+		close(fd);
+	}
+#endif
+
+	return r;
+}
+#endif
+
+static void nn_destory_layer_map(nn_t* nn)
+{
+	if(NULL != nn->lmap.entries)
+	{
+		free(nn->lmap.entries);
+	}
+
+	if(NULL != nn->contexts)
+	{
+		free(nn->contexts);
+	}
+
+	if(NULL != nn->last_use)
+	{
+		free(nn->last_use);
+	}
+
+	if(NULL != nn->readers)
+	{
+		free(nn->readers);
+	}
+
+	if(NULL != nn->bindings)
+	{
+		free(nn->bindings);
+	}
+
+#ifndef DISABLE_NN_FOLD_BN
+	if(NULL != nn->folds)
+	{
+		free(nn->folds);
+	}
+#endif
+#ifndef DISABLE_NN_FUSE_PAD
+	if(NULL != nn->pads)
+	{
+		free(nn->pads);
+	}
+#endif
+#ifndef DISABLE_NN_ELIMINATE_TRANSPOSE
+	if(NULL != nn->transposes)
+	{
+		free(nn->transposes);
+	}
+#endif
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 nn_t* nn_create(const network_t* network, runtime_type_t runtime_type)
 {
@@ -25,41 +763,69 @@ nn_t* nn_create(const network_t* network, runtime_type_t runtime_type)
 			!defined(DISABLE_RTE_FALLBACK)
 		nn->scratch.size = 0;
 		nn->scratch.area = NULL;
+		nn->scratch.requests = 0;
+		#endif
+		nn->runtime = NULL;
+		nn->tpool = NULL;
+		#ifndef DISABLE_NN_PROFILE
+		nn->profile = NULL;
 		#endif
 
-		nn->runtime = rte_create(nn);
-	}
-
-	if(NULL != nn->runtime)
-	{
-		int r = rte_init(nn);
+		if(0 == nn_create_layer_map(nn))
+		{
+			nn->runtime = rte_create(nn);
+		}
 
-		#ifndef DISABLE_NN_SCRATCH
-		if((0 == r) && (0 != nn->scratch.size))
+		if(NULL != nn->runtime)
 		{
-			nn->scratch.area = malloc(nn->scratch.size);
+			int r = rte_init(nn);
 
-			if(NULL == nn->scratch.area)
+			#ifndef DISABLE_NN_SCRATCH
+			if((0 == r) && (0 != nn->scratch.size))
 			{
-				r = NN_E_NO_MEMORY;
+				nn->scratch.area = malloc(nn->scratch.size);
+
+				if(NULL == nn->scratch.area)
+				{
+					r = NN_E_NO_MEMORY;
+				}
+			}
+			#endif
+			if(0 != r)
+			{
+				NNLOG(NN_ERROR,("nn create failed with %d\n", r));
+				rte_destory(nn);
+				nn->runtime = NULL;
 			}
 		}
-		#endif
-		if(0 != r)
+
+		if(NULL == nn->runtime)
 		{
-			NNLOG(NN_ERROR,("nn create failed with %d\n", r));
-			rte_destory(nn);
-			nn->runtime = NULL;
+			nn_destory_layer_map(nn);
+			free(nn);
+			nn = NULL;
 		}
 	}
 
-	if(NULL == nn->runtime)
+	return nn;
+}
+
+int nn_get_layer_id(const nn_t* nn, const layer_t* layer)
+{
+	size_t i = NN_LAYER_HASH(layer) & nn->lmap.mask;
+	int id = -1;
+
+	while(NULL != nn->lmap.entries[i].layer)
 	{
-		free(nn);
-		nn = NULL;
+		if(nn->lmap.entries[i].layer == layer)
+		{
+			id = nn->lmap.entries[i].id;
+			break;
+		}
+		i = (i+1) & nn->lmap.mask;
 	}
 
-	return nn;
+	return id;
 }
 
 void nn_set_log_level(int level)
@@ -67,14 +833,63 @@ void nn_set_log_level(int level)
 	nn_log_level = level;
 }
 
+int nn_set_num_threads(nn_t* nn, int num)
+{
+	int r = 0;
+
+	if(num < 1)
+	{
+		r = NN_E_INVALID_PARAMETER;
+	}
+	else if(num != thread_pool_get_num_threads(nn->tpool))
+	{
+		thread_pool_destory(nn->tpool);
+		nn->tpool = thread_pool_create(num);
+		if((num > 1) && (NULL == nn->tpool))
+		{
+			#ifndef DISABLE_NN_THREAD
+			r = NN_E_NO_MEMORY;
+			#else
+			r = NN_E_NOT_SUPPORTED;
+			#endif
+		}
+	}
+
+	return r;
+}
+
 int nn_predict(nn_t* nn)
 {
-	return rte_execute(nn);
+	int r;
+
+	#ifndef DISABLE_NN_PROFILE
+	if(NULL != nn->profile)
+	{
+		rte_profile_begin(nn);
+	}
+	#endif
+
+	r = rte_execute(nn);
+
+	#ifndef DISABLE_NN_PROFILE
+	if(NULL != nn->profile)
+	{
+		rte_profile_end(nn);
+	}
+	#endif
+
+	return r;
 }
 
 void* nn_get_input_data(const nn_t* nn, const layer_t* layer)
 {
 	void* data = NULL;
+	int id = nn_get_layer_id(nn, layer);
+
+	if(id >= 0)
+	{	/* a layer of another network has no binding here */
+		data = nn->bindings[id];
+	}
 
 	const nn_input_t* const* input = nn->network->inputs;
 
@@ -94,6 +909,12 @@ void* nn_get_input_data(const nn_t* nn, const layer_t* layer)
 void* nn_get_output_data(const nn_t* nn, const layer_t* layer)
 {
 	void* data = NULL;
+	int id = nn_get_layer_id(nn, layer);
+
+	if(id >= 0)
+	{	/* a layer of another network has no binding here */
+		data = nn->bindings[id];
+	}
 
 	const nn_output_t* const* output = nn->network->outputs;
 
@@ -110,6 +931,53 @@ void* nn_get_output_data(const nn_t* nn, const layer_t* layer)
 	return data;
 }
 
+int nn_bind_input(nn_t* nn, const layer_t* layer, void* data)
+{
+	int r = NN_E_INVALID_LAYER;
+
+	const nn_input_t* const* input = nn->network->inputs;
+
+	while(((*input) != NULL) && (0 != r))
+	{
+		if((*input)->layer == layer)
+		{
+			nn->bindings[nn_get_layer_id(nn, layer)] = data;
+			r = 0;
+		}
+
+		input++;
+	}
+
+	return r;
+}
+
+int nn_bind_output(nn_t* nn, const layer_t* layer, void* data)
+{
+	int r = NN_E_INVALID_LAYER;
+
+	const nn_output_t* const* output = nn->network->outputs;
+
+	while(((*output) != NULL) && (NN_E_INVALID_LAYER == r))
+	{
+		if((*output)->layer == layer)
+		{
+			if(NULL != (*output)->data)
+			{	/* the runtime decides at init whether to write into the output buffer */
+				nn->bindings[nn_get_layer_id(nn, layer)] = data;
+				r = 0;
+			}
+			else
+			{
+				r = NN_E_NO_OUTPUT_BUFFER_PROVIDED;
+			}
+		}
+
+		output++;
+	}
+
+	return r;
+}
+
 void nn_destory(nn_t* nn)
 {
 	if(NULL != nn)
@@ -121,6 +989,11 @@ void nn_destory(nn_t* nn)
 			free(nn->scratch.area);
 		}
 		#endif
+		thread_pool_destory(nn->tpool);
+		#ifndef DISABLE_NN_PROFILE
+		nn_set_profile(nn, FALSE);
+		#endif
+		nn_destory_layer_map(nn);
 		free(nn);
 	}
 }
@@ -130,6 +1003,7 @@ void nn_destory(nn_t* nn)
 void nn_request_scratch(const nn_t* nn, size_t sz)
 {
 	nn_t * pnn = (nn_t*)nn;
+	pnn->scratch.requests ++;
 	if(sz > pnn->scratch.size)
 	{
 		pnn->scratch.size = sz;
@@ -137,15 +1011,16 @@ void nn_request_scratch(const nn_t* nn, size_t sz)
 }
 #endif
 
-void* nn_allocate_input(const layer_t* layer)
+void* nn_allocate_input(const nn_t* nn, const layer_t* layer)
 {
-	void* mem;
+	void* mem = NULL;
 	layer_data_type_t dtype;
-	size_t sz = layer_get_size(layer);
+	layer_context_t* context = LAYER_CONTEXT(nn, layer);
+	size_t sz = layer_get_context_size(nn, layer);
 
-	if(NULL != layer->C->context)
+	if(NULL != context)
 	{
-		dtype = layer->C->context->dtype;
+		dtype = context->dtype;
 	}
 	else
 	{
@@ -181,9 +1056,9 @@ void* nn_allocate_input(const layer_t* layer)
 	return mem;
 }
 
-void* nn_allocate_output(const layer_t* layer)
+void* nn_allocate_output(const nn_t* nn, const layer_t* layer)
 {
-	return nn_allocate_input(layer);
+	return nn_allocate_input(nn, layer);
 }
 
 void nn_free_input(void* input)
@@ -205,7 +1080,6 @@ int nn_load(const network_t* network, nn_blob_loader_t loader, void* provider)
 	const layer_blob_t* const* blobs;
 	const layer_blob_t* blob;
 	size_t size;
-	const int* dims;
 
 	layers = network->layers;
 	layer = *layers++;
@@ -214,26 +1088,7 @@ int nn_load(const network_t* network, nn_blob_loader_t loader, void* provider)
 		if(blobs != NULL) {
 			blob = *blobs++;
 			while((NULL != blob) && (0 == r)) {
-				dims = blob->dims;
-				size = *dims++;
-				while(*dims != 0) {
-					size *= *dims++;
-				}
-				switch(blob->dtype) {
-					case L_DT_INT16:
-					case L_DT_UINT16:
-						size *= sizeof(int16_t);
-						break;
-					case L_DT_INT32:
-					case L_DT_UINT32:
-						size *= sizeof(int32_t);
-						break;
-					case L_DT_FLOAT:
-						size *= sizeof(float);
-						break;
-					default:
-						break;
-				}
+				size = nn_get_blob_size(blob);
 				r = loader(provider, (void*)blob->blob, size);
 				blob = *blobs++;
 			}
@@ -252,4 +1107,111 @@ int nn_load(const network_t* network, nn_blob_loader_t loader, void* provider)
 	}
 	return r;
 }
+
+nn_mapping_t* nn_map(const network_t* network, const char* path)
+{
+	int r;
+	nn_mapping_t* mapping;
+	const nn_bundle_header_t* header = NULL;
+	const nn_bundle_entry_t* entry = NULL;
+	const layer_t* const* layers;
+	const layer_blob_t* const* blobs;
+	uint32_t number = 0;
+
+	mapping = malloc(sizeof(nn_mapping_t));
+	if(NULL == mapping)
+	{
+		return NULL;
+	}
+
+	mapping->addr = NULL;
+	r = nn_map_file(mapping, path);
+
+	if(0 != r)
+	{
+		NNLOG(NN_ERROR, ("can't map weight bundle %s\n", path));
+	}
+	else
+	{
+		header = (const nn_bundle_header_t*)mapping->addr;
+		if((mapping->size < sizeof(nn_bundle_header_t)) ||
+			(0 != memcmp(header->magic, NN_BUNDLE_MAGIC, sizeof(header->magic))) ||
+			(NN_BUNDLE_VERSION != header->version) ||
+			(0 == header->align) || (0 != (header->align & (header->align-1))) ||
+			(header->number > ((mapping->size-sizeof(nn_bundle_header_t))/sizeof(nn_bundle_entry_t))))
+		{
+			r = NN_E_INVALID_WEIGHTS_LOADER;
+		}
+		entry = (const nn_bundle_entry_t*)&header[1];
+	}
+
+	/* check them all before touching any blob, so a bad bundle leaves the network as it was */
+	for(layers=network->layers; (NULL != (*layers)) && (0 == r); layers++)
+	{
+		for(blobs=(*layers)->blobs; (NULL != blobs) && (NULL != (*blobs)) && (0 == r); blobs++)
+		{
+			if(number < header->number)
+			{
+				r = nn_check_bundle_entry(&entry[number], *blobs, mapping->size, header->align);
+			}
+			number ++;
+		}
+	}
+
+	if((0 == r) && (number != header->number))
+	{
+		r = NN_E_INVALID_WEIGHTS_LOADER;
+	}
+
+	if(0 == r)
+	{
+		number = 0;
+		for(layers=network->layers; NULL != (*layers); layers++)
+		{
+			for(blobs=(*layers)->blobs; (NULL != blobs) && (NULL != (*blobs)); blobs++)
+			{
+				((layer_blob_t*)(*blobs))->blob = (uint8_t*)mapping->addr + entry[number].offset;
+				number ++;
+			}
+		}
+	}
+	else
+	{
+		if(NULL != header)
+		{
+			NNLOG(NN_ERROR, ("mismatched weight bundle %s for %s\n", path, network->name));
+		}
+		nn_unmap(mapping);
+		mapping = NULL;
+	}
+
+	return mapping;
+}
+
+void nn_unmap(nn_mapping_t* mapping)
+{
+	if(NULL != mapping)
+	{
+#ifdef _WIN32
+		if(NULL != mapping->addr)
+		{
+			UnmapViewOfFile(mapping->addr);
+		}
+		if(NULL != mapping->map)
+		{
+			CloseHandle(mapping->map);
+		}
+		if(INVALID_HANDLE_VALUE != mapping->file)
+		{
+			CloseHandle(mapping->file);
+		}
+#else
+		if(NULL != mapping->addr)
+		{
+			munmap(mapping->addr, mapping->size);
+		}
+#endif
+		free(mapping);
+	}
+}
 #endif
@@ -66,6 +66,9 @@ extern "C" {
 #define LAYER_Z(layer) RTE_FETCH_INT32((layer)->blobs[0]->blob, 1)
 #define LAYER_S(layer) RTE_FETCH_INT32((layer)->blobs[0]->blob, 2)
 
+/* the runtime context of a layer is owned by the nn instance, never by the shared layer */
+#define LAYER_CONTEXT(nn, layer) ((nn)->contexts[nn_get_layer_id((nn), (layer))])
+
 #define NN_MAX(a, b) (((a) > (b)) ? (a) : (b))
 #define NN_MIN(a, b) (((a) < (b)) ? (a) : (b))
 
@@ -112,15 +115,102 @@ typedef struct {
 	network_type_t type;
 } network_t;
 
+typedef struct {
+	const layer_t* layer;
+	int id;
+} nn_layer_map_t;
+
+struct thread_pool;
+
+#ifndef DISABLE_NN_PROFILE
+typedef struct
+{
+	const layer_t* layer;
+	/* in ns, the start is relative to the start of the last nn_predict */
+	uint64_t start;
+	uint64_t duration;
+	/* sum of the duration over all the profiled runs */
+	uint64_t total;
+	size_t out_bytes;
+} nn_layer_profile_t;
+
+typedef struct
+{
+	size_t runs;
+	/* in ns, of the last nn_predict and the sum over all the profiled runs */
+	uint64_t start;
+	uint64_t duration;
+	uint64_t total;
+	size_t layer_number;
+	/* indexed by the layer position in network->layers */
+	nn_layer_profile_t* layers;
+} nn_profile_t;
+#endif
+
+#ifndef DISABLE_RUNTIME_CPU
+typedef struct
+{
+	/* in bytes */
+	size_t arena;
+	size_t dynamic_arena;
+	size_t dynamic_used;
+	size_t allocations;
+	size_t total_allocations;
+	size_t predicts;
+} nn_memory_stats_t;
+#endif
+
+#ifdef L_BLOB_NOT_BUILTIN
+typedef struct nn_mapping nn_mapping_t;
+#endif
+
 typedef struct nn {
 	runtime_t runtime;
 	const network_t* network;
 	runtime_type_t runtime_type;
+	/* per instance layer context table, indexed by the layer position in network->layers */
+	layer_context_t** contexts;
+	size_t layer_number;
+	struct {
+		size_t mask;
+		nn_layer_map_t* entries;
+	} lmap;
+	/* index of the last layer that reads the output of each layer, itself if none */
+	int* last_use;
+	/* how many times the output of each layer is an input of the others */
+	int* readers;
+#ifndef DISABLE_NN_FOLD_BN
+	/* for a CONV2D, DWCONV2D or DENSE the index of the BATCHNORM folded into it, for
+	 * that BATCHNORM the index of the layer, -1 for the others */
+	int* folds;
+#endif
+#ifndef DISABLE_NN_FUSE_PAD
+	/* for a CONV2D, DWCONV2D, MAXPOOL or AVGPOOL the index of the PAD fused into its
+	 * padding, for that PAD the index of the layer, -1 for the others */
+	int* pads;
+#endif
+#ifndef DISABLE_NN_ELIMINATE_TRANSPOSE
+	/* for a TRANSPOSE that is cancelled by another one, the index of the first one of
+	 * the group, for a TRANSPOSE whose order goes into the weights of a DENSE, the
+	 * index of that DENSE and for the DENSE the index of the TRANSPOSE, -1 else */
+	int* transposes;
+#endif
+	/* buffers given by nn_bind_input/nn_bind_output, indexed by the layer position,
+	 * NULL means the one of the network */
+	void** bindings;
+	/* intra-op workers shared by the CPU kernels of this instance, NULL means single thread */
+	struct thread_pool* tpool;
+#ifndef DISABLE_NN_PROFILE
+	/* NULL unless profiling is on */
+	nn_profile_t* profile;
+#endif
 #if !defined(DISABLE_NN_SCRATCH) || \
 	!defined(DISABLE_RTE_FALLBACK) /* fallback will use scratch */
 	struct {
 		size_t size;
 		void* area;
+		/* number of requests, lets a runtime know which layers share the area */
+		size_t requests;
 	} scratch;
 #endif
 } nn_t;
@@ -162,21 +252,56 @@ int nn_predict(nn_t* nn);
 
 void nn_set_log_level(int level);
 
+int nn_set_num_threads(nn_t* nn, int num);
+
+#ifndef DISABLE_RUNTIME_CPU
+/* limit the CPU kernels of the instances created after to the instruction set
+ * "generic", "neon", "sse2", "sse4", "avx2" or "avx512", NULL goes back to the best
+ * one of the CPU, or to the one of the environment variable LWNN_CPU_ISA if set */
+int nn_set_cpu_isa(const char* isa);
+
+/* the memory of the CPU runtime: the arena of the static buffers, the pooled memory of
+ * the dynamic shapes and how much of it the last shape took, and the heap allocations
+ * made for the dynamic shapes by the last nn_predict and by all of them */
+int nn_get_memory_stats(const nn_t* nn, nn_memory_stats_t* stats);
+#endif
+
+#ifndef DISABLE_NN_PROFILE
+int nn_set_profile(nn_t* nn, int enable);
+/* NULL if profiling is off */
+const nn_profile_t* nn_get_profile(const nn_t* nn);
+/* write the profile of the last run as chrome://tracing JSON */
+int nn_dump_profile(const nn_t* nn, const char* path);
+#endif
+
 void nn_destory(nn_t* nn);
 
 #ifndef DISABLE_NN_SCRATCH
 void nn_request_scratch(const nn_t* nn, size_t sz);
 #endif
 
-void* nn_allocate_input(const layer_t* layer);
-void* nn_allocate_output(const layer_t* layer);
+/* -1 when the layer is not one of the network */
+int nn_get_layer_id(const nn_t* nn, const layer_t* layer);
+
+void* nn_allocate_input(const nn_t* nn, const layer_t* layer);
+void* nn_allocate_output(const nn_t* nn, const layer_t* layer);
 void nn_free_input(void* input);
 void nn_free_output(void* output);
 void* nn_get_input_data(const nn_t* nn, const layer_t* layer);
 void* nn_get_output_data(const nn_t* nn, const layer_t* layer);
+/* use data instead of the buffer of the network for this input or output in the
+ * following nn_predict calls, NULL goes back to the one of the network. The size
+ * and type must be the same as the buffer of the network, an output without one
+ * (dynamic shape) can't be bound */
+int nn_bind_input(nn_t* nn, const layer_t* layer, void* data);
+int nn_bind_output(nn_t* nn, const layer_t* layer, void* data);
 
 #ifdef L_BLOB_NOT_BUILTIN
 int nn_load(const network_t* network, nn_blob_loader_t loader, void* provider);
+/* map the weight bundle generated along with the network and point its blobs
+ * into the mapping, the network must not be used after nn_unmap */
+nn_mapping_t* nn_map(const network_t* network, const char* path);
+void nn_unmap(nn_mapping_t* mapping);
 #endif
 #ifdef __cplusplus
 }
@@ -0,0 +1,445 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "nn_batch.h"
+#ifndef DISABLE_NN_THREAD
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#endif
+/* ============================ [ MACROS    ] ====================================================== */
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct nn_batch_request
+{
+	const void* const* inputs;
+	void* const* outputs;
+	int r;
+	int done;
+#ifndef DISABLE_NN_THREAD
+	/* when the batch with this request runs even if it isn't full */
+	struct timespec deadline;
+	STAILQ_ENTRY(nn_batch_request) entry;
+#endif
+} nn_batch_request_t;
+
+struct nn_batcher
+{
+	nn_t* nn;
+	int batch;
+	int max_batch;
+	uint32_t timeout_us;
+	int ninput;
+	int noutput;
+	/* the bytes of one sample of each input, then of each output */
+	size_t* sizes;
+	/* bound to the inputs of the network, the samples are packed there */
+	void** inputs;
+	/* the requests of the batch being run */
+	nn_batch_request_t** running;
+	nn_batcher_stats_t stats;
+#ifndef DISABLE_NN_THREAD
+	pthread_t thread;
+	pthread_mutex_t lock;
+	/* a request is queued, or the batcher is going away */
+	pthread_cond_t work;
+	/* a batch is done */
+	pthread_cond_t done;
+	STAILQ_HEAD(nn_batch_queue, nn_batch_request) queue;
+	int queued;
+	int exit;
+#endif
+};
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+static size_t nn_batch_get_sample_size(const nn_t* nn, const layer_t* layer, int batch)
+{
+	layer_context_t* context = LAYER_CONTEXT(nn, layer);
+	size_t sz = NHWC_SIZE(context->nhwc)/batch;
+
+	switch(context->dtype)
+	{
+		case L_DT_INT8:
+		case L_DT_UINT8:
+			break;
+		case L_DT_INT16:
+		case L_DT_UINT16:
+			sz *= 2;
+			break;
+		case L_DT_INT32:
+		case L_DT_UINT32:
+		case L_DT_FLOAT:
+			sz *= 4;
+			break;
+		default:
+			sz = 0;
+			break;
+	}
+
+	return sz;
+}
+
+/* TRUE if all the inputs and outputs have the batch and a buffer */
+static int nn_batch_check_network(const nn_t* nn, int batch)
+{
+	int r = TRUE;
+	const nn_input_t* const* input;
+	const nn_output_t* const* output;
+
+	for(input=nn->network->inputs; (NULL != (*input)) && r; input++)
+	{
+		r = ((*input)->layer->dims[0] == batch) && (NULL != (*input)->data) &&
+				(0 != nn_batch_get_sample_size(nn, (*input)->layer, batch));
+	}
+
+	for(output=nn->network->outputs; (NULL != (*output)) && r; output++)
+	{
+		r = ((*output)->layer->dims[0] == batch) && (NULL != (*output)->data) &&
+				(0 != nn_batch_get_sample_size(nn, (*output)->layer, batch));
+	}
+
+	return r;
+}
+
+/* the rows after num keep the samples of an older batch, their results are dropped */
+static int nn_batch_run(const nn_batcher_t* batcher, int num)
+{
+	int r;
+	int i, j;
+	const layer_t* layer;
+	size_t sz;
+	char* data;
+
+	for(i=0; i<batcher->ninput; i++)
+	{
+		sz = batcher->sizes[i];
+		for(j=0; j<num; j++)
+		{
+			memcpy((char*)batcher->inputs[i]+sz*j, batcher->running[j]->inputs[i], sz);
+		}
+	}
+
+	r = nn_predict(batcher->nn);
+
+	for(i=0; (i<batcher->noutput) && (0 == r); i++)
+	{
+		layer = batcher->nn->network->outputs[i]->layer;
+		data = (char*)nn_get_output_data(batcher->nn, layer);
+		sz = batcher->sizes[batcher->ninput+i];
+		for(j=0; j<num; j++)
+		{
+			memcpy(batcher->running[j]->outputs[i], data+sz*j, sz);
+		}
+	}
+
+	return r;
+}
+
+/* with the lock held, the callers may return as soon as done is set */
+static void nn_batch_complete(nn_batcher_t* batcher, int num, int r)
+{
+	int j;
+
+	for(j=0; j<num; j++)
+	{
+		batcher->running[j]->r = r;
+		batcher->running[j]->done = TRUE;
+	}
+
+	batcher->stats.requests += num;
+	batcher->stats.batches ++;
+	if(num == batcher->max_batch)
+	{
+		batcher->stats.full_batches ++;
+	}
+}
+
+#ifndef DISABLE_NN_THREAD
+static void* nn_batch_main(void* arg)
+{
+	nn_batcher_t* batcher = (nn_batcher_t*)arg;
+	nn_batch_request_t* request;
+	int num;
+	int r;
+
+	pthread_mutex_lock(&batcher->lock);
+	while(1)
+	{
+		while(STAILQ_EMPTY(&batcher->queue) && (FALSE == batcher->exit))
+		{
+			pthread_cond_wait(&batcher->work, &batcher->lock);
+		}
+
+		if(STAILQ_EMPTY(&batcher->queue))
+		{	/* exit with nothing left to run */
+			break;
+		}
+
+		request = STAILQ_FIRST(&batcher->queue);
+		while((batcher->queued < batcher->max_batch) && (FALSE == batcher->exit))
+		{
+			if(ETIMEDOUT == pthread_cond_timedwait(&batcher->work, &batcher->lock, &request->deadline))
+			{
+				break;
+			}
+		}
+
+		for(num=0; (num<batcher->max_batch) && (FALSE == STAILQ_EMPTY(&batcher->queue)); num++)
+		{
+			batcher->running[num] = STAILQ_FIRST(&batcher->queue);
+			STAILQ_REMOVE_HEAD(&batcher->queue, entry);
+			batcher->queued --;
+		}
+
+		/* the callers only queue meanwhile, nn and the packed inputs are the thread's */
+		pthread_mutex_unlock(&batcher->lock);
+		NNLOG(NN_DEBUG, ("batch of %d\n", num));
+		r = nn_batch_run(batcher, num);
+		pthread_mutex_lock(&batcher->lock);
+		nn_batch_complete(batcher, num, r);
+		pthread_cond_broadcast(&batcher->done);
+	}
+	pthread_mutex_unlock(&batcher->lock);
+
+	return NULL;
+}
+#endif
+/* ============================ [ FUNCTIONS ] ====================================================== */
+nn_batcher_t* nn_batcher_create(nn_t* nn, const nn_batcher_config_t* config)
+{
+	int r = 0;
+	nn_batcher_t* batcher = NULL;
+	const nn_input_t* const* input;
+	const nn_output_t* const* output;
+	int batch;
+	int i;
+#ifndef DISABLE_NN_THREAD
+	pthread_condattr_t attr;
+#endif
+
+	if((NULL == nn) || (NULL == config) || (NULL == nn->network->inputs[0]))
+	{
+		r = NN_E_INVALID_PARAMETER;
+	}
+	else
+	{
+		batch = nn->network->inputs[0]->layer->dims[0];
+		if(batch <= 0)
+		{	/* the samples are rows of a batch the network must know up front */
+			NNLOG(NN_ERROR, ("%s: the batch of the inputs is dynamic, it can't be filled\n",
+					nn->network->name));
+			r = NN_E_INVALID_NETWORK;
+		}
+		else if(FALSE == nn_batch_check_network(nn, batch))
+		{
+			NNLOG(NN_ERROR, ("%s: the inputs and outputs must all have a batch of %d and a buffer\n",
+					nn->network->name, batch));
+			r = NN_E_INVALID_NETWORK;
+		}
+	}
+
+	if(0 == r)
+	{
+		batcher = malloc(sizeof(nn_batcher_t));
+		if(NULL == batcher)
+		{
+			r = NN_E_NO_MEMORY;
+		}
+		else
+		{
+			memset(batcher, 0, sizeof(nn_batcher_t));
+			batcher->nn = nn;
+			batcher->batch = batch;
+			batcher->max_batch = ((config->max_batch > 0) && (config->max_batch < batch)) ? config->max_batch : batch;
+			batcher->timeout_us = config->timeout_us;
+			for(input=nn->network->inputs; NULL != (*input); input++)
+			{
+				batcher->ninput ++;
+			}
+			for(output=nn->network->outputs; NULL != (*output); output++)
+			{
+				batcher->noutput ++;
+			}
+			batcher->sizes = malloc(sizeof(size_t)*(batcher->ninput+batcher->noutput));
+			batcher->inputs = malloc(sizeof(void*)*batcher->ninput);
+			batcher->running = malloc(sizeof(nn_batch_request_t*)*batcher->max_batch);
+			if((NULL == batcher->sizes) || (NULL == batcher->inputs) || (NULL == batcher->running))
+			{
+				r = NN_E_NO_MEMORY;
+			}
+			else
+			{
+				memset(batcher->inputs, 0, sizeof(void*)*batcher->ninput);
+			}
+		}
+	}
+
+	for(i=0; (0 == r) && (i<batcher->ninput); i++)
+	{
+		input = &nn->network->inputs[i];
+		batcher->sizes[i] = nn_batch_get_sample_size(nn, (*input)->layer, batch);
+		batcher->inputs[i] = nn_allocate_input(nn, (*input)->layer);
+		if(NULL == batcher->inputs[i])
+		{
+			r = NN_E_NO_MEMORY;
+		}
+		else
+		{	/* the rows of a batch that isn't full stay defined */
+			memset(batcher->inputs[i], 0, batcher->sizes[i]*batch);
+			r = nn_bind_input(nn, (*input)->layer, batcher->inputs[i]);
+		}
+	}
+
+	for(i=0; (0 == r) && (i<batcher->noutput); i++)
+	{
+		output = &nn->network->outputs[i];
+		batcher->sizes[batcher->ninput+i] = nn_batch_get_sample_size(nn, (*output)->layer, batch);
+	}
+
+#ifndef DISABLE_NN_THREAD
+	if(0 == r)
+	{	/* the deadlines of the requests must not move with the wall clock */
+		pthread_condattr_init(&attr);
+		if(0 != pthread_condattr_setclock(&attr, CLOCK_MONOTONIC))
+		{
+			pthread_condattr_destroy(&attr);
+			r = NN_E_NOT_SUPPORTED;
+		}
+	}
+
+	if(0 == r)
+	{
+		STAILQ_INIT(&batcher->queue);
+		pthread_mutex_init(&batcher->lock, NULL);
+		pthread_cond_init(&batcher->work, &attr);
+		pthread_condattr_destroy(&attr);
+		pthread_cond_init(&batcher->done, NULL);
+		if(0 != pthread_create(&batcher->thread, NULL, nn_batch_main, batcher))
+		{
+			pthread_mutex_destroy(&batcher->lock);
+			pthread_cond_destroy(&batcher->work);
+			pthread_cond_destroy(&batcher->done);
+			r = NN_E_NO_MEMORY;
+		}
+	}
+#endif
+
+	if((0 != r) && (NULL != batcher))
+	{
+		for(i=0; (NULL != batcher->inputs) && (i<batcher->ninput); i++)
+		{
+			if(NULL != batcher->inputs[i])
+			{
+				nn_bind_input(nn, nn->network->inputs[i]->layer, NULL);
+				nn_free_input(batcher->inputs[i]);
+			}
+		}
+		free(batcher->sizes);
+		free(batcher->inputs);
+		free(batcher->running);
+		free(batcher);
+		batcher = NULL;
+	}
+
+	if(0 != r)
+	{
+		NNLOG(NN_ERROR, ("create batcher failed with %d\n", r));
+	}
+
+	return batcher;
+}
+
+int nn_batcher_predict(nn_batcher_t* batcher, const void* const* inputs, void* const* outputs)
+{
+	int r = 0;
+	nn_batch_request_t request;
+#ifndef DISABLE_NN_THREAD
+	long nsec;
+#endif
+
+	if((NULL == batcher) || (NULL == inputs) || (NULL == outputs))
+	{
+		r = NN_E_INVALID_PARAMETER;
+	}
+	else
+	{
+		request.inputs = inputs;
+		request.outputs = outputs;
+		request.r = 0;
+		request.done = FALSE;
+#ifndef DISABLE_NN_THREAD
+		clock_gettime(CLOCK_MONOTONIC, &request.deadline);
+		nsec = request.deadline.tv_nsec + (long)(batcher->timeout_us%1000000)*1000;
+		request.deadline.tv_sec += batcher->timeout_us/1000000 + nsec/1000000000;
+		request.deadline.tv_nsec = nsec%1000000000;
+
+		pthread_mutex_lock(&batcher->lock);
+		STAILQ_INSERT_TAIL(&batcher->queue, &request, entry);
+		batcher->queued ++;
+		pthread_cond_signal(&batcher->work);
+		while(FALSE == request.done)
+		{
+			pthread_cond_wait(&batcher->done, &batcher->lock);
+		}
+		pthread_mutex_unlock(&batcher->lock);
+#else
+		batcher->running[0] = &request;
+		nn_batch_complete(batcher, 1, nn_batch_run(batcher, 1));
+#endif
+		r = request.r;
+	}
+
+	return r;
+}
+
+int nn_batcher_get_stats(nn_batcher_t* batcher, nn_batcher_stats_t* stats)
+{
+	int r = 0;
+
+	if((NULL == batcher) || (NULL == stats))
+	{
+		r = NN_E_INVALID_PARAMETER;
+	}
+	else
+	{
+#ifndef DISABLE_NN_THREAD
+		pthread_mutex_lock(&batcher->lock);
+#endif
+		*stats = batcher->stats;
+#ifndef DISABLE_NN_THREAD
+		pthread_mutex_unlock(&batcher->lock);
+#endif
+	}
+
+	return r;
+}
+
+void nn_batcher_destory(nn_batcher_t* batcher)
+{
+	int i;
+
+	if(NULL != batcher)
+	{
+#ifndef DISABLE_NN_THREAD
+		pthread_mutex_lock(&batcher->lock);
+		batcher->exit = TRUE;
+		pthread_cond_signal(&batcher->work);
+		pthread_mutex_unlock(&batcher->lock);
+		pthread_join(batcher->thread, NULL);
+		pthread_mutex_destroy(&batcher->lock);
+		pthread_cond_destroy(&batcher->work);
+		pthread_cond_destroy(&batcher->done);
+#endif
+		for(i=0; i<batcher->ninput; i++)
+		{
+			nn_bind_input(batcher->nn, batcher->nn->network->inputs[i]->layer, NULL);
+			nn_free_input(batcher->inputs[i]);
+		}
+		free(batcher->sizes);
+		free(batcher->inputs);
+		free(batcher->running);
+		free(batcher);
+	}
+}
@@ -0,0 +1,52 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+#ifndef NN_NN_BATCH_H_
+#define NN_NN_BATCH_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "nn.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* coalesces the requests of many threads into the batch (dims[0]) of one network:
+ * a batch runs once it is full or once its oldest request has waited long enough,
+ * the inputs of the requests are packed one after another, nn_predict runs once
+ * and each request gets its own part of the outputs back */
+typedef struct nn_batcher nn_batcher_t;
+
+typedef struct
+{
+	/* 0 or more than the batch of the network takes the batch of the network */
+	int max_batch;
+	/* in us, how long the oldest request may wait for the batch to fill */
+	uint32_t timeout_us;
+} nn_batcher_config_t;
+
+typedef struct
+{
+	size_t requests;
+	size_t batches;
+	/* the batches that ran with max_batch requests */
+	size_t full_batches;
+} nn_batcher_stats_t;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+/* all the inputs and outputs of the network must have the same batch and an output
+ * buffer, nn is used by the batcher only until nn_batcher_destory, NULL on error */
+nn_batcher_t* nn_batcher_create(nn_t* nn, const nn_batcher_config_t* config);
+/* inputs[i] is one sample of network->inputs[i] and outputs[i] gets one sample of
+ * network->outputs[i], blocks until the batch with the request has run. Safe to
+ * call from any number of threads, with DISABLE_NN_THREAD each call is a batch */
+int nn_batcher_predict(nn_batcher_t* batcher, const void* const* inputs, void* const* outputs);
+int nn_batcher_get_stats(nn_batcher_t* batcher, nn_batcher_stats_t* stats);
+/* the requests already queued still run */
+void nn_batcher_destory(nn_batcher_t* batcher);
+#ifdef __cplusplus
+}
+#endif
+#endif /* NN_NN_BATCH_H_ */
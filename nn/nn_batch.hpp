@@ -0,0 +1,57 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+#ifndef NN_NN_BATCH_HPP_
+#define NN_NN_BATCH_HPP_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "nn_batch.h"
+#include <vector>
+namespace lwnn {
+/* ============================ [ MACROS    ] ====================================================== */
+/* ============================ [ TYPES     ] ====================================================== */
+/* owns the nn_batcher_t, the nn must outlive it */
+class Batcher
+{
+public:
+	Batcher(nn_t* nn, int max_batch = 0, uint32_t timeout_us = 1000)
+	{
+		nn_batcher_config_t config = { max_batch, timeout_us };
+		batcher = nn_batcher_create(nn, &config);
+	}
+
+	~Batcher()
+	{
+		nn_batcher_destory(batcher);
+	}
+
+	Batcher(const Batcher&) = delete;
+	Batcher& operator=(const Batcher&) = delete;
+
+	bool valid() const
+	{
+		return NULL != batcher;
+	}
+
+	/* one sample per input and per output of the network, in their order */
+	int predict(const std::vector<const void*>& inputs, const std::vector<void*>& outputs)
+	{
+		return nn_batcher_predict(batcher, inputs.data(), outputs.data());
+	}
+
+	nn_batcher_stats_t stats() const
+	{
+		nn_batcher_stats_t stats = { 0, 0, 0 };
+		(void)nn_batcher_get_stats(batcher, &stats);
+		return stats;
+	}
+
+private:
+	nn_batcher_t* batcher;
+};
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+} /* namespace lwnn */
+#endif /* NN_NN_BATCH_HPP_ */
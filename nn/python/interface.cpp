@@ -8,6 +8,7 @@
 #include "nn.h"
 #include "algorithm.h"
 #include <math.h>
+#include <float.h>
 #include <cmath>
 #include <vector>
 /* https://pybind11.readthedocs.io/en/stable/advanced/pycpp/numpy.html */
@@ -32,7 +33,8 @@ int pooling(const float * Im_in,
 		const int dim_im_out_x,
 		const int dim_im_out_y,
 		layer_operation_t op,
-		uint8_t* Mask_out);
+		uint8_t* Mask_out,
+		float outside);
 int alg_up_sampling(void* pout, void* pin, NHWC_t *outNHWC, NHWC_t *inNHWC, size_t type_size, uint8_t* pmask);
 int ROIAlign_forward_cpu(float* o, const float* in, const float* boxes, const int* indices,
 		NHWC_t* onhwc, NHWC_t* inhwc);
@@ -134,7 +136,8 @@ py::object MaxPool2d(py::array_t<float> input, /* NCHW */
 				o+batch_sizeO*batch,
 				dim_im_out_x,dim_im_out_y,
 				L_OP_MAXPOOL,
-				M);
+				M,
+				-FLT_MAX);
 	}
 
 	NHWC_t onhwc = { batches, dim_im_out_y, dim_im_out_x, ch_im_out };
@@ -80,7 +80,7 @@ int alg_concat(const nn_t* nn, const layer_t* layer, int axis,
 {
 	int r = 0;
 	void* pin;
-	layer_context_t* context = (layer_context_t*)layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t** input = layer->inputs;
 	layer_context_t* input_context;
 
@@ -105,7 +105,7 @@ int alg_concat(const nn_t* nn, const layer_t* layer, int axis,
 
 	while((*input) != NULL)
 	{	/* concat all input layers */
-		input_context = (layer_context_t*)(*input)->C->context;
+		input_context = (layer_context_t*)LAYER_CONTEXT(nn, *input);
 		pin = fetch_input(nn, *input);
 
 		if(NULL == pin)
@@ -126,10 +126,13 @@ int alg_concat(const nn_t* nn, const layer_t* layer, int axis,
 				input_context->nhwc.W, input_context->nhwc.C,
 				(int)in_stride));
 
-		for(i=0; i<n_block; i++)
-		{
-			memcpy((void*)(((size_t)pout)+i*out_stride*type_size), pin, in_stride*type_size);
-			pin = (void*)(((size_t)pin) + in_stride*type_size);
+		if(pin != pout)
+		{	/* else the input layer has written its slice of the output itself */
+			for(i=0; i<n_block; i++)
+			{
+				memcpy((void*)(((size_t)pout)+i*out_stride*type_size), pin, in_stride*type_size);
+				pin = (void*)(((size_t)pin) + in_stride*type_size);
+			}
 		}
 		pout = (void*)(((size_t)pout) + in_stride*type_size);
 		input++;
@@ -0,0 +1,144 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "cpu_isa.h"
+#include <string.h>
+/* ============================ [ MACROS    ] ====================================================== */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ISA_X86_CPUID
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static const char* const isa_names[ALG_ISA_NUMBER] =
+{
+	"generic",
+	"neon",
+	"sse2",
+	"sse4",
+	"avx2",
+	"avx512",
+};
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int alg_isa_supported(alg_isa_t isa)
+{
+	int r = 0;
+
+#ifdef ISA_X86_CPUID
+	__builtin_cpu_init();
+#endif
+	switch(isa)
+	{
+		case ALG_ISA_GENERIC:
+			r = 1;
+			break;
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+		case ALG_ISA_NEON:
+			r = 1;
+			break;
+#endif
+#if defined(ISA_X86_CPUID)
+		case ALG_ISA_SSE2:
+			r = __builtin_cpu_supports("sse2");
+			break;
+		case ALG_ISA_SSE4:
+			r = __builtin_cpu_supports("sse4.1");
+			break;
+		case ALG_ISA_AVX2:
+			r = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+			break;
+		case ALG_ISA_AVX512:
+			r = __builtin_cpu_supports("avx512f");
+			break;
+#else
+		/* without cpuid only what the compiler was told the target has */
+#if defined(__SSE2__) || defined(_M_X64)
+		case ALG_ISA_SSE2:
+			r = 1;
+			break;
+#endif
+#if defined(__SSE4_1__)
+		case ALG_ISA_SSE4:
+			r = 1;
+			break;
+#endif
+#if defined(__AVX2__) && defined(__FMA__)
+		case ALG_ISA_AVX2:
+			r = 1;
+			break;
+#endif
+#if defined(__AVX512F__)
+		case ALG_ISA_AVX512:
+			r = 1;
+			break;
+#endif
+#endif
+		default:
+			break;
+	}
+
+	return r;
+}
+
+alg_isa_t alg_isa_detect(void)
+{
+	int isa;
+
+	for(isa=ALG_ISA_NUMBER-1; isa>ALG_ISA_GENERIC; isa--)
+	{
+		if(alg_isa_supported((alg_isa_t)isa))
+		{
+			break;
+		}
+	}
+
+	return (alg_isa_t)isa;
+}
+
+const char* alg_isa_name(alg_isa_t isa)
+{
+	const char* name = "unknown";
+
+	if(isa < ALG_ISA_NUMBER)
+	{
+		name = isa_names[isa];
+	}
+
+	return name;
+}
+
+alg_isa_t alg_isa_from_name(const char* name)
+{
+	int isa;
+
+	for(isa=0; isa<ALG_ISA_NUMBER; isa++)
+	{
+		if(0 == strcmp(name, isa_names[isa]))
+		{
+			break;
+		}
+	}
+
+	return (alg_isa_t)isa;
+}
+
+const void* alg_isa_select(const alg_isa_kernel_t* kernels, alg_isa_t isa)
+{
+	const alg_isa_kernel_t* best = NULL;
+
+	for(; NULL != kernels->kernel; kernels++)
+	{
+		if((kernels->isa <= isa) && alg_isa_supported(kernels->isa))
+		{
+			if((NULL == best) || (kernels->isa > best->isa))
+			{
+				best = kernels;
+			}
+		}
+	}
+
+	return (NULL != best) ? best->kernel : NULL;
+}
@@ -0,0 +1,47 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+#ifndef NN_RUNTIME_COMMON_CPU_ISA_H_
+#define NN_RUNTIME_COMMON_CPU_ISA_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <stddef.h>
+/* ============================ [ MACROS    ] ====================================================== */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* the instruction set levels a kernel can be built for, a higher level of the same
+ * architecture includes the lower ones */
+typedef enum {
+	ALG_ISA_GENERIC = 0,
+	ALG_ISA_NEON,
+	ALG_ISA_SSE2,
+	ALG_ISA_SSE4,
+	ALG_ISA_AVX2,
+	ALG_ISA_AVX512,
+	ALG_ISA_NUMBER
+} alg_isa_t;
+
+/* one implementation of a kernel, a table of them is ended by a NULL kernel */
+typedef struct {
+	alg_isa_t isa;
+	const void* kernel;
+} alg_isa_kernel_t;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+/* TRUE if this CPU can run the code built for isa */
+int alg_isa_supported(alg_isa_t isa);
+/* the highest level this CPU supports */
+alg_isa_t alg_isa_detect(void);
+const char* alg_isa_name(alg_isa_t isa);
+/* ALG_ISA_NUMBER if the name is unknown */
+alg_isa_t alg_isa_from_name(const char* name);
+/* the kernel of the highest level not above isa that this CPU supports, NULL if none */
+const void* alg_isa_select(const alg_isa_kernel_t* kernels, alg_isa_t isa);
+#ifdef __cplusplus
+}
+#endif
+#endif /* NN_RUNTIME_COMMON_CPU_ISA_H_ */
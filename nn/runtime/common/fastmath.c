@@ -0,0 +1,551 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "fastmath.h"
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#ifndef DISABLE_NN_FAST_MATH
+/* with GCC or clang on x86 all the kernels are built and the CPU picks one at
+ * runtime, elsewhere only the ones the compiler targets, as gemm.c does */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define FM_HAS_SSE2
+#define FM_HAS_AVX2
+#define FM_TARGET_SSE2 __attribute__((target("sse2")))
+#define FM_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define FM_HAS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FM_HAS_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FM_HAS_NEON
+#endif
+#define FM_TARGET_SSE2
+#define FM_TARGET_AVX2
+#endif
+#endif
+/* ============================ [ MACROS    ] ====================================================== */
+#define FM_EXP_HI     88.37f
+#define FM_EXP_LO     -87.3365478515625f
+#define FM_LOG2E      1.44269504088896341f
+#define FM_LN2_HI     0.693359375f
+#define FM_LN2_LO     -2.12194440e-4f
+
+#define FM_EXP_P0     1.9875691500E-4f
+#define FM_EXP_P1     1.3981999507E-3f
+#define FM_EXP_P2     8.3334519073E-3f
+#define FM_EXP_P3     4.1665795894E-2f
+#define FM_EXP_P4     1.6666665459E-1f
+#define FM_EXP_P5     5.0000001201E-1f
+
+#define FM_SQRTHF     0.707106781186547524f
+#define FM_LOG_P0     7.0376836292E-2f
+#define FM_LOG_P1     -1.1514610310E-1f
+#define FM_LOG_P2     1.1676998740E-1f
+#define FM_LOG_P3     -1.2420140846E-1f
+#define FM_LOG_P4     1.4249322787E-1f
+#define FM_LOG_P5     -1.6668057665E-1f
+#define FM_LOG_P6     2.0000714765E-1f
+#define FM_LOG_P7     -2.4999993993E-1f
+#define FM_LOG_P8     3.3333331174E-1f
+
+#define FM_TANH_SMALL 0.625f
+#define FM_TANH_P0    -5.70498872745E-3f
+#define FM_TANH_P1    2.06390887954E-2f
+#define FM_TANH_P2    -5.37397155531E-2f
+#define FM_TANH_P3    1.33314422036E-1f
+#define FM_TANH_P4    -3.33332819422E-1f
+
+/* the vexpf, vtanhf and vsigmoidf of one instruction set as fm_v*f_##isa and its
+ * alg_fastmath_kernel_t, FM_VL floats at a time with the FM_V_* of that set */
+#define FM_V_KERNELS(isa, target)													\
+target static void fm_vexpf_##isa(const float* x, float* y, size_t n)				\
+{																					\
+	size_t i = 0;																	\
+	for(; (i+FM_VL) <= n; i += FM_VL)												\
+	{																				\
+		FM_V_STORE(y+i, FM_V_EXP(FM_V_LOAD(x+i)));									\
+	}																				\
+	for(; i < n; i++)																\
+	{																				\
+		y[i] = fm_expf(x[i]);														\
+	}																				\
+}																					\
+																					\
+target static void fm_vtanhf_##isa(const float* x, float* y, size_t n)				\
+{																					\
+	float e[FM_VL];																	\
+	FM_V_T vx, va;																	\
+	size_t i, j;																	\
+	float v;																		\
+																					\
+	for(i = 0; (i+FM_VL) <= n; i += FM_VL)											\
+	{																				\
+		vx = FM_V_LOAD(x+i);														\
+		va = FM_V_ADD(vx, vx);														\
+		/* -2|x| = min(2x, -2x) */													\
+		va = FM_V_MIN(va, FM_V_NEG(va));											\
+		FM_V_STORE(e, FM_V_EXP(va));												\
+		for(j = 0; j < FM_VL; j++)													\
+		{																			\
+			v = x[i+j];																\
+			y[i+j] = fm_tanhf_e(v, e[j]);											\
+		}																			\
+	}																				\
+	for(; i < n; i++)																\
+	{																				\
+		v = x[i];																	\
+		y[i] = fm_tanhf_e(v, fm_expf(-2.0f*fabsf(v)));								\
+	}																				\
+}																					\
+																					\
+target static void fm_vsigmoidf_##isa(const float* x, float* y, size_t n)			\
+{																					\
+	size_t i = 0;																	\
+	FM_V_T one = FM_V_DUP(1.0f);													\
+	FM_V_T e;																		\
+	for(; (i+FM_VL) <= n; i += FM_VL)												\
+	{																				\
+		e = FM_V_EXP(FM_V_NEG(FM_V_LOAD(x+i)));										\
+		FM_V_STORE(y+i, FM_V_DIV(one, FM_V_ADD(one, e)));							\
+	}																				\
+	for(; i < n; i++)																\
+	{																				\
+		y[i] = 1.0f/(1.0f + fm_expf(-x[i]));										\
+	}																				\
+}																					\
+static const alg_fastmath_kernel_t alg_fastmath_##isa =							\
+		{ #isa, fm_vexpf_##isa, fm_vtanhf_##isa, fm_vsigmoidf_##isa }
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+#ifndef DISABLE_NN_FAST_MATH
+static inline float fm_as_float(uint32_t u)
+{
+	float f;
+	memcpy(&f, &u, sizeof(f));
+	return f;
+}
+
+static inline uint32_t fm_as_uint(float f)
+{
+	uint32_t u;
+	memcpy(&u, &f, sizeof(u));
+	return u;
+}
+
+static inline float fm_expf(float x)
+{
+	float fx, r, p;
+	int n;
+
+	if(x > FM_EXP_HI) x = FM_EXP_HI;
+	if(x < FM_EXP_LO) x = FM_EXP_LO;
+
+	/* x = n*ln2 + r, |r| <= ln2/2 */
+	fx = x*FM_LOG2E + 0.5f;
+	n = (int)fx;
+	if((float)n > fx) n--;
+	fx = (float)n;
+	r = x - fx*FM_LN2_HI - fx*FM_LN2_LO;
+
+	p = FM_EXP_P0;
+	p = p*r + FM_EXP_P1;
+	p = p*r + FM_EXP_P2;
+	p = p*r + FM_EXP_P3;
+	p = p*r + FM_EXP_P4;
+	p = p*r + FM_EXP_P5;
+	p = p*r*r + r + 1.0f;
+
+	return p*fm_as_float((uint32_t)(n + 127) << 23);
+}
+
+static inline float fm_logf(float x)
+{
+	uint32_t u;
+	int e;
+	float m, z, y;
+
+	if(!(x > 0.0f)) return (0.0f == x) ? -INFINITY : NAN;
+	if(isinf(x)) return x;
+
+	u = fm_as_uint(x);
+	if(u < 0x00800000u)
+	{	/* denormal */
+		x *= 8388608.0f;
+		u = fm_as_uint(x);
+		e = -23;
+	}
+	else
+	{
+		e = 0;
+	}
+
+	/* x = m*2^e, sqrt(1/2) <= m < sqrt(2) */
+	e += (int)(u >> 23) - 126;
+	m = fm_as_float((u & 0x007FFFFFu) | 0x3F000000u);
+	if(m < FM_SQRTHF)
+	{
+		e--;
+		m = m + m - 1.0f;
+	}
+	else
+	{
+		m = m - 1.0f;
+	}
+
+	z = m*m;
+	y = FM_LOG_P0;
+	y = y*m + FM_LOG_P1;
+	y = y*m + FM_LOG_P2;
+	y = y*m + FM_LOG_P3;
+	y = y*m + FM_LOG_P4;
+	y = y*m + FM_LOG_P5;
+	y = y*m + FM_LOG_P6;
+	y = y*m + FM_LOG_P7;
+	y = y*m + FM_LOG_P8;
+	y = y*m*z;
+	y += (float)e*FM_LN2_LO;
+	y += -0.5f*z;
+	return m + y + (float)e*FM_LN2_HI;
+}
+
+/* the tanh of |x| < 0.625 */
+static inline float fm_tanhf_small(float x)
+{
+	float z = x*x;
+	float p;
+
+	p = FM_TANH_P0;
+	p = p*z + FM_TANH_P1;
+	p = p*z + FM_TANH_P2;
+	p = p*z + FM_TANH_P3;
+	p = p*z + FM_TANH_P4;
+	return x + x*z*p;
+}
+
+/* the tanh of x given e = exp(-2|x|) */
+static inline float fm_tanhf_e(float x, float e)
+{
+	float ax = fabsf(x);
+	float y;
+
+	if(ax < FM_TANH_SMALL)
+	{
+		y = fm_tanhf_small(x);
+	}
+	else
+	{
+		y = (1.0f - e)/(1.0f + e);
+		if(x < 0) y = -y;
+	}
+
+	return y;
+}
+
+#ifdef FM_HAS_AVX2
+FM_TARGET_AVX2 static inline __m256 fm_v_expf_avx2(__m256 x)
+{
+	__m256 fx, r, p;
+	__m256i n;
+
+	x = _mm256_min_ps(x, _mm256_set1_ps(FM_EXP_HI));
+	x = _mm256_max_ps(x, _mm256_set1_ps(FM_EXP_LO));
+
+	fx = _mm256_floor_ps(_mm256_fmadd_ps(x, _mm256_set1_ps(FM_LOG2E), _mm256_set1_ps(0.5f)));
+	r = _mm256_fnmadd_ps(fx, _mm256_set1_ps(FM_LN2_HI), x);
+	r = _mm256_fnmadd_ps(fx, _mm256_set1_ps(FM_LN2_LO), r);
+
+	p = _mm256_set1_ps(FM_EXP_P0);
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FM_EXP_P1));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FM_EXP_P2));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FM_EXP_P3));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FM_EXP_P4));
+	p = _mm256_fmadd_ps(p, r, _mm256_set1_ps(FM_EXP_P5));
+	p = _mm256_fmadd_ps(p, _mm256_mul_ps(r, r), r);
+	p = _mm256_add_ps(p, _mm256_set1_ps(1.0f));
+
+	n = _mm256_cvtps_epi32(fx);
+	n = _mm256_slli_epi32(_mm256_add_epi32(n, _mm256_set1_epi32(127)), 23);
+	return _mm256_mul_ps(p, _mm256_castsi256_ps(n));
+}
+#define FM_VL           8
+#define FM_V_T          __m256
+#define FM_V_LOAD(p)    _mm256_loadu_ps(p)
+#define FM_V_STORE(p,v) _mm256_storeu_ps(p,v)
+#define FM_V_DUP(f)     _mm256_set1_ps(f)
+#define FM_V_NEG(v)     _mm256_sub_ps(_mm256_setzero_ps(), v)
+#define FM_V_ADD(a,b)   _mm256_add_ps(a,b)
+#define FM_V_DIV(a,b)   _mm256_div_ps(a,b)
+#define FM_V_MIN(a,b)   _mm256_min_ps(a,b)
+#define FM_V_EXP(v)     fm_v_expf_avx2(v)
+FM_V_KERNELS(avx2, FM_TARGET_AVX2);
+#undef FM_VL
+#undef FM_V_T
+#undef FM_V_LOAD
+#undef FM_V_STORE
+#undef FM_V_DUP
+#undef FM_V_NEG
+#undef FM_V_ADD
+#undef FM_V_DIV
+#undef FM_V_MIN
+#undef FM_V_EXP
+#endif
+
+#ifdef FM_HAS_SSE2
+FM_TARGET_SSE2 static inline __m128 fm_v_expf_sse2(__m128 x)
+{
+	__m128 fx, t, r, p;
+	__m128i n;
+
+	x = _mm_min_ps(x, _mm_set1_ps(FM_EXP_HI));
+	x = _mm_max_ps(x, _mm_set1_ps(FM_EXP_LO));
+
+	/* floor by truncation, minus 1 where that rounded up */
+	fx = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(FM_LOG2E)), _mm_set1_ps(0.5f));
+	n = _mm_cvttps_epi32(fx);
+	t = _mm_cvtepi32_ps(n);
+	t = _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, fx), _mm_set1_ps(1.0f)));
+	fx = t;
+	r = _mm_sub_ps(x, _mm_mul_ps(fx, _mm_set1_ps(FM_LN2_HI)));
+	r = _mm_sub_ps(r, _mm_mul_ps(fx, _mm_set1_ps(FM_LN2_LO)));
+
+	p = _mm_set1_ps(FM_EXP_P0);
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FM_EXP_P1));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FM_EXP_P2));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FM_EXP_P3));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FM_EXP_P4));
+	p = _mm_add_ps(_mm_mul_ps(p, r), _mm_set1_ps(FM_EXP_P5));
+	p = _mm_add_ps(_mm_mul_ps(p, _mm_mul_ps(r, r)), r);
+	p = _mm_add_ps(p, _mm_set1_ps(1.0f));
+
+	n = _mm_cvttps_epi32(fx);
+	n = _mm_slli_epi32(_mm_add_epi32(n, _mm_set1_epi32(127)), 23);
+	return _mm_mul_ps(p, _mm_castsi128_ps(n));
+}
+#define FM_VL           4
+#define FM_V_T          __m128
+#define FM_V_LOAD(p)    _mm_loadu_ps(p)
+#define FM_V_STORE(p,v) _mm_storeu_ps(p,v)
+#define FM_V_DUP(f)     _mm_set1_ps(f)
+#define FM_V_NEG(v)     _mm_sub_ps(_mm_setzero_ps(), v)
+#define FM_V_ADD(a,b)   _mm_add_ps(a,b)
+#define FM_V_DIV(a,b)   _mm_div_ps(a,b)
+#define FM_V_MIN(a,b)   _mm_min_ps(a,b)
+#define FM_V_EXP(v)     fm_v_expf_sse2(v)
+FM_V_KERNELS(sse2, FM_TARGET_SSE2);
+#undef FM_VL
+#undef FM_V_T
+#undef FM_V_LOAD
+#undef FM_V_STORE
+#undef FM_V_DUP
+#undef FM_V_NEG
+#undef FM_V_ADD
+#undef FM_V_DIV
+#undef FM_V_MIN
+#undef FM_V_EXP
+#endif
+
+#ifdef FM_HAS_NEON
+#if defined(__aarch64__)
+#define FM_NEON_FMA(a,b,c) vfmaq_f32(a,b,c)
+static inline float32x4_t fm_neon_div(float32x4_t a, float32x4_t b)
+{
+	return vdivq_f32(a, b);
+}
+#else
+#define FM_NEON_FMA(a,b,c) vmlaq_f32(a,b,c)
+static inline float32x4_t fm_neon_div(float32x4_t a, float32x4_t b)
+{
+	float32x4_t rb = vrecpeq_f32(b);
+	rb = vmulq_f32(vrecpsq_f32(b, rb), rb);
+	rb = vmulq_f32(vrecpsq_f32(b, rb), rb);
+	return vmulq_f32(a, rb);
+}
+#endif
+static inline float32x4_t fm_v_expf_neon(float32x4_t x)
+{
+	float32x4_t fx, t, r, p;
+	int32x4_t n;
+	uint32x4_t m;
+
+	x = vminq_f32(x, vdupq_n_f32(FM_EXP_HI));
+	x = vmaxq_f32(x, vdupq_n_f32(FM_EXP_LO));
+
+	fx = FM_NEON_FMA(vdupq_n_f32(0.5f), x, vdupq_n_f32(FM_LOG2E));
+	t = vcvtq_f32_s32(vcvtq_s32_f32(fx));
+	m = vcgtq_f32(t, fx);
+	fx = vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(m, vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+	r = vmlsq_f32(x, fx, vdupq_n_f32(FM_LN2_HI));
+	r = vmlsq_f32(r, fx, vdupq_n_f32(FM_LN2_LO));
+
+	p = vdupq_n_f32(FM_EXP_P0);
+	p = FM_NEON_FMA(vdupq_n_f32(FM_EXP_P1), p, r);
+	p = FM_NEON_FMA(vdupq_n_f32(FM_EXP_P2), p, r);
+	p = FM_NEON_FMA(vdupq_n_f32(FM_EXP_P3), p, r);
+	p = FM_NEON_FMA(vdupq_n_f32(FM_EXP_P4), p, r);
+	p = FM_NEON_FMA(vdupq_n_f32(FM_EXP_P5), p, r);
+	p = FM_NEON_FMA(r, p, vmulq_f32(r, r));
+	p = vaddq_f32(p, vdupq_n_f32(1.0f));
+
+	n = vcvtq_s32_f32(fx);
+	n = vshlq_n_s32(vaddq_s32(n, vdupq_n_s32(127)), 23);
+	return vmulq_f32(p, vreinterpretq_f32_s32(n));
+}
+#define FM_VL           4
+#define FM_V_T          float32x4_t
+#define FM_V_LOAD(p)    vld1q_f32(p)
+#define FM_V_STORE(p,v) vst1q_f32(p,v)
+#define FM_V_DUP(f)     vdupq_n_f32(f)
+#define FM_V_NEG(v)     vnegq_f32(v)
+#define FM_V_ADD(a,b)   vaddq_f32(a,b)
+#define FM_V_DIV(a,b)   fm_neon_div(a,b)
+#define FM_V_MIN(a,b)   vminq_f32(a,b)
+#define FM_V_EXP(v)     fm_v_expf_neon(v)
+FM_V_KERNELS(neon, );
+#undef FM_VL
+#undef FM_V_T
+#undef FM_V_LOAD
+#undef FM_V_STORE
+#undef FM_V_DUP
+#undef FM_V_NEG
+#undef FM_V_ADD
+#undef FM_V_DIV
+#undef FM_V_MIN
+#undef FM_V_EXP
+#endif
+#endif /* DISABLE_NN_FAST_MATH */
+static void fm_vexpf_ref(const float* x, float* y, size_t n)
+{
+	size_t i;
+
+	for(i = 0; i < n; i++)
+	{
+		y[i] = alg_expf(x[i]);
+	}
+}
+
+static void fm_vtanhf_ref(const float* x, float* y, size_t n)
+{
+	size_t i;
+
+	for(i = 0; i < n; i++)
+	{
+		y[i] = alg_tanhf(x[i]);
+	}
+}
+
+static void fm_vsigmoidf_ref(const float* x, float* y, size_t n)
+{
+	size_t i;
+
+	for(i = 0; i < n; i++)
+	{
+		y[i] = alg_sigmoidf(x[i]);
+	}
+}
+
+static const alg_fastmath_kernel_t alg_fastmath_ref = { "ref", fm_vexpf_ref, fm_vtanhf_ref, fm_vsigmoidf_ref };
+
+/* the best first, the generic one is always there */
+const alg_isa_kernel_t alg_fastmath_kernels[] =
+{
+#ifdef FM_HAS_AVX2
+	{ ALG_ISA_AVX2, &alg_fastmath_avx2 },
+#endif
+#ifdef FM_HAS_SSE2
+	{ ALG_ISA_SSE2, &alg_fastmath_sse2 },
+#endif
+#ifdef FM_HAS_NEON
+	{ ALG_ISA_NEON, &alg_fastmath_neon },
+#endif
+	{ ALG_ISA_GENERIC, &alg_fastmath_ref },
+	{ ALG_ISA_GENERIC, NULL }
+};
+/* ============================ [ FUNCTIONS ] ====================================================== */
+#ifndef DISABLE_NN_FAST_MATH
+float alg_expf(float x)
+{
+	return fm_expf(x);
+}
+
+float alg_logf(float x)
+{
+	return fm_logf(x);
+}
+
+float alg_tanhf(float x)
+{
+	return fm_tanhf_e(x, fm_expf(-2.0f*fabsf(x)));
+}
+
+float alg_sigmoidf(float x)
+{
+	return 1.0f/(1.0f + fm_expf(-x));
+}
+#else /* DISABLE_NN_FAST_MATH */
+float alg_expf(float x)
+{
+	return (float)exp((double)x);
+}
+
+float alg_logf(float x)
+{
+	return (float)log((double)x);
+}
+
+float alg_tanhf(float x)
+{
+	return (float)tanh((double)x);
+}
+
+float alg_sigmoidf(float x)
+{
+	return (float)(1.0/(1.0 + exp(-(double)x)));
+}
+#endif /* DISABLE_NN_FAST_MATH */
+
+const alg_fastmath_kernel_t* alg_fastmath_kernel(const alg_fastmath_kernel_t* kernel)
+{
+	if(NULL == kernel)
+	{
+		kernel = (const alg_fastmath_kernel_t*)alg_isa_select(alg_fastmath_kernels, ALG_ISA_NUMBER);
+	}
+
+	return kernel;
+}
+
+void alg_vexpf(const float* x, float* y, size_t n)
+{
+	alg_fastmath_kernel(NULL)->vexpf(x, y, n);
+}
+
+void alg_vlogf(const float* x, float* y, size_t n)
+{
+	size_t i;
+
+	for(i = 0; i < n; i++)
+	{
+		y[i] = alg_logf(x[i]);
+	}
+}
+
+void alg_vtanhf(const float* x, float* y, size_t n)
+{
+	alg_fastmath_kernel(NULL)->vtanhf(x, y, n);
+}
+
+void alg_vsigmoidf(const float* x, float* y, size_t n)
+{
+	alg_fastmath_kernel(NULL)->vsigmoidf(x, y, n);
+}
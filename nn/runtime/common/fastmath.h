@@ -0,0 +1,45 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+#ifndef NN_RUNTIME_COMMON_FASTMATH_H_
+#define NN_RUNTIME_COMMON_FASTMATH_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <stddef.h>
+#include "cpu_isa.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* the vector loops of one instruction set, y[i] = f(x[i]), x and y may be the same buffer */
+typedef struct {
+	const char* name;
+	void (*vexpf)(const float* x, float* y, size_t n);
+	void (*vtanhf)(const float* x, float* y, size_t n);
+	void (*vsigmoidf)(const float* x, float* y, size_t n);
+} alg_fastmath_kernel_t;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* the alg_fastmath_kernel_t built in, for alg_isa_select */
+extern const alg_isa_kernel_t alg_fastmath_kernels[];
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+/* single precision exp/log/tanh/sigmoid by range reduction and polynomials (cephes),
+ * the relative error is below 1e-6 (exp, log, sigmoid) and 2e-6 (tanh).
+ * With DISABLE_NN_FAST_MATH they are the double precision libm ones, to verify. */
+float alg_expf(float x);
+float alg_logf(float x);
+float alg_tanhf(float x);
+float alg_sigmoidf(float x);
+/* kernel if not NULL, else the best one for this CPU */
+const alg_fastmath_kernel_t* alg_fastmath_kernel(const alg_fastmath_kernel_t* kernel);
+/* y[i] = f(x[i]) with alg_fastmath_kernel(NULL), x and y may be the same buffer */
+void alg_vexpf(const float* x, float* y, size_t n);
+void alg_vlogf(const float* x, float* y, size_t n);
+void alg_vtanhf(const float* x, float* y, size_t n);
+void alg_vsigmoidf(const float* x, float* y, size_t n);
+#ifdef __cplusplus
+}
+#endif
+#endif /* NN_RUNTIME_COMMON_FASTMATH_H_ */
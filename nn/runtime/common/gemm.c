@@ -0,0 +1,788 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "gemm.h"
+/* with GCC or clang on x86 all the kernels are built and the CPU picks one at
+ * runtime, elsewhere only the ones the compiler targets */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define GEMM_HAS_SSE2
+#define GEMM_HAS_AVX2
+#define GEMM_HAS_AVX512
+#define GEMM_TARGET_SSE2   __attribute__((target("sse2")))
+#define GEMM_TARGET_AVX2   __attribute__((target("avx2,fma")))
+#define GEMM_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#if defined(__AVX512F__)
+#include <immintrin.h>
+#define GEMM_HAS_AVX512
+#endif
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define GEMM_HAS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define GEMM_HAS_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define GEMM_HAS_NEON
+#endif
+#define GEMM_TARGET_SSE2
+#define GEMM_TARGET_AVX2
+#define GEMM_TARGET_AVX512
+#endif
+/* ============================ [ MACROS    ] ====================================================== */
+/* the micro kernel computes a MR x NR block of C from a panel of A packed as [kc][MR]
+ * and a panel of B packed as [kc][NR], both stay in registers and L1, the GEMV one
+ * computes NR outputs from a vector and a whole [K][NR] panel of B */
+#define GEMM_MR_MAX 8
+#define GEMM_NR_MAX 32
+
+/* a KC x NR panel of B stays in L1, a MC x KC block of A in L2, a KC x NC block of B in L3 */
+#ifndef GEMM_KC
+#define GEMM_KC 256
+#endif
+#ifndef GEMM_MC_PANELS
+#define GEMM_MC_PANELS 16
+#endif
+/* a multiple of all the NR */
+#ifndef GEMM_NC
+#define GEMM_NC 1024
+#endif
+
+#define GEMM_ALIGN 64
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct {
+	const float* A;
+	int lda;
+} alg_sgemm_matrix_t;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+#ifdef GEMM_HAS_AVX512
+#define AVX512_MR 8
+#define AVX512_NR 32
+#define AVX512_ROW(i) \
+		av = _mm512_set1_ps(a[i]); \
+		c##i##0 = _mm512_fmadd_ps(av, b0, c##i##0); c##i##1 = _mm512_fmadd_ps(av, b1, c##i##1)
+#define AVX512_LOAD(i) \
+		c##i##0 = _mm512_add_ps(c##i##0, _mm512_loadu_ps(c+i*ldc)); \
+		c##i##1 = _mm512_add_ps(c##i##1, _mm512_loadu_ps(c+i*ldc+16))
+#define AVX512_STORE(i) \
+		_mm512_storeu_ps(c+i*ldc, c##i##0); _mm512_storeu_ps(c+i*ldc+16, c##i##1)
+GEMM_TARGET_AVX512 static void alg_sgemm_kernel_avx512(int kc, const float* a, const float* b, float* c, int ldc, int accumulate)
+{
+	__m512 c00 = _mm512_setzero_ps(), c01 = _mm512_setzero_ps();
+	__m512 c10 = _mm512_setzero_ps(), c11 = _mm512_setzero_ps();
+	__m512 c20 = _mm512_setzero_ps(), c21 = _mm512_setzero_ps();
+	__m512 c30 = _mm512_setzero_ps(), c31 = _mm512_setzero_ps();
+	__m512 c40 = _mm512_setzero_ps(), c41 = _mm512_setzero_ps();
+	__m512 c50 = _mm512_setzero_ps(), c51 = _mm512_setzero_ps();
+	__m512 c60 = _mm512_setzero_ps(), c61 = _mm512_setzero_ps();
+	__m512 c70 = _mm512_setzero_ps(), c71 = _mm512_setzero_ps();
+	__m512 b0, b1, av;
+	int k;
+
+	for(k=0; k<kc; k++)
+	{
+		b0 = _mm512_load_ps(b);
+		b1 = _mm512_load_ps(b+16);
+		AVX512_ROW(0); AVX512_ROW(1); AVX512_ROW(2); AVX512_ROW(3);
+		AVX512_ROW(4); AVX512_ROW(5); AVX512_ROW(6); AVX512_ROW(7);
+		a += AVX512_MR;
+		b += AVX512_NR;
+	}
+
+	if(accumulate)
+	{
+		AVX512_LOAD(0); AVX512_LOAD(1); AVX512_LOAD(2); AVX512_LOAD(3);
+		AVX512_LOAD(4); AVX512_LOAD(5); AVX512_LOAD(6); AVX512_LOAD(7);
+	}
+
+	AVX512_STORE(0); AVX512_STORE(1); AVX512_STORE(2); AVX512_STORE(3);
+	AVX512_STORE(4); AVX512_STORE(5); AVX512_STORE(6); AVX512_STORE(7);
+}
+
+GEMM_TARGET_AVX512 static void alg_sgemv_kernel_avx512(int K, const float* x, const float* b, float* y)
+{
+	__m512 y00 = _mm512_setzero_ps(), y01 = _mm512_setzero_ps();
+	__m512 y10 = _mm512_setzero_ps(), y11 = _mm512_setzero_ps();
+	__m512 xv;
+	int k;
+
+	for(k=0; k+2<=K; k+=2)
+	{
+		xv = _mm512_set1_ps(x[k]);
+		y00 = _mm512_fmadd_ps(xv, _mm512_load_ps(b), y00);
+		y01 = _mm512_fmadd_ps(xv, _mm512_load_ps(b+16), y01);
+		xv = _mm512_set1_ps(x[k+1]);
+		y10 = _mm512_fmadd_ps(xv, _mm512_load_ps(b+32), y10);
+		y11 = _mm512_fmadd_ps(xv, _mm512_load_ps(b+48), y11);
+		b += 2*AVX512_NR;
+	}
+	if(k < K)
+	{
+		xv = _mm512_set1_ps(x[k]);
+		y00 = _mm512_fmadd_ps(xv, _mm512_load_ps(b), y00);
+		y01 = _mm512_fmadd_ps(xv, _mm512_load_ps(b+16), y01);
+	}
+
+	_mm512_storeu_ps(y, _mm512_add_ps(y00, y10));
+	_mm512_storeu_ps(y+16, _mm512_add_ps(y01, y11));
+}
+#endif
+
+#ifdef GEMM_HAS_AVX2
+#define AVX2_MR 6
+#define AVX2_NR 16
+GEMM_TARGET_AVX2 static void alg_sgemm_kernel_avx2(int kc, const float* a, const float* b, float* c, int ldc, int accumulate)
+{
+	__m256 c00 = _mm256_setzero_ps(), c01 = _mm256_setzero_ps();
+	__m256 c10 = _mm256_setzero_ps(), c11 = _mm256_setzero_ps();
+	__m256 c20 = _mm256_setzero_ps(), c21 = _mm256_setzero_ps();
+	__m256 c30 = _mm256_setzero_ps(), c31 = _mm256_setzero_ps();
+	__m256 c40 = _mm256_setzero_ps(), c41 = _mm256_setzero_ps();
+	__m256 c50 = _mm256_setzero_ps(), c51 = _mm256_setzero_ps();
+	__m256 b0, b1, av;
+	int k;
+
+	for(k=0; k<kc; k++)
+	{
+		b0 = _mm256_load_ps(b);
+		b1 = _mm256_load_ps(b+8);
+		av = _mm256_broadcast_ss(a);
+		c00 = _mm256_fmadd_ps(av, b0, c00); c01 = _mm256_fmadd_ps(av, b1, c01);
+		av = _mm256_broadcast_ss(a+1);
+		c10 = _mm256_fmadd_ps(av, b0, c10); c11 = _mm256_fmadd_ps(av, b1, c11);
+		av = _mm256_broadcast_ss(a+2);
+		c20 = _mm256_fmadd_ps(av, b0, c20); c21 = _mm256_fmadd_ps(av, b1, c21);
+		av = _mm256_broadcast_ss(a+3);
+		c30 = _mm256_fmadd_ps(av, b0, c30); c31 = _mm256_fmadd_ps(av, b1, c31);
+		av = _mm256_broadcast_ss(a+4);
+		c40 = _mm256_fmadd_ps(av, b0, c40); c41 = _mm256_fmadd_ps(av, b1, c41);
+		av = _mm256_broadcast_ss(a+5);
+		c50 = _mm256_fmadd_ps(av, b0, c50); c51 = _mm256_fmadd_ps(av, b1, c51);
+		a += AVX2_MR;
+		b += AVX2_NR;
+	}
+
+	if(accumulate)
+	{
+		c00 = _mm256_add_ps(c00, _mm256_loadu_ps(c)); c01 = _mm256_add_ps(c01, _mm256_loadu_ps(c+8));
+		c10 = _mm256_add_ps(c10, _mm256_loadu_ps(c+ldc)); c11 = _mm256_add_ps(c11, _mm256_loadu_ps(c+ldc+8));
+		c20 = _mm256_add_ps(c20, _mm256_loadu_ps(c+2*ldc)); c21 = _mm256_add_ps(c21, _mm256_loadu_ps(c+2*ldc+8));
+		c30 = _mm256_add_ps(c30, _mm256_loadu_ps(c+3*ldc)); c31 = _mm256_add_ps(c31, _mm256_loadu_ps(c+3*ldc+8));
+		c40 = _mm256_add_ps(c40, _mm256_loadu_ps(c+4*ldc)); c41 = _mm256_add_ps(c41, _mm256_loadu_ps(c+4*ldc+8));
+		c50 = _mm256_add_ps(c50, _mm256_loadu_ps(c+5*ldc)); c51 = _mm256_add_ps(c51, _mm256_loadu_ps(c+5*ldc+8));
+	}
+
+	_mm256_storeu_ps(c, c00); _mm256_storeu_ps(c+8, c01);
+	_mm256_storeu_ps(c+ldc, c10); _mm256_storeu_ps(c+ldc+8, c11);
+	_mm256_storeu_ps(c+2*ldc, c20); _mm256_storeu_ps(c+2*ldc+8, c21);
+	_mm256_storeu_ps(c+3*ldc, c30); _mm256_storeu_ps(c+3*ldc+8, c31);
+	_mm256_storeu_ps(c+4*ldc, c40); _mm256_storeu_ps(c+4*ldc+8, c41);
+	_mm256_storeu_ps(c+5*ldc, c50); _mm256_storeu_ps(c+5*ldc+8, c51);
+}
+
+GEMM_TARGET_AVX2 static void alg_sgemv_kernel_avx2(int K, const float* x, const float* b, float* y)
+{
+	__m256 y00 = _mm256_setzero_ps(), y01 = _mm256_setzero_ps();
+	__m256 y10 = _mm256_setzero_ps(), y11 = _mm256_setzero_ps();
+	__m256 xv;
+	int k;
+
+	for(k=0; k+2<=K; k+=2)
+	{
+		xv = _mm256_broadcast_ss(x+k);
+		y00 = _mm256_fmadd_ps(xv, _mm256_load_ps(b), y00);
+		y01 = _mm256_fmadd_ps(xv, _mm256_load_ps(b+8), y01);
+		xv = _mm256_broadcast_ss(x+k+1);
+		y10 = _mm256_fmadd_ps(xv, _mm256_load_ps(b+16), y10);
+		y11 = _mm256_fmadd_ps(xv, _mm256_load_ps(b+24), y11);
+		b += 2*AVX2_NR;
+	}
+	if(k < K)
+	{
+		xv = _mm256_broadcast_ss(x+k);
+		y00 = _mm256_fmadd_ps(xv, _mm256_load_ps(b), y00);
+		y01 = _mm256_fmadd_ps(xv, _mm256_load_ps(b+8), y01);
+	}
+
+	_mm256_storeu_ps(y, _mm256_add_ps(y00, y10));
+	_mm256_storeu_ps(y+8, _mm256_add_ps(y01, y11));
+}
+#endif
+
+#ifdef GEMM_HAS_SSE2
+#define SSE2_MR 4
+#define SSE2_NR 8
+GEMM_TARGET_SSE2 static void alg_sgemm_kernel_sse(int kc, const float* a, const float* b, float* c, int ldc, int accumulate)
+{
+	__m128 c00 = _mm_setzero_ps(), c01 = _mm_setzero_ps();
+	__m128 c10 = _mm_setzero_ps(), c11 = _mm_setzero_ps();
+	__m128 c20 = _mm_setzero_ps(), c21 = _mm_setzero_ps();
+	__m128 c30 = _mm_setzero_ps(), c31 = _mm_setzero_ps();
+	__m128 b0, b1, av;
+	int k;
+
+	for(k=0; k<kc; k++)
+	{
+		b0 = _mm_load_ps(b);
+		b1 = _mm_load_ps(b+4);
+		av = _mm_set1_ps(a[0]);
+		c00 = _mm_add_ps(c00, _mm_mul_ps(av, b0)); c01 = _mm_add_ps(c01, _mm_mul_ps(av, b1));
+		av = _mm_set1_ps(a[1]);
+		c10 = _mm_add_ps(c10, _mm_mul_ps(av, b0)); c11 = _mm_add_ps(c11, _mm_mul_ps(av, b1));
+		av = _mm_set1_ps(a[2]);
+		c20 = _mm_add_ps(c20, _mm_mul_ps(av, b0)); c21 = _mm_add_ps(c21, _mm_mul_ps(av, b1));
+		av = _mm_set1_ps(a[3]);
+		c30 = _mm_add_ps(c30, _mm_mul_ps(av, b0)); c31 = _mm_add_ps(c31, _mm_mul_ps(av, b1));
+		a += SSE2_MR;
+		b += SSE2_NR;
+	}
+
+	if(accumulate)
+	{
+		c00 = _mm_add_ps(c00, _mm_loadu_ps(c)); c01 = _mm_add_ps(c01, _mm_loadu_ps(c+4));
+		c10 = _mm_add_ps(c10, _mm_loadu_ps(c+ldc)); c11 = _mm_add_ps(c11, _mm_loadu_ps(c+ldc+4));
+		c20 = _mm_add_ps(c20, _mm_loadu_ps(c+2*ldc)); c21 = _mm_add_ps(c21, _mm_loadu_ps(c+2*ldc+4));
+		c30 = _mm_add_ps(c30, _mm_loadu_ps(c+3*ldc)); c31 = _mm_add_ps(c31, _mm_loadu_ps(c+3*ldc+4));
+	}
+
+	_mm_storeu_ps(c, c00); _mm_storeu_ps(c+4, c01);
+	_mm_storeu_ps(c+ldc, c10); _mm_storeu_ps(c+ldc+4, c11);
+	_mm_storeu_ps(c+2*ldc, c20); _mm_storeu_ps(c+2*ldc+4, c21);
+	_mm_storeu_ps(c+3*ldc, c30); _mm_storeu_ps(c+3*ldc+4, c31);
+}
+
+GEMM_TARGET_SSE2 static void alg_sgemv_kernel_sse(int K, const float* x, const float* b, float* y)
+{
+	__m128 y00 = _mm_setzero_ps(), y01 = _mm_setzero_ps();
+	__m128 y10 = _mm_setzero_ps(), y11 = _mm_setzero_ps();
+	__m128 xv;
+	int k;
+
+	for(k=0; k+2<=K; k+=2)
+	{
+		xv = _mm_set1_ps(x[k]);
+		y00 = _mm_add_ps(y00, _mm_mul_ps(xv, _mm_load_ps(b)));
+		y01 = _mm_add_ps(y01, _mm_mul_ps(xv, _mm_load_ps(b+4)));
+		xv = _mm_set1_ps(x[k+1]);
+		y10 = _mm_add_ps(y10, _mm_mul_ps(xv, _mm_load_ps(b+8)));
+		y11 = _mm_add_ps(y11, _mm_mul_ps(xv, _mm_load_ps(b+12)));
+		b += 2*SSE2_NR;
+	}
+	if(k < K)
+	{
+		xv = _mm_set1_ps(x[k]);
+		y00 = _mm_add_ps(y00, _mm_mul_ps(xv, _mm_load_ps(b)));
+		y01 = _mm_add_ps(y01, _mm_mul_ps(xv, _mm_load_ps(b+4)));
+	}
+
+	_mm_storeu_ps(y, _mm_add_ps(y00, y10));
+	_mm_storeu_ps(y+4, _mm_add_ps(y01, y11));
+}
+#endif
+
+#ifdef GEMM_HAS_NEON
+#define NEON_MR 4
+#define NEON_NR 8
+#if defined(__aarch64__)
+#define GEMM_VFMA(c, a, b) vfmaq_f32(c, a, b)
+#else
+#define GEMM_VFMA(c, a, b) vmlaq_f32(c, a, b)
+#endif
+static void alg_sgemm_kernel_neon(int kc, const float* a, const float* b, float* c, int ldc, int accumulate)
+{
+	float32x4_t c00 = vdupq_n_f32(0), c01 = vdupq_n_f32(0);
+	float32x4_t c10 = vdupq_n_f32(0), c11 = vdupq_n_f32(0);
+	float32x4_t c20 = vdupq_n_f32(0), c21 = vdupq_n_f32(0);
+	float32x4_t c30 = vdupq_n_f32(0), c31 = vdupq_n_f32(0);
+	float32x4_t b0, b1, av;
+	int k;
+
+	for(k=0; k<kc; k++)
+	{
+		b0 = vld1q_f32(b);
+		b1 = vld1q_f32(b+4);
+		av = vdupq_n_f32(a[0]);
+		c00 = GEMM_VFMA(c00, av, b0); c01 = GEMM_VFMA(c01, av, b1);
+		av = vdupq_n_f32(a[1]);
+		c10 = GEMM_VFMA(c10, av, b0); c11 = GEMM_VFMA(c11, av, b1);
+		av = vdupq_n_f32(a[2]);
+		c20 = GEMM_VFMA(c20, av, b0); c21 = GEMM_VFMA(c21, av, b1);
+		av = vdupq_n_f32(a[3]);
+		c30 = GEMM_VFMA(c30, av, b0); c31 = GEMM_VFMA(c31, av, b1);
+		a += NEON_MR;
+		b += NEON_NR;
+	}
+
+	if(accumulate)
+	{
+		c00 = vaddq_f32(c00, vld1q_f32(c)); c01 = vaddq_f32(c01, vld1q_f32(c+4));
+		c10 = vaddq_f32(c10, vld1q_f32(c+ldc)); c11 = vaddq_f32(c11, vld1q_f32(c+ldc+4));
+		c20 = vaddq_f32(c20, vld1q_f32(c+2*ldc)); c21 = vaddq_f32(c21, vld1q_f32(c+2*ldc+4));
+		c30 = vaddq_f32(c30, vld1q_f32(c+3*ldc)); c31 = vaddq_f32(c31, vld1q_f32(c+3*ldc+4));
+	}
+
+	vst1q_f32(c, c00); vst1q_f32(c+4, c01);
+	vst1q_f32(c+ldc, c10); vst1q_f32(c+ldc+4, c11);
+	vst1q_f32(c+2*ldc, c20); vst1q_f32(c+2*ldc+4, c21);
+	vst1q_f32(c+3*ldc, c30); vst1q_f32(c+3*ldc+4, c31);
+}
+
+static void alg_sgemv_kernel_neon(int K, const float* x, const float* b, float* y)
+{
+	float32x4_t y00 = vdupq_n_f32(0), y01 = vdupq_n_f32(0);
+	float32x4_t y10 = vdupq_n_f32(0), y11 = vdupq_n_f32(0);
+	float32x4_t xv;
+	int k;
+
+	for(k=0; k+2<=K; k+=2)
+	{
+		xv = vdupq_n_f32(x[k]);
+		y00 = GEMM_VFMA(y00, xv, vld1q_f32(b));
+		y01 = GEMM_VFMA(y01, xv, vld1q_f32(b+4));
+		xv = vdupq_n_f32(x[k+1]);
+		y10 = GEMM_VFMA(y10, xv, vld1q_f32(b+8));
+		y11 = GEMM_VFMA(y11, xv, vld1q_f32(b+12));
+		b += 2*NEON_NR;
+	}
+	if(k < K)
+	{
+		xv = vdupq_n_f32(x[k]);
+		y00 = GEMM_VFMA(y00, xv, vld1q_f32(b));
+		y01 = GEMM_VFMA(y01, xv, vld1q_f32(b+4));
+	}
+
+	vst1q_f32(y, vaddq_f32(y00, y10));
+	vst1q_f32(y+4, vaddq_f32(y01, y11));
+}
+#endif
+
+#define REF_MR 4
+#define REF_NR 4
+static void alg_sgemm_kernel_ref(int kc, const float* a, const float* b, float* c, int ldc, int accumulate)
+{
+	float acc[REF_MR][REF_NR] = { { 0 } };
+	int i, j, k;
+
+	for(k=0; k<kc; k++)
+	{
+		for(i=0; i<REF_MR; i++)
+		{
+			for(j=0; j<REF_NR; j++)
+			{
+				acc[i][j] += a[i]*b[j];
+			}
+		}
+		a += REF_MR;
+		b += REF_NR;
+	}
+
+	for(i=0; i<REF_MR; i++)
+	{
+		for(j=0; j<REF_NR; j++)
+		{
+			c[i*ldc+j] = accumulate ? (c[i*ldc+j] + acc[i][j]) : acc[i][j];
+		}
+	}
+}
+
+static void alg_sgemv_kernel_ref(int K, const float* x, const float* b, float* y)
+{
+	int j, k;
+
+	for(j=0; j<REF_NR; j++)
+	{
+		y[j] = 0;
+	}
+
+	for(k=0; k<K; k++)
+	{
+		for(j=0; j<REF_NR; j++)
+		{
+			y[j] += x[k]*b[j];
+		}
+		b += REF_NR;
+	}
+}
+
+#ifdef GEMM_HAS_AVX512
+static const alg_sgemm_kernel_t alg_sgemm_avx512 = { "avx512", AVX512_MR, AVX512_NR, alg_sgemm_kernel_avx512, alg_sgemv_kernel_avx512 };
+#endif
+#ifdef GEMM_HAS_AVX2
+static const alg_sgemm_kernel_t alg_sgemm_avx2 = { "avx2", AVX2_MR, AVX2_NR, alg_sgemm_kernel_avx2, alg_sgemv_kernel_avx2 };
+#endif
+#ifdef GEMM_HAS_SSE2
+static const alg_sgemm_kernel_t alg_sgemm_sse2 = { "sse2", SSE2_MR, SSE2_NR, alg_sgemm_kernel_sse, alg_sgemv_kernel_sse };
+#endif
+#ifdef GEMM_HAS_NEON
+static const alg_sgemm_kernel_t alg_sgemm_neon = { "neon", NEON_MR, NEON_NR, alg_sgemm_kernel_neon, alg_sgemv_kernel_neon };
+#endif
+static const alg_sgemm_kernel_t alg_sgemm_ref = { "ref", REF_MR, REF_NR, alg_sgemm_kernel_ref, alg_sgemv_kernel_ref };
+
+/* the best first, the generic one is always there */
+const alg_isa_kernel_t alg_sgemm_kernels[] =
+{
+#ifdef GEMM_HAS_AVX512
+	{ ALG_ISA_AVX512, &alg_sgemm_avx512 },
+#endif
+#ifdef GEMM_HAS_AVX2
+	{ ALG_ISA_AVX2, &alg_sgemm_avx2 },
+#endif
+#ifdef GEMM_HAS_SSE2
+	{ ALG_ISA_SSE2, &alg_sgemm_sse2 },
+#endif
+#ifdef GEMM_HAS_NEON
+	{ ALG_ISA_NEON, &alg_sgemm_neon },
+#endif
+	{ ALG_ISA_GENERIC, &alg_sgemm_ref },
+	{ ALG_ISA_GENERIC, NULL }
+};
+
+static void alg_sgemm_pack_matrix(const void* param, int i, int mr, int k, int kc, float* dst, int ld)
+{
+	const alg_sgemm_matrix_t* m = (const alg_sgemm_matrix_t*)param;
+	const float* A;
+	int r, kk;
+
+	for(r=0; r<mr; r++)
+	{
+		A = m->A + (size_t)(i+r)*m->lda + k;
+		for(kk=0; kk<kc; kk++)
+		{
+			dst[kk*ld+r] = A[kk];
+		}
+	}
+}
+
+/* a panel of MR rows of A, zero padded */
+static void alg_sgemm_pack_a(const alg_sgemm_kernel_t* kernel, alg_sgemm_pack_t pack, const void* param,
+		int i, int mr, int k, int kc, float* dst)
+{
+	int r, kk;
+
+	pack(param, i, mr, k, kc, dst, kernel->mr);
+	for(r=mr; r<kernel->mr; r++)
+	{
+		for(kk=0; kk<kc; kk++)
+		{
+			dst[kk*kernel->mr+r] = 0;
+		}
+	}
+}
+
+/* panels of NR columns of B', zero padded */
+static void alg_sgemm_pack_b(const alg_sgemm_kernel_t* kernel, const float* B, int ldb, int n, int k, int kc, float* dst)
+{
+	const int NR = kernel->nr;
+	const float* b;
+	int jr, j, nr, kk;
+
+	for(jr=0; jr<n; jr+=NR)
+	{
+		nr = NN_MIN(NR, n-jr);
+		for(j=0; j<nr; j++)
+		{
+			b = B + (size_t)(jr+j)*ldb + k;
+			for(kk=0; kk<kc; kk++)
+			{
+				dst[kk*NR+j] = b[kk];
+			}
+		}
+		for(; j<NR; j++)
+		{
+			for(kk=0; kk<kc; kk++)
+			{
+				dst[kk*NR+j] = 0;
+			}
+		}
+		dst += kc*NR;
+	}
+}
+
+static void alg_sgemm_finish(float* c, int ldc, int mr, int nr, const float* bias, layer_activation_type_t act)
+{
+	int i, j;
+	float v;
+
+	for(i=0; i<mr; i++)
+	{
+		for(j=0; j<nr; j++)
+		{
+			v = c[j];
+			if(NULL != bias)
+			{
+				v += bias[j];
+			}
+			switch(act) {
+				case L_ACT_RELU:
+					if(v<0) v = 0;
+					break;
+				case L_ACT_LEAKY:
+					if(v<0) v = 0.1*v;
+					break;
+				default:
+					break;
+			}
+			c[j] = v;
+		}
+		c += ldc;
+	}
+}
+
+static void* alg_sgemm_align(void* p)
+{
+	return (void*)(((size_t)p + GEMM_ALIGN - 1) & ~(size_t)(GEMM_ALIGN - 1));
+}
+
+static const alg_sgemm_kernel_t* alg_sgemm_get_kernel(const alg_sgemm_kernel_t* kernel)
+{
+	if(NULL == kernel)
+	{
+		kernel = (const alg_sgemm_kernel_t*)alg_isa_select(alg_sgemm_kernels, ALG_ISA_NUMBER);
+	}
+
+	return kernel;
+}
+
+/* B is packed on the fly if packed is NULL, else packed holds the [K][NR] panels of
+ * the rows of B one after another */
+static int alg_sgemm_run(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		alg_sgemm_pack_t pack, const void* param,
+		const float* B, int ldb, const float* packed,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act)
+{
+	int r = 0;
+	const int MR = kernel->mr;
+	const int NR = kernel->nr;
+	const int MC = MR*GEMM_MC_PANELS;
+	int jc, pc, ic, jr, ir, nc, kc, mc, mr, nr, i;
+	int last;
+	void* mem;
+	float* ap;
+	float* bp = NULL;
+	const float* b;
+	float* c;
+	float tile[GEMM_MR_MAX*GEMM_NR_MAX];
+	int kcMax = NN_MIN(K, GEMM_KC);
+	int ncMax = (NN_MIN(N, GEMM_NC) + NR - 1) / NR * NR;
+	/* the distance between 2 panels of B */
+	int ldp;
+
+	if(NULL != packed)
+	{
+		ncMax = 0;
+	}
+
+	mem = malloc(sizeof(float)*((size_t)MC*kcMax + (size_t)kcMax*ncMax) + 2*GEMM_ALIGN);
+	if(NULL == mem)
+	{
+		return NN_E_NO_MEMORY;
+	}
+
+	ap = (float*)alg_sgemm_align(mem);
+	if(NULL == packed)
+	{
+		bp = (float*)alg_sgemm_align(ap + (size_t)MC*kcMax);
+	}
+
+	for(jc=0; jc<N; jc+=GEMM_NC)
+	{
+		nc = NN_MIN(GEMM_NC, N-jc);
+		for(pc=0; pc<K; pc+=GEMM_KC)
+		{
+			kc = NN_MIN(GEMM_KC, K-pc);
+			last = (pc+kc) >= K;
+			if(NULL == packed)
+			{
+				alg_sgemm_pack_b(kernel, B+(size_t)jc*ldb, ldb, nc, pc, kc, bp);
+				b = bp;
+				ldp = kc*NR;
+			}
+			else
+			{
+				b = packed + (size_t)jc*K + pc*NR;
+				ldp = K*NR;
+			}
+			for(ic=0; ic<M; ic+=MC)
+			{
+				mc = NN_MIN(MC, M-ic);
+				for(ir=0; ir<mc; ir+=MR)
+				{
+					alg_sgemm_pack_a(kernel, pack, param, ic+ir, NN_MIN(MR, mc-ir), pc, kc, ap+ir*kc);
+				}
+
+				for(jr=0; jr<nc; jr+=NR)
+				{
+					nr = NN_MIN(NR, nc-jr);
+					for(ir=0; ir<mc; ir+=MR)
+					{
+						mr = NN_MIN(MR, mc-ir);
+						c = C + (size_t)(ic+ir)*ldc + jc + jr;
+						if((MR == mr) && (NR == nr))
+						{
+							kernel->gemm(kc, ap+ir*kc, b+(size_t)jr/NR*ldp, c, ldc, pc > 0);
+						}
+						else
+						{	/* the edge goes through a full tile */
+							if(pc > 0)
+							{
+								for(i=0; i<mr; i++)
+								{
+									memcpy(&tile[i*NR], c+(size_t)i*ldc, nr*sizeof(float));
+								}
+							}
+							kernel->gemm(kc, ap+ir*kc, b+(size_t)jr/NR*ldp, tile, NR, pc > 0);
+							for(i=0; i<mr; i++)
+							{
+								memcpy(c+(size_t)i*ldc, &tile[i*NR], nr*sizeof(float));
+							}
+						}
+
+						if(last)
+						{
+							alg_sgemm_finish(c, ldc, mr, nr, (NULL != bias) ? (bias+jc+jr) : NULL, act);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	free(mem);
+
+	return r;
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+size_t alg_sgemm_packed_size(const alg_sgemm_kernel_t* kernel, int N, int K)
+{
+	const int NR = alg_sgemm_get_kernel(kernel)->nr;
+	size_t sz = (size_t)(N + NR - 1) / NR * NR * K;
+	size_t align = GEMM_ALIGN / sizeof(float);
+
+	return (sz + align - 1) / align * align;
+}
+
+void* alg_sgemm_malloc(size_t sz)
+{
+	void* mem = malloc(sz + GEMM_ALIGN + sizeof(void*));
+	void* p = NULL;
+
+	if(NULL != mem)
+	{
+		p = alg_sgemm_align((char*)mem + sizeof(void*));
+		((void**)p)[-1] = mem;
+	}
+
+	return p;
+}
+
+void alg_sgemm_free(void* p)
+{
+	if(NULL != p)
+	{
+		free(((void**)p)[-1]);
+	}
+}
+
+const alg_sgemm_kernel_t* alg_sgemm_kernel(const alg_sgemm_kernel_t* kernel)
+{
+	return alg_sgemm_get_kernel(kernel);
+}
+
+int alg_sgemm_panel_width(const alg_sgemm_kernel_t* kernel)
+{
+	return alg_sgemm_get_kernel(kernel)->nr;
+}
+
+void alg_sgemm_pack_nt(const alg_sgemm_kernel_t* kernel, int N, int K, const float* B, int ldb, float* packed)
+{
+	alg_sgemm_pack_b(alg_sgemm_get_kernel(kernel), B, ldb, N, 0, K, packed);
+}
+
+int alg_sgemv_packed(const alg_sgemm_kernel_t* kernel, int N, int K,
+		const float* x,
+		const float* packed,
+		const float* bias,
+		float* y,
+		layer_activation_type_t act)
+{
+	int j, nr;
+	float tile[GEMM_NR_MAX];
+
+	kernel = alg_sgemm_get_kernel(kernel);
+	for(j=0; j<N; j+=kernel->nr)
+	{
+		nr = NN_MIN(kernel->nr, N-j);
+		if(kernel->nr == nr)
+		{
+			kernel->gemv(K, x, packed+(size_t)j*K, y+j);
+		}
+		else
+		{
+			kernel->gemv(K, x, packed+(size_t)j*K, tile);
+			memcpy(y+j, tile, nr*sizeof(float));
+		}
+		alg_sgemm_finish(y+j, 0, 1, nr, (NULL != bias) ? (bias+j) : NULL, act);
+	}
+
+	return 0;
+}
+
+int alg_sgemm_nt_ex(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		alg_sgemm_pack_t pack, const void* param,
+		const float* B, int ldb,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act)
+{
+	return alg_sgemm_run(alg_sgemm_get_kernel(kernel), M, N, K, pack, param, B, ldb, NULL, bias, C, ldc, act);
+}
+
+int alg_sgemm_nt_ex_packed(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		alg_sgemm_pack_t pack, const void* param,
+		const float* packed,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act)
+{
+	return alg_sgemm_run(alg_sgemm_get_kernel(kernel), M, N, K, pack, param, NULL, 0, packed, bias, C, ldc, act);
+}
+
+int alg_sgemm_nt_packed(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		const float* A, int lda,
+		const float* packed,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act)
+{
+	alg_sgemm_matrix_t m;
+
+	m.A = A;
+	m.lda = lda;
+
+	return alg_sgemm_run(alg_sgemm_get_kernel(kernel), M, N, K, alg_sgemm_pack_matrix, &m, NULL, 0, packed, bias, C, ldc, act);
+}
+
+int alg_sgemm_nt(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		const float* A, int lda,
+		const float* B, int ldb,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act)
+{
+	alg_sgemm_matrix_t m;
+
+	m.A = A;
+	m.lda = lda;
+
+	return alg_sgemm_nt_ex(kernel, M, N, K, alg_sgemm_pack_matrix, &m, B, ldb, bias, C, ldc, act);
+}
@@ -0,0 +1,84 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+#ifndef NN_RUNTIME_COMMON_GEMM_H_
+#define NN_RUNTIME_COMMON_GEMM_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "nn.h"
+#include "cpu_isa.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* copy the rows [i, i+mr) and the columns [k, k+kc) of the matrix A to dst, with
+ * dst[kk*ld+r] = A[i+r][k+kk], this lets the caller build A on the fly (im2col) */
+typedef void (*alg_sgemm_pack_t)(const void* param, int i, int mr, int k, int kc, float* dst, int ld);
+
+/* the micro-kernels of one instruction set, the packed B depends on nr so the
+ * same kernel must be used to pack and to multiply */
+typedef struct {
+	const char* name;
+	int mr;
+	int nr;
+	void (*gemm)(int kc, const float* a, const float* b, float* c, int ldc, int accumulate);
+	void (*gemv)(int K, const float* x, const float* b, float* y);
+} alg_sgemm_kernel_t;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* the alg_sgemm_kernel_t built in, for alg_isa_select */
+extern const alg_isa_kernel_t alg_sgemm_kernels[];
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+/* C[M][N] = act(A[M][K] * B[N][K]' + bias[N]), all row major, bias may be NULL.
+ * The B layout is the one of the weights of CONV2D(OHWI) and DENSE.
+ * A NULL kernel everywhere means the best one for this CPU. */
+const alg_sgemm_kernel_t* alg_sgemm_kernel(const alg_sgemm_kernel_t* kernel);
+int alg_sgemm_nt(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		const float* A, int lda,
+		const float* B, int ldb,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act);
+/* same as alg_sgemm_nt but A is given by a pack function */
+int alg_sgemm_nt_ex(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		alg_sgemm_pack_t pack, const void* param,
+		const float* B, int ldb,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act);
+/* B can be packed once (weights) into the layout of the micro-kernel, this is the
+ * number of floats it takes, a multiple of the alignment. The rows of B are packed
+ * by panels of alg_sgemm_panel_width(), so for a j multiple of it, packed+j*K is
+ * the packed B from its row j. */
+size_t alg_sgemm_packed_size(const alg_sgemm_kernel_t* kernel, int N, int K);
+int alg_sgemm_panel_width(const alg_sgemm_kernel_t* kernel);
+/* memory aligned for the micro-kernel, for the packed matrices */
+void* alg_sgemm_malloc(size_t sz);
+void alg_sgemm_free(void* p);
+void alg_sgemm_pack_nt(const alg_sgemm_kernel_t* kernel, int N, int K, const float* B, int ldb, float* packed);
+/* same as alg_sgemm_nt and alg_sgemm_nt_ex with B packed by alg_sgemm_pack_nt */
+int alg_sgemm_nt_packed(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		const float* A, int lda,
+		const float* packed,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act);
+int alg_sgemm_nt_ex_packed(const alg_sgemm_kernel_t* kernel, int M, int N, int K,
+		alg_sgemm_pack_t pack, const void* param,
+		const float* packed,
+		const float* bias,
+		float* C, int ldc,
+		layer_activation_type_t act);
+/* y[N] = act(B[N][K] * x[K] + bias[N]) with B packed by alg_sgemm_pack_nt */
+int alg_sgemv_packed(const alg_sgemm_kernel_t* kernel, int N, int K,
+		const float* x,
+		const float* packed,
+		const float* bias,
+		float* y,
+		layer_activation_type_t act);
+#ifdef __cplusplus
+}
+#endif
+#endif /* NN_RUNTIME_COMMON_GEMM_H_ */
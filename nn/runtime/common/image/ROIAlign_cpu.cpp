@@ -351,10 +351,10 @@ extern "C" int CropAndResize_forward_cpu(float* o, const float* in,
 extern "C" int Pyramid_ROIAlign_forward_cpu(const nn_t* nn, const layer_t* layer)
 {
   int r = 0;
-  layer_context_t* context = layer->C->context;
-  layer_context_t* roi_context = layer->inputs[0]->C->context;
+  layer_context_t* context = LAYER_CONTEXT(nn, layer);
+  layer_context_t* roi_context = LAYER_CONTEXT(nn, layer->inputs[0]);
   const layer_t** features = &layer->inputs[1];
-  layer_context_t* img_context = nn->network->inputs[0]->layer->C->context;
+  layer_context_t* img_context = LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
   layer_context_t* feature_context;
   int n_features = 0; while(features[n_features] != NULL) n_features++;
   int num_rois;
@@ -398,9 +398,9 @@ extern "C" int Pyramid_ROIAlign_forward_cpu(const nn_t* nn, const layer_t* layer
     roi_level = calc_roi_level(y1,x1,y2,x2,image_area, n_features);
     NNLOG(NN_DEBUG, (" ROI @[%.2f,%.2f,%.2f,%.2f] from feature %d [%d %d %d %d]\n",
                     y1, x1, y2, x2, roi_level,
-                    L_SHAPES(features[roi_level>0?roi_level:0])));
+                    L_SHAPES(nn, features[roi_level>0?roi_level:0])));
     if(roi_level >= 0) {
-      feature_context = features[roi_level]->C->context;
+      feature_context = LAYER_CONTEXT(nn, features[roi_level]);
       feature = (float*)feature_context->out[0];
       CropAndResizeForward_cpu_kernel(1, feature, 1.0f, channels,
               feature_context->nhwc.H, feature_context->nhwc.W,
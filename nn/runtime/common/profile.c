@@ -0,0 +1,231 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "profile.h"
+#ifndef DISABLE_NN_PROFILE
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+/* ============================ [ MACROS    ] ====================================================== */
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+static const char* const op_names[] =
+{
+#define OP_DEF(op) #op,
+	#include "opdef.h"
+#undef OP_DEF
+};
+/* ============================ [ LOCALS    ] ====================================================== */
+static size_t profile_get_type_size(layer_data_type_t dtype)
+{
+	size_t sz;
+
+	switch(dtype)
+	{
+		case L_DT_INT8:
+		case L_DT_UINT8:
+			sz = 1;
+			break;
+		case L_DT_INT16:
+		case L_DT_UINT16:
+			sz = 2;
+			break;
+		case L_DT_DOUBLE:
+			sz = 8;
+			break;
+		default:
+			sz = 4;
+			break;
+	}
+
+	return sz;
+}
+
+static void profile_print_string(FILE* fp, const char* s)
+{
+	fputc('"', fp);
+	for(; '\0' != (*s); s++)
+	{
+		if(('"' == (*s)) || ('\\' == (*s)))
+		{
+			fputc('\\', fp);
+		}
+		fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+/* ============================ [ FUNCTIONS ] ====================================================== */
+uint64_t rte_profile_now(void)
+{
+#ifdef _WIN32
+	LARGE_INTEGER freq, counter;
+
+	QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&counter);
+
+	return (uint64_t)((double)counter.QuadPart*1000000000.0/freq.QuadPart);
+#else
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec*1000000000u + ts.tv_nsec;
+#endif
+}
+
+void rte_profile_begin(const nn_t* nn)
+{
+	nn->profile->start = rte_profile_now();
+}
+
+void rte_profile_end(const nn_t* nn)
+{
+	nn_profile_t* profile = nn->profile;
+
+	profile->duration = rte_profile_now() - profile->start;
+	profile->total += profile->duration;
+	profile->runs ++;
+}
+
+/* the layers running in parallel each have their own record, so no lock is needed */
+void rte_profile_layer(const nn_t* nn, const layer_t* layer, uint64_t start)
+{
+	nn_profile_t* profile = nn->profile;
+	nn_layer_profile_t* record = &profile->layers[nn_get_layer_id(nn, layer)];
+	layer_context_t* context = LAYER_CONTEXT(nn, layer);
+	uint64_t end = rte_profile_now();
+
+	record->start = start - profile->start;
+	record->duration = end - start;
+	record->total += record->duration;
+	if(NULL != context)
+	{
+		record->out_bytes = NHWC_SIZE(context->nhwc)*profile_get_type_size(context->dtype);
+	}
+}
+
+int nn_set_profile(nn_t* nn, int enable)
+{
+	int r = 0;
+	nn_profile_t* profile = nn->profile;
+	size_t i;
+
+	if(enable && (NULL == profile))
+	{
+		profile = malloc(sizeof(nn_profile_t)+nn->layer_number*sizeof(nn_layer_profile_t));
+		if(NULL != profile)
+		{
+			memset(profile, 0, sizeof(nn_profile_t)+nn->layer_number*sizeof(nn_layer_profile_t));
+			profile->layer_number = nn->layer_number;
+			profile->layers = (nn_layer_profile_t*)&profile[1];
+			for(i=0; i<nn->layer_number; i++)
+			{
+				profile->layers[i].layer = nn->network->layers[i];
+			}
+			nn->profile = profile;
+		}
+		else
+		{
+			r = NN_E_NO_MEMORY;
+		}
+	}
+	else if((!enable) && (NULL != profile))
+	{
+		nn->profile = NULL;
+		free(profile);
+	}
+	else
+	{
+		/* pass */
+	}
+
+	return r;
+}
+
+const nn_profile_t* nn_get_profile(const nn_t* nn)
+{
+	return nn->profile;
+}
+
+/* chrome://tracing format of the last run, layers that overlap in time go to
+ * different rows, the average over all the profiled runs is given in args */
+int nn_dump_profile(const nn_t* nn, const char* path)
+{
+	int r = 0;
+	const nn_profile_t* profile = nn->profile;
+	const nn_layer_profile_t* record;
+	uint64_t* rows = NULL;
+	size_t nrow = 0;
+	size_t i, row;
+	FILE* fp = NULL;
+
+	if((NULL == profile) || (0 == profile->runs))
+	{
+		r = NN_E_INVALID_PARAMETER;
+	}
+
+	if(0 == r)
+	{
+		rows = malloc((profile->layer_number+1)*sizeof(uint64_t));
+		if(NULL == rows)
+		{
+			r = NN_E_NO_MEMORY;
+		}
+	}
+
+	if(0 == r)
+	{
+		fp = fopen(path, "w");
+		if(NULL == fp)
+		{
+			NNLOG(NN_ERROR, ("can't open %s for the profile\n", path));
+			r = NN_E_INVALID_PARAMETER;
+		}
+	}
+
+	if(0 == r)
+	{
+		fprintf(fp, "{\"traceEvents\":[\n");
+		fprintf(fp, "{\"name\":");
+		profile_print_string(fp, (NULL != nn->network->name) ? nn->network->name : "network");
+		fprintf(fp, ",\"cat\":\"predict\",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":0,\"dur\":%.3f,"
+				"\"args\":{\"runs\":%d,\"avg_us\":%.3f}}",
+				profile->duration/1000.0, (int)profile->runs, profile->total/1000.0/profile->runs);
+
+		for(i=0; i<profile->layer_number; i++)
+		{
+			record = &profile->layers[i];
+			for(row=0; (row<nrow) && (rows[row] > record->start); row++);
+			if(row == nrow)
+			{
+				nrow ++;
+			}
+			rows[row] = record->start + record->duration;
+
+			fprintf(fp, ",\n{\"name\":");
+			profile_print_string(fp, record->layer->name);
+			fprintf(fp, ",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,"
+					"\"args\":{\"op\":\"%s\",\"bytes\":%d,\"avg_us\":%.3f}}",
+					op_names[record->layer->op], (int)row+1,
+					record->start/1000.0, record->duration/1000.0,
+					op_names[record->layer->op], (int)record->out_bytes,
+					record->total/1000.0/profile->runs);
+		}
+
+		fprintf(fp, "\n],\"displayTimeUnit\":\"ms\"}\n");
+		fclose(fp);
+	}
+
+	if(NULL != rows)
+	{
+		free(rows);
+	}
+
+	return r;
+}
+#endif /* DISABLE_NN_PROFILE */
@@ -0,0 +1,49 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+#ifndef NN_RUNTIME_COMMON_PROFILE_H_
+#define NN_RUNTIME_COMMON_PROFILE_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "nn.h"
+/* ============================ [ MACROS    ] ====================================================== */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DISABLE_NN_PROFILE
+/* the runtimes wrap the execution of each layer with these, nothing is
+ * measured unless nn_set_profile has been called for this instance */
+#define RTE_PROFILE_START(nn, start)				\
+	do {											\
+		if(NULL != (nn)->profile) {					\
+			start = rte_profile_now();				\
+		}											\
+	}while(0)
+
+#define RTE_PROFILE_STOP(nn, layer, start)			\
+	do {											\
+		if(NULL != (nn)->profile) {					\
+			rte_profile_layer(nn, layer, start);	\
+		}											\
+	}while(0)
+#else
+#define RTE_PROFILE_START(nn, start)
+#define RTE_PROFILE_STOP(nn, layer, start)
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+#ifndef DISABLE_NN_PROFILE
+/* monotonic time in ns */
+uint64_t rte_profile_now(void);
+void rte_profile_begin(const nn_t* nn);
+void rte_profile_end(const nn_t* nn);
+void rte_profile_layer(const nn_t* nn, const layer_t* layer, uint64_t start);
+#endif
+#ifdef __cplusplus
+}
+#endif
+#endif /* NN_RUNTIME_COMMON_PROFILE_H_ */
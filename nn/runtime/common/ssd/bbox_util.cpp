@@ -1054,12 +1054,13 @@ extern "C" int detection_output_forward(
 		CodeType code_type_,
 		bool variance_encoded_in_target_,
 		int eta_,
-		const layer_t* layer
+		const layer_t* layer,
+		layer_context_t* context
 		)
 {
 	int r = 0;
 	int num_loc_classes_ = share_location_ ? 1 : num_classes_;
-	int num = layer->C->context->nhwc.N;
+	int num = context->nhwc.N;
 
 	// Retrieve all location predictions.
 	vector<LabelBBox> all_loc_preds;
@@ -1151,16 +1152,16 @@ extern "C" int detection_output_forward(
 		}
 	}
 
-	if(num_kept > (layer->C->context->nhwc.N*layer->C->context->nhwc.H)) {
-		num_kept =  (layer->C->context->nhwc.N*layer->C->context->nhwc.H);
+	if(num_kept > (context->nhwc.N*context->nhwc.H)) {
+		num_kept =  (context->nhwc.N*context->nhwc.H);
 	}
 
 	if (L_OP_PROPOSAL == layer->op) {
-		layer->C->context->nhwc.N = 1;
-		layer->C->context->nhwc.H = num_kept;
+		context->nhwc.N = 1;
+		context->nhwc.H = num_kept;
 	} else {
-		layer->C->context->nhwc.N = num_kept;
-		layer->C->context->nhwc.H = 1;
+		context->nhwc.N = num_kept;
+		context->nhwc.H = 1;
 	}
 	int count = 0;
 	for (int i = 0; i < num; ++i) {
@@ -1215,11 +1216,11 @@ extern "C" int detection_output_forward(
 extern "C" int layer_cpu_float_DETECTIONOUTPUT_execute(const nn_t* nn,
 		const layer_t* layer) {
 	int r = 0;
-	layer_cpu_context_t* context = (layer_cpu_context_t*) layer->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*) LAYER_CONTEXT(nn, layer);
 	layer_cpu_context_t* mbox_loc_context =
-			(layer_cpu_context_t*) layer->inputs[0]->C->context;
+			(layer_cpu_context_t*) LAYER_CONTEXT(nn, layer->inputs[0]);
 	layer_cpu_context_t* mbox_conf_context =
-			(layer_cpu_context_t*) layer->inputs[1]->C->context;
+			(layer_cpu_context_t*) LAYER_CONTEXT(nn, layer->inputs[1]);
 	const float* loc_data = (float*) mbox_loc_context->out[0];
 	const float* conf_data = (float*) mbox_conf_context->out[0];
 	const float* prior_data = (float*) layer->blobs[2]->blob;
@@ -1264,7 +1265,8 @@ extern "C" int layer_cpu_float_DETECTIONOUTPUT_execute(const nn_t* nn,
 			code_type_,
 			variance_encoded_in_target_,
 			eta_,
-			layer);
+			layer,
+			(layer_context_t*)context);
 	}
 
 	return r;
@@ -1273,10 +1275,10 @@ extern "C" int layer_cpu_float_DETECTIONOUTPUT_execute(const nn_t* nn,
 extern "C" int layer_cpu_float_DETECTION_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r;
-	layer_cpu_context_t* context = (layer_cpu_context_t*) layer->C->context;
-	layer_context_t* rois_c = layer->inputs[0]->C->context;
-	layer_context_t* scores_c = layer->inputs[1]->C->context;
-	layer_context_t* bbox_c = layer->inputs[2]->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*) LAYER_CONTEXT(nn, layer);
+	layer_context_t* rois_c = LAYER_CONTEXT(nn, layer->inputs[0]);
+	layer_context_t* scores_c = LAYER_CONTEXT(nn, layer->inputs[1]);
+	layer_context_t* bbox_c = LAYER_CONTEXT(nn, layer->inputs[2]);
 
 	const float* loc_data = (float*) bbox_c->out[0];
 	const float* conf_data = (float*) scores_c->out[0];
@@ -1318,7 +1320,8 @@ extern "C" int layer_cpu_float_DETECTION_execute(const nn_t* nn, const layer_t*
 		code_type_,
 		variance_encoded_in_target_,
 		eta_,
-		layer);
+		layer,
+		(layer_context_t*)context);
 
 	return r;
 }
@@ -1326,9 +1329,9 @@ extern "C" int layer_cpu_float_DETECTION_execute(const nn_t* nn, const layer_t*
 extern "C" int rpn_proposal_forward(const nn_t* nn, const layer_t* layer, float* anchors, size_t n_anchors)
 {
 	int r;
-	layer_cpu_context_t* context = (layer_cpu_context_t*) layer->C->context;
-	layer_context_t* scores_c = layer->inputs[0]->C->context;
-	layer_context_t* bbox_c = layer->inputs[1]->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*) LAYER_CONTEXT(nn, layer);
+	layer_context_t* scores_c = LAYER_CONTEXT(nn, layer->inputs[0]);
+	layer_context_t* bbox_c = LAYER_CONTEXT(nn, layer->inputs[1]);
 
 	const float* loc_data = (float*) bbox_c->out[0];
 	const float* conf_data = (float*) scores_c->out[0];
@@ -1370,7 +1373,8 @@ extern "C" int rpn_proposal_forward(const nn_t* nn, const layer_t* layer, float*
 		code_type_,
 		variance_encoded_in_target_,
 		eta_,
-		layer);
+		layer,
+		(layer_context_t*)context);
 
 	return r;
 }
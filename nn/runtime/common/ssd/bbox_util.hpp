@@ -140,7 +140,8 @@ extern "C" int detection_output_forward(
 		CodeType code_type_,
 		bool variance_encoded_in_target_,
 		int eta_,
-		const layer_t* layer
+		const layer_t* layer,
+		layer_context_t* context
 		);
 } /* namespace ssd */
 #endif /* _SSD_BBOX_UTIL_HPP_ */
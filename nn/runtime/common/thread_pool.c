@@ -0,0 +1,341 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include "thread_pool.h"
+#include <stdlib.h>
+#ifndef DISABLE_NN_THREAD
+#include <pthread.h>
+#endif
+/* ============================ [ MACROS    ] ====================================================== */
+/* ============================ [ TYPES     ] ====================================================== */
+#ifndef DISABLE_NN_THREAD
+typedef struct {
+	thread_pool_t* pool;
+	pthread_t thread;
+	int id;
+} thread_pool_worker_t;
+
+struct thread_pool {
+	/* held by the parallel_for that owns the workers */
+	pthread_mutex_t busy;
+	pthread_mutex_t lock;
+	pthread_cond_t start;
+	pthread_cond_t done;
+	thread_pool_task_t task;
+	void* param;
+	size_t total;
+	/* bumped on each parallel_for, workers sleep until it changes */
+	unsigned int generation;
+	int pending;
+	int exit;
+	int num;
+	thread_pool_worker_t* workers;
+};
+
+typedef struct {
+	const thread_pool_graph_t* graph;
+	thread_pool_node_t node;
+	void* param;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int head;
+	int tail;
+	int done;
+	int r;
+} thread_pool_graph_run_t;
+#endif
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+#ifndef DISABLE_NN_THREAD
+static void thread_pool_run_slice(thread_pool_t* pool, int id)
+{
+	size_t chunk = (pool->total + pool->num - 1) / pool->num;
+	size_t start = chunk*id;
+	size_t end = start + chunk;
+
+	if(end > pool->total)
+	{
+		end = pool->total;
+	}
+
+	if(start < end)
+	{
+		pool->task(pool->param, start, end);
+	}
+}
+
+static void* thread_pool_main(void* arg)
+{
+	thread_pool_worker_t* worker = (thread_pool_worker_t*)arg;
+	thread_pool_t* pool = worker->pool;
+	unsigned int generation = 0;
+
+	pthread_mutex_lock(&pool->lock);
+	while(1)
+	{
+		while((generation == pool->generation) && (0 == pool->exit))
+		{
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+
+		if(pool->exit)
+		{
+			break;
+		}
+
+		generation = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		thread_pool_run_slice(pool, worker->id);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->pending --;
+		if(0 == pool->pending)
+		{
+			pthread_cond_signal(&pool->done);
+		}
+	}
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+static void thread_pool_graph_worker(void* param, size_t start, size_t end)
+{
+	thread_pool_graph_run_t* run = (thread_pool_graph_run_t*)param;
+	const thread_pool_graph_t* graph = run->graph;
+	int id, i, r;
+
+	(void)start;
+	(void)end;
+
+	pthread_mutex_lock(&run->lock);
+	while((run->done < graph->num) && (0 == run->r))
+	{
+		if(run->head != run->tail)
+		{
+			id = graph->ready[run->head++];
+			pthread_mutex_unlock(&run->lock);
+
+			r = run->node(run->param, id);
+
+			pthread_mutex_lock(&run->lock);
+			if(0 != r)
+			{
+				run->r = r;
+			}
+			else
+			{
+				for(i=graph->succ_start[id]; i<graph->succ_start[id+1]; i++)
+				{
+					graph->pending[graph->succs[i]] --;
+					if(0 == graph->pending[graph->succs[i]])
+					{
+						graph->ready[run->tail++] = graph->succs[i];
+					}
+				}
+			}
+			run->done ++;
+			pthread_cond_broadcast(&run->cond);
+		}
+		else
+		{
+			pthread_cond_wait(&run->cond, &run->lock);
+		}
+	}
+	pthread_mutex_unlock(&run->lock);
+}
+#endif
+/* ============================ [ FUNCTIONS ] ====================================================== */
+thread_pool_t* thread_pool_create(int num)
+{
+	thread_pool_t* pool = NULL;
+#ifndef DISABLE_NN_THREAD
+	int i;
+	int r = 0;
+
+	if(num > 1)
+	{
+		pool = malloc(sizeof(thread_pool_t));
+	}
+
+	if(NULL != pool)
+	{
+		pool->workers = malloc(sizeof(thread_pool_worker_t)*num);
+		if(NULL == pool->workers)
+		{
+			free(pool);
+			pool = NULL;
+		}
+	}
+
+	if(NULL != pool)
+	{
+		pthread_mutex_init(&pool->busy, NULL);
+		pthread_mutex_init(&pool->lock, NULL);
+		pthread_cond_init(&pool->start, NULL);
+		pthread_cond_init(&pool->done, NULL);
+		pool->generation = 0;
+		pool->pending = 0;
+		pool->exit = 0;
+		pool->num = 1;
+		/* worker 0 is the caller of parallel_for */
+		for(i=1; (i<num) && (0 == r); i++)
+		{
+			pool->workers[i].pool = pool;
+			pool->workers[i].id = i;
+			r = pthread_create(&pool->workers[i].thread, NULL, thread_pool_main, &pool->workers[i]);
+			if(0 == r)
+			{
+				pool->num ++;
+			}
+		}
+
+		if(0 != r)
+		{
+			thread_pool_destory(pool);
+			pool = NULL;
+		}
+	}
+#else
+	(void)num;
+#endif
+
+	return pool;
+}
+
+void thread_pool_destory(thread_pool_t* pool)
+{
+#ifndef DISABLE_NN_THREAD
+	int i;
+
+	if(NULL != pool)
+	{
+		pthread_mutex_lock(&pool->lock);
+		pool->exit = 1;
+		pthread_cond_broadcast(&pool->start);
+		pthread_mutex_unlock(&pool->lock);
+
+		for(i=1; i<pool->num; i++)
+		{
+			pthread_join(pool->workers[i].thread, NULL);
+		}
+
+		pthread_cond_destroy(&pool->done);
+		pthread_cond_destroy(&pool->start);
+		pthread_mutex_destroy(&pool->lock);
+		pthread_mutex_destroy(&pool->busy);
+		free(pool->workers);
+		free(pool);
+	}
+#else
+	(void)pool;
+#endif
+}
+
+int thread_pool_get_num_threads(const thread_pool_t* pool)
+{
+	int num = 1;
+#ifndef DISABLE_NN_THREAD
+	if(NULL != pool)
+	{
+		num = pool->num;
+	}
+#else
+	(void)pool;
+#endif
+	return num;
+}
+
+void thread_pool_parallel_for(thread_pool_t* pool, size_t total, thread_pool_task_t task, void* param)
+{
+#ifndef DISABLE_NN_THREAD
+	if((NULL != pool) && (total > 1) && (0 == pthread_mutex_trylock(&pool->busy)))
+	{
+		pthread_mutex_lock(&pool->lock);
+		pool->task = task;
+		pool->param = param;
+		pool->total = total;
+		pool->pending = pool->num - 1;
+		pool->generation ++;
+		pthread_cond_broadcast(&pool->start);
+		pthread_mutex_unlock(&pool->lock);
+
+		thread_pool_run_slice(pool, 0);
+
+		pthread_mutex_lock(&pool->lock);
+		while(pool->pending > 0)
+		{
+			pthread_cond_wait(&pool->done, &pool->lock);
+		}
+		pthread_mutex_unlock(&pool->lock);
+		pthread_mutex_unlock(&pool->busy);
+	}
+	else
+#else
+	(void)pool;
+#endif
+	if(total > 0)
+	{
+		task(param, 0, total);
+	}
+}
+
+int thread_pool_run_graph(thread_pool_t* pool, const thread_pool_graph_t* graph, thread_pool_node_t node, void* param)
+{
+	int i, id;
+	int head = 0;
+	int tail = 0;
+	int r = 0;
+#ifndef DISABLE_NN_THREAD
+	thread_pool_graph_run_t run;
+#endif
+
+	for(i=0; i<graph->num; i++)
+	{
+		graph->pending[i] = graph->npreds[i];
+		if(0 == graph->npreds[i])
+		{
+			graph->ready[tail++] = i;
+		}
+	}
+
+#ifndef DISABLE_NN_THREAD
+	if(NULL != pool)
+	{
+		run.graph = graph;
+		run.node = node;
+		run.param = param;
+		run.head = head;
+		run.tail = tail;
+		run.done = 0;
+		run.r = 0;
+		pthread_mutex_init(&run.lock, NULL);
+		pthread_cond_init(&run.cond, NULL);
+		/* one work item per thread, each one is a worker loop over the ready nodes */
+		thread_pool_parallel_for(pool, pool->num, thread_pool_graph_worker, &run);
+		pthread_cond_destroy(&run.cond);
+		pthread_mutex_destroy(&run.lock);
+		r = run.r;
+	}
+	else
+#endif
+	while((head != tail) && (0 == r))
+	{
+		id = graph->ready[head++];
+		r = node(param, id);
+		for(i=graph->succ_start[id]; (i<graph->succ_start[id+1]) && (0 == r); i++)
+		{
+			graph->pending[graph->succs[i]] --;
+			if(0 == graph->pending[graph->succs[i]])
+			{
+				graph->ready[tail++] = graph->succs[i];
+			}
+		}
+	}
+
+	return r;
+}
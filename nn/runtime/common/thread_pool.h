@@ -0,0 +1,51 @@
+/**
+ * LWNN - Lightweight Neural Network
+ * Copyright (C) 2019  Parai Wang <parai@foxmail.com>
+ */
+#ifndef NN_RUNTIME_COMMON_THREAD_POOL_H_
+#define NN_RUNTIME_COMMON_THREAD_POOL_H_
+/* ============================ [ INCLUDES  ] ====================================================== */
+#include <stddef.h>
+/* ============================ [ MACROS    ] ====================================================== */
+#ifdef __cplusplus
+extern "C" {
+#endif
+/* ============================ [ TYPES     ] ====================================================== */
+typedef struct thread_pool thread_pool_t;
+
+/* process the work items [start, end) */
+typedef void (*thread_pool_task_t)(void* param, size_t start, size_t end);
+
+/* run the node id of a graph, non zero stops the graph */
+typedef int (*thread_pool_node_t)(void* param, int id);
+
+typedef struct {
+	int num;
+	/* number of nodes that must be done before node i can run */
+	const int* npreds;
+	/* successors of node i are succs[succ_start[i]] ... succs[succ_start[i+1]-1] */
+	const int* succ_start;
+	const int* succs;
+	/* work areas of num ints, owned by the caller */
+	int* pending;
+	int* ready;
+} thread_pool_graph_t;
+/* ============================ [ DECLARES  ] ====================================================== */
+/* ============================ [ DATAS     ] ====================================================== */
+/* ============================ [ LOCALS    ] ====================================================== */
+/* ============================ [ FUNCTIONS ] ====================================================== */
+/* the caller thread is counted as one of the num threads */
+thread_pool_t* thread_pool_create(int num);
+void thread_pool_destory(thread_pool_t* pool);
+int thread_pool_get_num_threads(const thread_pool_t* pool);
+/* split [0, total) into contiguous ranges, one per thread, and return when all are done.
+ * A NULL pool, or a pool already busy with another parallel_for, runs the whole range
+ * on the caller thread. */
+void thread_pool_parallel_for(thread_pool_t* pool, size_t total, thread_pool_task_t task, void* param);
+/* run every node once all its predecessors are done, ready nodes are picked up by any
+ * free thread of the pool. Return the first non zero result of a node. */
+int thread_pool_run_graph(thread_pool_t* pool, const thread_pool_graph_t* graph, thread_pool_node_t node, void* param);
+#ifdef __cplusplus
+}
+#endif
+#endif /* NN_RUNTIME_COMMON_THREAD_POOL_H_ */
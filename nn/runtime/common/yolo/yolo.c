@@ -7,6 +7,7 @@
 #if !defined(DISABLE_RUNTIME_CPU_FLOAT) || !defined(DISABLE_RUNTIME_OPENCL)
 #include "yolo.h"
 #include "algorithm.h"
+#include "fastmath.h"
 #include <math.h>
 #include <stdlib.h>
 /* ============================ [ MACROS    ] ====================================================== */
@@ -26,13 +27,9 @@ typedef struct detection{
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
-static inline float logistic_activate(float x){return 1./(1. + exp(-x));}
 static void activate_array(float *x, const int n)
 {
-	int i;
-	for(i = 0; i < n; ++i){
-		x[i] = logistic_activate(x[i]);
-	}
+	alg_vsigmoidf(x, x, n);
 }
 
 static int entry_index(NHWC_t *inhwc, int classes, int batch, int location, int entry)
@@ -45,11 +42,11 @@ static int entry_index(NHWC_t *inhwc, int classes, int batch, int location, int
 static int yolo_num_detections(const nn_t* nn, const layer_t* layer, float thresh)
 {
 	int i, n;
-	float* output = (float*)layer->C->context->out[0];
+	float* output = (float*)LAYER_CONTEXT(nn, layer)->out[0];
 	int count = 0;
 	int num = layer->blobs[0]->dims[0];
 	int classes = RTE_FETCH_FLOAT(layer->blobs[2]->blob, 0);
-	layer_context_t* context = (layer_context_t*)layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, layer);
 
 	for (i = 0; i < context->nhwc.W*context->nhwc.H; ++i){
 		for(n = 0; n < num; ++n){
@@ -97,8 +94,8 @@ static detection *make_network_boxes(const nn_t* nn, const layer_t* layer, float
 static void avg_flipped_yolo(const nn_t* nn, const layer_t* layer)
 {
 	int i,j,n,z;
-	layer_context_t* context = (layer_context_t*)layer->C->context;
-	float *output = (float*)layer->C->context->out[0];
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, layer);
+	float *output = (float*)LAYER_CONTEXT(nn, layer)->out[0];
 	int num = layer->blobs[0]->dims[0];
 	int classes = RTE_FETCH_FLOAT(layer->blobs[2]->blob, 0);
 	float *flip = output + NHWC_BATCH_SIZE(context->nhwc);
@@ -129,8 +126,8 @@ static box get_yolo_box(float *x, const int *anchors, int n, int index, int i, i
 	box b;
 	b.x = (i + x[index + 0*stride]) / lw;
 	b.y = (j + x[index + 1*stride]) / lh;
-	b.w = exp(x[index + 2*stride]) * anchors[2*n]   / w;
-	b.h = exp(x[index + 3*stride]) * anchors[2*n+1] / h;
+	b.w = alg_expf(x[index + 2*stride]) * anchors[2*n]   / w;
+	b.h = alg_expf(x[index + 3*stride]) * anchors[2*n+1] / h;
 	return b;
 }
 
@@ -138,15 +135,15 @@ static int get_yolo_detections(const nn_t* nn, const layer_t* layer,
 			float thresh, int *map, int relative, detection *dets)
 {
 	int i,j,n;
-	float *predictions = (float*)layer->C->context->out[0];
+	float *predictions = (float*)LAYER_CONTEXT(nn, layer)->out[0];
 	int num = layer->blobs[0]->dims[0];
 	const int* mask = (const int*)layer->blobs[0]->blob;
 	const int* anchors = (const int*)layer->blobs[1]->blob;
 	int classes = RTE_FETCH_FLOAT(layer->blobs[2]->blob, 0);
-	layer_context_t* context = (layer_context_t*)layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, layer);
 	if (context->nhwc.N == 2) avg_flipped_yolo(nn, layer);
 	int count = 0;
-	layer_context_t* image_context = (layer_context_t*)nn->network->inputs[0]->layer->C->context;
+	layer_context_t* image_context = (layer_context_t*)LAYER_CONTEXT(nn, nn->network->inputs[0]->layer);
 	int netw = image_context->nhwc.W;
 	int neth = image_context->nhwc.H;
 
@@ -351,7 +348,7 @@ int yolo_forward(float* output, const float* input, NHWC_t *inhwc, int num, int
 int yolo_output_forward(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_context_t* context = (layer_context_t*)layer->C->context;
+	layer_context_t* context = (layer_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	int classes = RTE_FETCH_FLOAT(input->blobs[2]->blob, 0);
 	int nboxes = 0;
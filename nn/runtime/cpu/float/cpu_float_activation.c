@@ -62,21 +62,21 @@ static void clip_ref(float* out, float * in, size_t size, float min, float max)
 
 static int layer_cpu_float_activation_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_actvation_context_t), sizeof(float));
+	return rte_cpu_create_layer_inplace(nn, layer, sizeof(layer_cpu_float_actvation_context_t), sizeof(float));
 }
 
 static int layer_cpu_float_activation_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_actvation_context_t* context = (layer_cpu_float_actvation_context_t*)layer->C->context;
+	layer_cpu_float_actvation_context_t* context = (layer_cpu_float_actvation_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	size_t sz = NHWC_SIZE(input_context->nhwc);
 	float* IN;
 	float* OUT;
 
-	rte_cpu_dynamic_shape_copy(layer, input_context);
-	r = rte_cpu_dynamic_memory(&context->out[0], sz, &context->allocated, sizeof(float));
+	rte_cpu_dynamic_shape_copy(nn, layer, input_context);
+	r = rte_cpu_dynamic_memory(nn, layer, 0, sz, &context->allocated, sizeof(float));
 
   if(0 == r) {
 	IN = (float*)input_context->out[0];
@@ -112,7 +112,7 @@ static int layer_cpu_float_activation_execute(const nn_t* nn, const layer_t* lay
 
 static void layer_cpu_float_activation_deinit(const nn_t* nn, const layer_t* layer)
 {
-	rte_cpu_dynamic_free(layer);
+	rte_cpu_dynamic_free(nn, layer);
 	rte_cpu_destory_layer_context(nn, layer);
 }
 /* ============================ [ FUNCTIONS ] ====================================================== */
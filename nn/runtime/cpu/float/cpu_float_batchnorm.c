@@ -6,11 +6,13 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
-#include <math.h>
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CPU_CONTEXT_MEMBER;
+	/* y = x*a[c] + b[c], NULL if folded into its input */
+	float* a;
+	float* b;
 } layer_cpu_float_batchnorm_context_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
@@ -18,39 +20,78 @@ typedef struct {
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_float_BATCHNORM_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_batchnorm_context_t), sizeof(float));
+	int r;
+	layer_cpu_float_batchnorm_context_t* context;
+	int C = layer->blobs[0]->dims[0];
+
+	r = rte_cpu_create_layer_inplace(nn, layer, sizeof(layer_cpu_float_batchnorm_context_t), sizeof(float));
+
+	if(0 == r)
+	{
+		context = (layer_cpu_float_batchnorm_context_t*)LAYER_CONTEXT(nn, layer);
+		context->a = NULL;
+		context->b = NULL;
+		if(rte_is_bn_folded(nn, layer))
+		{
+			NNLOG(NN_DEBUG, ("%s: folded into %s\n", layer->name, layer->inputs[0]->name));
+		}
+		else
+		{
+			context->a = malloc(2*C*sizeof(float));
+			if(NULL == context->a)
+			{
+				r = NN_E_NO_MEMORY;
+			}
+			else
+			{
+				context->b = context->a + C;
+				rte_get_bn_affine(layer, context->a, context->b);
+			}
+		}
+	}
+
+	return r;
 }
 int layer_cpu_float_BATCHNORM_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	layer_cpu_float_batchnorm_context_t* context = (layer_cpu_float_batchnorm_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
-	float* scale = (float*)layer->blobs[0]->blob;
-	float* bias = (float*)layer->blobs[1]->blob;
-	float* var = (float*)layer->blobs[2]->blob;
-	float* mean = (float*)layer->blobs[3]->blob;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
+	const float* a = context->a;
+	const float* b = context->b;
 	float *IN = (float*)input_context->out[0];
 	float *O = (float*)context->out[0];
-	float epsilon = RTE_FETCH_FLOAT(layer->blobs[4]->blob, 0);
 	int nC = context->nhwc.N*context->nhwc.H*context->nhwc.W;
+	int C = context->nhwc.C;
 	int i,c;
-	float X;
 
-	/* s * (x - mean) / np.sqrt(var + epsilon) + bias */
-	for(i=0; i<nC; i++)
+	if(NULL != a)
 	{
-		for(c=0; c<context->nhwc.C; c++)
+		for(i=0; i<nC; i++)
 		{
-			X = IN[i*context->nhwc.C+c];
-			O[i*context->nhwc.C+c] = scale[c]*(X-mean[c])/(sqrt(var[c]+epsilon)) + bias[c];
+			for(c=0; c<C; c++)
+			{
+				O[i*C+c] = IN[i*C+c]*a[c] + b[c];
+			}
 		}
 	}
+	else if(O != IN)
+	{	/* folded, but not sharing the buffer of the input */
+		memcpy(O, IN, NHWC_SIZE(context->nhwc)*sizeof(float));
+	}
 
 	return r;
 }
 void layer_cpu_float_BATCHNORM_deinit(const nn_t* nn, const layer_t* layer)
 {
+	layer_cpu_float_batchnorm_context_t* context = (layer_cpu_float_batchnorm_context_t*)LAYER_CONTEXT(nn, layer);
+
+	if(NULL != context)
+	{
+		free(context->a);
+	}
+
 	rte_cpu_destory_layer_context(nn, layer);
 }
 
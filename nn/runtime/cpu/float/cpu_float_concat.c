@@ -18,12 +18,12 @@ typedef struct {
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_float_CONCAT_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_concat_context_t), sizeof(float));
+	return rte_cpu_create_layer_concat(nn, layer, sizeof(layer_cpu_float_concat_context_t), sizeof(float));
 }
 int layer_cpu_float_CONCAT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 	int axis = RTE_FETCH_INT32(layer->blobs[0]->blob, 0);
 
 	r = alg_concat(nn, layer, axis, context->out[0], rte_cpu_fetch_out0, sizeof(float));
@@ -23,7 +23,7 @@ int layer_cpu_float_CONST_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_CONST_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_const_context_t* context = (layer_cpu_float_const_context_t*)layer->C->context;
+	layer_cpu_float_const_context_t* context = (layer_cpu_float_const_context_t*)LAYER_CONTEXT(nn, layer);
 
 	context->out[0] = layer->blobs[0]->blob;
 
@@ -6,12 +6,75 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
+#include "thread_pool.h"
+#include "gemm.h"
 /* ============================ [ MACROS    ] ====================================================== */
+/* MKL-DNN replaces convolve_HWC_ref_nonsquare, so it must be called then */
+#if !defined(DISABLE_NN_GEMM) && !defined(ENABLE_MKLDNN)
+#define CONV2D_USE_GEMM
+#endif
+
+/* F(4x4,3x3): each 6x6 input tile gives a 4x4 output tile */
+#if defined(CONV2D_USE_GEMM) && !defined(DISABLE_NN_WINOGRAD)
+#define CONV2D_USE_WINOGRAD
+#define WINOGRAD_M 4
+#define WINOGRAD_T 6
+#define WINOGRAD_TT (WINOGRAD_T*WINOGRAD_T)
+/* tiles transformed together, keep the transformed block in about 1MB */
+#define WINOGRAD_TB(Cin, Cout) NN_MIN(64, NN_MAX(4, (1<<18) / (WINOGRAD_TT*((Cin)+(Cout)))))
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CPU_CONTEXT_MEMBER;
 	LAYER_CPU_DYNMIC_SHAPE_COMMON_MEMBER;
+	/* the bias and weights with the BATCHNORM folded into this layer, NULL if none,
+	 * only the bias is kept once the weights are packed */
+	float* folded;
+	/* floats between two output pixels, more than C when writing into a CONCAT */
+	int pitch;
+#ifdef CONV2D_USE_GEMM
+	/* the weights packed once for the GEMM, for winograd the 36 [Cout][Cin] of U,
+	 * by the kernel bound at init */
+	const alg_sgemm_kernel_t* gemm;
+	float* packed;
+#endif
+#ifdef CONV2D_USE_WINOGRAD
+	int winograd;
+	/* the transform buffers, one set of set_size floats per thread of the nn */
+	float* buffers;
+	size_t set_size;
+	int sets;
+#endif
 } layer_cpu_float_conv2d_context_t;
+
+typedef struct {
+	const float* IN;
+	float* O;
+	const float* weights;
+	const float* bias;
+	const NHWC_t* inhwc;
+	const NHWC_t* onhwc;
+	int knlX, knlY, padX, padY, strideX, strideY;
+	int pitch;
+	layer_activation_type_t act;
+#ifdef CONV2D_USE_GEMM
+	const alg_sgemm_kernel_t* gemm;
+	const float* packed;
+#endif
+#ifdef CONV2D_USE_WINOGRAD
+	float* buffers;
+	size_t set_size;
+	int sets;
+#endif
+	/* set by a task that failed */
+	int r;
+} conv2d_task_t;
+
+typedef struct {
+	const conv2d_task_t* t;
+	/* the first output pixel of the GEMM */
+	size_t start;
+} conv2d_im2col_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -74,32 +137,523 @@ void __weak convolve_HWC_ref_nonsquare(const float * Im_in,  /* input image */
 		}
 	}
 }
+#ifdef CONV2D_USE_GEMM
+/* the row i of the im2col matrix is the receptive field of output pixel i, with the
+ * pixels of all the batches one after another and the columns in the OHWI order of
+ * the weights, so a run of C columns is one contiguous pixel of the input or padding */
+static void conv2d_pack_im2col(const void* param, int i, int mr, int k, int kc, float* dst, int ld)
+{
+	const conv2d_task_t* t = ((const conv2d_im2col_t*)param)->t;
+	const int C = t->inhwc->C;
+	const int W = t->inhwc->W;
+	const int H = t->inhwc->H;
+	const int pixels = t->onhwc->H*t->onhwc->W;
+	const float* in;
+	const float* src;
+	size_t pixel = ((const conv2d_im2col_t*)param)->start + i;
+	int r, p, kk, l, tap, run, q, iy, ix, iy0, ix0;
+
+	for(r=0; r<mr; r++, pixel++)
+	{
+		p = pixel % pixels;
+		in = t->IN + NHWC_BATCH_SIZE(*t->inhwc)*(pixel/pixels);
+		iy0 = (p/t->onhwc->W)*t->strideY - t->padY;
+		ix0 = (p%t->onhwc->W)*t->strideX - t->padX;
+
+		tap = k / C;
+		l = k % C;
+		for(kk=0; kk<kc; kk+=run)
+		{
+			run = NN_MIN(C-l, kc-kk);
+			iy = iy0 + tap/t->knlX;
+			ix = ix0 + tap%t->knlX;
+			if((iy >= 0) && (ix >= 0) && (iy < H) && (ix < W))
+			{
+				src = in + (iy*W+ix)*C + l;
+				for(q=0; q<run; q++)
+				{
+					dst[(kk+q)*ld+r] = src[q];
+				}
+			}
+			else
+			{
+				for(q=0; q<run; q++)
+				{
+					dst[(kk+q)*ld+r] = 0;
+				}
+			}
+			tap ++;
+			l = 0;
+		}
+	}
+}
+
+#ifdef CONV2D_USE_WINOGRAD
+/* r = BT*d of 6 points with a stride, for C channels */
+static void winograd_input_1d(const float* d, int stride, float* r, int rstride, int C)
+{
+	int c;
+	float d0, d1, d2, d3, d4, d5;
+
+	for(c=0; c<C; c++)
+	{
+		d0 = d[c];
+		d1 = d[stride+c];
+		d2 = d[2*stride+c];
+		d3 = d[3*stride+c];
+		d4 = d[4*stride+c];
+		d5 = d[5*stride+c];
+		r[c] = 4*d0 - 5*d2 + d4;
+		r[rstride+c] = -4*(d1 + d2) + d3 + d4;
+		r[2*rstride+c] = 4*(d1 - d2) - d3 + d4;
+		r[3*rstride+c] = 2*(d3 - d1) - d2 + d4;
+		r[4*rstride+c] = 2*(d1 - d3) - d2 + d4;
+		r[5*rstride+c] = 4*d1 - 5*d3 + d5;
+	}
+}
+
+/* o = AT*m of 6 points with a stride, for C channels */
+static void winograd_output_1d(const float* m, int stride, float* o, int ostride, int C)
+{
+	int c;
+	float m0, m1, m2, m3, m4, m5;
+
+	for(c=0; c<C; c++)
+	{
+		m0 = m[c];
+		m1 = m[stride+c];
+		m2 = m[2*stride+c];
+		m3 = m[3*stride+c];
+		m4 = m[4*stride+c];
+		m5 = m[5*stride+c];
+		o[c] = m0 + m1 + m2 + m3 + m4;
+		o[ostride+c] = m1 - m2 + 2*(m3 - m4);
+		o[2*ostride+c] = m1 + m2 + 4*(m3 + m4);
+		o[3*ostride+c] = m1 - m2 + 8*(m3 - m4) + m5;
+	}
+}
+
+/* U = G*g*GT for each pair of output and input channel, packed for the GEMM */
+static float* winograd_transform_weights(const alg_sgemm_kernel_t* gemm, const float* W, int Cout, int Cin)
+{
+	static const float G[WINOGRAD_T][3] = {
+		{ 1.0f/4, 0, 0 },
+		{ -1.0f/6, -1.0f/6, -1.0f/6 },
+		{ -1.0f/6, 1.0f/6, -1.0f/6 },
+		{ 1.0f/24, 1.0f/12, 1.0f/6 },
+		{ 1.0f/24, -1.0f/12, 1.0f/6 },
+		{ 0, 0, 1 },
+	};
+	float* U = malloc(sizeof(float)*WINOGRAD_TT*Cout*Cin);
+	float* packed = NULL;
+	size_t sz = alg_sgemm_packed_size(gemm, Cout, Cin);
+	float Gg[WINOGRAD_T][3];
+	const float* g;
+	int co, ci, i, j, k;
+
+	for(co=0; (NULL != U) && (co<Cout); co++)
+	{
+		for(ci=0; ci<Cin; ci++)
+		{
+			g = W + co*9*Cin + ci;
+			for(i=0; i<WINOGRAD_T; i++)
+			{
+				for(j=0; j<3; j++)
+				{
+					Gg[i][j] = G[i][0]*g[j*Cin] + G[i][1]*g[(3+j)*Cin] + G[i][2]*g[(6+j)*Cin];
+				}
+			}
+			for(i=0; i<WINOGRAD_T; i++)
+			{
+				for(j=0; j<WINOGRAD_T; j++)
+				{
+					k = i*WINOGRAD_T+j;
+					U[(k*Cout+co)*Cin+ci] = Gg[i][0]*G[j][0] + Gg[i][1]*G[j][1] + Gg[i][2]*G[j][2];
+				}
+			}
+		}
+	}
+
+	if(NULL != U)
+	{
+		packed = alg_sgemm_malloc(sizeof(float)*WINOGRAD_TT*sz);
+		for(k=0; (NULL != packed) && (k<WINOGRAD_TT); k++)
+		{
+			alg_sgemm_pack_nt(gemm, Cout, Cin, U+k*Cout*Cin, Cin, packed+k*sz);
+		}
+		free(U);
+	}
+
+	return packed;
+}
+
+static size_t winograd_set_size(int Cin, int Cout)
+{
+	return (size_t)WINOGRAD_TT*WINOGRAD_TB(Cin, Cout)*(Cin+Cout) + 2*WINOGRAD_TT*NN_MAX(Cin, Cout);
+}
+
+/* the output tiles [start, end) with the transform buffers V, the tiles are done in
+ * blocks: the input transform of a block gives 36 [tiles][Cin] matrices, each one is
+ * multiplied by the matching [Cout][Cin] of U and the output transform reads the 36 results */
+static int conv2d_winograd_tiles(const conv2d_task_t* t, float* V, size_t start, size_t end)
+{
+	const int Cin = t->inhwc->C;
+	const int Cout = t->onhwc->C;
+	const int C = NN_MAX(Cin, Cout);
+	const int tilesX = (t->onhwc->W + WINOGRAD_M - 1) / WINOGRAD_M;
+	const int tilesY = (t->onhwc->H + WINOGRAD_M - 1) / WINOGRAD_M;
+	const int TB = WINOGRAD_TB(Cin, Cout);
+	float* M;
+	float* P;
+	float* T;
+	float* O;
+	const float* in;
+	const size_t packed_sz = alg_sgemm_packed_size(t->gemm, Cout, Cin);
+	size_t tile;
+	int r = 0;
+	int nt, b, i, j, k, c, y, x, iy, ix, oy, ox, batch;
+	float v;
+
+	M = V + WINOGRAD_TT*TB*Cin;
+	P = M + WINOGRAD_TT*TB*Cout;
+	T = P + WINOGRAD_TT*C;
+
+	for(; (start < end) && (0 == r); start += nt)
+	{
+		nt = (int)NN_MIN((size_t)TB, end-start);
+		for(b=0; b<nt; b++)
+		{
+			tile = start + b;
+			batch = (int)(tile / (tilesX*tilesY));
+			y = (int)(tile % (tilesX*tilesY)) / tilesX * WINOGRAD_M - t->padY;
+			x = (int)(tile % tilesX) * WINOGRAD_M - t->padX;
+			in = t->IN + NHWC_BATCH_SIZE(*t->inhwc)*batch;
+			for(i=0; i<WINOGRAD_T; i++)
+			{
+				for(j=0; j<WINOGRAD_T; j++)
+				{
+					iy = y + i;
+					ix = x + j;
+					if((iy >= 0) && (ix >= 0) && (iy < t->inhwc->H) && (ix < t->inhwc->W))
+					{
+						memcpy(P+(i*WINOGRAD_T+j)*Cin, in+(iy*t->inhwc->W+ix)*Cin, sizeof(float)*Cin);
+					}
+					else
+					{
+						memset(P+(i*WINOGRAD_T+j)*Cin, 0, sizeof(float)*Cin);
+					}
+				}
+			}
+			for(j=0; j<WINOGRAD_T; j++)
+			{
+				winograd_input_1d(P+j*Cin, WINOGRAD_T*Cin, T+j*Cin, WINOGRAD_T*Cin, Cin);
+			}
+			for(i=0; i<WINOGRAD_T; i++)
+			{
+				winograd_input_1d(T+i*WINOGRAD_T*Cin, Cin, V+(i*WINOGRAD_T*TB+b)*Cin, TB*Cin, Cin);
+			}
+		}
+
+		for(k=0; (k<WINOGRAD_TT) && (0 == r); k++)
+		{
+			r = alg_sgemm_nt_packed(t->gemm, nt, Cout, Cin, V+k*TB*Cin, Cin, t->packed+k*packed_sz,
+						NULL, M+k*TB*Cout, Cout, L_ACT_NONE);
+		}
+
+		for(b=0; (b<nt) && (0 == r); b++)
+		{
+			tile = start + b;
+			batch = (int)(tile / (tilesX*tilesY));
+			y = (int)(tile % (tilesX*tilesY)) / tilesX * WINOGRAD_M;
+			x = (int)(tile % tilesX) * WINOGRAD_M;
+			for(j=0; j<WINOGRAD_T; j++)
+			{
+				winograd_output_1d(M+(j*TB+b)*Cout, WINOGRAD_T*TB*Cout, T+j*Cout, WINOGRAD_T*Cout, Cout);
+			}
+			for(i=0; i<WINOGRAD_M; i++)
+			{
+				winograd_output_1d(T+i*WINOGRAD_T*Cout, Cout, P+i*WINOGRAD_M*Cout, Cout, Cout);
+			}
+			for(i=0; i<WINOGRAD_M; i++)
+			{
+				for(j=0; j<WINOGRAD_M; j++)
+				{
+					oy = y + i;
+					ox = x + j;
+					if((oy >= t->onhwc->H) || (ox >= t->onhwc->W))
+					{
+						continue;
+					}
+					O = t->O + (t->onhwc->H*t->onhwc->W*batch + oy*t->onhwc->W+ox)*t->pitch;
+					for(c=0; c<Cout; c++)
+					{
+						v = P[(i*WINOGRAD_M+j)*Cout+c] + t->bias[c];
+						if((L_ACT_RELU == t->act) && (v < 0))
+						{
+							v = 0;
+						}
+						else if((L_ACT_LEAKY == t->act) && (v < 0))
+						{
+							v = 0.1*v;
+						}
+						O[c] = v;
+					}
+				}
+			}
+		}
+	}
+
+	return r;
+}
+
+/* each work item is one set of the transform buffers and the share of the 4x4
+ * output tiles that goes with it, so no two threads ever use the same set */
+static void conv2d_winograd_task(void* param, size_t start, size_t end)
+{
+	conv2d_task_t* t = (conv2d_task_t*)param;
+	const size_t tiles = t->inhwc->N*((t->onhwc->H+WINOGRAD_M-1)/WINOGRAD_M)*((t->onhwc->W+WINOGRAD_M-1)/WINOGRAD_M);
+	const size_t chunk = (tiles + t->sets - 1) / t->sets;
+	int r = 0;
+
+	for(; (start < end) && (0 == r); start++)
+	{
+		if((start*chunk) < tiles)
+		{
+			r = conv2d_winograd_tiles(t, t->buffers+start*t->set_size, start*chunk, NN_MIN(tiles, (start+1)*chunk));
+		}
+	}
+
+	if(0 != r)
+	{
+		t->r = r;
+	}
+}
+
+/* one set of buffers for each thread the nn has now, grown when it gets more */
+static int conv2d_winograd_reserve(const nn_t* nn, layer_cpu_float_conv2d_context_t* context)
+{
+	int r = 0;
+	int sets = NN_MAX(1, thread_pool_get_num_threads(nn->tpool));
+	float* buffers;
+
+	if(sets > context->sets)
+	{
+		buffers = malloc(sizeof(float)*context->set_size*sets);
+		if(NULL != buffers)
+		{
+			free(context->buffers);
+			context->buffers = buffers;
+			context->sets = sets;
+		}
+		else
+		{
+			r = NN_E_NO_MEMORY;
+		}
+	}
+
+	return r;
+}
+#endif
+
+/* 1x1 stride 1 without padding and with the H and W of the input: the NHWC input is
+ * already the [pixels][Cin] matrix */
+static void conv2d_pointwise_task(void* param, size_t start, size_t end)
+{
+	conv2d_task_t* t = (conv2d_task_t*)param;
+
+	if(0 != alg_sgemm_nt_packed(t->gemm, (int)(end-start), t->onhwc->C, t->inhwc->C,
+				t->IN+start*t->inhwc->C, t->inhwc->C,
+				t->packed, t->bias,
+				t->O+start*t->pitch, t->pitch, t->act))
+	{
+		t->r = NN_E_NO_MEMORY;
+	}
+}
+
+/* each work item is one output pixel, [start, end) is a block of rows of the GEMM */
+static void conv2d_gemm_task(void* param, size_t start, size_t end)
+{
+	conv2d_task_t* t = (conv2d_task_t*)param;
+	conv2d_im2col_t im2col;
+	int K = t->knlY*t->knlX*t->inhwc->C;
+
+	im2col.t = t;
+	im2col.start = start;
+	if(0 != alg_sgemm_nt_ex_packed(t->gemm, (int)(end-start), t->onhwc->C, K,
+				conv2d_pack_im2col, &im2col,
+				t->packed, t->bias,
+				t->O+start*t->pitch, t->pitch, t->act))
+	{
+		t->r = NN_E_NO_MEMORY;
+	}
+}
+
+#endif
+
+/* each work item is one output row of one batch, a range of rows is computed as a
+ * smaller convolution over only the input rows it needs, so the padding stays valid.
+ * With the GEMM this is the way left when there is no memory for the packed weights */
+static void conv2d_task(void* param, size_t start, size_t end)
+{
+	conv2d_task_t* t = (conv2d_task_t*)param;
+	size_t batch, row, rows;
+	int in_start, in_end;
+	/* writing into a CONCAT, the pixels are not next to each other so go one by one */
+	const int cols = (t->pitch == t->onhwc->C) ? 1 : t->onhwc->W;
+	int col;
+
+	while(start < end)
+	{
+		batch = start / t->onhwc->H;
+		row = start % t->onhwc->H;
+		rows = t->onhwc->H - row;
+		if(rows > (end-start))
+		{
+			rows = end - start;
+		}
+		if(cols > 1)
+		{
+			rows = 1;
+		}
+
+		in_start = (int)row*t->strideY - t->padY;
+		in_end = (int)(row+rows-1)*t->strideY - t->padY + t->knlY;
+		if(in_end > t->inhwc->H)
+		{
+			in_end = t->inhwc->H;
+		}
+		if(in_start < 0)
+		{
+			in_start = 0;
+		}
+
+		for(col=0; col<cols; col++)
+		{
+			convolve_HWC_ref_nonsquare(t->IN+NHWC_BATCH_SIZE(*t->inhwc)*batch+in_start*t->inhwc->W*t->inhwc->C,
+				t->inhwc->W,
+				in_end - in_start,
+				t->inhwc->C,
+				t->weights,
+				t->onhwc->C,
+				t->knlX, t->knlY,
+				t->padX - col*t->strideX, in_start - ((int)row*t->strideY - t->padY),
+				t->strideX, t->strideY,
+				t->bias,
+				t->O+((batch*t->onhwc->H+row)*t->onhwc->W+col)*t->pitch,
+				(1 == cols) ? t->onhwc->W : 1,
+				rows,
+				t->act);
+		}
+
+		start += rows;
+	}
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_float_CONV2D_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_conv2d_context_t), sizeof(float));
+	int pitch = 0;
+#ifdef CONV2D_USE_GEMM
+	/* the GEMM takes the pitch of the output rows, so this may write into a CONCAT */
+	int r = rte_cpu_create_layer_slice(nn, layer, sizeof(layer_cpu_float_conv2d_context_t), &pitch);
+#else
+	int r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_conv2d_context_t), sizeof(float));
+#endif
+	layer_cpu_float_conv2d_context_t* context = NULL;
+#ifdef CONV2D_USE_GEMM
+	const float* weights = (const float*)layer->blobs[0]->blob;
+	const int* dims = layer->blobs[0]->dims;
+	int K = dims[1]*dims[2]*dims[3];
+	float* bias;
+#ifdef CONV2D_USE_WINOGRAD
+	const int* ints = (const int*)layer->blobs[2]->blob;
+#endif
+#endif
+
+	if(0 == r) {
+		context = (layer_cpu_float_conv2d_context_t*)LAYER_CONTEXT(nn, layer);
+#ifdef CONV2D_USE_GEMM
+		context->packed = NULL;
+#ifdef CONV2D_USE_WINOGRAD
+		context->buffers = NULL;
+		context->sets = 0;
+#endif
+#else
+		pitch = context->nhwc.C;
+#endif
+		context->pitch = pitch;
+		r = rte_fold_bn(nn, layer, &context->folded);
+	}
+#ifdef CONV2D_USE_GEMM
+	if(0 == r) {
+		if(NULL != context->folded) {
+			weights = context->folded + dims[0];
+		}
+		context->gemm = (const alg_sgemm_kernel_t*)rte_cpu_select_kernel(nn, alg_sgemm_kernels);
+		NNLOG(NN_DEBUG, ("%s: use %s GEMM\n", layer->name, context->gemm->name));
+#ifdef CONV2D_USE_WINOGRAD
+		context->winograd = (3 == dims[1]) && (3 == dims[2]) && (1 == ints[4]) && (1 == ints[5]);
+		if(context->winograd) {
+			NNLOG(NN_DEBUG, ("%s: use winograd F(4x4,3x3)\n", layer->name));
+			context->packed = winograd_transform_weights(context->gemm, weights, dims[0], dims[3]);
+			if(NULL != context->packed) {
+				context->set_size = winograd_set_size(dims[3], dims[0]);
+				r = conv2d_winograd_reserve(nn, context);
+			}
+		} else
+#endif
+		{
+			context->packed = alg_sgemm_malloc(sizeof(float)*alg_sgemm_packed_size(context->gemm, dims[0], K));
+			if(NULL != context->packed) {
+				alg_sgemm_pack_nt(context->gemm, dims[0], K, weights, K, context->packed);
+			}
+		}
+		if((NULL == context->packed) || (0 != r)) {
+			NNLOG(NN_WARNING, ("%s: no memory for the GEMM, use the reference convolution\n", layer->name));
+			alg_sgemm_free(context->packed);
+			context->packed = NULL;
+#ifdef CONV2D_USE_WINOGRAD
+			context->winograd = FALSE;
+#endif
+			r = 0;
+		} else if(NULL != context->folded) {
+			bias = realloc(context->folded, sizeof(float)*dims[0]);
+			if(NULL != bias) {
+				context->folded = bias;
+			}
+		}
+	}
+#endif
+
+	return r;
 }
 int layer_cpu_float_CONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_conv2d_context_t* context = (layer_cpu_float_conv2d_context_t*)layer->C->context;
-	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
-	float *IN = (float*)input_context->out[0];
+	layer_cpu_float_conv2d_context_t* context = (layer_cpu_float_conv2d_context_t*)LAYER_CONTEXT(nn, layer);
+	const layer_t* input;
+	layer_cpu_context_t* input_context;
+	float *IN;
 	float *O;
 	float *weights = (float*)layer->blobs[0]->blob;
 	float *bias = (float*)layer->blobs[1]->blob;
 	int knlX, knlY, padX, padY, strideX, strideY;
 	int* ints;
 	layer_activation_type_t act;
-
-	size_t batch;
-	size_t batch_sizeIn;
-	size_t batch_sizeO;
+	conv2d_task_t task;
 
 	ints = (int*)layer->blobs[0]->dims;
 	knlY = ints[1];
 	knlX = ints[2];
+	if(NULL != context->folded) {
+		bias = context->folded;
+#ifdef CONV2D_USE_GEMM
+		/* the packed weights are folded already and folded was cut to the bias */
+		if(NULL == context->packed)
+#endif
+		{
+			weights = context->folded + ints[0];
+		}
+	}
 
 	ints = (int*)layer->blobs[2]->blob;
 	padY = ints[0];
@@ -108,43 +662,86 @@ int layer_cpu_float_CONV2D_execute(const nn_t* nn, const layer_t* layer)
 	strideX = ints[5];
 	act = ints[6];
 
+	input = rte_get_padded_input(nn, layer, &padY, &padX);
+	input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
+	IN = (float*)input_context->out[0];
+
 #ifndef DISABLE_DYNAMIC_SHAPE
-  r = rte_cpu_dynamic_conv2d_or_pool(layer, (layer_cpu_context_t*)context, input_context,
+  r = rte_cpu_dynamic_conv2d_or_pool(nn, layer, (layer_cpu_context_t*)context, input_context,
 				&padY, &padX, strideY, strideX, knlY, knlX);
   if(0 == r) {
-	r = rte_cpu_dynamic_memory(&context->out[0], NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
+	r = rte_cpu_dynamic_memory(nn, layer, 0, NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
   }
 #endif
   if(0 == r) {
 	O = (float*)context->out[0];
-	batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
-	batch_sizeO = NHWC_BATCH_SIZE(context->nhwc);
 	NNLOG(NN_DEBUG, (" kernel=[%d %d], pads=[%d %d], strides=[%d %d], activation=%d\n",
 			knlY, knlX, padY, padX, strideY, strideX, act));
 
-	for(batch=0; batch<input_context->nhwc.N; batch++)
-	{
-		convolve_HWC_ref_nonsquare(IN+batch_sizeIn*batch,
-			input_context->nhwc.W,
-			input_context->nhwc.H,
-			input_context->nhwc.C,
-			weights,
-			context->nhwc.C,
-			knlX, knlY,
-			padX, padY,
-			strideX, strideY,
-			bias,
-			O+batch_sizeO*batch,
-			context->nhwc.W,
-			context->nhwc.H,
-			act);
+	task.IN = IN;
+	task.O = O;
+	task.weights = weights;
+	task.bias = bias;
+	task.inhwc = &input_context->nhwc;
+	task.onhwc = &context->nhwc;
+	task.knlX = knlX;
+	task.knlY = knlY;
+	task.padX = padX;
+	task.padY = padY;
+	task.strideX = strideX;
+	task.strideY = strideY;
+	task.pitch = context->pitch;
+	task.act = act;
+	task.r = 0;
+
+#ifdef CONV2D_USE_GEMM
+	task.gemm = context->gemm;
+	task.packed = context->packed;
+	if(NULL == context->packed) {
+		thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H, conv2d_task, &task);
+	}
+	else if((1 == knlX) && (1 == knlY) && (1 == strideX) && (1 == strideY) && (0 == padX) && (0 == padY) &&
+		(input_context->nhwc.H == context->nhwc.H) && (input_context->nhwc.W == context->nhwc.W)) {
+		/* a fused PAD on the bottom or right only keeps the pads at 0 but grows H or W */
+		thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H*context->nhwc.W, conv2d_pointwise_task, &task);
+	}
+#ifdef CONV2D_USE_WINOGRAD
+	else if(context->winograd) {
+		r = conv2d_winograd_reserve(nn, context);
+		task.buffers = context->buffers;
+		task.set_size = context->set_size;
+		task.sets = context->sets;
+		if(0 == r) {
+			thread_pool_parallel_for(nn->tpool, context->sets, conv2d_winograd_task, &task);
+		}
+	}
+#endif
+	else {
+		thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H*context->nhwc.W, conv2d_gemm_task, &task);
 	}
+	if(0 == r) {
+		r = task.r;
+	}
+#else
+	thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H, conv2d_task, &task);
+#endif
   }
 	return r;
 }
 void layer_cpu_float_CONV2D_deinit(const nn_t* nn, const layer_t* layer)
 {
-	rte_cpu_dynamic_free(layer);
+	layer_cpu_float_conv2d_context_t* context = (layer_cpu_float_conv2d_context_t*)LAYER_CONTEXT(nn, layer);
+
+	if(NULL != context) {
+		free(context->folded);
+#ifdef CONV2D_USE_GEMM
+		alg_sgemm_free(context->packed);
+#endif
+#ifdef CONV2D_USE_WINOGRAD
+		free(context->buffers);
+#endif
+	}
+	rte_cpu_dynamic_free(nn, layer);
 	rte_cpu_destory_layer_context(nn, layer);
 }
 
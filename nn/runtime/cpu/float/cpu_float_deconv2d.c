@@ -88,9 +88,9 @@ int layer_cpu_float_DECONV2D_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_DECONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_deconv2d_context_t* context = (layer_cpu_float_deconv2d_context_t*)layer->C->context;
+	layer_cpu_float_deconv2d_context_t* context = (layer_cpu_float_deconv2d_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	float *IN = (float*)input_context->out[0];
 	float *O = (float*)context->out[0];
 	float *weights = (float*)layer->blobs[0]->blob;
@@ -102,7 +102,7 @@ int layer_cpu_float_DECONV2D_execute(const nn_t* nn, const layer_t* layer)
 	size_t batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
 	size_t batch_sizeO = NHWC_BATCH_SIZE(context->nhwc);
 
-	rte_cpu_dynamic_batch(layer, input_context);
+	rte_cpu_dynamic_batch(nn, layer, input_context);
 
 	ints = (int*)layer->blobs[0]->dims;
 	knlY = ints[1];
@@ -6,14 +6,75 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
+#include "thread_pool.h"
+#include "gemm.h"
 /* ============================ [ MACROS    ] ====================================================== */
+#ifndef DISABLE_NN_GEMM
+#define DENSE_USE_GEMM
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CPU_CONTEXT_MEMBER;
+	/* the bias and weights with the BATCHNORM folded into this layer, NULL if none,
+	 * only the bias is kept once the weights are packed */
+	float* folded;
+#ifdef DENSE_USE_GEMM
+	/* the weights packed once for the GEMM, by the kernel bound at init */
+	const alg_sgemm_kernel_t* gemm;
+	float* packed;
+#endif
 } layer_cpu_float_dense_context_t;
+
+typedef struct {
+	const float* IN;
+	float* O;
+	const float* weights;
+	const float* bias;
+	int dim_vec;
+	int num_of_rows;
+	size_t batch_sizeIn;
+	size_t batch_sizeO;
+#ifdef DENSE_USE_GEMM
+	const alg_sgemm_kernel_t* gemm;
+	const float* packed;
+	int batch;
+	int panel;
+	/* set by a task that failed */
+	int r;
+#endif
+} dense_task_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
+#ifdef DENSE_USE_GEMM
+/* each work item is one panel of output units for all the batches, so each thread
+ * reads its part of the weights once whatever the batch is */
+static void dense_gemm_task(void* param, size_t start, size_t end)
+{
+	dense_task_t* t = (dense_task_t*)param;
+	int row = (int)start*t->panel;
+	int rows = NN_MIN((int)end*t->panel, t->num_of_rows) - row;
+	int r;
+
+	if(1 == t->batch)
+	{
+		r = alg_sgemv_packed(t->gemm, rows, t->dim_vec, t->IN,
+				t->packed+(size_t)row*t->dim_vec, t->bias+row,
+				t->O+row, L_ACT_NONE);
+	}
+	else
+	{
+		r = alg_sgemm_nt_packed(t->gemm, t->batch, rows, t->dim_vec, t->IN, (int)t->batch_sizeIn,
+				t->packed+(size_t)row*t->dim_vec, t->bias+row,
+				t->O+row, (int)t->batch_sizeO, L_ACT_NONE);
+	}
+
+	if(0 != r)
+	{
+		t->r = r;
+	}
+}
+#else
 static void fully_connected_ref(const float * pV,
 						const float * pM,
 						const int dim_vec,
@@ -33,19 +94,86 @@ static void fully_connected_ref(const float * pV,
 		pOut[i] = ip_out;
 	}
 }
+/* each work item is one output unit of one batch */
+static void dense_task(void* param, size_t start, size_t end)
+{
+	dense_task_t* t = (dense_task_t*)param;
+	size_t batch, row, rows;
+
+	while(start < end)
+	{
+		batch = start / t->num_of_rows;
+		row = start % t->num_of_rows;
+		rows = t->num_of_rows - row;
+		if(rows > (end-start))
+		{
+			rows = end - start;
+		}
+
+		fully_connected_ref(t->IN+t->batch_sizeIn*batch,
+				t->weights+row*t->dim_vec,
+				t->dim_vec,
+				rows,
+				t->bias+row,
+				t->O+t->batch_sizeO*batch+row);
+
+		start += rows;
+	}
+}
+#endif
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_float_DENSE_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_dense_context_t), sizeof(float));
+	int r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_dense_context_t), sizeof(float));
+	layer_cpu_float_dense_context_t* context = NULL;
+#ifdef DENSE_USE_GEMM
+	int num_of_rows = (int)RTE_FETCH_INT32(layer->blobs[0]->dims, 0);
+	int dim_vec = (int)RTE_FETCH_INT32(layer->blobs[0]->dims, 1);
+	const float* weights = (const float*)layer->blobs[0]->blob;
+	float* bias;
+#endif
+
+	if(0 == r) {
+		context = (layer_cpu_float_dense_context_t*)LAYER_CONTEXT(nn, layer);
+#ifdef DENSE_USE_GEMM
+		context->packed = NULL;
+#endif
+		r = rte_fold_bn(nn, layer, &context->folded);
+	}
+	if(0 == r) {
+		r = rte_fold_transpose(nn, layer, &context->folded);
+	}
+#ifdef DENSE_USE_GEMM
+	if(0 == r) {
+		if(NULL != context->folded) {
+			weights = context->folded + num_of_rows;
+		}
+		context->gemm = (const alg_sgemm_kernel_t*)rte_cpu_select_kernel(nn, alg_sgemm_kernels);
+		NNLOG(NN_DEBUG, ("%s: use %s GEMM\n", layer->name, context->gemm->name));
+		context->packed = alg_sgemm_malloc(sizeof(float)*alg_sgemm_packed_size(context->gemm, num_of_rows, dim_vec));
+		if(NULL == context->packed) {
+			r = NN_E_NO_MEMORY;
+		} else {
+			alg_sgemm_pack_nt(context->gemm, num_of_rows, dim_vec, weights, dim_vec, context->packed);
+			if(NULL != context->folded) {
+				bias = realloc(context->folded, sizeof(float)*num_of_rows);
+				if(NULL != bias) {
+					context->folded = bias;
+				}
+			}
+		}
+	}
+#endif
 
+	return r;
 }
 
 int layer_cpu_float_DENSE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_dense_context_t* context = (layer_cpu_float_dense_context_t*)layer->C->context;
+	layer_cpu_float_dense_context_t* context = (layer_cpu_float_dense_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	float *IN = (float*)input_context->out[0];
 	float *O = (float*)context->out[0];
 	float *weights = (float*)layer->blobs[0]->blob;
@@ -54,29 +182,57 @@ int layer_cpu_float_DENSE_execute(const nn_t* nn, const layer_t* layer)
 	int num_of_rows = (int)RTE_FETCH_INT32(layer->blobs[0]->dims, 0);
 	int dim_vec = (int)RTE_FETCH_INT32(layer->blobs[0]->dims, 1);
 
-	size_t batch;
-	size_t batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
-	size_t batch_sizeO = NHWC_BATCH_SIZE(context->nhwc);
+	dense_task_t task;
 
-	rte_cpu_dynamic_batch(layer, input_context);
+	if(NULL != context->folded) {
+		bias = context->folded;
+#ifdef DENSE_USE_GEMM
+		/* the packed weights are folded already and folded was cut to the bias */
+		if(NULL == context->packed)
+#endif
+		{
+			weights = context->folded + num_of_rows;
+		}
+	}
+
+	rte_cpu_dynamic_batch(nn, layer, input_context);
 
 	NNLOG(NN_DEBUG, (" *[%dx%d]\n", dim_vec, num_of_rows));
 
-	for(batch=0; batch<input_context->nhwc.N; batch++)
-	{
-		fully_connected_ref(IN+batch_sizeIn*batch,
-				weights,
-				dim_vec,
-				num_of_rows,
-				bias,
-				O+batch_sizeO*batch);
-	}
+	task.IN = IN;
+	task.O = O;
+	task.weights = weights;
+	task.bias = bias;
+	task.dim_vec = dim_vec;
+	task.num_of_rows = num_of_rows;
+	task.batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
+	task.batch_sizeO = NHWC_BATCH_SIZE(context->nhwc);
+
+#ifdef DENSE_USE_GEMM
+	task.gemm = context->gemm;
+	task.packed = context->packed;
+	task.batch = input_context->nhwc.N;
+	task.panel = alg_sgemm_panel_width(context->gemm);
+	task.r = 0;
+	thread_pool_parallel_for(nn->tpool, (num_of_rows+task.panel-1)/task.panel, dense_gemm_task, &task);
+	r = task.r;
+#else
+	thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*num_of_rows, dense_task, &task);
+#endif
 
 	return r;
 }
 
 void layer_cpu_float_DENSE_deinit(const nn_t* nn, const layer_t* layer)
 {
+	layer_cpu_float_dense_context_t* context = (layer_cpu_float_dense_context_t*)LAYER_CONTEXT(nn, layer);
+
+	if(NULL != context) {
+		free(context->folded);
+#ifdef DENSE_USE_GEMM
+		alg_sgemm_free(context->packed);
+#endif
+	}
 	rte_cpu_destory_layer_context(nn, layer);
 }
 
@@ -6,58 +6,269 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
+#include "thread_pool.h"
+/* with GCC or clang on x86 all the kernels are built and the CPU picks one at
+ * runtime, elsewhere only the ones the compiler targets, as gemm.c does */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define DW_HAS_SSE2
+#define DW_HAS_AVX2
+#define DW_TARGET_SSE2 __attribute__((target("sse2")))
+#define DW_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#if defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define DW_HAS_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define DW_HAS_SSE2
+#endif
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define DW_HAS_NEON
+#endif
+#define DW_TARGET_SSE2
+#define DW_TARGET_AVX2
+#endif
 /* ============================ [ MACROS    ] ====================================================== */
+/* the 3x3 interior of dwconv2d_3x3_interior_##isa, over DW_VL channels at a time with
+ * the DW_* of that instruction set, DW_FMA(a, b, c) is a*b+c */
+#define DW_3X3_INTERIOR(isa, target)																\
+target static void dwconv2d_3x3_interior_##isa(const dwconv2d_task_t* t, const float* in, float* out, int y, int x0, int x1) \
+{																									\
+	const int C = t->onhwc->C;																		\
+	const int IC = t->inhwc->C;																		\
+	const int stride = t->strideX*IC;																\
+	const float* w = t->weights;																	\
+	const float* r0;																				\
+	const float* r1;																				\
+	const float* r2;																				\
+	float* o;																						\
+	dw_vec_t acc;																					\
+	float sum;																						\
+	int x, c;																						\
+																									\
+	r0 = in + ((y*t->strideY-t->padY)*t->inhwc->W + x0*t->strideX-t->padX)*IC;					\
+	r1 = r0 + t->inhwc->W*IC;																		\
+	r2 = r1 + t->inhwc->W*IC;																		\
+	o = out + x0*t->pitch;																			\
+																									\
+	for(x=x0; x<x1; x++)																			\
+	{																								\
+		for(c=0; c+DW_VL<=C; c+=DW_VL)																\
+		{																							\
+			acc = DW_LOAD(t->bias+c);																\
+			acc = DW_FMA(DW_LOAD(r0+c), DW_LOAD(w+c), acc);											\
+			acc = DW_FMA(DW_LOAD(r0+IC+c), DW_LOAD(w+C+c), acc);									\
+			acc = DW_FMA(DW_LOAD(r0+2*IC+c), DW_LOAD(w+2*C+c), acc);								\
+			acc = DW_FMA(DW_LOAD(r1+c), DW_LOAD(w+3*C+c), acc);										\
+			acc = DW_FMA(DW_LOAD(r1+IC+c), DW_LOAD(w+4*C+c), acc);									\
+			acc = DW_FMA(DW_LOAD(r1+2*IC+c), DW_LOAD(w+5*C+c), acc);								\
+			acc = DW_FMA(DW_LOAD(r2+c), DW_LOAD(w+6*C+c), acc);										\
+			acc = DW_FMA(DW_LOAD(r2+IC+c), DW_LOAD(w+7*C+c), acc);									\
+			acc = DW_FMA(DW_LOAD(r2+2*IC+c), DW_LOAD(w+8*C+c), acc);								\
+			DW_STORE(o+c, acc);																		\
+		}																							\
+		for(; c<C; c++)																				\
+		{																							\
+			sum = t->bias[c];																		\
+			sum += r0[c]*w[c] + r0[IC+c]*w[C+c] + r0[2*IC+c]*w[2*C+c];								\
+			sum += r1[c]*w[3*C+c] + r1[IC+c]*w[4*C+c] + r1[2*IC+c]*w[5*C+c];						\
+			sum += r2[c]*w[6*C+c] + r2[IC+c]*w[7*C+c] + r2[2*IC+c]*w[8*C+c];						\
+			o[c] = sum;																				\
+		}																							\
+		r0 += stride;																				\
+		r1 += stride;																				\
+		r2 += stride;																				\
+		o += t->pitch;																				\
+	}																								\
+}
 /* ============================ [ TYPES     ] ====================================================== */
+typedef struct {
+	const float* IN;
+	float* O;
+	const float* weights;
+	const float* bias;
+	const NHWC_t* inhwc;
+	const NHWC_t* onhwc;
+	int knlX, knlY, padX, padY, strideX, strideY;
+	int pitch;
+	const struct dwconv2d_kernel_s* kernel;
+} dwconv2d_task_t;
+
+/* the 3x3 interior of one instruction set, 3x3 pixels [x0, x1) of a row whose
+ * taps are all inside the input */
+typedef struct dwconv2d_kernel_s {
+	void (*interior)(const dwconv2d_task_t* t, const float* in, float* out, int y, int x0, int x1);
+} dwconv2d_kernel_t;
+
 typedef struct {
 	LAYER_CPU_CONTEXT_MEMBER;
+	/* the bias and weights with the BATCHNORM folded into this layer, NULL if none */
+	float* folded;
+	/* floats between two output pixels, more than C when writing into a CONCAT */
+	int pitch;
+	/* the dwconv2d_kernel_t of the CPU this instance runs on */
+	const dwconv2d_kernel_t* kernel;
 } layer_cpu_float_dwconv2d_context_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
-static void depthwise_convolve_HWC_ref_nonsquare(const float * Im_in,
-		const int dim_im_in_x,
-		const int dim_im_in_y,
-		const int ch_im_in,
-		const float * wt,
-		const int ch_im_out,
-		const int dim_kernel_x,
-		const int dim_kernel_y,
-		const int padding_x,
-		const int padding_y,
-		const int stride_x,
-		const int stride_y,
-		const float * bias,
-		float * Im_out,
-		const int dim_im_out_x,
-		const int dim_im_out_y
-		)
+/* one output pixel with the bounds checked per tap, the channels are the inner loop */
+static void dwconv2d_pixel(const dwconv2d_task_t* t, const float* in, float* out, int y, int x)
+{
+	const int C = t->onhwc->C;
+	const float* src;
+	const float* w;
+	int ky, kx, iy, ix, c;
+
+	for(c=0; c<C; c++)
+	{
+		out[c] = t->bias[c];
+	}
+
+	for(ky=0; ky<t->knlY; ky++)
+	{
+		iy = y*t->strideY + ky - t->padY;
+		if((iy < 0) || (iy >= t->inhwc->H))
+		{
+			continue;
+		}
+		for(kx=0; kx<t->knlX; kx++)
+		{
+			ix = x*t->strideX + kx - t->padX;
+			if((ix < 0) || (ix >= t->inhwc->W))
+			{
+				continue;
+			}
+			src = in + (iy*t->inhwc->W+ix)*t->inhwc->C;
+			w = t->weights + (ky*t->knlX+kx)*C;
+			for(c=0; c<C; c++)
+			{
+				out[c] += src[c]*w[c];
+			}
+		}
+	}
+}
+
+#ifdef DW_HAS_AVX2
+#define DW_VL 8
+#define dw_vec_t __m256
+#define DW_LOAD(p) _mm256_loadu_ps(p)
+#define DW_STORE(p, v) _mm256_storeu_ps(p, v)
+#define DW_FMA(a, b, c) _mm256_fmadd_ps(a, b, c)
+DW_3X3_INTERIOR(avx2, DW_TARGET_AVX2)
+#undef DW_VL
+#undef dw_vec_t
+#undef DW_LOAD
+#undef DW_STORE
+#undef DW_FMA
+static const dwconv2d_kernel_t dwconv2d_avx2 = { dwconv2d_3x3_interior_avx2 };
+#endif
+
+#ifdef DW_HAS_SSE2
+#define DW_VL 4
+#define dw_vec_t __m128
+#define DW_LOAD(p) _mm_loadu_ps(p)
+#define DW_STORE(p, v) _mm_storeu_ps(p, v)
+#define DW_FMA(a, b, c) _mm_add_ps(_mm_mul_ps(a, b), c)
+DW_3X3_INTERIOR(sse2, DW_TARGET_SSE2)
+#undef DW_VL
+#undef dw_vec_t
+#undef DW_LOAD
+#undef DW_STORE
+#undef DW_FMA
+static const dwconv2d_kernel_t dwconv2d_sse2 = { dwconv2d_3x3_interior_sse2 };
+#endif
+
+#ifdef DW_HAS_NEON
+#define DW_VL 4
+#define dw_vec_t float32x4_t
+#define DW_LOAD(p) vld1q_f32(p)
+#define DW_STORE(p, v) vst1q_f32(p, v)
+#if defined(__aarch64__)
+#define DW_FMA(a, b, c) vfmaq_f32(c, a, b)
+#else
+#define DW_FMA(a, b, c) vmlaq_f32(c, a, b)
+#endif
+DW_3X3_INTERIOR(neon, )
+#undef DW_VL
+#undef dw_vec_t
+#undef DW_LOAD
+#undef DW_STORE
+#undef DW_FMA
+static const dwconv2d_kernel_t dwconv2d_neon = { dwconv2d_3x3_interior_neon };
+#endif
+
+#define DW_VL 1
+#define dw_vec_t float
+#define DW_LOAD(p) (*(p))
+#define DW_STORE(p, v) (*(p) = (v))
+#define DW_FMA(a, b, c) ((a)*(b)+(c))
+DW_3X3_INTERIOR(ref, )
+#undef DW_VL
+#undef dw_vec_t
+#undef DW_LOAD
+#undef DW_STORE
+#undef DW_FMA
+static const dwconv2d_kernel_t dwconv2d_ref = { dwconv2d_3x3_interior_ref };
+
+/* the best first, the generic one is always there */
+static const alg_isa_kernel_t dwconv2d_kernels[] =
 {
-	float conv_out;
-	int i_out_y, i_out_x, i_ch_out;
-	int i_ker_y, i_ker_x;
-	int in_row, in_col;
+#ifdef DW_HAS_AVX2
+	{ ALG_ISA_AVX2, &dwconv2d_avx2 },
+#endif
+#ifdef DW_HAS_SSE2
+	{ ALG_ISA_SSE2, &dwconv2d_sse2 },
+#endif
+#ifdef DW_HAS_NEON
+	{ ALG_ISA_NEON, &dwconv2d_neon },
+#endif
+	{ ALG_ISA_GENERIC, &dwconv2d_ref },
+	{ ALG_ISA_GENERIC, NULL }
+};
 
-	for (i_out_y = 0; i_out_y < dim_im_out_y; i_out_y++)
+/* each work item is one output row of one batch, the 3x3 stride 1 and 2 kernels do the
+ * pixels whose taps are all inside the input, the border ones go pixel by pixel */
+static void dwconv2d_task(void* param, size_t start, size_t end)
+{
+	const dwconv2d_task_t* t = (const dwconv2d_task_t*)param;
+	const int fast = (3 == t->knlX) && (3 == t->knlY) &&
+			(t->strideX <= 2) && (t->strideY <= 2) && (t->inhwc->C == t->onhwc->C);
+	const float* in;
+	float* out;
+	int batch, y, x, x0, x1, iy;
+
+	x0 = (t->padX + t->strideX - 1) / t->strideX;
+	x1 = (t->inhwc->W - t->knlX + t->padX) / t->strideX + 1;
+	x1 = NN_MAX(x0, NN_MIN(x1, t->onhwc->W));
+
+	for(; start < end; start++)
 	{
-		for (i_out_x = 0; i_out_x < dim_im_out_x; i_out_x++)
+		batch = (int)(start / t->onhwc->H);
+		y = (int)(start % t->onhwc->H);
+		in = t->IN + NHWC_BATCH_SIZE(*t->inhwc)*batch;
+		out = t->O + (t->onhwc->H*batch + y)*t->onhwc->W*t->pitch;
+		iy = y*t->strideY - t->padY;
+		if(fast && (iy >= 0) && ((iy + t->knlY) <= t->inhwc->H) && (x0 < x1))
 		{
-			for (i_ch_out = 0; i_ch_out < ch_im_out; i_ch_out++)
+			for(x=0; x<x0; x++)
 			{
-				conv_out = bias[i_ch_out];
-				for (i_ker_y = 0; i_ker_y < dim_kernel_y; i_ker_y++)
-				{
-					for (i_ker_x = 0; i_ker_x < dim_kernel_x; i_ker_x++)
-					{
-						in_row = stride_y * i_out_y + i_ker_y - padding_y;
-						in_col = stride_x * i_out_x + i_ker_x - padding_x;
-						if ((in_row >= 0) && (in_col >= 0) && (in_row < dim_im_in_y) && (in_col < dim_im_in_x))
-						{
-							conv_out += Im_in[(in_row * dim_im_in_x + in_col) * ch_im_in + i_ch_out] *
-								wt[(i_ker_y * dim_kernel_x + i_ker_x) * ch_im_out + i_ch_out];
-						}
-					}
-				}
-				Im_out[(i_out_y * dim_im_out_x + i_out_x) * ch_im_out + i_ch_out] = conv_out;
+				dwconv2d_pixel(t, in, out+x*t->pitch, y, x);
+			}
+			t->kernel->interior(t, in, out, y, x0, x1);
+			for(x=x1; x<t->onhwc->W; x++)
+			{
+				dwconv2d_pixel(t, in, out+x*t->pitch, y, x);
+			}
+		}
+		else
+		{
+			for(x=0; x<t->onhwc->W; x++)
+			{
+				dwconv2d_pixel(t, in, out+x*t->pitch, y, x);
 			}
 		}
 	}
@@ -65,29 +276,42 @@ static void depthwise_convolve_HWC_ref_nonsquare(const float * Im_in,
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_float_DWCONV2D_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_dwconv2d_context_t), sizeof(float));
+	int pitch;
+	int r = rte_cpu_create_layer_slice(nn, layer, sizeof(layer_cpu_float_dwconv2d_context_t), &pitch);
+	layer_cpu_float_dwconv2d_context_t* context;
+
+	if(0 == r)
+	{
+		context = (layer_cpu_float_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
+		context->pitch = pitch;
+		context->kernel = (const dwconv2d_kernel_t*)rte_cpu_select_kernel(nn, dwconv2d_kernels);
+		r = rte_fold_bn(nn, layer, &context->folded);
+	}
+
+	return r;
 }
 int layer_cpu_float_DWCONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_dwconv2d_context_t* context = (layer_cpu_float_dwconv2d_context_t*)layer->C->context;
-	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
-	float *IN = (float*)input_context->out[0];
+	layer_cpu_float_dwconv2d_context_t* context = (layer_cpu_float_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
+	const layer_t* input;
+	layer_cpu_context_t* input_context;
+	float *IN;
 	float *O = (float*)context->out[0];
 	float *weights = (float*)layer->blobs[0]->blob;
 	float *bias = (float*)layer->blobs[1]->blob;
 	int knlX, knlY, padX, padY, strideX, strideY;
 	int* ints;
-
-	size_t batch;
-	size_t batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
-	size_t batch_sizeO = NHWC_BATCH_SIZE(context->nhwc);
-
+	dwconv2d_task_t task;
 
 	ints = (int*)layer->blobs[0]->dims;
 	knlY = ints[1];
 	knlX = ints[2];
+	if(NULL != context->folded)
+	{
+		bias = context->folded;
+		weights = context->folded + ints[3];
+	}
 
 	ints = (int*)layer->blobs[2]->blob;
 	padY = ints[0];
@@ -95,30 +319,41 @@ int layer_cpu_float_DWCONV2D_execute(const nn_t* nn, const layer_t* layer)
 	strideY = ints[4];
 	strideX = ints[5];
 
+	input = rte_get_padded_input(nn, layer, &padY, &padX);
+	input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
+	IN = (float*)input_context->out[0];
+
 	NNLOG(NN_DEBUG, (" kernel=[%d %d], pads=[%d %d], strides=[%d %d]\n",
 			knlY, knlX, padY, padX, strideY, strideX));
 
-	for(batch=0; batch<input_context->nhwc.N; batch++)
-	{
-		depthwise_convolve_HWC_ref_nonsquare(IN+batch_sizeIn*batch,
-			input_context->nhwc.W,
-			input_context->nhwc.H,
-			input_context->nhwc.C,
-			weights,
-			context->nhwc.C,
-			knlX, knlY,
-			padX, padY,
-			strideX, strideY,
-			bias,
-			O+batch_sizeO*batch,
-			context->nhwc.W,
-			context->nhwc.H);
-	}
+	task.IN = IN;
+	task.O = O;
+	task.weights = weights;
+	task.bias = bias;
+	task.inhwc = &input_context->nhwc;
+	task.onhwc = &context->nhwc;
+	task.knlX = knlX;
+	task.knlY = knlY;
+	task.padX = padX;
+	task.padY = padY;
+	task.strideX = strideX;
+	task.strideY = strideY;
+	task.pitch = context->pitch;
+	task.kernel = context->kernel;
+
+	thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H, dwconv2d_task, &task);
 
 	return r;
 }
 void layer_cpu_float_DWCONV2D_deinit(const nn_t* nn, const layer_t* layer)
 {
+	layer_cpu_float_dwconv2d_context_t* context = (layer_cpu_float_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
+
+	if(NULL != context)
+	{
+		free(context->folded);
+	}
+
 	rte_cpu_destory_layer_context(nn, layer);
 }
 
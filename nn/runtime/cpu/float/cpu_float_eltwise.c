@@ -7,6 +7,7 @@
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
 #include "algorithm.h"
+#include "thread_pool.h"
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
@@ -16,6 +17,14 @@ typedef struct {
 	layer_context_t* inputA_context;
 	layer_context_t* inputB_context;
 } layer_cpu_float_eltwise_context_t;
+
+typedef struct {
+	int op;
+	float* A;
+	float* B;
+	float* O;
+	size_t C;
+} eltwise_task_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -37,97 +46,110 @@ DEF_ALG_BROADCAST_CHANNEL(float, ADD)
 DEF_ALG_BROADCAST_CHANNEL(float, SUB)
 DEF_ALG_BROADCAST_CHANNEL(float, MUL)
 
-static int layer_cpu_float_eltwise_init(const nn_t* nn, const layer_t* layer)
+/* each work item is one pixel, that is C elements, so the channel broadcast stays aligned */
+static void eltwise_task(void* param, size_t start, size_t end)
 {
-	layer_cpu_float_eltwise_context_t* context;
-	int r;
-
-	r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_eltwise_context_t), sizeof(float));
-
-	if(0 == r) {
-		layer_cpu_float_eltwise_context_t* context = (layer_cpu_float_eltwise_context_t*)layer->C->context;
-		context->broadcast = ALG_BROADCAST_NONE;
-		context->inputA_context = (layer_context_t*)layer->inputs[0]->C->context;
-		context->inputB_context = (layer_context_t*)layer->inputs[1]->C->context;
-		r = alg_broadcast_prepare(&(context->inputA_context), &(context->inputB_context), &(context->broadcast));
-	}
-
-	return r;
-}
-
-static int layer_cpu_float_eltwise_execute(const nn_t* nn, const layer_t* layer)
-{
-	int r = 0;
-	layer_cpu_float_eltwise_context_t* context = (layer_cpu_float_eltwise_context_t*)layer->C->context;
-	size_t sz;
-	float* A;
-	float* B;
-	float* O;
-
-#ifndef DISABLE_DYNAMIC_SHAPE
-  rte_cpu_dynamic_shape_copy(layer, (layer_cpu_context_t*)context->inputA_context);
-  sz = NHWC_SIZE(context->nhwc);
-  if(NULL == context->out[0]) {
-	r = alg_broadcast_prepare(&(context->inputA_context), &(context->inputB_context), &(context->broadcast));
-  }
-  if( 0 == r) {
-	r = rte_cpu_dynamic_memory(&context->out[0], sz, &context->allocated, sizeof(float));
-  }
-#endif
-  if(0 == r) {
-	A = (float*)context->inputA_context->out[0];
-	B = (float*)context->inputB_context->out[0];
-	O = (float*)context->out[0];
+	eltwise_task_t* t = (eltwise_task_t*)param;
+	float* A = t->A + start*t->C;
+	float* B = t->B;
+	float* O = t->O + start*t->C;
+	size_t sz = (end-start)*t->C;
 
-	switch(layer->op+context->broadcast)
+	switch(t->op)
 	{
 		case L_OP_MAXIMUM:
-			alg_eltwise_MAX_float(A, B, O, sz);
+			alg_eltwise_MAX_float(A, B+start*t->C, O, sz);
 			break;
 		case L_OP_MAXIMUM+ALG_BROADCAST_ONE:
 			alg_broadcast_one_MAX_float(A, B[0], O, sz);
 			break;
 		case L_OP_MAXIMUM+ALG_BROADCAST_CHANNEL:
-			alg_broadcast_channel_MAX_float(A, B, O, sz, context->nhwc.C);
+			alg_broadcast_channel_MAX_float(A, B, O, sz, t->C);
 			break;
 		case L_OP_ADD:
-			alg_eltwise_ADD_float(A, B, O, sz);
+			alg_eltwise_ADD_float(A, B+start*t->C, O, sz);
 			break;
 		case L_OP_ADD+ALG_BROADCAST_ONE:
 			alg_broadcast_one_ADD_float(A, B[0], O, sz);
 			break;
 		case L_OP_ADD+ALG_BROADCAST_CHANNEL:
-			alg_broadcast_channel_ADD_float(A, B, O, sz, context->nhwc.C);
+			alg_broadcast_channel_ADD_float(A, B, O, sz, t->C);
 			break;
 		case L_OP_MINIMUM:
-			alg_eltwise_MIN_float(A, B, O, sz);
+			alg_eltwise_MIN_float(A, B+start*t->C, O, sz);
 			break;
 		case L_OP_MINIMUM+ALG_BROADCAST_ONE:
 			alg_broadcast_one_MIN_float(A, B[0], O, sz);
 			break;
 		case L_OP_MINIMUM+ALG_BROADCAST_CHANNEL:
-			alg_broadcast_channel_MIN_float(A, B, O, sz, context->nhwc.C);
+			alg_broadcast_channel_MIN_float(A, B, O, sz, t->C);
 			break;
 		case L_OP_MUL:
-			alg_eltwise_MUL_float(A, B, O, sz);
+			alg_eltwise_MUL_float(A, B+start*t->C, O, sz);
 			break;
 		case L_OP_MUL+ALG_BROADCAST_ONE:
 			alg_broadcast_one_MUL_float(A, B[0], O, sz);
 			break;
 		case L_OP_MUL+ALG_BROADCAST_CHANNEL:
-			alg_broadcast_channel_MUL_float(A, B, O, sz, context->nhwc.C);
+			alg_broadcast_channel_MUL_float(A, B, O, sz, t->C);
 			break;
 		default:
-			r = NN_E_INVALID_LAYER;
+			assert(0);
 			break;
 	}
+}
+
+static int layer_cpu_float_eltwise_init(const nn_t* nn, const layer_t* layer)
+{
+	layer_cpu_float_eltwise_context_t* context;
+	int r;
+
+	/* element by element, so the output may be over the input of the same size */
+	r = rte_cpu_create_layer_inplace(nn, layer, sizeof(layer_cpu_float_eltwise_context_t), sizeof(float));
+
+	if(0 == r) {
+		layer_cpu_float_eltwise_context_t* context = (layer_cpu_float_eltwise_context_t*)LAYER_CONTEXT(nn, layer);
+		context->broadcast = ALG_BROADCAST_NONE;
+		context->inputA_context = (layer_context_t*)LAYER_CONTEXT(nn, layer->inputs[0]);
+		context->inputB_context = (layer_context_t*)LAYER_CONTEXT(nn, layer->inputs[1]);
+		r = alg_broadcast_prepare(&(context->inputA_context), &(context->inputB_context), &(context->broadcast));
+	}
+
+	return r;
+}
+
+static int layer_cpu_float_eltwise_execute(const nn_t* nn, const layer_t* layer)
+{
+	int r = 0;
+	layer_cpu_float_eltwise_context_t* context = (layer_cpu_float_eltwise_context_t*)LAYER_CONTEXT(nn, layer);
+	size_t sz;
+	eltwise_task_t task;
+
+#ifndef DISABLE_DYNAMIC_SHAPE
+  rte_cpu_dynamic_shape_copy(nn, layer, (layer_cpu_context_t*)context->inputA_context);
+  sz = NHWC_SIZE(context->nhwc);
+  if(NULL == context->out[0]) {
+	r = alg_broadcast_prepare(&(context->inputA_context), &(context->inputB_context), &(context->broadcast));
+  }
+  if( 0 == r) {
+	r = rte_cpu_dynamic_memory(nn, layer, 0, sz, &context->allocated, sizeof(float));
+  }
+#endif
+  if(0 == r) {
+	task.op = layer->op+context->broadcast;
+	task.A = (float*)context->inputA_context->out[0];
+	task.B = (float*)context->inputB_context->out[0];
+	task.O = (float*)context->out[0];
+	task.C = context->nhwc.C;
+
+	thread_pool_parallel_for(nn->tpool, sz/task.C, eltwise_task, &task);
   }
 	return r;
 }
 
 static void layer_cpu_float_eltwise_deinit(const nn_t* nn, const layer_t* layer)
 {
-	rte_cpu_dynamic_free(layer);
+	rte_cpu_dynamic_free(nn, layer);
 	rte_cpu_destory_layer_context(nn, layer);
 }
 /* ============================ [ FUNCTIONS ] ====================================================== */
@@ -25,7 +25,7 @@ int layer_cpu_float_INPUT_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cpu_float_input_context_t*)layer->C->context;
+		context = (layer_cpu_float_input_context_t*)LAYER_CONTEXT(nn, layer);
 		context->out[0] = NULL;
 	}
 
@@ -35,7 +35,7 @@ int layer_cpu_float_INPUT_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_INPUT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_input_context_t* context = (layer_cpu_float_input_context_t*)layer->C->context;
+	layer_cpu_float_input_context_t* context = (layer_cpu_float_input_context_t*)LAYER_CONTEXT(nn, layer);
 
 	context->out[0] = nn_get_input_data(nn, layer);
 
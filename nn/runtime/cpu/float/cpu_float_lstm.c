@@ -6,18 +6,20 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
-#include <math.h>
+#include "fastmath.h"
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CPU_CONTEXT_MEMBER;
 	float* h;
 	float* c;
+	/* the alg_fastmath_kernel_t of the CPU this instance runs on */
+	const alg_fastmath_kernel_t* fm;
 } layer_cpu_float_lstm_context_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
-static void gate_calc(float* x, const float* W, float* h, const float* R,
+static void gate_calc(const alg_fastmath_kernel_t* fm, float* x, const float* W, float* h, const float* R,
 		const float* Wb, const float* Rb, const float* P, const float* c, float* gate,
 		int input_size, int hidden_size, int output_size, layer_activation_type_t activation)
 {
@@ -38,18 +40,19 @@ static void gate_calc(float* x, const float* W, float* h, const float* R,
 			o += P[i]*c[i];
 		}
 
-		switch(activation){
-		case L_ACT_SIGMOID:
-			o = 1 / (1 + exp(-o));
-			break;
-		case L_ACT_TANH:
-			o = tanh(o);
-			break;
-		default:
-			break;
-		}
 		gate[i] = o;
 	}
+
+	switch(activation){
+	case L_ACT_SIGMOID:
+		fm->vsigmoidf(gate, gate, hidden_size);
+		break;
+	case L_ACT_TANH:
+		fm->vtanhf(gate, gate, hidden_size);
+		break;
+	default:
+		break;
+	}
 }
 
 static void cell_state_calc(float* c, float* ft, float* it, float* ct, int hidden_size)
@@ -61,12 +64,13 @@ static void cell_state_calc(float* c, float* ft, float* it, float* ct, int hidde
 	}
 }
 
-static void output_calc(float* h, float* Ct, float* ot, int hidden_size)
+static void output_calc(const alg_fastmath_kernel_t* fm, float* h, float* Ct, float* ot, int hidden_size)
 {
 	int i;
 
+	fm->vtanhf(Ct, h, hidden_size);
 	for(i=0; i<hidden_size; i++){
-		h[i] = ot[i]*tanh(Ct[i]);
+		h[i] = ot[i]*h[i];
 	}
 }
 
@@ -92,16 +96,17 @@ int layer_cpu_float_LSTM_init(const nn_t* nn, const layer_t* layer)
 	int r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_lstm_context_t), sizeof(float));
 
 	if(0 == r) {
-		context = (layer_cpu_float_lstm_context_t*)layer->C->context;
+		context = (layer_cpu_float_lstm_context_t*)LAYER_CONTEXT(nn, layer);
 		num_directions = layer->blobs[0]->dims[0];
 		hidden_size = layer->blobs[0]->dims[1]/4;
 		output_size = context->nhwc.C;
 		context->c = malloc(num_directions*sizeof(float)*(hidden_size+output_size));
 		context->h = context->c + num_directions*hidden_size;
+		context->fm = (const alg_fastmath_kernel_t*)rte_cpu_select_kernel(nn, alg_fastmath_kernels);
 		scratch_size = 3*sizeof(float)*hidden_size;
 		#if !defined(DISABLE_RTE_FALLBACK) && !defined(DISABLE_RUNTIME_OPENCL)
 		if(RUNTIME_OPENCL == nn->runtime_type) { /* those are used for fallback */
-			scratch_size += sizeof(float)*NHWC_SIZE(layer->inputs[0]->C->context->nhwc) + sizeof(void*);
+			scratch_size += sizeof(float)*NHWC_SIZE(LAYER_CONTEXT(nn, layer->inputs[0])->nhwc) + sizeof(void*);
 			scratch_size += sizeof(float)*NHWC_SIZE(context->nhwc) + sizeof(void*);
 		}
 		#endif
@@ -119,8 +124,8 @@ int layer_cpu_float_LSTM_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
 	int batch_size, input_size, hidden_size, output_size, i;
-	layer_cpu_float_lstm_context_t* context = (layer_cpu_float_lstm_context_t*)layer->C->context;
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)layer->inputs[0]->C->context;
+	layer_cpu_float_lstm_context_t* context = (layer_cpu_float_lstm_context_t*)LAYER_CONTEXT(nn, layer);
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer->inputs[0]);
 	float* x;
 	float* y;
 	const float *Wi,*Wo,*Wf,*Wc;
@@ -206,16 +211,16 @@ int layer_cpu_float_LSTM_execute(const nn_t* nn, const layer_t* layer)
 		}
 
 		for(i=0; i<batch_size; i++) {
-			gate_calc(x, Wi, h, Ri, Wbi, Rbi, Pi, c, it, input_size, hidden_size, output_size, L_ACT_SIGMOID);
-			gate_calc(x, Wf, h, Rf, Wbf, Rbf, Pf, c, ft, input_size, hidden_size, output_size, L_ACT_SIGMOID);
-			gate_calc(x, Wc, h, Rc, Wbc, Rbc, NULL, NULL, ct, input_size, hidden_size, output_size, L_ACT_TANH);
+			gate_calc(context->fm, x, Wi, h, Ri, Wbi, Rbi, Pi, c, it, input_size, hidden_size, output_size, L_ACT_SIGMOID);
+			gate_calc(context->fm, x, Wf, h, Rf, Wbf, Rbf, Pf, c, ft, input_size, hidden_size, output_size, L_ACT_SIGMOID);
+			gate_calc(context->fm, x, Wc, h, Rc, Wbc, Rbc, NULL, NULL, ct, input_size, hidden_size, output_size, L_ACT_TANH);
 			cell_state_calc(c, ft, it, ct, hidden_size);
-			gate_calc(x, Wo, h, Ro, Wbo, Rbo, Po, c, ot, input_size, hidden_size, output_size, L_ACT_SIGMOID);
+			gate_calc(context->fm, x, Wo, h, Ro, Wbo, Rbo, Po, c, ot, input_size, hidden_size, output_size, L_ACT_SIGMOID);
 			if(NULL != PJ) {
-				output_calc(ct, c, ot, hidden_size);
+				output_calc(context->fm, ct, c, ot, hidden_size);
 				projection(h, ct, PJ, hidden_size, output_size);
 			} else {
-				output_calc(h, c, ot, hidden_size);
+				output_calc(context->fm, h, c, ot, hidden_size);
 			}
 			memcpy(y, h, output_size*sizeof(float));
 			if(context->nhwc.H == batch_size) {
@@ -229,7 +234,7 @@ int layer_cpu_float_LSTM_execute(const nn_t* nn, const layer_t* layer)
 }
 void layer_cpu_float_LSTM_deinit(const nn_t* nn, const layer_t* layer)
 {
-	layer_cpu_float_lstm_context_t* context = (layer_cpu_float_lstm_context_t*)layer->C->context;
+	layer_cpu_float_lstm_context_t* context = (layer_cpu_float_lstm_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context) {
 		if(NULL != context->c) free(context->c);
@@ -275,7 +275,7 @@ int layer_cpu_float_MFCC_init(const nn_t* nn, const layer_t* layer)
 	int r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_mfcc_context_t), sizeof(float));
 
 	if(0 == r) {
-		context = (layer_cpu_float_mfcc_context_t*)layer->C->context;
+		context = (layer_cpu_float_mfcc_context_t*)LAYER_CONTEXT(nn, layer);
 		memset(&((layer_cpu_context_t*)context)[1], 0,
 				sizeof(layer_cpu_float_mfcc_context_t)-sizeof(layer_cpu_context_t));
 		if(NETWORK_TYPE_FLOAT == nn->network->type) {
@@ -335,7 +335,7 @@ int layer_cpu_float_MFCC_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_MFCC_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_mfcc_context_t* context = (layer_cpu_float_mfcc_context_t*)layer->C->context;
+	layer_cpu_float_mfcc_context_t* context = (layer_cpu_float_mfcc_context_t*)LAYER_CONTEXT(nn, layer);
 
 	wav_t* wav = nn_get_input_data(nn, layer);
 
@@ -357,7 +357,7 @@ int layer_cpu_float_MFCC_execute(const nn_t* nn, const layer_t* layer)
 void layer_cpu_float_MFCC_deinit(const nn_t* nn, const layer_t* layer)
 {
 	int i;
-	layer_cpu_float_mfcc_context_t* context = (layer_cpu_float_mfcc_context_t*)layer->C->context;
+	layer_cpu_float_mfcc_context_t* context = (layer_cpu_float_mfcc_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context) {
 		if((-1 == layer->dims[1]) && (NULL != context->out[0])) {
@@ -23,9 +23,9 @@ int layer_cpu_float_NORMALIZE_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_NORMALIZE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	float* scale = (float*)layer->blobs[0]->blob;
 	float *IN = (float*)input_context->out[0];
 	float *O = (float*)context->out[0];
@@ -26,7 +26,7 @@ int layer_cpu_float_OUTPUT_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cpu_float_output_context_t*)layer->C->context;
+		context = (layer_cpu_float_output_context_t*)LAYER_CONTEXT(nn, layer);
 		context->p_out = out;
 	}
 
@@ -36,20 +36,24 @@ int layer_cpu_float_OUTPUT_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_OUTPUT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_output_context_t* context = (layer_cpu_float_output_context_t*)layer->C->context;
+	layer_cpu_float_output_context_t* context = (layer_cpu_float_output_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cpu_context_t* input_context;
 	float* data;
 
-	input_context = (layer_cpu_context_t*)input->C->context;
+	input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	if(context->p_out != NULL) {
-		context->out[0] = context->p_out;
+		context->out[0] = nn_get_output_data(nn, layer);
 	}
-  rte_cpu_dynamic_shape_copy(layer, input_context);
-  r = rte_cpu_dynamic_memory(&context->out[0], NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
+  rte_cpu_dynamic_shape_copy(nn, layer, input_context);
+  r = rte_cpu_dynamic_memory(nn, layer, 0, NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
   if(0 == r) {
 	data = (float*)context->out[0];
-	if(NULL != data)
+	if(data == input_context->out[0])
+	{
+		/* the input layer has written it in place */
+	}
+	else if(NULL != data)
 	{
 		memcpy(data, input_context->out[0], NHWC_SIZE(context->nhwc)*sizeof(float));
 	}
@@ -63,7 +67,7 @@ int layer_cpu_float_OUTPUT_execute(const nn_t* nn, const layer_t* layer)
 
 void layer_cpu_float_OUTPUT_deinit(const nn_t* nn, const layer_t* layer)
 {
-	rte_cpu_dynamic_free(layer);
+	rte_cpu_dynamic_free(nn, layer);
 	rte_cpu_destory_layer_context(nn, layer);
 }
 #endif /* DISABLE_RUNTIME_CPU_FLOAT */
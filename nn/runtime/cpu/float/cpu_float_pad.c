@@ -59,19 +59,31 @@ static void padding_HWC_ref(const float *Im_in,
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_float_PAD_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_pad_context_t), sizeof(float));
+	int r;
+	const layer_t* reader = rte_get_pad_reader(nn, layer);
 
+	if(NULL != reader)
+	{	/* the reader pads its input itself, so there is nothing to keep */
+		NNLOG(NN_DEBUG, ("%s: fused into %s\n", layer->name, reader->name));
+		r = rte_cpu_create_layer_context(nn, layer, sizeof(layer_cpu_float_pad_context_t), 0);
+	}
+	else
+	{
+		r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_pad_context_t), sizeof(float));
+	}
+
+	return r;
 }
 
 int layer_cpu_float_PAD_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_pad_context_t* context = (layer_cpu_float_pad_context_t*)layer->C->context;
+	layer_cpu_float_pad_context_t* context = (layer_cpu_float_pad_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 
 	float* IN = (float*)input_context->out[0];
-	float *O = (float*)context->out[0];
+	float *O;
 
 	size_t batch;
 	size_t batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
@@ -85,6 +97,12 @@ int layer_cpu_float_PAD_execute(const nn_t* nn, const layer_t* layer)
 
 	float value = RTE_FETCH_FLOAT(layer->blobs[1]->blob, 0);
 
+	if(0 == context->nout)
+	{	/* fused */
+		return r;
+	}
+
+	O = (float*)context->out[0];
 	assert(layer->blobs[0]->dims[0] == 8);
 	NNLOG(NN_DEBUG, (" padding=[%d %d %d %d]\n",
 			padding_top,padding_bottom, padding_left,padding_right));
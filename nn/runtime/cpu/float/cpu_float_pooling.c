@@ -6,6 +6,7 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
+#include "thread_pool.h"
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
@@ -15,6 +16,18 @@ typedef struct {
 	size_t allocated_mask;
 #endif
 } layer_cpu_float_pool_context_t;
+
+typedef struct {
+	const float* IN;
+	float* O;
+	uint8_t* M;
+	const NHWC_t* inhwc;
+	const NHWC_t* onhwc;
+	int knlX, knlY, padX, padY, strideX, strideY;
+	/* what the max sees outside of the input */
+	float outside;
+	layer_operation_t op;
+} pool_task_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -32,7 +45,8 @@ static void maxpooling(const float * Im_in,
 		float * Im_out,
 		const int dim_im_out_x,
 		const int dim_im_out_y,
-		uint8_t* Mask_out)
+		uint8_t* Mask_out,
+		float outside)
 {
 	int   i_ch_in, i_x, i_y;
 	int   k_x, k_y;
@@ -61,6 +75,10 @@ static void maxpooling(const float * Im_in,
 								}
 							}
 						}
+						else if(outside > max)
+						{
+							max = outside;
+						}
 					}
 				}
 				Im_out[i_ch_in + ch_im_in * (i_x + i_y * dim_im_out_x)] = max;
@@ -128,7 +146,8 @@ int pooling(const float * Im_in,
 		const int dim_im_out_x,
 		const int dim_im_out_y,
 		layer_operation_t op,
-		uint8_t* Mask_out)
+		uint8_t* Mask_out,
+		float outside)
 {
 	int r = 0;
 
@@ -149,7 +168,8 @@ int pooling(const float * Im_in,
 				Im_out,
 				dim_im_out_x,
 				dim_im_out_y,
-				Mask_out);
+				Mask_out,
+				outside);
 			break;
 		case L_OP_AVGPOOL:
 			avgpooling(Im_in,
@@ -174,6 +194,44 @@ int pooling(const float * Im_in,
 
 	return r;
 }
+/* each work item is one output row of one batch, rows are selected by shifting the
+ * output pointer and the top padding */
+static void pool_task(void* param, size_t start, size_t end)
+{
+	pool_task_t* t = (pool_task_t*)param;
+	size_t batch, row, rows;
+	size_t offset;
+
+	while(start < end)
+	{
+		batch = start / t->onhwc->H;
+		row = start % t->onhwc->H;
+		rows = t->onhwc->H - row;
+		if(rows > (end-start))
+		{
+			rows = end - start;
+		}
+
+		offset = NHWC_BATCH_SIZE(*t->onhwc)*batch + row*t->onhwc->W*t->onhwc->C;
+		(void)pooling(t->IN+NHWC_BATCH_SIZE(*t->inhwc)*batch,
+				t->inhwc->W,
+				t->inhwc->H,
+				t->inhwc->C,
+				t->onhwc->C,
+				t->knlX, t->knlY,
+				t->padX, t->padY - (int)row*t->strideY,
+				t->strideX, t->strideY,
+				t->O+offset,
+				t->onhwc->W,
+				rows,
+				t->op,
+				(NULL != t->M) ? (t->M+offset) : NULL,
+				t->outside);
+
+		start += rows;
+	}
+}
+
 static int layer_cpu_float_pool_init(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
@@ -192,7 +250,7 @@ static int layer_cpu_float_pool_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cpu_float_pool_context_t*)layer->C->context;
+		context = (layer_cpu_float_pool_context_t*)LAYER_CONTEXT(nn, layer);
 
 	  bsz = NHWC_SIZE(context->nhwc);
 	  if(bsz > 0) {
@@ -228,19 +286,18 @@ static int layer_cpu_float_pool_init(const nn_t* nn, const layer_t* layer)
 static int layer_cpu_float_pool_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_pool_context_t* context = (layer_cpu_float_pool_context_t*)layer->C->context;
-	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;;
-	float* IN = (float*)input_context->out[0];
+	layer_cpu_float_pool_context_t* context = (layer_cpu_float_pool_context_t*)LAYER_CONTEXT(nn, layer);
+	const layer_t* input;
+	const layer_t* pad = rte_get_fused_pad(nn, layer);
+	layer_cpu_context_t* input_context;
+	float* IN;
 	float *O;
 	uint8_t *M = NULL;
 
 	int* ints;
 	int with_mask;
 	int knlX, knlY, padX, padY, strideX, strideY;
-	size_t batch;
-	size_t batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
-	size_t batch_sizeO = NHWC_BATCH_SIZE(context->nhwc);
+	pool_task_t task;
 
 	ints = (int*)layer->blobs[0]->blob;
 	with_mask = ints[6];
@@ -253,14 +310,18 @@ static int layer_cpu_float_pool_execute(const nn_t* nn, const layer_t* layer)
 	strideY = ints[4];
 	strideX = ints[5];
 
+	input = rte_get_padded_input(nn, layer, &padY, &padX);
+	input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
+	IN = (float*)input_context->out[0];
+
 #ifndef DISABLE_DYNAMIC_SHAPE
-	r = rte_cpu_dynamic_conv2d_or_pool(layer, (layer_cpu_context_t*)context, input_context,
+	r = rte_cpu_dynamic_conv2d_or_pool(nn, layer, (layer_cpu_context_t*)context, input_context,
 				&padY, &padX, strideY, strideX, knlY, knlX);
 	if(0 == r) {
-		r = rte_cpu_dynamic_memory(&context->out[0], NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
+		r = rte_cpu_dynamic_memory(nn, layer, 0, NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
 	}
 	if((0 == r) && (with_mask)) {
-		r = rte_cpu_dynamic_memory(&context->out[1], NHWC_SIZE(context->nhwc), &context->allocated_mask, sizeof(uint8_t));
+		r = rte_cpu_dynamic_memory(nn, layer, 1, NHWC_SIZE(context->nhwc), &context->allocated_mask, sizeof(uint8_t));
 	}
 #endif
   if(0 == r) {
@@ -275,28 +336,29 @@ static int layer_cpu_float_pool_execute(const nn_t* nn, const layer_t* layer)
 					knlY, knlX, padY, padX, strideY, strideX));
 
 
-	for(batch=0; batch<input_context->nhwc.N; batch++)
+	if((L_OP_MAXPOOL != layer->op) && (L_OP_AVGPOOL != layer->op))
 	{
-		r = pooling(IN+batch_sizeIn*batch,
-				input_context->nhwc.W,
-				input_context->nhwc.H,
-				input_context->nhwc.C,
-				context->nhwc.C,
-				knlX, knlY,
-				padX, padY,
-				strideX, strideY,
-				O+batch_sizeO*batch,
-				context->nhwc.W,
-				context->nhwc.H,
-				layer->op,
-				M
-				);
-		if(2 == context->nout)
-		{
-			M = M + batch_sizeO;
-		}
+		r = NN_E_INVALID_LAYER;
 	}
   }
+
+  if(0 == r) {
+	task.IN = IN;
+	task.O = O;
+	task.M = M;
+	task.inhwc = &input_context->nhwc;
+	task.onhwc = &context->nhwc;
+	task.knlX = knlX;
+	task.knlY = knlY;
+	task.padX = padX;
+	task.padY = padY;
+	task.strideX = strideX;
+	task.strideY = strideY;
+	task.outside = (NULL != pad) ? RTE_FETCH_FLOAT(pad->blobs[1]->blob, 0) : -FLT_MAX;
+	task.op = layer->op;
+
+	thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H, pool_task, &task);
+  }
 	return r;
 }
 
@@ -38,7 +38,7 @@ int layer_cpu_float_PROPOSAL_init(const nn_t* nn, const layer_t* layer)
 	int r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_proposal_context_t), sizeof(float));
 
 	if(0 == r) {
-		context = (layer_cpu_float_proposal_context_t*) layer->C->context;
+		context = (layer_cpu_float_proposal_context_t*) LAYER_CONTEXT(nn, layer);
 		r = rpn_generate_anchors(nn, layer, &context->anchors, &context->n_anchors);
 	}
 
@@ -47,13 +47,13 @@ int layer_cpu_float_PROPOSAL_init(const nn_t* nn, const layer_t* layer)
 
 int layer_cpu_float_PROPOSAL_execute(const nn_t* nn, const layer_t* layer)
 {
-	layer_cpu_float_proposal_context_t* context = (layer_cpu_float_proposal_context_t*) layer->C->context;
+	layer_cpu_float_proposal_context_t* context = (layer_cpu_float_proposal_context_t*) LAYER_CONTEXT(nn, layer);
 	return rpn_proposal_forward(nn, layer, context->anchors, context->n_anchors);
 }
 void layer_cpu_float_PROPOSAL_deinit(const nn_t* nn, const layer_t* layer)
 {
 #ifdef DISBALE_CONST_RPN_ANCHORS
-	layer_cpu_float_proposal_context_t * context = (layer_cpu_float_proposal_context_t*) layer->C->context;
+	layer_cpu_float_proposal_context_t * context = (layer_cpu_float_proposal_context_t*) LAYER_CONTEXT(nn, layer);
 
 	if(context != NULL) {
 		if(context->anchors != NULL) {
@@ -27,15 +27,15 @@ int layer_cpu_float_RESHAPE_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cpu_float_reshape_context_t*)layer->C->context;
+		context = (layer_cpu_float_reshape_context_t*)LAYER_CONTEXT(nn, layer);
 
 		input = layer->inputs[0];
-		input_context = (layer_cpu_context_t*)input->C->context;
+		input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 
 		if(NULL != input_context->out[0])
 		{
 			/* reuse its input layer's output buffer */
-			rte_cpu_take_buffer(input_context->out[0], layer, 0);
+			rte_cpu_alias_buffer(nn, input_context->out[0], layer, 0);
 		}
 	}
 
@@ -45,13 +45,13 @@ int layer_cpu_float_RESHAPE_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_RESHAPE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_reshape_context_t* context = (layer_cpu_float_reshape_context_t*)layer->C->context;
+	layer_cpu_float_reshape_context_t* context = (layer_cpu_float_reshape_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 
 	float* IN = (float*)input_context->out[0];
 
-	rte_cpu_dynamic_reshape(layer, input_context);
+	rte_cpu_dynamic_reshape(nn, layer, input_context);
 
 	context->out[0] = IN;	/* yes, just set up the output */
 
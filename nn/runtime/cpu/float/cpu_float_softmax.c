@@ -6,18 +6,20 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_FLOAT
 #include "../runtime_cpu.h"
-#include <math.h>
+#include "fastmath.h"
 /* ============================ [ MACROS    ] ====================================================== */
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CPU_CONTEXT_MEMBER;
 	LAYER_CPU_DYNMIC_SHAPE_COMMON_MEMBER;
 	void* p_out;
+	/* the alg_fastmath_kernel_t of the CPU this instance runs on */
+	const alg_fastmath_kernel_t* fm;
 } layer_cpu_float_softmax_context_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
-static void softmax_ref(const float * vec_in, const size_t dim_vec, float * p_out)
+static void softmax_ref(const alg_fastmath_kernel_t* fm, const float * vec_in, const size_t dim_vec, float * p_out)
 {
 	float     sum;
 	float     base;
@@ -33,16 +35,26 @@ static void softmax_ref(const float * vec_in, const size_t dim_vec, float * p_ou
 		}
 	}
 
+	/* exp only once, in place in the output */
+	for (i = 0; i < dim_vec; i++)
+	{
+		p_out[i] = vec_in[i] - base;
+	}
+
+	fm->vexpf(p_out, p_out, dim_vec);
+
 	sum = 0;
 
 	for (i = 0; i < dim_vec; i++)
 	{
-		sum += exp(vec_in[i] - base);
+		sum += p_out[i];
 	}
 
+	sum = 1.0f/sum;
+
 	for (i = 0; i < dim_vec; i++)
 	{
-		p_out[i] = exp(vec_in[i] - base)/sum;
+		p_out[i] = p_out[i]*sum;
 	}
 }
 /* ============================ [ FUNCTIONS ] ====================================================== */
@@ -57,7 +69,7 @@ int layer_cpu_float_SOFTMAX_init(const nn_t* nn, const layer_t* layer)
 		r = rte_cpu_create_layer_context(nn, layer, sizeof(layer_cpu_float_softmax_context_t), 1);
 		if(0 == r)
 		{
-			context = (layer_cpu_float_softmax_context_t*)layer->C->context;
+			context = (layer_cpu_float_softmax_context_t*)LAYER_CONTEXT(nn, layer);
 			context->p_out = out;
 		}
 	}
@@ -66,15 +78,21 @@ int layer_cpu_float_SOFTMAX_init(const nn_t* nn, const layer_t* layer)
 		r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_softmax_context_t), sizeof(float));
 	}
 
+	if(0 == r)
+	{
+		context = (layer_cpu_float_softmax_context_t*)LAYER_CONTEXT(nn, layer);
+		context->fm = (const alg_fastmath_kernel_t*)rte_cpu_select_kernel(nn, alg_fastmath_kernels);
+	}
+
 	return r;
 }
 
 int layer_cpu_float_SOFTMAX_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_softmax_context_t* context = (layer_cpu_float_softmax_context_t*)layer->C->context;
+	layer_cpu_float_softmax_context_t* context = (layer_cpu_float_softmax_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	float *IN = (float*)input_context->out[0];
 	float *O;
 	size_t n_block = input_context->nhwc.N*input_context->nhwc.H*input_context->nhwc.W;
@@ -82,17 +100,17 @@ int layer_cpu_float_SOFTMAX_execute(const nn_t* nn, const layer_t* layer)
 	size_t i;
 
 	if(context->p_out != NULL) {
-		context->out[0] = context->p_out;
+		context->out[0] = nn_get_output_data(nn, layer);
 	}
 
-  rte_cpu_dynamic_shape_copy(layer, input_context);
-  r = rte_cpu_dynamic_memory(&context->out[0], NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
+  rte_cpu_dynamic_shape_copy(nn, layer, input_context);
+  r = rte_cpu_dynamic_memory(nn, layer, 0, NHWC_SIZE(context->nhwc), &context->allocated, sizeof(float));
   if(0 == r) {
 	O = (float*)context->out[0];
 
 	for(i=0; i<n_block; i++)
 	{
-		softmax_ref(IN+stride*i,
+		softmax_ref(context->fm, IN+stride*i,
 					stride,
 					O+stride*i);
 	}
@@ -102,7 +120,7 @@ int layer_cpu_float_SOFTMAX_execute(const nn_t* nn, const layer_t* layer)
 
 void layer_cpu_float_SOFTMAX_deinit(const nn_t* nn, const layer_t* layer)
 {
-	rte_cpu_dynamic_free(layer);
+	rte_cpu_dynamic_free(nn, layer);
 	rte_cpu_destory_layer_context(nn, layer);
 }
 
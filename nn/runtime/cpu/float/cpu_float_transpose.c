@@ -18,21 +18,47 @@ typedef struct {
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_float_TRANSPOSE_init(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_transpose_context_t), sizeof(float));
+	int r;
+	layer_cpu_context_t* input_context;
 
+	if(rte_is_transpose_skipped(nn, layer))
+	{	/* as a RESHAPE, the layers after it take the order it is in */
+		NNLOG(NN_DEBUG, ("%s: skipped\n", layer->name));
+		r = rte_cpu_create_layer_context(nn, layer, sizeof(layer_cpu_float_transpose_context_t), 1);
+		if(0 == r)
+		{
+			input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer->inputs[0]);
+			if(NULL != input_context->out[0])
+			{
+				rte_cpu_alias_buffer(nn, input_context->out[0], layer, 0);
+			}
+		}
+	}
+	else
+	{
+		r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_float_transpose_context_t), sizeof(float));
+	}
+
+	return r;
 }
 
 int layer_cpu_float_TRANSPOSE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_transpose_context_t* context = (layer_cpu_float_transpose_context_t*)layer->C->context;
+	layer_cpu_float_transpose_context_t* context = (layer_cpu_float_transpose_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	float *IN = (float*)input_context->out[0];
 	float *O = (float*)context->out[0];
 
 	int perm = (int)RTE_FETCH_INT32(layer->blobs[0]->blob, 0);
 
+	if(rte_is_transpose_skipped(nn, layer))
+	{
+		context->out[0] = IN;
+		return r;
+	}
+
 	NNLOG(NN_DEBUG, (" perm=0x%X\n", (uint32_t)perm));
 
 	r = alg_transpose(O, IN, &input_context->nhwc, sizeof(float), (alg_transpose_t)perm);
@@ -24,14 +24,14 @@ int layer_cpu_float_UPSAMPLE_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_UPSAMPLE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_upsample_context_t* context = (layer_cpu_float_upsample_context_t*)layer->C->context;
+	layer_cpu_float_upsample_context_t* context = (layer_cpu_float_upsample_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	uint8_t* pmask = NULL;
 
 	if(NULL != layer->inputs[1])
 	{
-		pmask = (uint8_t*) layer->inputs[1]->C->context->out[1];
+		pmask = (uint8_t*) LAYER_CONTEXT(nn, layer->inputs[1])->out[1];
 	}
 
 	NNLOG(NN_DEBUG, (" %s:", pmask?" with mask":""));
@@ -24,7 +24,7 @@ int layer_cpu_float_YOLOOUTPUT_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_float_YOLOOUTPUT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_float_yolooutput_context_t* context = (layer_cpu_float_yolooutput_context_t*)layer->C->context;
+	layer_cpu_float_yolooutput_context_t* context = (layer_cpu_float_yolooutput_context_t*)LAYER_CONTEXT(nn, layer);
 
 	r = yolo_output_forward(nn, layer);
 
@@ -45,12 +45,12 @@ static int layer_cpu_q16_activation_init(const nn_t* nn, const layer_t* layer)
 	if(0 == r)
 	{
 		input = layer->inputs[0];
-		input_context = (layer_cpu_q16_context_t*)input->C->context;
+		input_context = (layer_cpu_q16_context_t*)LAYER_CONTEXT(nn, input);
 
 		if(NULL != input_context->out[0])
 		{
 			/* reuse its input layer's output buffer */
-			rte_cpu_take_buffer(input_context->out[0], layer, 0);
+			rte_cpu_take_buffer(nn, input_context->out[0], layer, 0);
 		}
 	}
 
@@ -60,13 +60,13 @@ static int layer_cpu_q16_activation_init(const nn_t* nn, const layer_t* layer)
 static int layer_cpu_q16_activation_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q16_actvation_context_t* context = (layer_cpu_q16_actvation_context_t*)layer->C->context;
+	layer_cpu_q16_actvation_context_t* context = (layer_cpu_q16_actvation_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cpu_q16_context_t* input_context;
 	size_t sz = NHWC_SIZE(context->nhwc);
 	int16_t* IN;
 
-	input_context = (layer_cpu_q16_context_t*)input->C->context;
+	input_context = (layer_cpu_q16_context_t*)LAYER_CONTEXT(nn, input);
 
 	IN = (int16_t*)input_context->out[0];
 
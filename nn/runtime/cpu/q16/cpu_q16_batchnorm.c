@@ -23,9 +23,9 @@ int layer_cpu_q16_BATCHNORM_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q16_BATCHNORM_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	int16_t* scale = (int16_t*)layer->blobs[1]->blob;
 	int16_t* bias = (int16_t*)layer->blobs[2]->blob;
 	int16_t *IN = (int16_t*)input_context->out[0];
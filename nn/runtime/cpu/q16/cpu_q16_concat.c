@@ -44,7 +44,7 @@ int layer_cpu_q16_CONCAT_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q16_CONCAT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q16_concat_context_t* context = (layer_cpu_q16_concat_context_t*)layer->C->context;
+	layer_cpu_q16_concat_context_t* context = (layer_cpu_q16_concat_context_t*)LAYER_CONTEXT(nn, layer);
 	int axis = RTE_FETCH_INT32(layer->blobs[1]->blob, 0);
 
 	r = alg_concat(nn, layer, axis, context->out[0], rte_cpu_fetch_out0, sizeof(int16_t));
@@ -76,9 +76,9 @@ int layer_cpu_q16_DWCONV2D_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q16_DWCONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q16_dwconv2d_context_t* context = (layer_cpu_q16_dwconv2d_context_t*)layer->C->context;
+	layer_cpu_q16_dwconv2d_context_t* context = (layer_cpu_q16_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_q16_context_t* input_context = (layer_cpu_q16_context_t*)input->C->context;
+	layer_cpu_q16_context_t* input_context = (layer_cpu_q16_context_t*)LAYER_CONTEXT(nn, input);
 	int16_t *IN = (int16_t*)input_context->out[0];
 	int16_t *O = (int16_t*)context->out[0];
 	int16_t *weights = (int16_t*)layer->blobs[1]->blob;
@@ -54,10 +54,10 @@ static int layer_cpu_q16_eltwise_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cpu_q16_eltwise_context_t*)layer->C->context;
+		context = (layer_cpu_q16_eltwise_context_t*)LAYER_CONTEXT(nn, layer);
 		context->broadcast = ALG_BROADCAST_NONE;
-		context->inputA_context = (layer_context_t*)layer->inputs[0]->C->context;
-		context->inputB_context = (layer_context_t*)layer->inputs[1]->C->context;
+		context->inputA_context = (layer_context_t*)LAYER_CONTEXT(nn, layer->inputs[0]);
+		context->inputB_context = (layer_context_t*)LAYER_CONTEXT(nn, layer->inputs[1]);
 		r = alg_broadcast_prepare(&(context->inputA_context), &(context->inputB_context), &(context->broadcast));
 	}
 
@@ -67,7 +67,7 @@ static int layer_cpu_q16_eltwise_init(const nn_t* nn, const layer_t* layer)
 static int layer_cpu_q16_eltwise_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q16_eltwise_context_t* context = (layer_cpu_q16_eltwise_context_t*)layer->C->context;
+	layer_cpu_q16_eltwise_context_t* context = (layer_cpu_q16_eltwise_context_t*)LAYER_CONTEXT(nn, layer);
 	size_t sz = NHWC_SIZE(context->nhwc);
 	int16_t* A;
 	int16_t* B;
@@ -24,15 +24,19 @@ int layer_cpu_q16_OUTPUT_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q16_OUTPUT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q16_output_context_t* context = (layer_cpu_q16_output_context_t*)layer->C->context;
+	layer_cpu_q16_output_context_t* context = (layer_cpu_q16_output_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cpu_context_t* input_context;
 	int16_t* data;
 
-	input_context = (layer_cpu_context_t*)input->C->context;
+	input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 
 	data = (int16_t*) nn_get_output_data(nn, layer);
-	if(NULL != data)
+	if(data == input_context->out[0])
+	{
+		/* the input layer has written it in place */
+	}
+	else if(NULL != data)
 	{
 		memcpy(data, input_context->out[0], NHWC_SIZE(context->nhwc)*sizeof(int16_t));
 	}
@@ -6,10 +6,14 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_Q8
 #include "../runtime_cpu.h"
-
+#include "thread_pool.h"
 #include "arm_math.h"
 #include "arm_nnfunctions.h"
 /* ============================ [ MACROS    ] ====================================================== */
+/* without the DSP extension the 1x1 kernels of CMSIS are plain loops, do it as a GEMM here */
+#if !defined(ARM_MATH_DSP) && !defined(DISABLE_NN_GEMM)
+#define CONV2D_USE_POINTWISE
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CPU_Q8_CONTEXT_MEMBER;
@@ -17,6 +21,19 @@ typedef struct {
 	rte_cpu_buffer_t* bufferA;
 #endif
 } layer_cpu_q8_conv2d_context_t;
+
+#ifdef CONV2D_USE_POINTWISE
+typedef struct {
+	const int8_t* IN;
+	int8_t* O;
+	const int8_t* weights;
+	const int8_t* bias;
+	int Cin;
+	int Cout;
+	int bias_shift;
+	int out_shift;
+} conv2d_pointwise_task_t;
+#endif
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
@@ -185,6 +202,60 @@ static int convolve(const int8_t * Im_in,  /* input image */
 
 	return r;
 }
+#ifdef CONV2D_USE_POINTWISE
+/* same arithmetic as arm_convolve_1x1_HWC_q7_fast_nonsquare, but 4 output channels
+ * share each input load and any channel number is accepted */
+static void conv2d_pointwise_task(void* param, size_t start, size_t end)
+{
+	const conv2d_pointwise_task_t* t = (const conv2d_pointwise_task_t*)param;
+	const int8_t* in;
+	const int8_t* w0;
+	const int8_t* w1;
+	const int8_t* w2;
+	const int8_t* w3;
+	int8_t* out;
+	q31_t sum0, sum1, sum2, sum3;
+	int co, ci;
+
+	for(; start < end; start++)
+	{
+		in = t->IN + start*t->Cin;
+		out = t->O + start*t->Cout;
+		for(co=0; co+4<=t->Cout; co+=4)
+		{
+			w0 = t->weights + co*t->Cin;
+			w1 = w0 + t->Cin;
+			w2 = w1 + t->Cin;
+			w3 = w2 + t->Cin;
+			sum0 = ((q31_t)t->bias[co] << t->bias_shift) + NN_ROUND(t->out_shift);
+			sum1 = ((q31_t)t->bias[co+1] << t->bias_shift) + NN_ROUND(t->out_shift);
+			sum2 = ((q31_t)t->bias[co+2] << t->bias_shift) + NN_ROUND(t->out_shift);
+			sum3 = ((q31_t)t->bias[co+3] << t->bias_shift) + NN_ROUND(t->out_shift);
+			for(ci=0; ci<t->Cin; ci++)
+			{
+				sum0 += in[ci]*w0[ci];
+				sum1 += in[ci]*w1[ci];
+				sum2 += in[ci]*w2[ci];
+				sum3 += in[ci]*w3[ci];
+			}
+			out[co] = (q7_t)__SSAT((sum0 >> t->out_shift), 8);
+			out[co+1] = (q7_t)__SSAT((sum1 >> t->out_shift), 8);
+			out[co+2] = (q7_t)__SSAT((sum2 >> t->out_shift), 8);
+			out[co+3] = (q7_t)__SSAT((sum3 >> t->out_shift), 8);
+		}
+		for(; co<t->Cout; co++)
+		{
+			w0 = t->weights + co*t->Cin;
+			sum0 = ((q31_t)t->bias[co] << t->bias_shift) + NN_ROUND(t->out_shift);
+			for(ci=0; ci<t->Cin; ci++)
+			{
+				sum0 += in[ci]*w0[ci];
+			}
+			out[co] = (q7_t)__SSAT((sum0 >> t->out_shift), 8);
+		}
+	}
+}
+#endif
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_q8_CONV2D_init(const nn_t* nn, const layer_t* layer)
 {
@@ -199,7 +270,7 @@ int layer_cpu_q8_CONV2D_init(const nn_t* nn, const layer_t* layer)
 #if defined (ARM_MATH_DSP)
 	if(0 == r)
 	{
-		context = (layer_cpu_q8_conv2d_context_t*)layer->C->context;
+		context = (layer_cpu_q8_conv2d_context_t*)LAYER_CONTEXT(nn, layer);
 
 		ints = (int*)layer->blobs[1]->dims;	/* W in format FHWC */
 
@@ -222,9 +293,9 @@ int layer_cpu_q8_CONV2D_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q8_CONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q8_conv2d_context_t* context = (layer_cpu_q8_conv2d_context_t*)layer->C->context;
+	layer_cpu_q8_conv2d_context_t* context = (layer_cpu_q8_conv2d_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)input->C->context;
+	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)LAYER_CONTEXT(nn, input);
 	int8_t *IN = (int8_t*)input_context->out[0];
 	int8_t *O = (int8_t*)context->out[0];
 	int8_t *weights = (int8_t*)layer->blobs[1]->blob;
@@ -232,6 +303,9 @@ int layer_cpu_q8_CONV2D_execute(const nn_t* nn, const layer_t* layer)
 	int knlX, knlY, padX, padY, strideX, strideY;
 	int8_t wQ, bQ;
 	int* ints;
+#ifdef CONV2D_USE_POINTWISE
+	conv2d_pointwise_task_t task;
+#endif
 
 	size_t batch;
 	size_t batch_sizeIn = NHWC_BATCH_SIZE(input_context->nhwc);
@@ -254,6 +328,23 @@ int layer_cpu_q8_CONV2D_execute(const nn_t* nn, const layer_t* layer)
 			knlY, knlX, padY, padX, strideY, strideX,
 			LAYER_Q(input), wQ, bQ, LAYER_Q(layer)));
 
+#ifdef CONV2D_USE_POINTWISE
+	if((1 == knlX) && (1 == knlY) && (1 == strideX) && (1 == strideY) && (0 == padX) && (0 == padY))
+	{
+		task.IN = IN;
+		task.O = O;
+		task.weights = weights;
+		task.bias = bias;
+		task.Cin = input_context->nhwc.C;
+		task.Cout = context->nhwc.C;
+		task.bias_shift = wQ+LAYER_Q(input)-bQ;
+		task.out_shift = wQ+LAYER_Q(input)-LAYER_Q(layer);
+		thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H*context->nhwc.W,
+				conv2d_pointwise_task, &task);
+		return r;
+	}
+#endif
+
 	for(batch=0; (batch<input_context->nhwc.N) && (0 == r); batch++)
 	{
 		r = convolve(IN+batch_sizeIn*batch,
@@ -116,11 +116,11 @@ int layer_cpu_q8_LSTM_init(const nn_t* nn, const layer_t* layer)
 	int r = rte_cpu_create_layer_common(nn, layer, sizeof(layer_cpu_q8_lstm_context_t), sizeof(int8_t));
 
 	if(0 == r) {
-		context = (layer_cpu_q8_lstm_context_t*)layer->C->context;
+		context = (layer_cpu_q8_lstm_context_t*)LAYER_CONTEXT(nn, layer);
 		num_directions = layer->blobs[1]->dims[0];
 		hidden_size = layer->blobs[1]->dims[1]/4;
 		output_size = context->nhwc.C;
-		input_size = layer->inputs[0]->C->context->nhwc.C;
+		input_size = LAYER_CONTEXT(nn, layer->inputs[0])->nhwc.C;
 		context->c = malloc(num_directions*sizeof(int8_t)*(hidden_size+output_size));
 		context->h = context->c + num_directions*hidden_size;
 		nn_request_scratch(nn, sizeof(int8_t)*(4*hidden_size + (input_size+output_size)));
@@ -154,9 +154,9 @@ int layer_cpu_q8_LSTM_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
 	int batch_size, input_size, hidden_size, output_size, i;
-	layer_cpu_q8_lstm_context_t* context = (layer_cpu_q8_lstm_context_t*)layer->C->context;
+	layer_cpu_q8_lstm_context_t* context = (layer_cpu_q8_lstm_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)input->C->context;
+	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)LAYER_CONTEXT(nn, input);
 	int8_t *IN = (int8_t*)input_context->out[0];
 	int8_t *O = (int8_t*)context->out[0];
 	const int8_t *W = (const int8_t*)layer->blobs[1]->blob;
@@ -237,7 +237,7 @@ int layer_cpu_q8_LSTM_execute(const nn_t* nn, const layer_t* layer)
 
 void layer_cpu_q8_LSTM_deinit(const nn_t* nn, const layer_t* layer)
 {
-	layer_cpu_q8_lstm_context_t* context = (layer_cpu_q8_lstm_context_t*)layer->C->context;
+	layer_cpu_q8_lstm_context_t* context = (layer_cpu_q8_lstm_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context) {
 		if(NULL != context->c) free(context->c);
@@ -67,9 +67,9 @@ int layer_cpu_q8_PAD_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q8_PAD_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q8_pad_context_t* context = (layer_cpu_q8_pad_context_t*)layer->C->context;
+	layer_cpu_q8_pad_context_t* context = (layer_cpu_q8_pad_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)input->C->context;
+	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)LAYER_CONTEXT(nn, input);
 
 	int8_t* IN = (int8_t*)input_context->out[0];
 	int8_t *O = (int8_t*)context->out[0];
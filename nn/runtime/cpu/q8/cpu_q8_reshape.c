@@ -26,12 +26,12 @@ int layer_cpu_q8_RESHAPE_init(const nn_t* nn, const layer_t* layer)
 	if(0 == r)
 	{
 		input = layer->inputs[0];
-		input_context = (layer_cpu_q8_context_t*)input->C->context;
+		input_context = (layer_cpu_q8_context_t*)LAYER_CONTEXT(nn, input);
 
 		if(NULL != input_context->out[0])
 		{
 			/* reuse its input layer's output buffer */
-			rte_cpu_take_buffer(input_context->out[0], layer, 0);
+			rte_cpu_alias_buffer(nn, input_context->out[0], layer, 0);
 		}
 	}
 
@@ -41,9 +41,9 @@ int layer_cpu_q8_RESHAPE_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q8_RESHAPE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q8_reshape_context_t* context = (layer_cpu_q8_reshape_context_t*)layer->C->context;
+	layer_cpu_q8_reshape_context_t* context = (layer_cpu_q8_reshape_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)input->C->context;
+	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)LAYER_CONTEXT(nn, input);
 
 	int8_t* IN = (int8_t*)input_context->out[0];
 
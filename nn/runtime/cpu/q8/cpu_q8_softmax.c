@@ -36,7 +36,7 @@ int layer_cpu_q8_SOFTMAX_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cpu_q8_softmax_context_t*)layer->C->context;
+		context = (layer_cpu_q8_softmax_context_t*)LAYER_CONTEXT(nn, layer);
 		context->p_out = out;
 	}
 
@@ -46,19 +46,19 @@ int layer_cpu_q8_SOFTMAX_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q8_SOFTMAX_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q8_softmax_context_t* context = (layer_cpu_q8_softmax_context_t*)layer->C->context;
+	layer_cpu_q8_softmax_context_t* context = (layer_cpu_q8_softmax_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)input->C->context;
+	layer_cpu_q8_context_t* input_context = (layer_cpu_q8_context_t*)LAYER_CONTEXT(nn, input);
 	int8_t *IN = (int8_t*)input_context->out[0];
 	int8_t *O = (int8_t*)context->out[0];
 	size_t n_block = context->nhwc.N*context->nhwc.H*context->nhwc.W;
 	size_t stride = context->nhwc.C;
 	size_t i;
 
-	if(NULL == O)
+	if(NULL != context->p_out)
 	{
-		O = (int8_t*)context->p_out;
-		context->out[0] = context->p_out;
+		O = (int8_t*)nn_get_output_data(nn, layer);
+		context->out[0] = O;
 	}
 
 	for(i=0; i<n_block; i++)
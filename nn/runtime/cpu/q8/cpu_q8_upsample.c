@@ -24,9 +24,9 @@ int layer_cpu_q8_UPSAMPLE_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_q8_UPSAMPLE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_q8_upsample_context_t* context = (layer_cpu_q8_upsample_context_t*)layer->C->context;
+	layer_cpu_q8_upsample_context_t* context = (layer_cpu_q8_upsample_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_context_t* input_context = (layer_cpu_context_t*)input->C->context;
+	layer_cpu_context_t* input_context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, input);
 	uint8_t* pmask = NULL;
 
 	if(2 == input_context->nout)
@@ -6,6 +6,8 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU
 #include "runtime_cpu.h"
+#include "thread_pool.h"
+#include "profile.h"
 #ifndef DISABLE_RTE_FALLBACK
 #include "quantize.h"
 #ifndef DISABLE_RUNTIME_OPENCL
@@ -13,10 +15,117 @@
 #endif
 #endif
 /* ============================ [ MACROS    ] ====================================================== */
+#ifndef RTE_CPU_BUFFER_ALIGN
+#define RTE_CPU_BUFFER_ALIGN 16
+#endif
+#define RTE_CPU_ALIGN(sz) (((sz)+RTE_CPU_BUFFER_ALIGN-1)&(~(size_t)(RTE_CPU_BUFFER_ALIGN-1)))
+
+#ifndef DISABLE_NN_THREAD
+#define CPU_SCHED_DEPS(rt, id) (&(rt)->sched.deps[(id)*(rt)->sched.stride])
+#endif
+
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+/* number of input shapes whose plan is kept, the least recently used one goes first */
+#ifndef NN_DYNAMIC_PLAN_NUMBER
+#define NN_DYNAMIC_PLAN_NUMBER 4
+#endif
+/* the pooled memory of the plans at least doubles when it grows, as long as that
+ * stays below this many bytes */
+#ifndef NN_DYNAMIC_ARENA_CAP
+#define NN_DYNAMIC_ARENA_CAP (16*1024*1024)
+#endif
+#define CPU_PLAN_FREE		0
+#define CPU_PLAN_RECORDING	1
+#define CPU_PLAN_READY		2
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
+#ifndef DISABLE_NN_THREAD
+typedef struct
+{
+	/* bit j of row i set means layer i must wait for layer j, only alive during init */
+	uint8_t* deps;
+	size_t stride;
+	/* the planned buffers layer i writes are writes[write_start[i]] to
+	 * writes[write_start[i+1]-1], kept until the graph is built */
+	rte_cpu_buffer_t** writes;
+	int* write_start;
+	int last_scratch_user;
+	/* FALSE when the layers form a plain chain, then there is nothing to run in parallel */
+	int parallel;
+	thread_pool_graph_t graph;
+	thread_pool_t* pool;
+} rte_cpu_sched_t;
+#endif
+
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+/* what a layer of the dynamic part works out at one input shape */
+typedef struct
+{
+	NHWC_t nhwc;
+	int padY;
+	int padX;
+	/* of the outputs in the pooled memory, until the plan is ready they are in temp */
+	size_t offset[2];
+	size_t size[2];
+	void* temp[2];
+} rte_cpu_plan_layer_t;
+
+typedef struct
+{
+	/* the shape the root layer has got from the input data */
+	NHWC_t key;
+	int state;
+	uint32_t used;
+	/* indexed by the layer position in network->layers */
+	rte_cpu_plan_layer_t* layers;
+	/* what the plan takes of the pooled memory */
+	size_t size;
+} rte_cpu_plan_t;
+#endif
+
+/* an OUTPUT layer whose input layer writes straight into the output buffer */
+typedef struct
+{
+	const layer_t* output;
+	layer_context_t* producer;
+	/* where the producer writes when there is no output buffer */
+	void* planned;
+} rte_cpu_direct_output_t;
+
 typedef struct
 {
 	STAILQ_HEAD(rte_cpu_buffer_head,rte_cpu_buffer) buffers;
+	/* all the buffers live in this one block at the offset given by the planner */
+	void* arena;
+	size_t arena_size;
+	rte_cpu_direct_output_t* directs;
+	int ndirect;
+	/* the highest instruction set the kernels may use */
+	alg_isa_t isa;
+#ifndef DISABLE_NN_THREAD
+	rte_cpu_sched_t sched;
+#endif
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+	/* the only layer with a dynamic shape whose inputs are all static (MFCC), all the
+	 * dynamic shapes follow from its one, -1 if there is none or more than one */
+	int root;
+	rte_cpu_plan_t plans[NN_DYNAMIC_PLAN_NUMBER];
+	/* the plan of the current run, NULL until the root has run */
+	rte_cpu_plan_t* plan;
+	uint32_t stamp;
+	/* all the plans use this one block, it only grows */
+	void* dynamic_arena;
+	size_t dynamic_size;
+	size_t dynamic_used;
+#endif
+#ifndef DISABLE_DYNAMIC_SHAPE
+	/* heap allocations for the dynamic shapes in the current run, per layer so that the
+	 * branches running in parallel don't share a counter, the first one is the runtime's */
+	size_t* allocations;
+	size_t last_allocations;
+	size_t total_allocations;
+	size_t predicts;
+#endif
 } rte_cpu_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 #ifndef DISABLE_RUNTIME_CPU_Q8
@@ -43,6 +152,11 @@ typedef struct
 #ifndef DISABLE_NN_DDO
 extern void rte_ddo_save(const nn_t* nn, const layer_t* layer);
 #endif
+static int cpu_execute_layer(const nn_t* nn, const layer_t* layer);
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+static int cpu_compare_buffer(const void* a, const void* b);
+static size_t cpu_find_best_fit(rte_cpu_buffer_t** placed, int num, rte_cpu_buffer_t* b);
+#endif
 /* ============================ [ DATAS     ] ====================================================== */
 static const layer_ops_t cpu_lops[][L_OP_NUMBER] =
 {
@@ -75,6 +189,9 @@ static const layer_ops_t cpu_lops[][L_OP_NUMBER] =
 	},
 #endif
 };
+
+/* set by nn_set_cpu_isa, ALG_ISA_NUMBER lets the CPU or LWNN_CPU_ISA decide */
+static alg_isa_t cpu_isa_forced = ALG_ISA_NUMBER;
 /* ============================ [ LOCALS    ] ====================================================== */
 #ifndef DISABLE_NN_LOG
 static int cpu_get_buffer_id(const nn_t* nn, rte_cpu_buffer_t* buffer)
@@ -98,159 +215,1683 @@ static int cpu_get_buffer_id(const nn_t* nn, rte_cpu_buffer_t* buffer)
 }
 #endif
 
-static int cpu_init_layer(const nn_t* nn, const layer_t* layer)
+#ifndef DISABLE_NN_THREAD
+/* the creator of a buffer and the layers that have it as output write it */
+static int cpu_is_buffer_writer(const nn_t* nn, int id, rte_cpu_buffer_t* buffer)
 {
-	int r = NN_E_INVALID_LAYER;
 	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	int r = (buffer->start == id);
+	int i;
 
-	if(nn->network->type < ARRAY_SIZE(cpu_lops))
+	for(i=rt->sched.write_start[id]; (i<rt->sched.write_start[id+1]) && (FALSE == r); i++)
 	{
-		if(layer->op < ARRAY_SIZE(cpu_lops[nn->network->type]))
+		r = (rt->sched.writes[i] == buffer);
+	}
+
+	return r;
+}
+
+static void cpu_sched_add_dep(rte_cpu_t* rt, int id, int dep)
+{
+	if((NULL != rt->sched.deps) && (id != dep))
+	{
+		CPU_SCHED_DEPS(rt, id)[dep>>3] |= 1<<(dep&7);
+	}
+}
+
+static int cpu_sched_is_dep(rte_cpu_t* rt, int id, int dep)
+{
+	return (CPU_SCHED_DEPS(rt, id)[dep>>3] >> (dep&7)) & 1;
+}
+
+/* layer id overwrites what writer has produced, so it has to wait until the
+ * writer and all the readers of that content are done. The readers all run
+ * after the writer and no later than its last use. */
+static void cpu_sched_after_readers(const nn_t* nn, int id, const layer_t* writer)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	const layer_t** inputs;
+	const layer_t* reader;
+	int wid = nn_get_layer_id(nn, writer);
+	int rid;
+	int n = 0;
+
+	cpu_sched_add_dep(rt, id, wid);
+	for(rid=wid+1; (rid<=nn->last_use[wid]) && (n<nn->readers[wid]); rid++)
+	{
+		for(inputs=nn->network->layers[rid]->inputs; (NULL != inputs) && (NULL != (*inputs)); inputs++)
 		{
-			NNLOG(NN_DEBUG, ("init %s\n", layer->name));
-			r = cpu_lops[nn->network->type][layer->op].init(nn, layer);
+			if(*inputs == writer)
+			{
+				n ++;
+				cpu_sched_add_dep(rt, id, rid);
+				reader = rte_get_pad_reader(nn, nn->network->layers[rid]);
+				if(NULL != reader)
+				{	/* the layer a PAD is fused into reads the content instead */
+					cpu_sched_add_dep(rt, id, nn_get_layer_id(nn, reader));
+				}
+			}
+		}
+	}
+}
+
+/* the layers in the lifetime of the buffer that write it, returns their number */
+static int cpu_sched_get_writers(const nn_t* nn, rte_cpu_buffer_t* buffer, int* writers)
+{
+	int n = 0;
+	int i;
+
+	for(i=buffer->start; i<=buffer->end; i++)
+	{
+		if(cpu_is_buffer_writer(nn, i, buffer))
+		{
+			writers[n++] = i;
+		}
+	}
+
+	return n;
+}
+
+/* the planner may put two buffers with disjoint lifetimes at the same place, the
+ * writers of the later one must then wait for all the users of the former one */
+static void cpu_sched_share_memory(const nn_t* nn, rte_cpu_buffer_t* former,
+		const int* writers, int nwriter, int* scratch)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	int nformer = cpu_sched_get_writers(nn, former, scratch);
+	int i, j;
+
+	for(i=0; i<nwriter; i++)
+	{
+		for(j=0; j<nformer; j++)
+		{
+			if(NULL == former->owner)
+			{	/* released scratch, nobody else reads it */
+				cpu_sched_add_dep(rt, writers[i], scratch[j]);
+			}
+			else
+			{
+				cpu_sched_after_readers(nn, writers[i], nn->network->layers[scratch[j]]);
+			}
 		}
 	}
+}
+
+static int cpu_compare_buffer_end(const void* a, const void* b)
+{
+	const rte_cpu_buffer_t* ba = *(const rte_cpu_buffer_t* const*)a;
+	const rte_cpu_buffer_t* bb = *(const rte_cpu_buffer_t* const*)b;
+
+	/* the last used ones first */
+	return bb->end - ba->end;
+}
+
+/* a former buffer needs no edges of its own when a later one at the same place that
+ * comes after it covers what it shares with the buffer: the writers of that one
+ * already wait for its users. So a slot reused again and again gives one edge per reuse */
+static int cpu_sched_is_covered(rte_cpu_buffer_t** kept, int nkept, rte_cpu_buffer_t* former,
+		rte_cpu_buffer_t* b)
+{
+	size_t start = NN_MAX(former->offset, b->offset);
+	size_t end = NN_MIN(former->offset+former->sz, b->offset+b->sz);
+	int r = FALSE;
+	int i;
+
+	for(i=0; (i<nkept) && (FALSE == r); i++)
+	{
+		r = (kept[i]->start > former->end) && (kept[i]->offset <= start) &&
+			((kept[i]->offset + kept[i]->sz) >= end);
+	}
+
+	return r;
+}
+
+/* the ordering the memory plan adds to the schedule, only needed once the branches run
+ * in parallel */
+static int cpu_sched_plan_memory(const nn_t* nn)
+{
+	int r = 0;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	rte_cpu_buffer_t** placed;
+	rte_cpu_buffer_t** kept;
+	rte_cpu_buffer_t* b;
+	int* writers;
+	int* scratch;
+	int num = 0;
+	int nkept, nwriter;
+	int i, j;
+
+	STAILQ_FOREACH(b, &(rt->buffers), entry)
+	{
+		num += (NULL == b->parent);
+	}
+
+	placed = malloc(2*num*sizeof(rte_cpu_buffer_t*) + 2*nn->layer_number*sizeof(int));
+	if(NULL == placed)
+	{
+		r = NN_E_NO_MEMORY;
+	}
 	else
 	{
-		r = NN_E_INVALID_RUNTIME;
+		kept = placed + num;
+		writers = (int*)(kept + num);
+		scratch = writers + nn->layer_number;
+		i = 0;
+		STAILQ_FOREACH(b, &(rt->buffers), entry)
+		{
+			if(NULL == b->parent)
+			{
+				placed[i++] = b;
+			}
+		}
+
+		qsort(placed, num, sizeof(rte_cpu_buffer_t*), cpu_compare_buffer_end);
+
+		for(i=0; i<num; i++)
+		{
+			b = placed[i];
+			nwriter = -1;
+			nkept = 0;
+			for(j=i+1; j<num; j++)
+			{
+				if((placed[j]->end < b->start) &&
+					(placed[j]->offset < (b->offset + b->sz)) &&
+					(b->offset < (placed[j]->offset + placed[j]->sz)) &&
+					(FALSE == cpu_sched_is_covered(kept, nkept, placed[j], b)))
+				{
+					if(nwriter < 0)
+					{
+						nwriter = cpu_sched_get_writers(nn, b, writers);
+					}
+					cpu_sched_share_memory(nn, placed[j], writers, nwriter, scratch);
+					kept[nkept++] = placed[j];
+				}
+			}
+		}
+
+		free(placed);
 	}
 
 	return r;
 }
 
-static int cpu_execute_layer(const nn_t* nn, const layer_t* layer)
+#ifndef DISABLE_RTE_FALLBACK
+/* layer id points the out[0] of input at its dequantized copy while it runs, so no
+ * other reader of input may run at the same time, the order of the network is kept */
+static void cpu_sched_exclude_readers(const nn_t* nn, int id, const layer_t* input)
 {
-	int r = NN_E_INVALID_LAYER;
 	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	const layer_t* const* layers;
+	const layer_t** inputs;
+	const layer_t* reader;
+	int rid;
 
-	if(nn->network->type < ARRAY_SIZE(cpu_lops))
+	for(layers=nn->network->layers; NULL != (*layers); layers++)
 	{
-		if(layer->op < ARRAY_SIZE(cpu_lops[nn->network->type]))
+		for(inputs=(*layers)->inputs; (NULL != inputs) && (NULL != (*inputs)); inputs++)
 		{
-			NNLOG(NN_DEBUG, ("execute %s: [%dx%dx%dx%d]\n", layer->name, L_SHAPES(layer)));
-			r = cpu_lops[nn->network->type][layer->op].execute(nn, layer);
-#ifndef DISABLE_NN_DDO
-			NNDDO(NN_DEBUG, rte_ddo_save(nn, layer));
+			if(*inputs != input)
+			{
+				continue;
+			}
+			reader = rte_get_pad_reader(nn, *layers);
+			if(NULL == reader)
+			{
+				reader = *layers;
+			}
+			rid = nn_get_layer_id(nn, reader);
+			if(rid < id)
+			{
+				cpu_sched_add_dep(rt, id, rid);
+			}
+			else
+			{
+				cpu_sched_add_dep(rt, rid, id);
+			}
+			break;
+		}
+	}
+}
 #endif
+
+static int cpu_sched_create(const nn_t* nn)
+{
+	int r = 0;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+
+	memset(&rt->sched, 0, sizeof(rt->sched));
+	rt->sched.last_scratch_user = -1;
+
+	if(nn->layer_number > 1)
+	{
+		rt->sched.stride = (nn->layer_number+7)/8;
+		rt->sched.deps = malloc(rt->sched.stride*nn->layer_number);
+		if(NULL == rt->sched.deps)
+		{
+			r = NN_E_NO_MEMORY;
+		}
+		else
+		{
+			memset(rt->sched.deps, 0, rt->sched.stride*nn->layer_number);
 		}
 	}
+
+	return r;
+}
+
+static int cpu_sched_record_writes(const nn_t* nn)
+{
+	int r = 0;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	layer_context_t* context;
+	rte_cpu_buffer_t* b;
+	int n = (int)nn->layer_number;
+	int i, j, k = 0;
+
+	for(i=0; i<n; i++)
+	{
+		k += (NULL != nn->contexts[i]) ? nn->contexts[i]->nout : 0;
+	}
+
+	rt->sched.write_start = malloc(sizeof(int)*(n+1) + sizeof(rte_cpu_buffer_t*)*k);
+	if(NULL == rt->sched.write_start)
+	{
+		r = NN_E_NO_MEMORY;
+	}
 	else
 	{
-		r = NN_E_INVALID_RUNTIME;
+		rt->sched.writes = (rte_cpu_buffer_t**)&rt->sched.write_start[n+1];
+		k = 0;
+		for(i=0; i<n; i++)
+		{
+			rt->sched.write_start[i] = k;
+			context = nn->contexts[i];
+			for(j=0; (NULL != context) && (j<context->nout); j++)
+			{
+				b = (rte_cpu_buffer_t*)context->out[j];
+				if(NULL != b)
+				{
+					rt->sched.writes[k++] = (NULL != b->parent) ? b->parent : b;
+				}
+			}
+		}
+		rt->sched.write_start[n] = k;
 	}
 
 	return r;
 }
 
-static int cpu_deinit_layer(const nn_t* nn, const layer_t* layer)
+/* add the data flow to the dependency bitmap once all the layers are initialized, the
+ * branches can only run in parallel if some layer doesn't wait for the one before it */
+static int cpu_sched_prepare(const nn_t* nn)
 {
+	int r = 0;
 	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	const layer_t** inputs;
+	int n = (int)nn->layer_number;
+	int i;
 
-	if(nn->network->type < ARRAY_SIZE(cpu_lops))
+	if(NULL == rt->sched.deps)
 	{
-		if(layer->op < ARRAY_SIZE(cpu_lops[nn->network->type]))
+		return r;
+	}
+
+	for(i=0; i<n; i++)
+	{
+		for(inputs=nn->network->layers[i]->inputs; (NULL != inputs) && (NULL != (*inputs)); inputs++)
+		{
+			cpu_sched_add_dep(rt, i, nn_get_layer_id(nn, *inputs));
+		}
+		if((i > 0) && (FALSE == cpu_sched_is_dep(rt, i, i-1)))
+		{
+			rt->sched.parallel = TRUE;
+		}
+	}
+
+	if(FALSE == rt->sched.parallel)
+	{	/* a chain stays a chain, the graph is never needed */
+		free(rt->sched.deps);
+		rt->sched.deps = NULL;
+	}
+	else
+	{	/* the outputs turn into plain data once the buffers are placed */
+		r = cpu_sched_record_writes(nn);
+	}
+
+	return r;
+}
+
+/* the number of nodes a run of the graph reaches, less than graph->num if there is a cycle */
+static int cpu_sched_get_reachable(thread_pool_graph_t* graph)
+{
+	int head = 0;
+	int tail = 0;
+	int i, j;
+
+	for(i=0; i<graph->num; i++)
+	{
+		graph->pending[i] = graph->npreds[i];
+		if(0 == graph->pending[i])
+		{
+			graph->ready[tail++] = i;
+		}
+	}
+
+	while(head < tail)
+	{
+		i = graph->ready[head++];
+		for(j=graph->succ_start[i]; j<graph->succ_start[i+1]; j++)
+		{
+			graph->pending[graph->succs[j]] --;
+			if(0 == graph->pending[graph->succs[j]])
+			{
+				graph->ready[tail++] = graph->succs[j];
+			}
+		}
+	}
+
+	return tail;
+}
+
+/* turn the dependency bitmap into the successor lists used by thread_pool_run_graph,
+ * done by the first run on more than one thread */
+static int cpu_sched_build(const nn_t* nn)
+{
+	int r;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	thread_pool_graph_t* graph = &rt->sched.graph;
+	int* npreds;
+	int* succ_start;
+	int* succs;
+	int n = (int)nn->layer_number;
+	int i, j, k, nedge = 0;
+
+	r = cpu_sched_plan_memory(nn);
+	if(0 != r)
+	{
+		return r;
+	}
+
+	for(i=0; i<n; i++)
+	{
+		for(j=0; j<n; j++)
+		{
+			nedge += cpu_sched_is_dep(rt, i, j);
+		}
+	}
+
+	npreds = malloc(sizeof(int)*(4*n+1+nedge));
+	if(NULL == npreds)
+	{
+		r = NN_E_NO_MEMORY;
+	}
+	else
+	{
+		succ_start = npreds + n;
+		succs = succ_start + n + 1;
+		graph->pending = succs + nedge;
+		graph->ready = graph->pending + n;
+
+		memset(npreds, 0, sizeof(int)*(2*n+1));
+		for(i=0; i<n; i++)
+		{
+			for(j=0; j<n; j++)
+			{
+				if(cpu_sched_is_dep(rt, i, j))
+				{
+					npreds[i] ++;
+					succ_start[j+1] ++;
+				}
+			}
+		}
+		for(j=0; j<n; j++)
+		{
+			succ_start[j+1] += succ_start[j];
+		}
+		/* pending is free until the first run, use it as the fill position */
+		for(j=0; j<n; j++)
+		{
+			graph->pending[j] = succ_start[j];
+		}
+		for(i=0; i<n; i++)
+		{
+			for(j=0; j<n; j++)
+			{
+				if(cpu_sched_is_dep(rt, i, j))
+				{
+					k = graph->pending[j]++;
+					succs[k] = i;
+				}
+			}
+		}
+
+		graph->num = n;
+		graph->npreds = npreds;
+		graph->succ_start = succ_start;
+		graph->succs = succs;
+
+		free(rt->sched.deps);
+		rt->sched.deps = NULL;
+		free(rt->sched.write_start);
+		rt->sched.write_start = NULL;
+
+		NNLOG(NN_DEBUG, ("Schedule: %d layers, %d dependencies\n", n, nedge));
+
+		k = cpu_sched_get_reachable(graph);
+		if(k < n)
+		{	/* a cycle would leave the workers waiting for a layer that is never ready */
+			NNLOG(NN_WARNING, ("Schedule: %d of %d layers are never ready, there is a cycle, run the layers in order\n", n-k, n));
+			free(npreds);
+			memset(graph, 0, sizeof(thread_pool_graph_t));
+			rt->sched.parallel = FALSE;
+		}
+	}
+
+	return r;
+}
+
+static void cpu_sched_destory(const nn_t* nn)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+
+	if(NULL != rt->sched.deps)
+	{
+		free(rt->sched.deps);
+	}
+
+	if(NULL != rt->sched.write_start)
+	{
+		free(rt->sched.write_start);
+	}
+
+	if(NULL != rt->sched.graph.npreds)
+	{
+		free((void*)rt->sched.graph.npreds);
+	}
+
+	thread_pool_destory(rt->sched.pool);
+}
+
+static int cpu_sched_execute_layer(void* param, int id)
+{
+	const nn_t* nn = (const nn_t*)param;
+
+	return cpu_execute_layer(nn, nn->network->layers[id]);
+}
+#endif
+
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+static int cpu_is_dynamic(const layer_t* layer)
+{
+	return (NULL != layer->dims) && (layer_get_dynamic_axis(layer) > 0);
+}
+
+static void cpu_find_dynamic_root(const nn_t* nn)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	const layer_t* const* inputs;
+	int i, root = TRUE;
+	int nroot = 0;
+
+	rt->root = -1;
+	for(i=0; i<nn->layer_number; i++)
+	{
+		if(FALSE == cpu_is_dynamic(nn->network->layers[i]))
+		{
+			continue;
+		}
+
+		root = TRUE;
+		for(inputs=nn->network->layers[i]->inputs; (NULL != inputs) && (NULL != (*inputs)); inputs++)
+		{
+			if(cpu_is_dynamic(*inputs))
+			{
+				root = FALSE;
+			}
+		}
+
+		if(root)
+		{
+			rt->root = i;
+			nroot ++;
+		}
+	}
+
+	if(nroot > 1)
+	{	/* the shapes of the runs don't come down to one key */
+		rt->root = -1;
+	}
+}
+
+static void cpu_reset_plan(const nn_t* nn, rte_cpu_plan_t* plan)
+{
+	int id, i;
+
+	for(id=0; (NULL != plan->layers) && (id<nn->layer_number); id++)
+	{
+		for(i=0; i<2; i++)
+		{
+			if(NULL != plan->layers[id].temp[i])
+			{
+				free(plan->layers[id].temp[i]);
+			}
+		}
+	}
+
+	if(NULL != plan->layers)
+	{
+		memset(plan->layers, 0, sizeof(rte_cpu_plan_layer_t)*nn->layer_number);
+	}
+	plan->size = 0;
+	plan->state = CPU_PLAN_FREE;
+	plan->used = 0;
+}
+
+/* called once the root has run, so before any other dynamic layer */
+static int cpu_select_plan(const nn_t* nn)
+{
+	int r = 0;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	layer_context_t* context = nn->contexts[rt->root];
+	rte_cpu_plan_t* plan = NULL;
+	rte_cpu_plan_t* victim = &rt->plans[0];
+	int i;
+
+	for(i=0; (i<NN_DYNAMIC_PLAN_NUMBER) && (NULL == plan); i++)
+	{
+		if((CPU_PLAN_READY == rt->plans[i].state) &&
+			(0 == memcmp(&rt->plans[i].key, &context->nhwc, sizeof(NHWC_t))))
+		{
+			plan = &rt->plans[i];
+		}
+		else if(rt->plans[i].used < victim->used)
+		{
+			victim = &rt->plans[i];
+		}
+	}
+
+	if(NULL == plan)
+	{
+		plan = victim;
+		cpu_reset_plan(nn, plan);
+		if(NULL == plan->layers)
+		{
+			rt->allocations[rt->root] ++;
+			plan->layers = malloc(sizeof(rte_cpu_plan_layer_t)*nn->layer_number);
+			if(NULL == plan->layers)
+			{
+				r = NN_E_NO_MEMORY;
+			}
+			else
+			{
+				memset(plan->layers, 0, sizeof(rte_cpu_plan_layer_t)*nn->layer_number);
+			}
+		}
+		plan->key = context->nhwc;
+		plan->state = CPU_PLAN_RECORDING;
+		NNLOG(NN_DEBUG, (" new plan for [%dx%dx%dx%d]\n",
+				context->nhwc.N, context->nhwc.H, context->nhwc.W, context->nhwc.C));
+	}
+
+	rt->stamp ++;
+	plan->used = rt->stamp;
+	if(0 == r)
+	{
+		rt->plan = plan;
+	}
+
+	return r;
+}
+
+/* the buffers of the plan share the pooled memory as the static ones share the arena:
+ * those whose lifetimes don't overlap may take the same place. The layers only run in
+ * the order of the network when the schedule is a chain, else nothing is shared. */
+static int cpu_place_plan(const nn_t* nn, rte_cpu_plan_t* plan)
+{
+	int r = 0;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	rte_cpu_plan_layer_t* entry;
+	layer_context_t* context;
+	rte_cpu_buffer_t* buffers;
+	rte_cpu_buffer_t** placed;
+	int num = 0;
+	int id, i, j, k;
+	int shared = TRUE;
+
+#ifndef DISABLE_NN_THREAD
+	shared = !rt->sched.parallel;
+#endif
+
+	for(id=0; id<nn->layer_number; id++)
+	{
+		for(i=0; i<2; i++)
+		{
+			num += (NULL != plan->layers[id].temp[i]);
+		}
+	}
+
+	rt->allocations[0] ++;
+	buffers = malloc(num*(sizeof(rte_cpu_buffer_t)+sizeof(rte_cpu_buffer_t*)));
+	if((NULL == buffers) && (num > 0))
+	{
+		r = NN_E_NO_MEMORY;
+	}
+
+	if(0 == r)
+	{
+		placed = (rte_cpu_buffer_t**)&buffers[num];
+		num = 0;
+		for(id=0; id<nn->layer_number; id++)
+		{
+			for(i=0; i<2; i++)
+			{
+				entry = &plan->layers[id];
+				if(NULL == entry->temp[i])
+				{
+					continue;
+				}
+				buffers[num].data = entry->temp[i];
+				buffers[num].sz = RTE_CPU_ALIGN(entry->size[i]);
+				buffers[num].offset = (size_t)id*2 + i;
+				buffers[num].start = shared ? id : 0;
+				buffers[num].end = shared ? nn->last_use[id] : (int)nn->layer_number;
+				for(j=id; shared && (j<nn->layer_number); j++)
+				{	/* and until the last reader of the layers that pass it along */
+					context = nn->contexts[j];
+					for(k=0; (NULL != context) && (k<context->nout); k++)
+					{
+						if(context->out[k] != entry->temp[i])
+						{
+							continue;
+						}
+						if(L_OP_OUTPUT == nn->network->layers[j]->op)
+						{	/* read after the run */
+							buffers[num].end = (int)nn->layer_number;
+						}
+						else if(nn->last_use[j] > buffers[num].end)
+						{
+							buffers[num].end = nn->last_use[j];
+						}
+					}
+				}
+				placed[num] = &buffers[num];
+				num ++;
+			}
+		}
+
+		qsort(placed, num, sizeof(rte_cpu_buffer_t*), cpu_compare_buffer);
+		plan->size = 0;
+		for(j=0; j<num; j++)
+		{	/* the offset held the position of the output until now */
+			id = (int)(placed[j]->offset/2);
+			i = (int)(placed[j]->offset%2);
+			placed[j]->offset = cpu_find_best_fit(placed, j, placed[j]);
+			plan->layers[id].offset[i] = placed[j]->offset;
+			if((placed[j]->offset + placed[j]->sz) > plan->size)
+			{
+				plan->size = placed[j]->offset + placed[j]->sz;
+			}
+		}
+		free(buffers);
+	}
+
+	return r;
+}
+
+/* the run that recorded the plan is over, place its outputs in the pooled memory */
+static int cpu_complete_plan(const nn_t* nn, int r)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	rte_cpu_plan_t* plan = rt->plan;
+	rte_cpu_plan_layer_t* entry;
+	layer_context_t* context;
+	size_t size;
+	int id, i, j, k;
+
+	rt->plan = NULL;
+	if(NULL != plan)
+	{
+		rt->dynamic_used = plan->size;
+	}
+	if((NULL == plan) || (CPU_PLAN_RECORDING != plan->state))
+	{
+		return r;
+	}
+
+	if(0 == r)
+	{
+		r = cpu_place_plan(nn, plan);
+	}
+
+	if((0 == r) && (plan->size > rt->dynamic_size))
+	{	/* grow geometrically so that a few bigger shapes don't each make a new block */
+		size = rt->dynamic_size*2;
+		if(size > NN_DYNAMIC_ARENA_CAP)
+		{
+			size = NN_DYNAMIC_ARENA_CAP;
+		}
+		if(size < plan->size)
+		{
+			size = plan->size;
+		}
+		if(NULL != rt->dynamic_arena)
+		{
+			free(rt->dynamic_arena);
+		}
+		rt->allocations[0] ++;
+		rt->dynamic_arena = malloc(size);
+		rt->dynamic_size = (NULL != rt->dynamic_arena) ? size : 0;
+		if(NULL == rt->dynamic_arena)
+		{
+			r = NN_E_NO_MEMORY;
+		}
+		NNLOG(NN_DEBUG, (" dynamic memory grows to %d bytes\n", (int)size));
+	}
+
+	for(id=0; (0 == r) && (id<nn->layer_number); id++)
+	{
+		for(i=0; i<2; i++)
+		{
+			entry = &plan->layers[id];
+			if(NULL == entry->temp[i])
+			{
+				continue;
+			}
+			for(j=id; j<nn->layer_number; j++)
+			{
+				context = nn->contexts[j];
+				for(k=0; (NULL != context) && (k<context->nout); k++)
+				{
+					if(context->out[k] != entry->temp[i])
+					{
+						continue;
+					}
+					context->out[k] = (char*)rt->dynamic_arena + entry->offset[i];
+					if(L_OP_OUTPUT == nn->network->layers[j]->op)
+					{	/* read after the run, nothing else is alive there at the end */
+						memcpy(context->out[k], entry->temp[i], entry->size[i]);
+					}
+				}
+			}
+			free(entry->temp[i]);
+			entry->temp[i] = NULL;
+		}
+	}
+
+	if(0 == r)
+	{
+		plan->state = CPU_PLAN_READY;
+		rt->dynamic_used = plan->size;
+		NNLOG(NN_DEBUG, ("plan for [%dx%dx%dx%d] ready, %d bytes\n", plan->key.N, plan->key.H,
+				plan->key.W, plan->key.C, (int)plan->size));
+	}
+	else
+	{
+		cpu_reset_plan(nn, plan);
+	}
+
+	return r;
+}
+
+/* the entry of the layer in the plan of the current run, NULL if it has none */
+static rte_cpu_plan_layer_t* cpu_get_plan_layer(const nn_t* nn, const layer_t* layer)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	rte_cpu_plan_layer_t* entry = NULL;
+
+	if((NULL != rt->plan) && cpu_is_dynamic(layer))
+	{
+		entry = &rt->plan->layers[nn_get_layer_id(nn, layer)];
+	}
+
+	return entry;
+}
+#endif
+
+static int cpu_init_layer(const nn_t* nn, const layer_t* layer)
+{
+	int r = NN_E_INVALID_LAYER;
+#if !defined(DISABLE_NN_THREAD) && (!defined(DISABLE_NN_SCRATCH) || !defined(DISABLE_RTE_FALLBACK))
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	size_t requests = nn->scratch.requests;
+#endif
+
+	if(nn->network->type < ARRAY_SIZE(cpu_lops))
+	{
+		if(layer->op < ARRAY_SIZE(cpu_lops[nn->network->type]))
+		{
+			NNLOG(NN_DEBUG, ("init %s\n", layer->name));
+			r = cpu_lops[nn->network->type][layer->op].init(nn, layer);
+		}
+	}
+	else
+	{
+		r = NN_E_INVALID_RUNTIME;
+	}
+
+#if !defined(DISABLE_NN_THREAD) && (!defined(DISABLE_NN_SCRATCH) || !defined(DISABLE_RTE_FALLBACK))
+	if(requests != nn->scratch.requests)
+	{	/* the scratch area is shared, so its users must run one after another */
+		if(rt->sched.last_scratch_user >= 0)
+		{
+			cpu_sched_add_dep(rt, nn_get_layer_id(nn, layer), rt->sched.last_scratch_user);
+		}
+		rt->sched.last_scratch_user = nn_get_layer_id(nn, layer);
+	}
+#endif
+
+	return r;
+}
+
+static int cpu_execute_layer(const nn_t* nn, const layer_t* layer)
+{
+	int r = NN_E_INVALID_LAYER;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+#ifndef DISABLE_NN_PROFILE
+	uint64_t start = 0;
+#endif
+
+	if(nn->network->type < ARRAY_SIZE(cpu_lops))
+	{
+		if(layer->op < ARRAY_SIZE(cpu_lops[nn->network->type]))
+		{
+			NNLOG(NN_DEBUG, ("execute %s: [%dx%dx%dx%d]\n", layer->name, L_SHAPES(nn, layer)));
+			RTE_PROFILE_START(nn, start);
+			r = cpu_lops[nn->network->type][layer->op].execute(nn, layer);
+			RTE_PROFILE_STOP(nn, layer, start);
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+			if((0 == r) && (rt->root >= 0) && (nn->network->layers[rt->root] == layer))
+			{
+				r = cpu_select_plan(nn);
+			}
+#endif
+#ifndef DISABLE_NN_DDO
+			NNDDO(NN_DEBUG, rte_ddo_save(nn, layer));
+#endif
+		}
+	}
+	else
+	{
+		r = NN_E_INVALID_RUNTIME;
+	}
+
+	return r;
+}
+
+static int cpu_deinit_layer(const nn_t* nn, const layer_t* layer)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+
+	if(nn->network->type < ARRAY_SIZE(cpu_lops))
+	{
+		if(layer->op < ARRAY_SIZE(cpu_lops[nn->network->type]))
+		{
+			cpu_lops[nn->network->type][layer->op].deinit(nn, layer);
+		}
+	}
+
+	return 0;
+}
+
+static int cpu_adjust_layer_buffer(const nn_t* nn, const layer_t* layer)
+{
+	int r = 0;
+	int i;
+	rte_cpu_buffer_t* buffer;
+	layer_cpu_context_t* context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
+
+	for(i=0; i<context->nout; i++)
+	{
+		buffer = context->out[i];
+		if(NULL != buffer)
+		{
+			context->out[i] = buffer->data;
+			NNLOG(NN_DEBUG, (" layer %s out[%d] using buffer%d\n", layer->name, i, cpu_get_buffer_id(nn, buffer)));
+		}
+	}
+
+	return r;
+}
+
+static int cpu_is_lifetime_overlapped(const rte_cpu_buffer_t* a, const rte_cpu_buffer_t* b)
+{
+	return (a->start <= b->end) && (b->start <= a->end);
+}
+
+static int cpu_compare_buffer(const void* a, const void* b)
+{
+	const rte_cpu_buffer_t* ba = *(const rte_cpu_buffer_t* const*)a;
+	const rte_cpu_buffer_t* bb = *(const rte_cpu_buffer_t* const*)b;
+	int r;
+
+	if(ba->sz != bb->sz)
+	{	/* the big ones first */
+		r = (ba->sz > bb->sz) ? -1 : 1;
+	}
+	else
+	{
+		r = ba->start - bb->start;
+	}
+
+	return r;
+}
+
+/* among the gaps left by the placed buffers that are alive at the same time,
+ * pick the smallest one that fits, or the top of the arena if none fits */
+static size_t cpu_find_best_fit(rte_cpu_buffer_t** placed, int num, rte_cpu_buffer_t* b)
+{
+	size_t best = 0;
+	size_t bestGap = (size_t)-1;
+	size_t offset, gap;
+	int found = FALSE;
+	int i, j;
+
+	for(i=-1; i<num; i++)
+	{
+		if(i < 0)
+		{
+			offset = 0;
+		}
+		else if(cpu_is_lifetime_overlapped(placed[i], b))
+		{
+			offset = placed[i]->offset + placed[i]->sz;
+		}
+		else
+		{
+			continue;
+		}
+
+		gap = (size_t)-1;
+		for(j=0; j<num; j++)
+		{
+			if(FALSE == cpu_is_lifetime_overlapped(placed[j], b))
+			{
+				continue;
+			}
+
+			if(placed[j]->offset >= offset)
+			{
+				if((placed[j]->offset - offset) < gap)
+				{
+					gap = placed[j]->offset - offset;
+				}
+			}
+			else if((placed[j]->offset + placed[j]->sz) > offset)
+			{	/* inside of another one */
+				gap = 0;
+				break;
+			}
+		}
+
+		if((gap >= b->sz) &&
+			((FALSE == found) || (gap < bestGap) || ((gap == bestGap) && (offset < best))))
+		{
+			best = offset;
+			bestGap = gap;
+			found = TRUE;
+		}
+	}
+
+	return best;
+}
+
+#ifndef DISABLE_NN_LOG
+/* how much the greedy first fit in the order of creation would have taken */
+static size_t cpu_get_greedy_size(const nn_t* nn)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	rte_cpu_buffer_t* b;
+	size_t* slotSz;
+	int* slotEnd;
+	int num = 0;
+	int nslot = 0;
+	int i;
+	size_t sum = 0;
+
+	STAILQ_FOREACH(b, &(rt->buffers), entry)
+	{
+		num ++;
+	}
+
+	slotSz = malloc(num*(sizeof(size_t)+sizeof(int)));
+	if(NULL != slotSz)
+	{
+		slotEnd = (int*)&slotSz[num];
+		STAILQ_FOREACH(b, &(rt->buffers), entry)
+		{
+			if(NULL != b->parent)
+			{
+				continue;
+			}
+			for(i=0; (i < nslot) && (slotEnd[i] >= b->start); i++);
+			if(i == nslot)
+			{
+				slotSz[i] = 0;
+				nslot ++;
+			}
+			if(b->sz > slotSz[i])
+			{
+				slotSz[i] = b->sz;
+			}
+			slotEnd[i] = b->end;
+		}
+
+		for(i=0; i < nslot; i++)
+		{
+			sum += slotSz[i];
+		}
+		free(slotSz);
+	}
+
+	return sum;
+}
+#endif
+
+static size_t cpu_get_type_size(layer_data_type_t dtype)
+{
+	size_t sz = sizeof(float);
+
+	if((L_DT_INT8 == dtype) || (L_DT_UINT8 == dtype))
+	{
+		sz = sizeof(int8_t);
+	}
+	else if((L_DT_INT16 == dtype) || (L_DT_UINT16 == dtype))
+	{
+		sz = sizeof(int16_t);
+	}
+
+	return sz;
+}
+
+/* the input of an OUTPUT layer can write straight into the output buffer if
+ * nothing else reads or writes its buffer and the content is the same */
+static int cpu_is_direct_output(const nn_t* nn, const layer_t* output)
+{
+	int r = FALSE;
+	const layer_t* producer = output->inputs[0];
+	int id = nn_get_layer_id(nn, producer);
+	layer_context_t* context = nn->contexts[id];
+	layer_context_t* out_context = LAYER_CONTEXT(nn, output);
+	rte_cpu_buffer_t* b = NULL;
+	const layer_t** inputs;
+	int i, j;
+
+	if((NULL != context) && (NULL != out_context) && (1 == context->nout) && (NULL != context->out[0]))
+	{
+		b = (rte_cpu_buffer_t*)context->out[0];
+		r = (b->start == id) && (context->dtype == out_context->dtype) &&
+			(b->sz == (NHWC_SIZE(out_context->nhwc)*cpu_get_type_size(out_context->dtype)));
+	}
+
+	for(i=0; (i<nn->layer_number) && r; i++)
+	{
+		context = nn->contexts[i];
+		for(j=0; (i != id) && (NULL != context) && (j<context->nout); j++)
+		{
+			if(context->out[j] == (void*)b)
+			{
+				r = FALSE;
+			}
+		}
+
+		for(inputs=nn->network->layers[i]->inputs; (nn->network->layers[i] != output) &&
+				(NULL != inputs) && (NULL != (*inputs)); inputs++)
+		{
+			if(*inputs == producer)
+			{
+				r = FALSE;
+			}
+		}
+	}
+
+	return r;
+}
+
+/* must be done before cpu_adjust_layer_buffer, the outputs still hold the buffers */
+static int cpu_plan_direct_output(const nn_t* nn)
+{
+	int r = 0;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	const layer_t* const* layers;
+
+	for(layers=nn->network->layers; NULL != (*layers); layers++)
+	{
+		if((L_OP_OUTPUT == (*layers)->op) && cpu_is_direct_output(nn, *layers))
+		{
+			rt->ndirect ++;
+		}
+	}
+
+	if(rt->ndirect > 0)
+	{
+		rt->directs = malloc(rt->ndirect*sizeof(rte_cpu_direct_output_t));
+		if(NULL == rt->directs)
+		{
+			r = NN_E_NO_MEMORY;
+		}
+	}
+
+	rt->ndirect = 0;
+	for(layers=nn->network->layers; (NULL != (*layers)) && (0 == r); layers++)
+	{
+		if((L_OP_OUTPUT == (*layers)->op) && cpu_is_direct_output(nn, *layers))
+		{
+			rt->directs[rt->ndirect].output = *layers;
+			rt->directs[rt->ndirect].producer = LAYER_CONTEXT(nn, (*layers)->inputs[0]);
+			rt->directs[rt->ndirect].planned = NULL;
+			NNLOG(NN_DEBUG, (" layer %s writes output %s in place\n", (*layers)->inputs[0]->name, (*layers)->name));
+			rt->ndirect ++;
+		}
+	}
+
+	return r;
+}
+
+/* all the buffers are known now, work out how long each of them is alive and
+ * pack them into one arena so that the ones alive at the same time never overlap */
+static int cpu_plan_memory(const nn_t* nn)
+{
+	int r = 0;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	rte_cpu_buffer_t** placed;
+	rte_cpu_buffer_t* b;
+	layer_context_t* context;
+	int num = 0;
+	int i, j, end;
+
+	for(i=0; i<nn->layer_number; i++)
+	{	/* an output is alive until its last reader, a released one is only
+		 * the scratch of its creator and never shows up here */
+		context = nn->contexts[i];
+		for(j=0; (NULL != context) && (j<context->nout); j++)
+		{
+			b = (rte_cpu_buffer_t*)context->out[j];
+			if((NULL != b) && (NULL != b->parent))
+			{	/* a slice keeps the whole CONCAT output alive */
+				b = b->parent;
+			}
+			if(NULL != b)
+			{
+				end = nn->last_use[i];
+				if(end > b->end)
+				{
+					b->end = end;
+				}
+			}
+		}
+	}
+
+	STAILQ_FOREACH(b, &(rt->buffers), entry)
+	{
+		if(NULL == b->parent)
+		{
+			b->sz = RTE_CPU_ALIGN(b->sz);
+			num ++;
+		}
+	}
+
+	placed = malloc(num*sizeof(rte_cpu_buffer_t*));
+	if(NULL == placed)
+	{
+		r = NN_E_NO_MEMORY;
+	}
+
+	if(0 == r)
+	{
+		i = 0;
+		STAILQ_FOREACH(b, &(rt->buffers), entry)
+		{
+			if(NULL == b->parent)
+			{
+				placed[i++] = b;
+			}
+		}
+
+		qsort(placed, num, sizeof(rte_cpu_buffer_t*), cpu_compare_buffer);
+
+		rt->arena_size = 0;
+		for(i=0; i<num; i++)
+		{
+			b = placed[i];
+			b->offset = cpu_find_best_fit(placed, i, b);
+			if((b->offset + b->sz) > rt->arena_size)
+			{
+				rt->arena_size = b->offset + b->sz;
+			}
+		}
+
+		free(placed);
+
+		if(rt->arena_size > 0)
+		{
+			rt->arena = malloc(rt->arena_size);
+			if(NULL == rt->arena)
+			{
+				r = NN_E_NO_MEMORY;
+			}
+		}
+	}
+
+	if(0 == r)
+	{
+		NNLOG(NN_DEBUG, ("Memory Usage:\n"));
+		STAILQ_FOREACH(b, &(rt->buffers), entry)
+		{
+			if(NULL != b->parent)
+			{
+				b->data = (uint8_t*)rt->arena + b->parent->offset + b->offset;
+				NNLOG(NN_DEBUG, (" buffer%d: %d @%d of buffer%d\n", cpu_get_buffer_id(nn, b),
+						(int)b->sz, (int)b->offset, cpu_get_buffer_id(nn, b->parent)));
+				continue;
+			}
+			b->data = (uint8_t*)rt->arena + b->offset;
+			NNLOG(NN_DEBUG, (" buffer%d: %d @%d, alive in [%d, %d]\n", cpu_get_buffer_id(nn, b),
+					(int)b->sz, (int)b->offset, b->start, b->end));
+		}
+		NNLOG(NN_DEBUG, (" summary: %d, greedy reuse takes %d\n", (int)rt->arena_size, (int)cpu_get_greedy_size(nn)));
+	}
+
+	return r;
+}
+
+static alg_isa_t cpu_get_isa(void)
+{
+	alg_isa_t isa = alg_isa_detect();
+	alg_isa_t forced = cpu_isa_forced;
+	const char* name;
+
+	if(ALG_ISA_NUMBER == forced)
+	{
+		name = getenv("LWNN_CPU_ISA");
+		if(NULL != name)
+		{
+			forced = alg_isa_from_name(name);
+			if(ALG_ISA_NUMBER == forced)
+			{
+				NNLOG(NN_WARNING, ("LWNN_CPU_ISA=%s is unknown, ignored\n", name));
+			}
+		}
+	}
+
+	if(ALG_ISA_NUMBER != forced)
+	{
+		if(alg_isa_supported(forced))
+		{
+			isa = forced;
+		}
+		else
+		{
+			NNLOG(NN_WARNING, ("ISA %s is not supported by this CPU, use %s\n",
+					alg_isa_name(forced), alg_isa_name(isa)));
+		}
+	}
+
+	return isa;
+}
+
+#if !defined(DISABLE_RUNTIME_CPU_FLOAT) && !defined(DISABLE_NN_CONCAT_SLICE)
+/* the CONCAT that the float layer can write its output into: it is the only reader,
+ * the slice is plain (the last axis, or only 1s before the axis) and the shapes are
+ * static. *offset is where the slice starts and *pitch the floats between two pixels */
+static const layer_t* cpu_get_concat_of(const nn_t* nn, const layer_t* layer, size_t* offset, int* pitch)
+{
+	const layer_t* concat = NULL;
+	const layer_t** inputs;
+	NHWC_t nhwc;
+	NHWC_t inhwc;
+	size_t n_block = 1;
+	size_t stride;
+	int axis = -1;
+	int i;
+
+	if((RUNTIME_CPU == nn->runtime_type) && (NETWORK_TYPE_FLOAT == nn->network->type) &&
+		((L_DT_AUTO == layer->dtype) || (L_DT_FLOAT == layer->dtype)) &&
+		(1 == rte_get_reader_number(nn, layer)))
+	{	/* the only reader is the last use, unless a pass has moved that one further */
+		concat = nn->network->layers[nn->last_use[nn_get_layer_id(nn, layer)]];
+		for(inputs=concat->inputs; (NULL != inputs) && (NULL != (*inputs)) && ((*inputs) != layer); inputs++);
+		if((NULL == inputs) || (NULL == (*inputs)))
+		{
+			concat = NULL;
+		}
+	}
+
+	if((NULL != concat) && (L_OP_CONCAT == concat->op) && (L_DT_AUTO == concat->dtype) &&
+		(0 == layer_get_NHWC(concat, &nhwc)) && (0 == layer_get_NHWC(layer, &inhwc))
+#ifndef DISABLE_DYNAMIC_SHAPE
+		&& (layer_get_dynamic_axis(layer) < 0) && (layer_get_dynamic_axis(concat) < 0)
+#endif
+		)
+	{
+		axis = RTE_FETCH_INT32(concat->blobs[0]->blob, 0);
+	}
+
+	for(i=0; (i<axis) && (i<4); i++)
+	{
+		n_block *= RTE_FETCH_INT32(&nhwc, i);
+	}
+
+	if((axis < 0) || (axis > 3) || ((3 != axis) && (1 != n_block)))
+	{
+		concat = NULL;
+	}
+	else
+	{
+		*pitch = (3 == axis) ? nhwc.C : inhwc.C;
+		*offset = 0;
+		for(inputs=concat->inputs; (NULL != concat) && ((*inputs) != layer); inputs++)
+		{
+			if(0 != layer_get_NHWC(*inputs, &inhwc))
+			{
+				concat = NULL;
+				break;
+			}
+			stride = 1;
+			for(i=axis; i<=3; i++)
+			{
+				stride *= RTE_FETCH_INT32(&inhwc, i);
+			}
+			*offset += stride;
+		}
+	}
+
+	return concat;
+}
+#endif
+
+#ifndef DISABLE_RUNTIME_CPU_FLOAT
+/* the output of the CONCAT, if one of its inputs has already taken a slice of it */
+static rte_cpu_buffer_t* cpu_find_concat_buffer(const nn_t* nn, const layer_t* concat)
+{
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	rte_cpu_buffer_t* buffer = NULL;
+	rte_cpu_buffer_t* b;
+
+	if(RUNTIME_CPU == nn->runtime_type)
+	{
+		STAILQ_FOREACH(b, &(rt->buffers), entry)
+		{
+			if((NULL == b->parent) && (b->owner == concat))
+			{
+				buffer = b;
+				break;
+			}
+		}
+	}
+
+	return buffer;
+}
+#endif
+/* ============================ [ FUNCTIONS ] ====================================================== */
+int nn_set_cpu_isa(const char* name)
+{
+	int r = 0;
+	alg_isa_t isa = ALG_ISA_NUMBER;
+
+	if(NULL != name)
+	{
+		isa = alg_isa_from_name(name);
+		if(ALG_ISA_NUMBER == isa)
+		{
+			r = NN_E_INVALID_PARAMETER;
+		}
+		else if(FALSE == alg_isa_supported(isa))
 		{
-			cpu_lops[nn->network->type][layer->op].deinit(nn, layer);
+			r = NN_E_NOT_SUPPORTED;
 		}
 	}
 
-	return 0;
+	if(0 == r)
+	{
+		cpu_isa_forced = isa;
+	}
+
+	return r;
 }
 
-static int cpu_adjust_layer_buffer(const nn_t* nn, const layer_t* layer)
+int nn_get_memory_stats(const nn_t* nn, nn_memory_stats_t* stats)
 {
 	int r = 0;
-	int i;
-	rte_cpu_buffer_t* buffer;
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	rte_cpu_t* rt;
 
-	for(i=0; i<context->nout; i++)
+	if((NULL == nn) || (NULL == stats))
 	{
-		buffer = context->out[i];
-		if(NULL != buffer)
-		{
-			context->out[i] = buffer->data;
-			NNLOG(NN_DEBUG, (" layer %s out[%d] using buffer%d\n", layer->name, i, cpu_get_buffer_id(nn, buffer)));
-		}
+		r = NN_E_INVALID_PARAMETER;
+	}
+	else if(RUNTIME_CPU != nn->runtime_type)
+	{
+		r = NN_E_INVALID_RUNTIME;
+	}
+	else
+	{
+		rt = (rte_cpu_t*)nn->runtime;
+		memset(stats, 0, sizeof(nn_memory_stats_t));
+		stats->arena = rt->arena_size;
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+		stats->dynamic_arena = rt->dynamic_size;
+		stats->dynamic_used = rt->dynamic_used;
+#endif
+#ifndef DISABLE_DYNAMIC_SHAPE
+		stats->allocations = rt->last_allocations;
+		stats->total_allocations = rt->total_allocations;
+		stats->predicts = rt->predicts;
+#endif
 	}
 
 	return r;
 }
 
-/* ============================ [ FUNCTIONS ] ====================================================== */
 runtime_t rte_CPU_create(const nn_t* nn)
 {
-	return malloc(sizeof(rte_cpu_t));
+	rte_cpu_t* rt = malloc(sizeof(rte_cpu_t));
+
+	if(NULL != rt)
+	{
+		rt->isa = cpu_get_isa();
+		NNLOG(NN_DEBUG, ("CPU ISA: %s\n", alg_isa_name(rt->isa)));
+	}
+
+	return rt;
 }
 
 void rte_CPU_destory(const nn_t* nn)
 {
 	rte_cpu_buffer_t* b;
 	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+	int i;
+#endif
 
 	rte_do_for_each_layer(nn, cpu_deinit_layer);
+#ifndef DISABLE_NN_THREAD
+	cpu_sched_destory(nn);
+#endif
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+	for(i=0; i<NN_DYNAMIC_PLAN_NUMBER; i++)
+	{
+		cpu_reset_plan(nn, &rt->plans[i]);
+		if(NULL != rt->plans[i].layers)
+		{
+			free(rt->plans[i].layers);
+		}
+	}
+
+	if(NULL != rt->dynamic_arena)
+	{
+		free(rt->dynamic_arena);
+	}
+#endif
+#ifndef DISABLE_DYNAMIC_SHAPE
+	if(NULL != rt->allocations)
+	{
+		free(rt->allocations);
+	}
+#endif
 
 	while(FALSE == STAILQ_EMPTY(&rt->buffers))
 	{
 		b = STAILQ_FIRST(&rt->buffers);
 		STAILQ_REMOVE_HEAD(&rt->buffers, entry);
-		if(b->data != NULL)
-		{
-			free(b->data);
-		}
 		free(b);
 	}
 
+	if(rt->arena != NULL)
+	{
+		free(rt->arena);
+	}
+
+	if(rt->directs != NULL)
+	{
+		free(rt->directs);
+	}
+
 	free(nn->runtime);
 }
 
 int rte_CPU_init(const nn_t* nn)
 {
 	int r;
-	rte_cpu_buffer_t* b;
+	int i;
 	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
-#ifndef DISABLE_NN_LOG
-	size_t sum = 0;
-	int bufferId = -1;
-#endif
 
 	STAILQ_INIT(&(rt->buffers));
+	rt->arena = NULL;
+	rt->arena_size = 0;
+	rt->directs = NULL;
+	rt->ndirect = 0;
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+	memset(rt->plans, 0, sizeof(rt->plans));
+	rt->plan = NULL;
+	rt->stamp = 0;
+	rt->dynamic_arena = NULL;
+	rt->dynamic_size = 0;
+	rt->dynamic_used = 0;
+	cpu_find_dynamic_root(nn);
+#endif
+
+#ifndef DISABLE_NN_THREAD
+	r = cpu_sched_create(nn);
+#else
+	r = 0;
+#endif
+
+#ifndef DISABLE_DYNAMIC_SHAPE
+	rt->last_allocations = 0;
+	rt->total_allocations = 0;
+	rt->predicts = 0;
+	/* the layers may ask for dynamic memory during their init already */
+	rt->allocations = malloc(sizeof(size_t)*nn->layer_number);
+	if(NULL == rt->allocations)
+	{
+		r = NN_E_NO_MEMORY;
+	}
+	else
+	{
+		memset(rt->allocations, 0, sizeof(size_t)*nn->layer_number);
+	}
+#endif
 
-	r = rte_do_for_each_layer(nn, cpu_init_layer);
+	if(0 == r)
+	{
+		r = rte_do_for_each_layer(nn, cpu_init_layer);
+	}
 
 	if(0 == r)
 	{
-		NNLOG(NN_DEBUG, ("Memory Usage:\n"));
-		STAILQ_FOREACH(b, &(rt->buffers), entry)
-		{
-			b->data = malloc(b->sz);
-			if(b->data == NULL)
-			{
-				r = NN_E_NO_MEMORY;
-				break;
-			}
+		r = cpu_plan_direct_output(nn);
+	}
 
-			#ifndef DISABLE_NN_LOG
-			sum += b->sz;
-			bufferId ++;
-			#endif
-			NNLOG(NN_DEBUG, (" buffer%d: %d\n", bufferId, (int)b->sz));
-		}
-		NNLOG(NN_DEBUG, (" summary: %d\n", (int)sum));
+	if(0 == r)
+	{
+		r = cpu_plan_memory(nn);
+	}
+
+#ifndef DISABLE_NN_THREAD
+	if(0 == r)
+	{
+		r = cpu_sched_prepare(nn);
 	}
+#endif
 
 	if(0 == r)
 	{
 		r = rte_do_for_each_layer(nn, cpu_adjust_layer_buffer);
 	}
 
+	for(i=0; (i<rt->ndirect) && (0 == r); i++)
+	{
+		rt->directs[i].planned = rt->directs[i].producer->out[0];
+	}
+
 	return r;
 }
 
 int rte_CPU_execute(const nn_t* nn)
 {
-	return rte_do_for_each_layer(nn, cpu_execute_layer);
+	int r;
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	void* data;
+	int i;
+#ifndef DISABLE_NN_THREAD
+	int num = thread_pool_get_num_threads(nn->tpool);
+#endif
+
+#ifndef DISABLE_DYNAMIC_SHAPE
+	memset(rt->allocations, 0, sizeof(size_t)*nn->layer_number);
+#endif
+
+	/* the output buffer may be bound to another one on each call */
+	for(i=0; i<rt->ndirect; i++)
+	{
+		data = nn_get_output_data(nn, rt->directs[i].output);
+		rt->directs[i].producer->out[0] = (NULL != data) ? data : rt->directs[i].planned;
+	}
+
+#ifndef DISABLE_NN_THREAD
+	if((num > 1) && rt->sched.parallel)
+	{	/* the branches get their own workers, the kernels keep using nn->tpool */
+		if(num != thread_pool_get_num_threads(rt->sched.pool))
+		{
+			thread_pool_destory(rt->sched.pool);
+			rt->sched.pool = thread_pool_create(num);
+		}
+
+		if(NULL != rt->sched.deps)
+		{	/* the first run on more than one thread, tried again on the next one if it fails */
+			r = cpu_sched_build(nn);
+			if(0 != r)
+			{
+				NNLOG(NN_WARNING, ("Schedule: failed with %d, run the layers in order\n", r));
+			}
+		}
+
+		if((NULL != rt->sched.pool) && (NULL != rt->sched.graph.npreds))
+		{
+			r = thread_pool_run_graph(rt->sched.pool, &rt->sched.graph, cpu_sched_execute_layer, (void*)nn);
+		}
+		else
+		{
+			r = rte_do_for_each_layer(nn, cpu_execute_layer);
+		}
+	}
+	else
+#endif
+	r = rte_do_for_each_layer(nn, cpu_execute_layer);
+
+#if !defined(DISABLE_DYNAMIC_SHAPE) && !defined(DISABLE_NN_DYNAMIC_PLAN)
+	r = cpu_complete_plan(nn, r);
+#endif
+#ifndef DISABLE_DYNAMIC_SHAPE
+	rt->last_allocations = 0;
+	for(i=0; i<nn->layer_number; i++)
+	{
+		rt->last_allocations += rt->allocations[i];
+	}
+	rt->total_allocations += rt->last_allocations;
+	rt->predicts ++;
+#endif
+
+	return r;
 }
 
 int rte_cpu_create_layer_context(
@@ -316,7 +1957,7 @@ int rte_cpu_create_layer_context(
 
 	if(0 == r)
 	{
-		layer->C->context = (layer_context_t*)context;
+		LAYER_CONTEXT(nn, layer) = (layer_context_t*)context;
 	}
 
 	return r;
@@ -325,14 +1966,14 @@ int rte_cpu_create_layer_context(
 void rte_cpu_destory_layer_context(const nn_t* nn, const layer_t* layer)
 {
 	size_t i;
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
 		free(context);
 	}
 
-	layer->C->context = NULL;
+	LAYER_CONTEXT(nn, layer) = NULL;
 }
 
 int rte_cpu_create_layer_common(const nn_t* nn, const layer_t* layer, size_t ctx_sz, size_t type_sz)
@@ -345,7 +1986,7 @@ int rte_cpu_create_layer_common(const nn_t* nn, const layer_t* layer, size_t ctx
 
 	if(0 == r)
 	{
-		context = (layer_cpu_context_t*)layer->C->context;
+		context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 		bsz = NHWC_SIZE(context->nhwc)*type_sz;
 	}
 
@@ -383,74 +2024,240 @@ int rte_cpu_create_layer_common(const nn_t* nn, const layer_t* layer, size_t ctx
 }
 
 
+/* the buffer has no memory yet, its place is decided by cpu_plan_memory */
 void* rte_cpu_create_buffer(const nn_t* nn, const layer_t* layer, size_t sz)
 {
-	int r;
-	rte_cpu_buffer_t* buffer = NULL;
-	rte_cpu_buffer_t* b;
+	rte_cpu_buffer_t* buffer;
 	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
 
-	STAILQ_FOREACH(b, &(rt->buffers), entry)
+	buffer = malloc(sizeof(rte_cpu_buffer_t));
+	if(NULL != buffer)
 	{
-		if(NULL == b->owner)
-		{
-			buffer = b;
-			break;
-		}
-		else
+		buffer->owner = layer;
+		buffer->sz = sz;
+		buffer->data = NULL;
+		buffer->start = nn_get_layer_id(nn, layer);
+		buffer->end = buffer->start;
+		buffer->offset = 0;
+		buffer->parent = NULL;
+
+		STAILQ_INSERT_TAIL(&(rt->buffers), buffer, entry);
+	}
+
+	return buffer;
+}
+
+void rte_cpu_take_buffer(const nn_t* nn, rte_cpu_buffer_t* buffer, const layer_t* layer, int id)
+{
+	layer_context_t* context = LAYER_CONTEXT(nn, layer);
+	assert(buffer != NULL);
+	#ifndef DISABLE_NN_THREAD
+	if(NULL != buffer->owner)
+	{
+		cpu_sched_after_readers(nn, nn_get_layer_id(nn, layer), buffer->owner);
+	}
+	#endif
+	buffer->owner = layer;
+	assert(id < context->nout);
+	context->out[id] = buffer;
+}
+
+void rte_cpu_alias_buffer(const nn_t* nn, rte_cpu_buffer_t* buffer, const layer_t* layer, int id)
+{
+	layer_context_t* context = LAYER_CONTEXT(nn, layer);
+	assert(buffer != NULL);
+	buffer->owner = layer;
+	assert(id < context->nout);
+	context->out[id] = buffer;
+}
+
+void rte_cpu_release_buffer(rte_cpu_buffer_t* buffer)
+{
+	assert(buffer != NULL);
+	buffer->owner = NULL;
+}
+
+#ifndef DISABLE_RUNTIME_CPU_FLOAT
+int rte_cpu_is_inplace(const nn_t* nn, const layer_t* layer, int i)
+{
+	int r = FALSE;
+#ifndef DISABLE_NN_INPLACE
+	const layer_t* input = layer->inputs[i];
+	layer_context_t* input_context = LAYER_CONTEXT(nn, input);
+	layer_context_t* context;
+	rte_cpu_buffer_t* buffer = NULL;
+	const layer_t* creator;
+	NHWC_t nhwc;
+	size_t id;
+
+	if((RUNTIME_CPU == nn->runtime_type) &&
+		(NETWORK_TYPE_FLOAT == nn->network->type) &&
+		(NULL != input_context) && (1 == input_context->nout) &&
+		(0 == layer_get_NHWC(layer, &nhwc)) &&
+		(NHWC_SIZE(nhwc) == NHWC_SIZE(input_context->nhwc))
+#ifndef DISABLE_DYNAMIC_SHAPE
+		&& (layer_get_dynamic_axis(layer) <= 0)
+#endif
+		)
+	{
+		buffer = (rte_cpu_buffer_t*)input_context->out[0];
+	}
+
+	if((NULL != buffer) && (buffer->owner == input))
+	{
+		creator = nn->network->layers[buffer->start];
+		r = (L_OP_INPUT != creator->op) && (L_OP_CONST != creator->op);
+		/* the layers that pass the buffer along to the input must have no other readers */
+		for(id=buffer->start; (id<nn->layer_number) && (TRUE == r); id++)
 		{
-			r = rte_is_layer_consumed_from(nn, b->owner, layer);
-			if(FALSE == r)
+			context = nn->contexts[id];
+			if((NULL != context) && (context->nout > 0) && (context->out[0] == (void*)buffer) &&
+				(1 != rte_get_reader_number(nn, nn->network->layers[id])))
 			{
-				buffer = b;
-				break;
+				r = FALSE;
 			}
 		}
 	}
+#else
+	(void)nn; (void)layer; (void)i;
+#endif
+
+	return r;
+}
+
+int rte_cpu_create_layer_inplace(const nn_t* nn, const layer_t* layer, size_t ctx_sz, size_t type_sz)
+{
+	int r;
+	int i = 0;
+	const layer_t* const* inputs = layer->inputs;
+
+	while((NULL != (*inputs)) && (FALSE == rte_cpu_is_inplace(nn, layer, i)))
+	{
+		inputs++;
+		i++;
+	}
 
-	if(NULL == buffer)
+	if(NULL != (*inputs))
 	{
-		buffer = malloc(sizeof(rte_cpu_buffer_t));
-		if(NULL != buffer)
+		r = rte_cpu_create_layer_context(nn, layer, ctx_sz, 1);
+		if(0 == r)
 		{
-			buffer->owner = layer;
-			buffer->sz = sz;
-			buffer->data = NULL;
+			NNLOG(NN_DEBUG, ("%s: in place of %s\n", layer->name, (*inputs)->name));
+			rte_cpu_take_buffer(nn, LAYER_CONTEXT(nn, *inputs)->out[0], layer, 0);
+		}
+	}
+	else
+	{
+		r = rte_cpu_create_layer_common(nn, layer, ctx_sz, type_sz);
+	}
+
+	return r;
+}
 
-			STAILQ_INSERT_TAIL(&(rt->buffers), buffer, entry);
+int rte_cpu_create_layer_slice(const nn_t* nn, const layer_t* layer, size_t ctx_sz, int* pitch)
+{
+	int r;
+	const layer_t* concat = NULL;
+	layer_cpu_context_t* context;
+	rte_cpu_buffer_t* parent = NULL;
+	rte_cpu_buffer_t* view = NULL;
+	size_t offset = 0;
+	NHWC_t nhwc;
+	int id = nn_get_layer_id(nn, layer);
+
+#ifndef DISABLE_NN_CONCAT_SLICE
+	concat = cpu_get_concat_of(nn, layer, &offset, pitch);
+#endif
+	if(NULL == concat)
+	{
+		r = rte_cpu_create_layer_common(nn, layer, ctx_sz, sizeof(float));
+		if(0 == r)
+		{
+			*pitch = LAYER_CONTEXT(nn, layer)->nhwc.C;
 		}
 	}
 	else
 	{
-		buffer->owner = layer;
-		if(sz > buffer->sz)
+		r = rte_cpu_create_layer_context(nn, layer, ctx_sz, 1);
+		if(0 == r)
+		{
+			parent = cpu_find_concat_buffer(nn, concat);
+			if((NULL == parent) && (0 == layer_get_NHWC(concat, &nhwc)))
+			{
+				parent = rte_cpu_create_buffer(nn, concat, NHWC_SIZE(nhwc)*sizeof(float));
+			}
+			if(NULL != parent)
+			{
+				view = rte_cpu_create_buffer(nn, layer, 0);
+			}
+			if(NULL == view)
+			{
+				r = NN_E_NO_MEMORY;
+				rte_cpu_destory_layer_context(nn, layer);
+			}
+		}
+
+		if(0 == r)
 		{
-			buffer->sz = sz;
+			context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
+			view->parent = parent;
+			view->sz = NHWC_SIZE(context->nhwc)*sizeof(float);
+			view->offset = offset*sizeof(float);
+			if(id < parent->start)
+			{
+				parent->start = id;
+			}
+			context->out[0] = view;
+			NNLOG(NN_DEBUG, ("%s: write into %s at %d, pitch %d\n", layer->name, concat->name, (int)offset, *pitch));
 		}
 	}
 
-	return buffer;
+	return r;
 }
 
-void rte_cpu_take_buffer(rte_cpu_buffer_t* buffer, const layer_t* layer, int id)
+int rte_cpu_create_layer_concat(const nn_t* nn, const layer_t* layer, size_t ctx_sz, size_t type_sz)
 {
-	assert(buffer != NULL);
-	buffer->owner = layer;
-	assert(id < layer->C->context->nout);
-	layer->C->context->out[id] = buffer;
+	int r;
+	rte_cpu_buffer_t* buffer = cpu_find_concat_buffer(nn, layer);
+
+	if(NULL != buffer)
+	{
+		r = rte_cpu_create_layer_context(nn, layer, ctx_sz, 1);
+		if(0 == r)
+		{
+			LAYER_CONTEXT(nn, layer)->out[0] = buffer;
+		}
+	}
+	else
+	{
+		r = rte_cpu_create_layer_common(nn, layer, ctx_sz, type_sz);
+	}
+
+	return r;
 }
+#endif
 
-void rte_cpu_release_buffer(rte_cpu_buffer_t* buffer)
+
+const void* rte_cpu_select_kernel(const nn_t* nn, const alg_isa_kernel_t* kernels)
 {
-	assert(buffer != NULL);
-	buffer->owner = NULL;
-}
+	alg_isa_t isa;
+
+	if(RUNTIME_CPU == nn->runtime_type)
+	{
+		isa = ((rte_cpu_t*)nn->runtime)->isa;
+	}
+	else
+	{	/* a layer of another runtime that falls back to the CPU one */
+		isa = cpu_get_isa();
+	}
 
+	return alg_isa_select(kernels, isa);
+}
 
 void* rte_cpu_fetch_out0(const nn_t* nn, const layer_t* layer)
 {
 	layer_cpu_context_t* context;
-	context = (layer_cpu_context_t*)layer->C->context;
+	context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 	(void)nn;
 
 	return context->out[0];
@@ -470,8 +2277,11 @@ void rte_cpuq_to_cpu_float_init_common(const nn_t* nn, const layer_t* layer)
 	inputs = layer->inputs;
 	while(NULL != (*inputs))
 	{
-		context = (layer_cpu_context_t*)(*inputs)->C->context;
+		context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, *inputs);
 		scratch_size += sizeof(float)*NHWC_SIZE(context->nhwc) + sizeof(void*);
+		#ifndef DISABLE_NN_THREAD
+		cpu_sched_exclude_readers(nn, nn_get_layer_id(nn, layer), *inputs);
+		#endif
 		inputs++;
 	}
 
@@ -493,7 +2303,7 @@ int rte_cpuq_to_cpu_float_pre_execute_common(const nn_t* nn, const layer_t* laye
 	inputs = layer->inputs;
 	while(NULL != (*inputs))
 	{
-		context = (layer_cpu_context_t*)(*inputs)->C->context;
+		context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, *inputs);
 		*l_inputs++ = context->out[0];
 		inputs++;
 	}
@@ -503,7 +2313,7 @@ int rte_cpuq_to_cpu_float_pre_execute_common(const nn_t* nn, const layer_t* laye
 	inputs = layer->inputs;
 	while((NULL != (*inputs)) && (0 == r))
 	{
-		context = (layer_cpu_context_t*) (*inputs)->C->context;
+		context = (layer_cpu_context_t*) LAYER_CONTEXT(nn, *inputs);
 		switch(nn->network->type)
 		{
 			#if !defined(DISABLE_RUNTIME_CPU_Q8)
@@ -544,7 +2354,7 @@ void rte_cpuq_to_cpu_float_post_execute_common(const nn_t* nn, const layer_t* la
 	float* pf;
 
 	if( IS_LAYER_WITH_REAL_BUFFER(layer) ) {
-		context = (layer_cpu_context_t*)layer->C->context;
+		context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 		switch(nn->network->type)
 		{
 			#if !defined(DISABLE_RUNTIME_CPU_Q8)
@@ -579,7 +2389,7 @@ void rte_cpuq_to_cpu_float_post_execute_common(const nn_t* nn, const layer_t* la
 	inputs = layer->inputs;
 	while(NULL != (*inputs))
 	{
-		context = (layer_cpu_context_t*)(*inputs)->C->context;
+		context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, *inputs);
 		context->out[0] = *l_inputs++;
 		inputs++;
 	}
@@ -587,7 +2397,7 @@ void rte_cpuq_to_cpu_float_post_execute_common(const nn_t* nn, const layer_t* la
 
 void rte_cpuq_to_cpu_float_deinit_common(const nn_t* nn, const layer_t* layer)
 {
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 	if(NULL != context) {
 		#ifndef DISABLE_RUNTIME_OPENCL
 		if((RUNTIME_OPENCL == nn->runtime_type) &&
@@ -605,36 +2415,69 @@ void rte_cpuq_to_cpu_float_deinit_common(const nn_t* nn, const layer_t* layer)
 #endif /* DISABLE_RTE_FALLBACK */
 
 #ifndef DISABLE_DYNAMIC_SHAPE
-void rte_cpu_dynamic_reshape(const layer_t* layer, layer_cpu_context_t* input_context) {
+void rte_cpu_dynamic_reshape(const nn_t* nn, const layer_t* layer, layer_cpu_context_t* input_context) {
+	layer_context_t* context = LAYER_CONTEXT(nn, layer);
 	int axis = layer_get_dynamic_axis(layer);
+#ifndef DISABLE_NN_DYNAMIC_PLAN
+	rte_cpu_plan_layer_t* entry = cpu_get_plan_layer(nn, layer);
+	if((NULL != entry) && (CPU_PLAN_READY == ((rte_cpu_t*)nn->runtime)->plan->state)) {
+		context->nhwc = entry->nhwc;
+		return;
+	}
+#endif
 	if(axis > 0) {
-		layer_set_dynamic_shape(layer, axis, NHWC_SIZE(input_context->nhwc));
+		layer_set_dynamic_shape(nn, layer, axis, NHWC_SIZE(input_context->nhwc));
 	}
 
-	layer->C->context->nhwc.N = input_context->nhwc.N;
-	assert(NHWC_SIZE(input_context->nhwc) == NHWC_SIZE(layer->C->context->nhwc));
+	context->nhwc.N = input_context->nhwc.N;
+	assert(NHWC_SIZE(input_context->nhwc) == NHWC_SIZE(context->nhwc));
+#ifndef DISABLE_NN_DYNAMIC_PLAN
+	if(NULL != entry) {
+		entry->nhwc = context->nhwc;
+	}
+#endif
 }
 
-void rte_cpu_dynamic_shape_copy(const layer_t* layer, layer_cpu_context_t* input_context) {
-	layer->C->context->nhwc = input_context->nhwc;
+void rte_cpu_dynamic_shape_copy(const nn_t* nn, const layer_t* layer, layer_cpu_context_t* input_context) {
+	LAYER_CONTEXT(nn, layer)->nhwc = input_context->nhwc;
 }
 
-void rte_cpu_dynamic_batch(const layer_t* layer, layer_cpu_context_t* input_context) {
-	layer->C->context->nhwc.N = input_context->nhwc.N;
+void rte_cpu_dynamic_batch(const nn_t* nn, const layer_t* layer, layer_cpu_context_t* input_context) {
+	LAYER_CONTEXT(nn, layer)->nhwc.N = input_context->nhwc.N;
 }
 
-int rte_cpu_dynamic_memory(void** mem, size_t required, size_t* allocated, size_t type_sz)
+int rte_cpu_dynamic_memory(const nn_t* nn, const layer_t* layer, int i,
+		size_t required, size_t* allocated, size_t type_sz)
 {
 	int r = 0;
-
+	rte_cpu_t* rt = (rte_cpu_t*)nn->runtime;
+	void** mem = &(LAYER_CONTEXT(nn, layer)->out[i]);
+	size_t* allocations = &rt->allocations[nn_get_layer_id(nn, layer)];
+#ifndef DISABLE_NN_DYNAMIC_PLAN
+	rte_cpu_plan_layer_t* entry = cpu_get_plan_layer(nn, layer);
+
+	if((NULL != entry) && (i < 2)) {
+		if(CPU_PLAN_READY == rt->plan->state) {
+			assert(required*type_sz <= entry->size[i]);
+			*mem = (char*)rt->dynamic_arena + entry->offset[i];
+		} else {
+			entry->size[i] = required*type_sz;
+			entry->temp[i] = malloc(entry->size[i]);
+			*mem = entry->temp[i];
+			(*allocations) ++;
+		}
+	} else
+#endif
 	if(NULL == *mem) {
 		*mem = malloc(required*type_sz);
 		*allocated = required;
+		(*allocations) ++;
 	} else if(*allocated > 0) {
 		if(required > *allocated) {
 			free(*mem);
 			*mem = malloc(required*type_sz);
 			*allocated = required;
+			(*allocations) ++;
 		}
 	} else {
 		/* pass */
@@ -647,12 +2490,21 @@ int rte_cpu_dynamic_memory(void** mem, size_t required, size_t* allocated, size_
 	return r;
 }
 
-int rte_cpu_dynamic_conv2d_or_pool(const layer_t* layer,
+int rte_cpu_dynamic_conv2d_or_pool(const nn_t* nn, const layer_t* layer,
 		layer_cpu_context_t* context, layer_cpu_context_t* input_context,
 		int* padY, int* padX, int strideY, int strideX,
 		int knlY, int knlX) {
 	int r = 0;
 	int axis = layer_get_dynamic_axis(layer);
+#ifndef DISABLE_NN_DYNAMIC_PLAN
+	rte_cpu_plan_layer_t* entry = cpu_get_plan_layer(nn, layer);
+	if((NULL != entry) && (CPU_PLAN_READY == ((rte_cpu_t*)nn->runtime)->plan->state)) {
+		context->nhwc = entry->nhwc;
+		*padY = entry->padY;
+		*padX = entry->padX;
+		return r;
+	}
+#endif
 	assert(axis != 3);
 	if(axis > 0) {
 		assert(*padY == 0xdeadbeef);
@@ -668,7 +2520,7 @@ int rte_cpu_dynamic_conv2d_or_pool(const layer_t* layer,
 			context->nhwc.W = (input_context->nhwc.W-knlX)/strideX + 1;
 			*padY = *padX = 0;
 		}
-		NNLOG(NN_DEBUG, (" -> [%dx%dx%dx%d],", L_SHAPES(layer)));
+		NNLOG(NN_DEBUG, (" -> [%dx%dx%dx%d],", L_SHAPES(nn, layer)));
 	} else {
 		if(context->nhwc.N != input_context->nhwc.N) {
 			if(layer->dims[0] > input_context->nhwc.N) {
@@ -678,14 +2530,26 @@ int rte_cpu_dynamic_conv2d_or_pool(const layer_t* layer,
 			}
 		}
 	}
+#ifndef DISABLE_NN_DYNAMIC_PLAN
+	if(NULL != entry) {
+		entry->nhwc = context->nhwc;
+		entry->padY = *padY;
+		entry->padX = *padX;
+	}
+#endif
 	return r;
 }
-void rte_cpu_dynamic_free(const layer_t* layer)
+void rte_cpu_dynamic_free(const nn_t* nn, const layer_t* layer)
 {
 	int axis;
-	layer_cpu_context_t* context = (layer_cpu_context_t*)layer->C->context;
+	layer_cpu_context_t* context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 	if(NULL != context) {
 		axis = layer_get_dynamic_axis(layer);
+#ifndef DISABLE_NN_DYNAMIC_PLAN
+		if(((rte_cpu_t*)nn->runtime)->root >= 0) {
+			/* the memory is the one of the plans */
+		} else
+#endif
 		if(axis > 0) {
 			if(NULL != context->out[0]) free(context->out[0]);
 		}
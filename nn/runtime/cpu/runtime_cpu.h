@@ -6,6 +6,7 @@
 #define NN_RUNTIME_CPU_RUNTIME_CPU_H_
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include "nn.h"
+#include "cpu_isa.h"
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -71,6 +72,14 @@ typedef struct rte_cpu_buffer
 	const layer_t* owner;
 	void* data;
 	size_t sz;
+	/* lifetime in layer index [start, end] and the place in the arena, decided
+	 * by the memory planner once all the layers are initialized */
+	int start;
+	int end;
+	size_t offset;
+	/* not NULL for the slice of a CONCAT output that an input layer writes into,
+	 * then offset is the place in the parent and only the parent is planned */
+	struct rte_cpu_buffer* parent;
 } rte_cpu_buffer_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
@@ -81,30 +90,54 @@ int rte_cpu_create_layer_context(
 			size_t sz, size_t nout);
 void rte_cpu_destory_layer_context(const nn_t* nn, const layer_t* layer);
 void* rte_cpu_create_buffer(const nn_t* nn, const layer_t* layer, size_t sz);
-void rte_cpu_take_buffer(rte_cpu_buffer_t* buffer, const layer_t* layer, int id);
+void rte_cpu_take_buffer(const nn_t* nn, rte_cpu_buffer_t* buffer, const layer_t* layer, int id);
+/* as rte_cpu_take_buffer for a layer that passes the content along as it is (RESHAPE),
+ * it doesn't write so it doesn't wait for the other readers of the content */
+void rte_cpu_alias_buffer(const nn_t* nn, rte_cpu_buffer_t* buffer, const layer_t* layer, int id);
 void rte_cpu_release_buffer(rte_cpu_buffer_t* buffer);
+#ifndef DISABLE_RUNTIME_CPU_FLOAT
+/* TRUE if the float layer can write its output over the buffer of its input i: same
+ * size, not a network input or constant, and nobody else reads what is in it */
+int rte_cpu_is_inplace(const nn_t* nn, const layer_t* layer, int i);
+/* rte_cpu_create_layer_common, but taking the buffer of the first input that
+ * rte_cpu_is_inplace allows, if any */
+int rte_cpu_create_layer_inplace(const nn_t* nn, const layer_t* layer, size_t ctx_sz, size_t type_sz);
+/* rte_cpu_create_layer_common, but when the only reader is a CONCAT the output is
+ * its slice of the CONCAT output, so the CONCAT has nothing to copy for it. The
+ * output pixels are then *pitch floats apart instead of C, the layer must honor it */
+int rte_cpu_create_layer_slice(const nn_t* nn, const layer_t* layer, size_t ctx_sz, int* pitch);
+/* rte_cpu_create_layer_common for a CONCAT, sharing the output with the inputs
+ * created by rte_cpu_create_layer_slice */
+int rte_cpu_create_layer_concat(const nn_t* nn, const layer_t* layer, size_t ctx_sz, size_t type_sz);
+#endif
 
 int rte_cpu_create_layer_common(const nn_t* nn, const layer_t* layer, size_t ctx_sz, size_t type_sz);
 void* rte_cpu_fetch_out0(const nn_t* nn, const layer_t* layer);
+/* the best kernel of the table for the CPU this instance runs on, for a layer to
+ * bind at init, see alg_isa_select */
+const void* rte_cpu_select_kernel(const nn_t* nn, const alg_isa_kernel_t* kernels);
 
 #ifndef DISABLE_DYNAMIC_SHAPE
-void rte_cpu_dynamic_reshape(const layer_t* layer, layer_cpu_context_t* input_context);
-void rte_cpu_dynamic_shape_copy(const layer_t* layer, layer_cpu_context_t* input_context);
-void rte_cpu_dynamic_batch(const layer_t* layer, layer_cpu_context_t* input_context);
-int rte_cpu_dynamic_memory(void** mem, size_t required, size_t* allocated, size_t type_sz);
-int rte_cpu_dynamic_conv2d_or_pool(const layer_t* layer,
+void rte_cpu_dynamic_reshape(const nn_t* nn, const layer_t* layer, layer_cpu_context_t* input_context);
+void rte_cpu_dynamic_shape_copy(const nn_t* nn, const layer_t* layer, layer_cpu_context_t* input_context);
+void rte_cpu_dynamic_batch(const nn_t* nn, const layer_t* layer, layer_cpu_context_t* input_context);
+/* the memory of the output i of the layer at its current shape, from the plan of the
+ * input shape if the network has one, else grown in place as *allocated says */
+int rte_cpu_dynamic_memory(const nn_t* nn, const layer_t* layer, int i,
+		size_t required, size_t* allocated, size_t type_sz);
+int rte_cpu_dynamic_conv2d_or_pool(const nn_t* nn, const layer_t* layer,
 		layer_cpu_context_t* context, layer_cpu_context_t* input_context,
 		int* padY, int* padX, int strideY, int strideX,
 		int knlY, int knlX);
-void rte_cpu_dynamic_free(const layer_t* layer);
+void rte_cpu_dynamic_free(const nn_t* nn, const layer_t* layer);
 #else
-#define rte_cpu_dynamic_reshape(layer, input_context)
-#define rte_cpu_dynamic_shape_copy(layer, input_context)
-#define rte_cpu_dynamic_batch(layer, input_context)
-#define rte_cpu_dynamic_memory(mem, required, allocated, type_sz) 0
-#define rte_cpu_dynamic_conv2d(layer, context, input_context, \
+#define rte_cpu_dynamic_reshape(nn, layer, input_context)
+#define rte_cpu_dynamic_shape_copy(nn, layer, input_context)
+#define rte_cpu_dynamic_batch(nn, layer, input_context)
+#define rte_cpu_dynamic_memory(nn, layer, i, required, allocated, type_sz) 0
+#define rte_cpu_dynamic_conv2d(nn, layer, context, input_context, \
 	padY, padX, strideY, strideX, knlY, knlX, O, max, type_sz) 0
-#define rte_cpu_dynamic_free(layer)
+#define rte_cpu_dynamic_free(nn, layer)
 #endif
 
 #ifndef DISABLE_RTE_FALLBACK
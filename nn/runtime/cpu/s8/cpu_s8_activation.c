@@ -55,12 +55,12 @@ static int layer_cpu_s8_activation_init(const nn_t* nn, const layer_t* layer)
 	if(0 == r)
 	{
 		input = layer->inputs[0];
-		input_context = (layer_cpu_s8_context_t*)input->C->context;
+		input_context = (layer_cpu_s8_context_t*)LAYER_CONTEXT(nn, input);
 
 		if(NULL != input_context->out[0])
 		{
 			/* reuse its input layer's output buffer */
-			rte_cpu_take_buffer(input_context->out[0], layer, 0);
+			rte_cpu_take_buffer(nn, input_context->out[0], layer, 0);
 		}
 	}
 
@@ -70,13 +70,13 @@ static int layer_cpu_s8_activation_init(const nn_t* nn, const layer_t* layer)
 static int layer_cpu_s8_activation_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_s8_actvation_context_t* context = (layer_cpu_s8_actvation_context_t*)layer->C->context;
+	layer_cpu_s8_actvation_context_t* context = (layer_cpu_s8_actvation_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cpu_s8_context_t* input_context;
 	size_t sz = NHWC_SIZE(context->nhwc);
 	int8_t* IN;
 
-	input_context = (layer_cpu_s8_context_t*)input->C->context;
+	input_context = (layer_cpu_s8_context_t*)LAYER_CONTEXT(nn, input);
 
 	IN = (int8_t*)input_context->out[0];
 
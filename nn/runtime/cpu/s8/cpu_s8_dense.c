@@ -32,7 +32,7 @@ int layer_cpu_s8_DENSE_init(const nn_t* nn, const layer_t* layer)
 #if defined (ARM_MATH_DSP)
 	if(0 == r)
 	{
-		context = (layer_cpu_s8_dense_context_t*)layer->C->context;
+		context = (layer_cpu_s8_dense_context_t*)LAYER_CONTEXT(nn, layer);
 		context->bufferA = rte_cpu_create_buffer(nn, layer, RTE_FETCH_INT32(layer->blobs[0]->dims, 0)*sizeof(q15_t));
 
 		if(NULL == context->bufferA)
@@ -52,9 +52,9 @@ int layer_cpu_s8_DENSE_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_s8_DENSE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_s8_dense_context_t* context = (layer_cpu_s8_dense_context_t*)layer->C->context;
+	layer_cpu_s8_dense_context_t* context = (layer_cpu_s8_dense_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_s8_context_t* input_context = (layer_cpu_s8_context_t*)input->C->context;
+	layer_cpu_s8_context_t* input_context = (layer_cpu_s8_context_t*)LAYER_CONTEXT(nn, input);
 	int8_t *IN = (int8_t*)input_context->out[0];
 	int8_t *O = (int8_t*)context->out[0];
 	int8_t *weights = (int8_t*)layer->blobs[1]->blob;
@@ -6,10 +6,17 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_CPU_S8
 #include "../runtime_cpu.h"
-
+#include "thread_pool.h"
 #include "arm_math.h"
 #include "arm_nnfunctions.h"
 /* ============================ [ MACROS    ] ====================================================== */
+/* without the DSP extension arm_depthwise_conv_s8 is a plain loop with
+ * the bounds checked per tap, so x86 uses the kernels below */
+#if !defined(ARM_MATH_DSP)
+#define DWCONV2D_USE_KERNEL
+/* the accumulators of a border pixel are done this many channels at a time */
+#define DWCONV2D_CB 64
+#endif
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CPU_S8_CONTEXT_MEMBER;
@@ -17,9 +24,151 @@ typedef struct {
 	rte_cpu_buffer_t* bufferA;
 #endif
 } layer_cpu_s8_dwconv2d_context_t;
+
+#ifdef DWCONV2D_USE_KERNEL
+typedef struct {
+	const int8_t* IN;
+	int8_t* O;
+	const int8_t* weights;
+	const int32_t* bias;
+	const NHWC_t* inhwc;
+	const NHWC_t* onhwc;
+	int knlX, knlY, padX, padY, strideX, strideY;
+	const int32_t* mult;
+	const int32_t* shift;
+	int input_offset;
+	int output_offset;
+} dwconv2d_task_t;
+#endif
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
+#ifdef DWCONV2D_USE_KERNEL
+/* one output pixel, only the taps inside the input are visited */
+static void dwconv2d_pixel(const dwconv2d_task_t* t, const int8_t* in, int8_t* out, int y, int x)
+{
+	const int C = t->onhwc->C;
+	const int iy0 = y*t->strideY - t->padY;
+	const int ix0 = x*t->strideX - t->padX;
+	const int ky0 = NN_MAX(0, -iy0);
+	const int kx0 = NN_MAX(0, -ix0);
+	const int ky1 = NN_MIN(t->knlY, t->inhwc->H - iy0);
+	const int kx1 = NN_MIN(t->knlX, t->inhwc->W - ix0);
+	q31_t acc[DWCONV2D_CB];
+	const int8_t* src;
+	const int8_t* w;
+	int cb, n, c, ky, kx;
+
+	for(cb=0; cb<C; cb+=DWCONV2D_CB)
+	{
+		n = NN_MIN(DWCONV2D_CB, C-cb);
+		for(c=0; c<n; c++)
+		{
+			acc[c] = t->bias[cb+c];
+		}
+		for(ky=ky0; ky<ky1; ky++)
+		{
+			for(kx=kx0; kx<kx1; kx++)
+			{
+				src = in + ((iy0+ky)*t->inhwc->W + ix0+kx)*C + cb;
+				w = t->weights + (ky*t->knlX+kx)*C + cb;
+				for(c=0; c<n; c++)
+				{
+					acc[c] += (src[c] + t->input_offset)*w[c];
+				}
+			}
+		}
+		for(c=0; c<n; c++)
+		{
+			acc[c] = arm_nn_requantize(acc[c], t->mult[cb+c], t->shift[cb+c]) + t->output_offset;
+			out[cb+c] = (int8_t)NN_MIN(NN_MAX(acc[c], INT8_MIN), INT8_MAX);
+		}
+	}
+}
+
+/* 3x3 output pixels [x0, x1) of a row, all the taps are inside the input */
+static void dwconv2d_3x3_interior(const dwconv2d_task_t* t, const int8_t* in, int8_t* out, int y, int x0, int x1)
+{
+	const int C = t->onhwc->C;
+	const int8_t* w = t->weights;
+	const int8_t* r0;
+	const int8_t* r1;
+	const int8_t* r2;
+	int8_t* o;
+	q31_t acc;
+	int x, c;
+
+	r0 = in + ((y*t->strideY-t->padY)*t->inhwc->W + x0*t->strideX-t->padX)*C;
+	r1 = r0 + t->inhwc->W*C;
+	r2 = r1 + t->inhwc->W*C;
+	o = out + x0*C;
+
+	for(x=x0; x<x1; x++)
+	{
+		for(c=0; c<C; c++)
+		{
+			acc = t->bias[c];
+			acc += (r0[c] + t->input_offset)*w[c];
+			acc += (r0[C+c] + t->input_offset)*w[C+c];
+			acc += (r0[2*C+c] + t->input_offset)*w[2*C+c];
+			acc += (r1[c] + t->input_offset)*w[3*C+c];
+			acc += (r1[C+c] + t->input_offset)*w[4*C+c];
+			acc += (r1[2*C+c] + t->input_offset)*w[5*C+c];
+			acc += (r2[c] + t->input_offset)*w[6*C+c];
+			acc += (r2[C+c] + t->input_offset)*w[7*C+c];
+			acc += (r2[2*C+c] + t->input_offset)*w[8*C+c];
+			acc = arm_nn_requantize(acc, t->mult[c], t->shift[c]) + t->output_offset;
+			o[c] = (int8_t)NN_MIN(NN_MAX(acc, INT8_MIN), INT8_MAX);
+		}
+		r0 += t->strideX*C;
+		r1 += t->strideX*C;
+		r2 += t->strideX*C;
+		o += C;
+	}
+}
+
+/* each work item is one output row of one batch, see the float DWCONV2D */
+static void dwconv2d_task(void* param, size_t start, size_t end)
+{
+	const dwconv2d_task_t* t = (const dwconv2d_task_t*)param;
+	const int fast = (3 == t->knlX) && (3 == t->knlY) && (t->strideX <= 2) && (t->strideY <= 2);
+	const int8_t* in;
+	int8_t* out;
+	int batch, y, x, x0, x1, iy;
+
+	x0 = (t->padX + t->strideX - 1) / t->strideX;
+	x1 = (t->inhwc->W - t->knlX + t->padX) / t->strideX + 1;
+	x1 = NN_MAX(x0, NN_MIN(x1, t->onhwc->W));
+
+	for(; start < end; start++)
+	{
+		batch = (int)(start / t->onhwc->H);
+		y = (int)(start % t->onhwc->H);
+		in = t->IN + NHWC_BATCH_SIZE(*t->inhwc)*batch;
+		out = t->O + NHWC_BATCH_SIZE(*t->onhwc)*batch + y*t->onhwc->W*t->onhwc->C;
+		iy = y*t->strideY - t->padY;
+		if(fast && (iy >= 0) && ((iy + t->knlY) <= t->inhwc->H) && (x0 < x1))
+		{
+			for(x=0; x<x0; x++)
+			{
+				dwconv2d_pixel(t, in, out+x*t->onhwc->C, y, x);
+			}
+			dwconv2d_3x3_interior(t, in, out, y, x0, x1);
+			for(x=x1; x<t->onhwc->W; x++)
+			{
+				dwconv2d_pixel(t, in, out+x*t->onhwc->C, y, x);
+			}
+		}
+		else
+		{
+			for(x=0; x<t->onhwc->W; x++)
+			{
+				dwconv2d_pixel(t, in, out+x*t->onhwc->C, y, x);
+			}
+		}
+	}
+}
+#endif
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cpu_s8_DWCONV2D_init(const nn_t* nn, const layer_t* layer)
 {
@@ -34,7 +183,7 @@ int layer_cpu_s8_DWCONV2D_init(const nn_t* nn, const layer_t* layer)
 #if defined (ARM_MATH_DSP)
 	if(0 == r)
 	{
-		context = (layer_cpu_s8_dwconv2d_context_t*)layer->C->context;
+		context = (layer_cpu_s8_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
 
 		ints = (int*)layer->blobs[1]->dims;	/* W in format FHWC */
 
@@ -57,15 +206,18 @@ int layer_cpu_s8_DWCONV2D_init(const nn_t* nn, const layer_t* layer)
 int layer_cpu_s8_DWCONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_s8_dwconv2d_context_t* context = (layer_cpu_s8_dwconv2d_context_t*)layer->C->context;
+	layer_cpu_s8_dwconv2d_context_t* context = (layer_cpu_s8_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_s8_context_t* input_context = (layer_cpu_s8_context_t*)input->C->context;
+	layer_cpu_s8_context_t* input_context = (layer_cpu_s8_context_t*)LAYER_CONTEXT(nn, input);
 	int8_t *IN = (int8_t*)input_context->out[0];
 	int8_t *O = (int8_t*)context->out[0];
 	int8_t *weights = (int8_t*)layer->blobs[1]->blob;
 	int32_t *bias = (int32_t*)layer->blobs[2]->blob;
 	int knlX, knlY, padX, padY, strideX, strideY;
 	int* ints;
+#ifdef DWCONV2D_USE_KERNEL
+	dwconv2d_task_t task;
+#endif
 	int omin;
 
 	size_t batch;
@@ -88,6 +240,30 @@ int layer_cpu_s8_DWCONV2D_execute(const nn_t* nn, const layer_t* layer)
 			knlY, knlX, padY, padX, strideY, strideX,
 			LAYER_Z(layer), LAYER_Q(input), LAYER_Q(layer)));
 
+#ifdef DWCONV2D_USE_KERNEL
+	if(input_context->nhwc.C == context->nhwc.C)
+	{
+		task.IN = IN;
+		task.O = O;
+		task.weights = weights;
+		task.bias = bias;
+		task.inhwc = &input_context->nhwc;
+		task.onhwc = &context->nhwc;
+		task.knlX = knlX;
+		task.knlY = knlY;
+		task.padX = padX;
+		task.padY = padY;
+		task.strideX = strideX;
+		task.strideY = strideY;
+		task.mult = (const int32_t*)layer->blobs[4]->blob;
+		task.shift = (const int32_t*)layer->blobs[5]->blob;
+		task.input_offset = LAYER_Z(input);
+		task.output_offset = -LAYER_Z(layer);
+		thread_pool_parallel_for(nn->tpool, input_context->nhwc.N*context->nhwc.H, dwconv2d_task, &task);
+		return r;
+	}
+#endif
+
 	for(batch=0; (batch<input_context->nhwc.N) && (0 == r); batch++)
 	{
 		r = arm_depthwise_conv_s8_opt(IN+batch_sizeIn*batch,
@@ -123,9 +299,9 @@ int layer_cpu_s8_DWCONV2D_execute(const nn_t* nn, const layer_t* layer)
 int layer_cpu_s8_DWCONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cpu_s8_dwconv2d_context_t* context = (layer_cpu_s8_dwconv2d_context_t*)layer->C->context;
+	layer_cpu_s8_dwconv2d_context_t* context = (layer_cpu_s8_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cpu_s8_context_t* input_context = (layer_cpu_s8_context_t*)input->C->context;
+	layer_cpu_s8_context_t* input_context = (layer_cpu_s8_context_t*)LAYER_CONTEXT(nn, input);
 	int8_t *IN = (int8_t*)input_context->out[0];
 	int8_t *O = (int8_t*)context->out[0];
 	int8_t *kernel = (int8_t*)layer->blobs[1]->blob;
@@ -33,8 +33,8 @@ extern "C" int layer_halide_CONV2D_init(const nn_t* nn, const layer_t* layer)
 	r = rte_halide_create_layer_common(nn, layer, sizeof(layer_halide_conv2d_context_t));
 
 	if(0 == r) {
-		input_context = (layer_halide_context_t*)layer->inputs[0]->C->context;
-		context = (layer_halide_conv2d_context_t*) layer->C->context;
+		input_context = (layer_halide_context_t*)LAYER_CONTEXT(nn, layer->inputs[0]);
+		context = (layer_halide_conv2d_context_t*) LAYER_CONTEXT(nn, layer);
 		context->HL_Convolution = (HL_Convolution_t)halide_load_algorithm("HL_Convolution", &context->dll);
 	}
 
@@ -80,8 +80,8 @@ extern "C" int layer_halide_CONV2D_init(const nn_t* nn, const layer_t* layer)
 extern "C" int layer_halide_CONV2D_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_halide_context_t* input_context = (layer_halide_context_t*)layer->inputs[0]->C->context;
-	layer_halide_conv2d_context_t* context = (layer_halide_conv2d_context_t*)layer->C->context;
+	layer_halide_context_t* input_context = (layer_halide_context_t*)LAYER_CONTEXT(nn, layer->inputs[0]);
+	layer_halide_conv2d_context_t* context = (layer_halide_conv2d_context_t*)LAYER_CONTEXT(nn, layer);
 	float* in = (float*)input_context->out[0];
 	float* out = (float*)context->out[0];
 
@@ -109,7 +109,7 @@ extern "C" int layer_halide_CONV2D_execute(const nn_t* nn, const layer_t* layer)
 
 extern "C" void layer_halide_CONV2D_deinit(const nn_t* nn, const layer_t* layer)
 {
-	layer_halide_conv2d_context_t* context = (layer_halide_conv2d_context_t*)layer->C->context;
+	layer_halide_conv2d_context_t* context = (layer_halide_conv2d_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
@@ -5,6 +5,7 @@
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include "runtime_halide.h"
 #include "runtime_cpu.h"
+#include "profile.h"
 /* ============================ [ MACROS    ] ====================================================== */
 #ifdef _WIN32
 #define BUILD_DIR "build/nt/"
@@ -88,11 +89,16 @@ static int halide_init_layer(const nn_t* nn, const layer_t* layer)
 static int halide_execute_layer(const nn_t* nn, const layer_t* layer)
 {
 	int r = NN_E_INVALID_LAYER;
+#ifndef DISABLE_NN_PROFILE
+	uint64_t start = 0;
+#endif
 
 	if(layer->op < ARRAY_SIZE(halide_lops))
 	{
-		NNLOG(NN_DEBUG, ("execute %s: [%dx%dx%dx%d]\n", layer->name, L_SHAPES(layer)));
+		NNLOG(NN_DEBUG, ("execute %s: [%dx%dx%dx%d]\n", layer->name, L_SHAPES(nn, layer)));
+		RTE_PROFILE_START(nn, start);
 		r = halide_lops[layer->op].execute(nn, layer);
+		RTE_PROFILE_STOP(nn, layer, start);
 		NNDDO(NN_DEBUG, rte_ddo_save(nn, layer));
 	}
 
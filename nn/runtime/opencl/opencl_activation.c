@@ -43,7 +43,7 @@ static int layer_cl_activation_init(const nn_t* nn, const layer_t* layer)
 
 	if((0 == r) && (L_OP_PRELU == layer->op))
 	{
-		context = (layer_cl_activation_context_t*)layer->C->context;
+		context = (layer_cl_activation_context_t*)LAYER_CONTEXT(nn, layer);
 
 		context->W = rte_cl_create_image2d_from_blob(nn, layer->blobs[0]);
 		if(NULL == context->W)
@@ -57,11 +57,11 @@ static int layer_cl_activation_init(const nn_t* nn, const layer_t* layer)
 static int layer_cl_activation_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_activation_context_t* context = (layer_cl_activation_context_t*)layer->C->context;
+	layer_cl_activation_context_t* context = (layer_cl_activation_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	switch(layer->op) {
 		case L_OP_RELU:
@@ -103,7 +103,7 @@ static void layer_cl_activation_deinit(const nn_t* nn, const layer_t* layer)
 {
 	layer_cl_activation_context_t* context;
 
-	context = (layer_cl_activation_context_t*)layer->C->context;
+	context = (layer_cl_activation_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
@@ -11,38 +11,58 @@
 /* ============================ [ TYPES     ] ====================================================== */
 typedef struct {
 	LAYER_CL_CONTEXT_MEMBER;
-	cl_mem scale;
-	cl_mem bias;
-	cl_mem mean;
-	cl_mem var;
+	/* y = x*a[c] + b[c], NULL if folded into its input */
+	cl_mem a;
+	cl_mem b;
 } layer_cl_batchnorm_context_t;
 /* ============================ [ DECLARES  ] ====================================================== */
 /* ============================ [ DATAS     ] ====================================================== */
 /* ============================ [ LOCALS    ] ====================================================== */
+static int batchnorm_create_affine(const nn_t* nn, const layer_t* layer, layer_cl_batchnorm_context_t* context)
+{
+	int r = 0;
+	int C = layer->blobs[0]->dims[0];
+	float* a = malloc(2*C*sizeof(float));
+
+	if(NULL != a)
+	{
+		layer_blob_t A = { layer->blobs[0]->dims, L_DT_FLOAT, a };
+		layer_blob_t B = { layer->blobs[0]->dims, L_DT_FLOAT, a+C };
+		rte_get_bn_affine(layer, a, a+C);
+		context->a = rte_cl_create_image2d_from_blob(nn, &A);
+		context->b = rte_cl_create_image2d_from_blob(nn, &B);
+		free(a);
+	}
+
+	if((NULL == context->a) || (NULL == context->b))
+	{
+		r = NN_E_NO_MEMORY;
+	}
+
+	return r;
+}
 /* ============================ [ FUNCTIONS ] ====================================================== */
 int layer_cl_BATCHNORM_init(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
 	layer_cl_batchnorm_context_t* context;
 
-	r = rte_cl_create_layer_common(nn, layer,
-			OPENCL_PATH "batchnorm.cl", "batchnorm", NULL,
-			sizeof(layer_cl_batchnorm_context_t));
-
-	if(0 == r)
+	if(rte_is_bn_folded(nn, layer))
+	{	/* the output is the image of the input, bound by set_args */
+		r = rte_cl_create_layer_context(nn, layer, NULL, NULL, NULL,
+				sizeof(layer_cl_batchnorm_context_t), 1);
+		NNLOG(NN_DEBUG, ("%s: folded into %s\n", layer->name, layer->inputs[0]->name));
+	}
+	else
 	{
-		context = (layer_cl_batchnorm_context_t*)layer->C->context;
-		context->scale = rte_cl_create_image2d_from_blob(nn, layer->blobs[0]);
-		context->bias = rte_cl_create_image2d_from_blob(nn, layer->blobs[1]);
-		context->var = rte_cl_create_image2d_from_blob(nn, layer->blobs[2]);
-		context->mean = rte_cl_create_image2d_from_blob(nn, layer->blobs[3]);
+		r = rte_cl_create_layer_common(nn, layer,
+				OPENCL_PATH "batchnorm.cl", "batchnorm", NULL,
+				sizeof(layer_cl_batchnorm_context_t));
 
-		if( (NULL == context->scale) ||
-			(NULL == context->bias) ||
-			(NULL == context->mean) ||
-			(NULL == context->var) )
+		if(0 == r)
 		{
-			r = NN_E_NO_MEMORY;
+			context = (layer_cl_batchnorm_context_t*)LAYER_CONTEXT(nn, layer);
+			r = batchnorm_create_affine(nn, layer, context);
 		}
 	}
 
@@ -52,43 +72,54 @@ int layer_cl_BATCHNORM_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_BATCHNORM_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_batchnorm_context_t* context = (layer_cl_batchnorm_context_t*)layer->C->context;
+	layer_cl_batchnorm_context_t* context = (layer_cl_batchnorm_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
-	layer_cl_context_t* input_context = (layer_cl_context_t*)input->C->context;
-	float epsilon = RTE_FETCH_FLOAT(layer->blobs[4]->blob, 0);
+	layer_cl_context_t* input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 	int nC4 = (context->nhwc.C+3)>>2;
 
-	NNLOG(NN_DEBUG, ("execute %s\n", layer->name));
-
-	r = rte_cl_set_layer_args(nn, layer, 0, 8,
+	if(NULL == context->kernel)
+	{
+		context->out[0] = input_context->out[0];
+	}
+	else
+	{
+		r = rte_cl_set_layer_args(nn, layer, 0, 5,
 					sizeof(cl_mem), &(input_context->out[0]),
-					sizeof(cl_mem), &(context->scale),
-					sizeof(cl_mem), &(context->bias),
-					sizeof(cl_mem), &(context->mean),
-					sizeof(cl_mem), &(context->var),
+					sizeof(cl_mem), &(context->a),
+					sizeof(cl_mem), &(context->b),
 					sizeof(cl_mem), &(context->out[0]),
-					sizeof(float), &epsilon,
 					sizeof(int), &nC4
 					);
+	}
 
 	return r;
 }
 
 int layer_cl_BATCHNORM_execute(const nn_t* nn, const layer_t* layer)
 {
-	return rte_cl_execute_layer(nn, layer, RTE_GWT_CL_W_H, FALSE, NULL);
+	int r = 0;
+	layer_cl_batchnorm_context_t* context = (layer_cl_batchnorm_context_t*)LAYER_CONTEXT(nn, layer);
+
+	if(NULL != context->kernel)
+	{
+		r = rte_cl_execute_layer(nn, layer, RTE_GWT_CL_W_H, FALSE, NULL);
+	}
+
+	return r;
 }
 
 void layer_cl_BATCHNORM_deinit(const nn_t* nn, const layer_t* layer)
 {
-	layer_cl_batchnorm_context_t* context = (layer_cl_batchnorm_context_t*)layer->C->context;
+	layer_cl_batchnorm_context_t* context = (layer_cl_batchnorm_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(context != NULL)
 	{
-		rte_cl_destory_memory(context->scale);
-		rte_cl_destory_memory(context->bias);
-		rte_cl_destory_memory(context->mean);
-		rte_cl_destory_memory(context->var);
+		rte_cl_destory_memory(context->a);
+		rte_cl_destory_memory(context->b);
+		if(NULL == context->kernel)
+		{	/* owned by the input */
+			context->out[0] = NULL;
+		}
 	}
 	rte_cl_destory_layer_context(nn, layer);
 }
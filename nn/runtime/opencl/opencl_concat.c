@@ -19,7 +19,7 @@ void* cl_concat_fetch_out0(const nn_t* nn, const layer_t* layer)
 {
 	int r;
 	float* pout = (float*)nn->scratch.area;
-	layer_cl_context_t* context = (layer_cl_context_t*)layer->C->context;
+	layer_cl_context_t* context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 
 	r = rte_cl_image2d_copy_out(nn, context->out[0], pout, &(context->nhwc));
 
@@ -57,7 +57,7 @@ int layer_cl_CONCAT_init(const nn_t* nn, const layer_t* layer)
 			kernel = "concat_depth";
 			while((0==r) && ((*input) != NULL))
 			{
-				input_context = (layer_cl_context_t*)(*input)->C->context;
+				input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, *input);
 				if(0 != (input_context->nhwc.C&0x03))
 				{	/* fall back to CPU */
 					program = NULL;
@@ -86,7 +86,7 @@ int layer_cl_CONCAT_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cl_concat_context_t*)layer->C->context;
+		context = (layer_cl_concat_context_t*)LAYER_CONTEXT(nn, layer);
 		if(0 != scratch_size)
 		{
 			scratch_size += NHWC_SIZE(context->nhwc);
@@ -105,7 +105,7 @@ int layer_cl_CONCAT_set_args(const nn_t* nn, const layer_t* layer)
 int layer_cl_CONCAT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_concat_context_t* context = (layer_cl_concat_context_t*)layer->C->context;
+	layer_cl_concat_context_t* context = (layer_cl_concat_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t** input = layer->inputs;
 	layer_cl_context_t* input_context;
 
@@ -117,7 +117,7 @@ int layer_cl_CONCAT_execute(const nn_t* nn, const layer_t* layer)
 
 	while((0==r) && ((*input) != NULL) && (NULL != context->kernel))
 	{
-		input_context = (layer_cl_context_t*)(*input)->C->context;
+		input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, *input);
 		in_stride = RTE_FETCH_INT32(&(input_context->nhwc), axis);
 
 		NNLOG(NN_DEBUG, ("  cl concat %s, in stride=%d\n", (*input)->name, in_stride));
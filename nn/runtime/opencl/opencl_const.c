@@ -25,7 +25,7 @@ int layer_cl_CONST_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cl_const_context_t*)layer->C->context;
+		context = (layer_cl_const_context_t*)LAYER_CONTEXT(nn, layer);
 
 		context->C = rte_cl_create_image2d_from_blob(nn, layer->blobs[0]);
 	}
@@ -41,7 +41,7 @@ int layer_cl_CONST_set_args(const nn_t* nn, const layer_t* layer)
 int layer_cl_CONST_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_const_context_t* context = (layer_cl_const_context_t*)layer->C->context;
+	layer_cl_const_context_t* context = (layer_cl_const_context_t*)LAYER_CONTEXT(nn, layer);
 
 	context->out[0] = context->C;
 
@@ -52,7 +52,7 @@ void layer_cl_CONST_deinit(const nn_t* nn, const layer_t* layer)
 {
 	layer_cl_const_context_t* context;
 
-	context = (layer_cl_const_context_t*)layer->C->context;
+	context = (layer_cl_const_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
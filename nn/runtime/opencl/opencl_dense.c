@@ -29,14 +29,9 @@ int layer_cl_DENSE_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cl_dense_context_t*)layer->C->context;
-
-		context->W = rte_cl_create_image2d_from_blob(nn, layer->blobs[0]);
-		context->B = rte_cl_create_image2d_from_blob(nn, layer->blobs[1]);
-		if((NULL == context->W) || (NULL == context->B))
-		{
-			r = NN_E_NO_MEMORY;
-		}
+		context = (layer_cl_dense_context_t*)LAYER_CONTEXT(nn, layer);
+
+		r = rte_cl_create_weights_and_bias(nn, layer, &(context->W), &(context->B));
 	}
 
 	return r;
@@ -45,11 +40,11 @@ int layer_cl_DENSE_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_DENSE_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_dense_context_t* context = (layer_cl_dense_context_t*)layer->C->context;
+	layer_cl_dense_context_t* context = (layer_cl_dense_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 
 	r = rte_cl_set_layer_args(nn, layer, RTE_CL_ARGS_WITH_NC, 5,
@@ -71,7 +66,7 @@ void layer_cl_DENSE_deinit(const nn_t* nn, const layer_t* layer)
 {
 	layer_cl_dense_context_t* context;
 
-	context = (layer_cl_dense_context_t*)layer->C->context;
+	context = (layer_cl_dense_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
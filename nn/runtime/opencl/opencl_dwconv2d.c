@@ -29,14 +29,9 @@ int layer_cl_DWCONV2D_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cl_dwconv2d_context_t*)layer->C->context;
-
-		context->W = rte_cl_create_image2d_from_blob(nn, layer->blobs[0]);
-		context->B = rte_cl_create_image2d_from_blob(nn, layer->blobs[1]);
-		if((NULL == context->W) || (NULL == context->B))
-		{
-			r = NN_E_NO_MEMORY;
-		}
+		context = (layer_cl_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
+
+		r = rte_cl_create_weights_and_bias(nn, layer, &(context->W), &(context->B));
 	}
 
 	return r;
@@ -44,13 +39,13 @@ int layer_cl_DWCONV2D_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_DWCONV2D_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_dwconv2d_context_t* context = (layer_cl_dwconv2d_context_t*)layer->C->context;
+	layer_cl_dwconv2d_context_t* context = (layer_cl_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 	int knlX, knlY, padX, padY, strideX, strideY;
 	int* ints;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	ints = (int*)layer->blobs[0]->dims;
 	knlY = ints[1];
@@ -90,7 +85,7 @@ void layer_cl_DWCONV2D_deinit(const nn_t* nn, const layer_t* layer)
 {
 	layer_cl_dwconv2d_context_t* context;
 
-	context = (layer_cl_dwconv2d_context_t*)layer->C->context;
+	context = (layer_cl_dwconv2d_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
@@ -24,8 +24,8 @@ static int layer_cl_eltwise_init(const nn_t* nn, const layer_t* layer)
 	const char* kernel;
 	layer_cl_eltwise_context_t* context;
 	alg_broadcast_t broadcast = ALG_BROADCAST_NONE;
-	layer_context_t* inputA_context = (layer_context_t*)layer->inputs[0]->C->context;
-	layer_context_t* inputB_context = (layer_context_t*)layer->inputs[1]->C->context;
+	layer_context_t* inputA_context = (layer_context_t*)LAYER_CONTEXT(nn, layer->inputs[0]);
+	layer_context_t* inputB_context = (layer_context_t*)LAYER_CONTEXT(nn, layer->inputs[1]);
 	r = alg_broadcast_prepare(&inputA_context, &inputB_context, &broadcast);
 
 	if(0 == r) {
@@ -78,7 +78,7 @@ static int layer_cl_eltwise_init(const nn_t* nn, const layer_t* layer)
 	}
 
 	if(0 == r) {
-		context = (layer_cl_eltwise_context_t*)layer->C->context;
+		context = (layer_cl_eltwise_context_t*)LAYER_CONTEXT(nn, layer);
 		context->broadcast = broadcast;
 		context->inputA_context = inputA_context;
 		context->inputB_context = inputB_context;
@@ -90,7 +90,7 @@ static int layer_cl_eltwise_init(const nn_t* nn, const layer_t* layer)
 static int layer_cl_eltwise_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_eltwise_context_t* context = (layer_cl_eltwise_context_t*)layer->C->context;
+	layer_cl_eltwise_context_t* context = (layer_cl_eltwise_context_t*)LAYER_CONTEXT(nn, layer);
 	alg_broadcast_t broadcast = context->broadcast;
 	layer_cl_context_t* inputA_context = (layer_cl_context_t*)context->inputA_context;
 	layer_cl_context_t* inputB_context = (layer_cl_context_t*)context->inputB_context;
@@ -27,7 +27,7 @@ int layer_cl_INPUT_init(const nn_t* nn, const layer_t* layer)
 				sizeof(layer_cl_input_context_t));
 	if(0 == r)
 	{
-		context = (layer_cl_input_context_t*)layer->C->context;
+		context = (layer_cl_input_context_t*)LAYER_CONTEXT(nn, layer);
 		context->in = NULL;
 	}
 
@@ -42,7 +42,7 @@ int layer_cl_INPUT_set_args(const nn_t* nn, const layer_t* layer)
 int layer_cl_INPUT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_input_context_t* context = (layer_cl_input_context_t*)layer->C->context;
+	layer_cl_input_context_t* context = (layer_cl_input_context_t*)LAYER_CONTEXT(nn, layer);
 	float* data;
 
 	data = (float*) nn_get_input_data(nn, layer);
@@ -81,7 +81,7 @@ int layer_cl_INPUT_execute(const nn_t* nn, const layer_t* layer)
 
 void layer_cl_INPUT_deinit(const nn_t* nn, const layer_t* layer)
 {
-	layer_cl_input_context_t* context = (layer_cl_input_context_t*)layer->C->context;
+	layer_cl_input_context_t* context = (layer_cl_input_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
@@ -27,9 +27,9 @@ int layer_cl_OUTPUT_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cl_output_context_t*)layer->C->context;
+		context = (layer_cl_output_context_t*)LAYER_CONTEXT(nn, layer);
 
-		RTE_CL_LOG_LAYER_SHAPE(layer);
+		RTE_CL_LOG_LAYER_SHAPE(nn, layer);
 
 		context->out[0] = rte_cl_create_buffer(nn,
 							NHWC_SIZE(context->nhwc),
@@ -48,11 +48,11 @@ int layer_cl_OUTPUT_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_OUTPUT_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_output_context_t* context = (layer_cl_output_context_t*)layer->C->context;
+	layer_cl_output_context_t* context = (layer_cl_output_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	r = rte_cl_set_layer_args(nn, layer, RTE_CL_ARGS_WITH_NHWC, 2,
 					sizeof(cl_mem), &(input_context->out[0]),
@@ -64,7 +64,7 @@ int layer_cl_OUTPUT_set_args(const nn_t* nn, const layer_t* layer)
 int layer_cl_OUTPUT_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_output_context_t* context = (layer_cl_output_context_t*)layer->C->context;
+	layer_cl_output_context_t* context = (layer_cl_output_context_t*)LAYER_CONTEXT(nn, layer);
 	float* data;
 
 	data = (float*) nn_get_output_data(nn, layer);
@@ -25,7 +25,7 @@ int layer_cl_PAD_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_PAD_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_pad_context_t* context = (layer_cl_pad_context_t*)layer->C->context;
+	layer_cl_pad_context_t* context = (layer_cl_pad_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 
@@ -36,7 +36,7 @@ int layer_cl_PAD_set_args(const nn_t* nn, const layer_t* layer)
 	int padding_left = ints[2];
 	int padding_right = ints[6];
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	r = rte_cl_set_layer_args(nn, layer, RTE_CL_ARGS_WITH_NHWC, 6,
 				sizeof(cl_mem), &(input_context->out[0]),
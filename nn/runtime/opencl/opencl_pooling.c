@@ -46,9 +46,9 @@ static int layer_cl_pooling_init(const nn_t* nn, const layer_t* layer)
 				sizeof(layer_cl_pooling_context_t), nout);
 
 	if(0 == r) {
-		context = (layer_cl_pooling_context_t*)layer->C->context;
+		context = (layer_cl_pooling_context_t*)LAYER_CONTEXT(nn, layer);
 
-		RTE_CL_LOG_LAYER_SHAPE(layer);
+		RTE_CL_LOG_LAYER_SHAPE(nn, layer);
 		#ifdef ENABLE_CL_IMAGE_REUSE
 		context->out[0] = (cl_mem)rte_cl_alloc_image2d(nn, layer,
 		#else
@@ -89,14 +89,14 @@ static int layer_cl_pooling_init(const nn_t* nn, const layer_t* layer)
 static int layer_cl_pooling_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_pooling_context_t* context = (layer_cl_pooling_context_t*)layer->C->context;
+	layer_cl_pooling_context_t* context = (layer_cl_pooling_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 	int knlX, knlY, padX, padY, strideX, strideY;
 	int* ints;
 	int with_mask;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	ints = (int*)layer->blobs[0]->blob;
 	knlY = ints[0];
@@ -26,7 +26,7 @@ int layer_cl_RESHAPE_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cl_reshape_context_t*)layer->C->context;
+		context = (layer_cl_reshape_context_t*)LAYER_CONTEXT(nn, layer);
 		nn_request_scratch(nn, NHWC_SIZE(context->nhwc)*sizeof(float));
 	}
 
@@ -36,11 +36,11 @@ int layer_cl_RESHAPE_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_RESHAPE_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_reshape_context_t* context = (layer_cl_reshape_context_t*)layer->C->context;
+	layer_cl_reshape_context_t* context = (layer_cl_reshape_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	if( (0 == (input_context->nhwc.C&0x3)) &&
 		(0 == (context->nhwc.C&0x3)) )
@@ -60,12 +60,12 @@ int layer_cl_RESHAPE_set_args(const nn_t* nn, const layer_t* layer)
 int layer_cl_RESHAPE_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_reshape_context_t* context = (layer_cl_reshape_context_t*)layer->C->context;
+	layer_cl_reshape_context_t* context = (layer_cl_reshape_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 	float* data;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	if( (0 == (input_context->nhwc.C&0x3)) &&
 		(0 == (context->nhwc.C&0x3)) )
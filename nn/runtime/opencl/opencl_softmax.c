@@ -28,7 +28,7 @@ int layer_cl_SOFTMAX_init(const nn_t* nn, const layer_t* layer)
 
 	if(0 == r)
 	{
-		context = (layer_cl_softmax_context_t*)layer->C->context;
+		context = (layer_cl_softmax_context_t*)LAYER_CONTEXT(nn, layer);
 		context->p_out = out;
 	}
 
@@ -37,11 +37,11 @@ int layer_cl_SOFTMAX_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_SOFTMAX_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_softmax_context_t* context = (layer_cl_softmax_context_t*)layer->C->context;
+	layer_cl_softmax_context_t* context = (layer_cl_softmax_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 	r = rte_cl_set_layer_args(nn, layer, RTE_CL_ARGS_WITH_NHC, 2,
 					sizeof(cl_mem), &(input_context->out[0]),
 					sizeof(cl_mem), &(context->out[0]));
@@ -52,13 +52,13 @@ int layer_cl_SOFTMAX_set_args(const nn_t* nn, const layer_t* layer)
 int layer_cl_SOFTMAX_execute(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_softmax_context_t* context = (layer_cl_softmax_context_t*)layer->C->context;
+	layer_cl_softmax_context_t* context = (layer_cl_softmax_context_t*)LAYER_CONTEXT(nn, layer);
 
 	r = rte_cl_execute_layer(nn, layer, RTE_GWT_W_H, FALSE, NULL);
 
 	if((0 == r) && (NULL != context->p_out))
 	{
-		r = rte_cl_image2d_copy_out(nn, context->out[0], context->p_out, &context->nhwc);
+		r = rte_cl_image2d_copy_out(nn, context->out[0], nn_get_output_data(nn, layer), &context->nhwc);
 	}
 
 	return r;
@@ -30,12 +30,12 @@ int layer_cl_UPSAMPLE_init(const nn_t* nn, const layer_t* layer)
 int layer_cl_UPSAMPLE_set_args(const nn_t* nn, const layer_t* layer)
 {
 	int r = 0;
-	layer_cl_upsample_context_t* context = (layer_cl_upsample_context_t*)layer->C->context;
+	layer_cl_upsample_context_t* context = (layer_cl_upsample_context_t*)LAYER_CONTEXT(nn, layer);
 	const layer_t* input = layer->inputs[0];
 	layer_cl_context_t* input_context;
 	int strideX, strideY;
 
-	input_context = (layer_cl_context_t*)input->C->context;
+	input_context = (layer_cl_context_t*)LAYER_CONTEXT(nn, input);
 
 	strideY = context->nhwc.H/input_context->nhwc.H;
 	strideX = context->nhwc.W/input_context->nhwc.W;
@@ -43,7 +43,7 @@ int layer_cl_UPSAMPLE_set_args(const nn_t* nn, const layer_t* layer)
 	if(NULL != layer->inputs[1]) {
 		r = rte_cl_set_layer_args(nn, layer, RTE_CL_ARGS_WITH_C, 5,
 					sizeof(cl_mem), &(input_context->out[0]),
-					sizeof(cl_mem), &(layer->inputs[1]->C->context->out[1]),
+					sizeof(cl_mem), &(LAYER_CONTEXT(nn, layer->inputs[1])->out[1]),
 					sizeof(cl_mem), &(context->out[0]),
 					sizeof(int), &strideX,
 					sizeof(int), &strideY);
@@ -6,6 +6,7 @@
 #include "nn.h"
 #ifndef DISABLE_RUNTIME_OPENCL
 #include "runtime_opencl.h"
+#include "profile.h"
 #ifndef DISABLE_RTE_FALLBACK
 #include "runtime_cpu.h"
 #endif
@@ -188,11 +189,23 @@ static cl_program cl_create_program(cl_context context, cl_device_id device,
 static int cl_execute_layer(const nn_t* nn, const layer_t* layer)
 {
 	int r = NN_E_INVALID_LAYER;
+#ifndef DISABLE_NN_PROFILE
+	rte_cl_t* rt = (rte_cl_t*)nn->runtime;
+	uint64_t start = 0;
+#endif
 
 	if(layer->op < ARRAY_SIZE(cl_lops))
 	{
-		NNLOG(NN_DEBUG, ("execute %s: [%dx%dx%dx%d]\n", layer->name, L_SHAPES(layer)));
+		NNLOG(NN_DEBUG, ("execute %s: [%dx%dx%dx%d]\n", layer->name, L_SHAPES(nn, layer)));
+		RTE_PROFILE_START(nn, start);
 		r = cl_lops[layer->op].execute(nn, layer);
+#ifndef DISABLE_NN_PROFILE
+		if(NULL != nn->profile)
+		{	/* the kernels are only enqueued, wait for them to get the real time */
+			clFinish(rt->command_queue);
+		}
+#endif
+		RTE_PROFILE_STOP(nn, layer, start);
 
 #ifndef DISABLE_NN_DDO
 		NNDDO(NN_DEBUG, cl_ddo_layer(nn, layer));
@@ -415,7 +428,7 @@ static int cl_adjust_layer_image(const nn_t* nn, const layer_t* layer)
 	int r = 0;
 	int i;
 	rte_cl_image_t* image;
-	layer_cl_context_t* context = (layer_cl_context_t*)layer->C->context;
+	layer_cl_context_t* context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if( (layer->op != L_OP_OUTPUT)
 	#ifndef DISABLE_RTE_FALLBACK
@@ -757,6 +770,39 @@ cl_mem rte_cl_create_image2d_from_blob(const nn_t* nn, const layer_blob_t* blob)
 	return img2d;
 }
 
+int rte_cl_create_weights_and_bias(const nn_t* nn, const layer_t* layer, cl_mem* W, cl_mem* B)
+{
+	int r;
+	float* folded;
+
+	*W = NULL;
+	*B = NULL;
+	r = rte_fold_bn(nn, layer, &folded);
+	if(0 == r)
+	{
+		if(NULL != folded)
+		{
+			layer_blob_t weights = { layer->blobs[0]->dims, layer->blobs[0]->dtype, folded+layer->blobs[1]->dims[0] };
+			layer_blob_t bias = { layer->blobs[1]->dims, layer->blobs[1]->dtype, folded };
+			*W = rte_cl_create_image2d_from_blob(nn, &weights);
+			*B = rte_cl_create_image2d_from_blob(nn, &bias);
+			free(folded);
+		}
+		else
+		{
+			*W = rte_cl_create_image2d_from_blob(nn, layer->blobs[0]);
+			*B = rte_cl_create_image2d_from_blob(nn, layer->blobs[1]);
+		}
+
+		if((NULL == *W) || (NULL == *B))
+		{
+			r = NN_E_NO_MEMORY;
+		}
+	}
+
+	return r;
+}
+
 void rte_cl_destory_memory(cl_mem mem)
 {
 	if(mem) clReleaseMemObject(mem);
@@ -824,7 +870,7 @@ int rte_cl_create_layer_context(
 	}
 	else
 	{
-		layer->C->context = (layer_context_t*)context;
+		LAYER_CONTEXT(nn, layer) = (layer_context_t*)context;
 	}
 
 	return r;
@@ -835,7 +881,7 @@ void rte_cl_destory_layer_context(const nn_t* nn, const layer_t* layer)
 #ifndef ENABLE_CL_IMAGE_REUSE
 	size_t i;
 #endif
-	layer_cl_context_t* context = (layer_cl_context_t*)layer->C->context;
+	layer_cl_context_t* context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL != context)
 	{
@@ -868,7 +914,7 @@ void rte_cl_destory_layer_context(const nn_t* nn, const layer_t* layer)
 		free(context);
 	}
 
-	layer->C->context = NULL;
+	LAYER_CONTEXT(nn, layer) = NULL;
 }
 
 int rte_cl_set_layer_args(
@@ -877,7 +923,7 @@ int rte_cl_set_layer_args(
 {
 	int r = 0;
 	va_list valist;
-	layer_cl_context_t* context = (layer_cl_context_t*)layer->C->context;
+	layer_cl_context_t* context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 
 	va_start(valist, num);
 	r = cl_set_kernel_args_v(context->kernel, nhwc, &context->nhwc, num, valist);
@@ -894,7 +940,7 @@ int rte_cl_set_layer_args(
 int rte_cl_execute_layer(const nn_t* nn, const layer_t* layer, rte_cl_global_work_type_t gwt, int run, NHWC_t* nhwc)
 {
 	int r = 0;
-	layer_cl_context_t* context = (layer_cl_context_t*)layer->C->context;
+	layer_cl_context_t* context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 
 	if(NULL == nhwc)
 	{
@@ -997,9 +1043,9 @@ int rte_cl_create_layer_common(const nn_t* nn, const layer_t* layer,
 
 	if(0 == r)
 	{
-		context = (layer_cl_context_t*)layer->C->context;
+		context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 
-		RTE_CL_LOG_LAYER_SHAPE(layer);
+		RTE_CL_LOG_LAYER_SHAPE(nn, layer);
 #ifdef ENABLE_CL_IMAGE_REUSE
 		context->out[0] = (cl_mem)rte_cl_alloc_image2d(nn, layer,
 #else
@@ -1027,7 +1073,7 @@ void rte_cl_to_cpu_float_init_common(const nn_t* nn, const layer_t* layer)
 	const layer_t* const* inputs;
 
 	if( IS_LAYER_WITH_REAL_BUFFER(layer) ) {
-		context = (layer_cpu_context_t*)layer->C->context;
+		context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, layer);
 		scratch_size += sizeof(float)*NHWC_SIZE(context->nhwc) + sizeof(void*);
 		nn_request_scratch(nn, scratch_size);
 	}
@@ -1039,7 +1085,7 @@ void rte_cl_to_cpu_float_init_common(const nn_t* nn, const layer_t* layer)
 	inputs = layer->inputs;
 	while(NULL != (*inputs))
 	{
-		context = (layer_cpu_context_t*)(*inputs)->C->context;
+		context = (layer_cpu_context_t*)LAYER_CONTEXT(nn, *inputs);
 		scratch_size += sizeof(float)*NHWC_SIZE(context->nhwc) + sizeof(void*);
 		inputs++;
 	}
@@ -1056,7 +1102,7 @@ int rte_cl_to_cpu_float_pre_execute_common(const nn_t* nn, const layer_t* layer)
 	float* pf;
 
 	if( IS_LAYER_WITH_REAL_BUFFER(layer) ) {
-		context = (layer_cl_context_t*)layer->C->context;
+		context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 		*cl_inputs++ = context->out[0];
 		pf = (float*)cl_inputs;
 		context->out[0] = (void*)pf;
@@ -1071,7 +1117,7 @@ int rte_cl_to_cpu_float_pre_execute_common(const nn_t* nn, const layer_t* layer)
 	inputs = layer->inputs;
 	while(NULL != (*inputs))
 	{
-		context = (layer_cl_context_t*)(*inputs)->C->context;
+		context = (layer_cl_context_t*)LAYER_CONTEXT(nn, *inputs);
 		*cl_inputs++ = context->out[0];
 		inputs++;
 	}
@@ -1081,7 +1127,7 @@ int rte_cl_to_cpu_float_pre_execute_common(const nn_t* nn, const layer_t* layer)
 	inputs = layer->inputs;
 	while((NULL != (*inputs)) && (0 == r))
 	{
-		context = (layer_cl_context_t*)(*inputs)->C->context;
+		context = (layer_cl_context_t*)LAYER_CONTEXT(nn, *inputs);
 		r = rte_cl_image2d_copy_out(nn, context->out[0], pf, &(context->nhwc));
 		context->out[0] = pf;
 		pf += NHWC_SIZE(context->nhwc);
@@ -1100,7 +1146,7 @@ void rte_cl_to_cpu_float_post_execute_common(const nn_t* nn, const layer_t* laye
 	float* pf;
 
 	if( IS_LAYER_WITH_REAL_BUFFER(layer) ) {
-		context = (layer_cl_context_t*)layer->C->context;
+		context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 		context->out[0] = *cl_inputs++;
 		pf = (float*)cl_inputs;
 		r = rte_cl_image2d_copy_in(nn, context->out[0], pf, &(context->nhwc));
@@ -1122,7 +1168,7 @@ void rte_cl_to_cpu_float_post_execute_common(const nn_t* nn, const layer_t* laye
 	inputs = layer->inputs;
 	while(NULL != (*inputs))
 	{
-		context = (layer_cl_context_t*)(*inputs)->C->context;
+		context = (layer_cl_context_t*)LAYER_CONTEXT(nn, *inputs);
 		context->out[0] = *cl_inputs++;
 		inputs++;
 	}
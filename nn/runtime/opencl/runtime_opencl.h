@@ -57,13 +57,11 @@ typedef struct rte_cl_image
 #define RTE_CL_ARGS_WITH_NHC	(0x01|0x02|0x08)
 #define RTE_CL_ARGS_WITH_NC	(0x01|0x08)
 
-#define RTE_CL_LOG_LAYER_SHAPE(layer) 											\
+#define RTE_CL_LOG_LAYER_SHAPE(nn, layer) 										\
 	NNLOG(NN_DEBUG, ("%s dims: [%dx%dx%dx%d] -> [1x%dx%dx4]\n",					\
-						layer->name,											\
-						layer->C->context->nhwc.N, layer->C->context->nhwc.H,	\
-						layer->C->context->nhwc.W, layer->C->context->nhwc.C,	\
-						RTE_CL_NHWC_H(layer->C->context->nhwc),					\
-						RTE_CL_NHWC_W(layer->C->context->nhwc)))
+						layer->name, L_SHAPES(nn, layer),						\
+						RTE_CL_NHWC_H(LAYER_CONTEXT(nn, layer)->nhwc),			\
+						RTE_CL_NHWC_W(LAYER_CONTEXT(nn, layer)->nhwc)))
 
 #define ENABLE_CL_IMAGE_REUSE
 /* ============================ [ DATAS     ] ====================================================== */
@@ -74,6 +72,9 @@ cl_mem rte_cl_create_image2d(const nn_t* nn, int H, int W, cl_channel_type ctype
 int rte_cl_image2d_copy_in(const nn_t* nn, cl_mem img2d, const float* in, NHWC_t* nhwc);
 int rte_cl_image2d_copy_out(const nn_t* nn, cl_mem img2d, float* out, NHWC_t* nhwc);
 cl_mem rte_cl_create_image2d_from_blob(const nn_t* nn, const layer_blob_t* blob);
+/* the images of the weights (blobs[0]) and bias (blobs[1]) of layer, with the
+ * BATCHNORM folded into it if any */
+int rte_cl_create_weights_and_bias(const nn_t* nn, const layer_t* layer, cl_mem* W, cl_mem* B);
 void rte_cl_destory_memory(cl_mem mem);
 int rte_cl_create_layer_context(
 			const nn_t* nn, const layer_t* layer,
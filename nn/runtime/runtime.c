@@ -4,6 +4,7 @@
  */
 /* ============================ [ INCLUDES  ] ====================================================== */
 #include "nn.h"
+#include <math.h>
 /* ============================ [ MACROS    ] ====================================================== */
 #define DECLARE_RUNTIME(name)									\
 	extern runtime_t rte_##name##_create(const nn_t* nn);	\
@@ -106,35 +107,258 @@ int rte_do_for_each_layer(const nn_t* nn, rte_layer_action_t action)
 int rte_is_layer_consumed_from(const nn_t* nn, const layer_t* layer, const layer_t* from)
 {
 	int r = FALSE;
+	int id;
 
-	const layer_t* const* layers;
-	const layer_t** inputs;
+	if(NULL != layer)
+	{
+		id = nn_get_layer_id(nn, layer);
+		if((nn->last_use[id] != id) &&
+			(nn->last_use[id] >= nn_get_layer_id(nn, from)))
+		{
+			r = TRUE;
+		}
+	}
 
-	layers = nn->network->layers;
-	while((NULL != (*layers)) && ((*layers) != from))
+	return r;
+}
+
+
+int rte_get_reader_number(const nn_t* nn, const layer_t* layer)
+{
+	return nn->readers[nn_get_layer_id(nn, layer)];
+}
+
+const layer_t* rte_get_folded_bn(const nn_t* nn, const layer_t* layer)
+{
+	const layer_t* bn = NULL;
+#ifndef DISABLE_NN_FOLD_BN
+	int id = nn->folds[nn_get_layer_id(nn, layer)];
+
+	if((id >= 0) && (L_OP_BATCHNORM != layer->op))
+	{
+		bn = nn->network->layers[id];
+	}
+#endif
+
+	return bn;
+}
+
+int rte_is_bn_folded(const nn_t* nn, const layer_t* layer)
+{
+	int r = FALSE;
+#ifndef DISABLE_NN_FOLD_BN
+	if((L_OP_BATCHNORM == layer->op) &&
+		(nn->folds[nn_get_layer_id(nn, layer)] >= 0))
+	{
+		r = TRUE;
+	}
+#endif
+
+	return r;
+}
+
+const layer_t* rte_get_fused_pad(const nn_t* nn, const layer_t* layer)
+{
+	const layer_t* pad = NULL;
+#ifndef DISABLE_NN_FUSE_PAD
+	int id = nn->pads[nn_get_layer_id(nn, layer)];
+
+	if((id >= 0) && (L_OP_PAD != layer->op))
+	{
+		pad = nn->network->layers[id];
+	}
+#endif
+
+	return pad;
+}
+
+const layer_t* rte_get_pad_reader(const nn_t* nn, const layer_t* layer)
+{
+	const layer_t* reader = NULL;
+#ifndef DISABLE_NN_FUSE_PAD
+	int id = nn->pads[nn_get_layer_id(nn, layer)];
+
+	if((id >= 0) && (L_OP_PAD == layer->op))
+	{
+		reader = nn->network->layers[id];
+	}
+#endif
+
+	return reader;
+}
+
+const layer_t* rte_get_padded_input(const nn_t* nn, const layer_t* layer, int* padY, int* padX)
+{
+	const layer_t* input = layer->inputs[0];
+	const layer_t* pad = rte_get_fused_pad(nn, layer);
+	const int* ints;
+
+	if(NULL != pad)
+	{	/* the bottom and right padding come with the output shape */
+		ints = (const int*)pad->blobs[0]->blob;
+		*padY += ints[1];
+		*padX += ints[2];
+		input = pad->inputs[0];
+	}
+
+	return input;
+}
+
+void rte_get_bn_affine(const layer_t* layer, float* a, float* b)
+{
+	const float* scale = (const float*)layer->blobs[0]->blob;
+	const float* bias = (const float*)layer->blobs[1]->blob;
+	const float* var = (const float*)layer->blobs[2]->blob;
+	const float* mean = (const float*)layer->blobs[3]->blob;
+	float epsilon = RTE_FETCH_FLOAT(layer->blobs[4]->blob, 0);
+	int C = layer->blobs[0]->dims[0];
+	int c;
+
+	/* s * (x - mean) / np.sqrt(var + epsilon) + bias */
+	for(c=0; c<C; c++)
 	{
-		layers++;
+		a[c] = scale[c]/sqrt(var[c]+epsilon);
+		b[c] = bias[c] - mean[c]*a[c];
 	}
+}
 
-	do
+int rte_fold_bn(const nn_t* nn, const layer_t* layer, float** folded)
+{
+	int r = 0;
+	const layer_t* bn = rte_get_folded_bn(nn, layer);
+	const float* weights = (const float*)layer->blobs[0]->blob;
+	const float* bias = (const float*)layer->blobs[1]->blob;
+	const int* dims = layer->blobs[0]->dims;
+	size_t sz, i;
+	int C, c;
+	float* a = NULL;
+	float* b;
+	float* W;
+
+	*folded = NULL;
+	if(NULL != bn)
 	{
-		inputs = (*layers)->inputs;
-		while((inputs != NULL) && (*inputs != NULL) && (FALSE == r))
+		C = bn->blobs[0]->dims[0];
+		sz = *dims++;
+		while(0 != *dims)
 		{
-			if(*inputs == layer)
-			{
-				r = TRUE;
-			}
+			sz *= *dims++;
+		}
 
-			inputs++;
+		a = malloc(2*C*sizeof(float));
+		*folded = malloc((C+sz)*sizeof(float));
+		if((NULL == a) || (NULL == *folded))
+		{
+			r = NN_E_NO_MEMORY;
+			free(*folded);
+			*folded = NULL;
 		}
-		layers++;
-	} while((NULL != (*layers)) && (FALSE == r));
+	}
+
+	if((NULL != *folded) && (0 == r))
+	{
+		b = a + C;
+		W = *folded + C;
+		rte_get_bn_affine(bn, a, b);
+		for(c=0; c<C; c++)
+		{
+			(*folded)[c] = bias[c]*a[c] + b[c];
+		}
+		for(i=0; i<sz; i++)
+		{	/* the channel is the innermost axis of the DWCONV2D weights, the outermost of the others */
+			c = (L_OP_DWCONV2D == layer->op) ? (int)(i%C) : (int)(i/(sz/C));
+			W[i] = weights[i]*a[c];
+		}
+	}
+
+	free(a);
 
 	return r;
 }
 
+int rte_is_transpose_skipped(const nn_t* nn, const layer_t* layer)
+{
+	int r = FALSE;
+#ifndef DISABLE_NN_ELIMINATE_TRANSPOSE
+	if((L_OP_TRANSPOSE == layer->op) &&
+		(nn->transposes[nn_get_layer_id(nn, layer)] >= 0))
+	{
+		r = TRUE;
+	}
+#endif
 
+	return r;
+}
+
+int rte_fold_transpose(const nn_t* nn, const layer_t* layer, float** folded)
+{
+	int r = 0;
+#ifndef DISABLE_NN_ELIMINATE_TRANSPOSE
+	int id = nn->transposes[nn_get_layer_id(nn, layer)];
+	const float* weights = (const float*)layer->blobs[0]->blob;
+	const float* bias = (const float*)layer->blobs[1]->blob;
+	int units = layer->blobs[0]->dims[0];
+	int K = layer->blobs[0]->dims[1];
+	const layer_t* transpose;
+	float* block = NULL;
+	float* W;
+	NHWC_t nhwc;
+	int u, h, w, c, nhwc_i, nchw_i;
+
+	if((L_OP_DENSE == layer->op) && (id >= 0))
+	{
+		transpose = nn->network->layers[id];
+		r = layer_get_NHWC(transpose->inputs[0], &nhwc);
+		if(0 == r)
+		{
+			block = malloc((units+(size_t)units*K)*sizeof(float));
+			if(NULL == block)
+			{
+				r = NN_E_NO_MEMORY;
+			}
+		}
+	}
+
+	if(NULL != block)
+	{
+		if(NULL != *folded)
+		{
+			bias = *folded;
+			weights = *folded + units;
+		}
+		memcpy(block, bias, units*sizeof(float));
+		W = block + units;
+		for(u=0; u<units; u++)
+		{
+			for(h=0; h<nhwc.H; h++)
+			{
+				for(w=0; w<nhwc.W; w++)
+				{
+					for(c=0; c<nhwc.C; c++)
+					{
+						nhwc_i = (h*nhwc.W+w)*nhwc.C+c;
+						nchw_i = (c*nhwc.H+h)*nhwc.W+w;
+						if(0 == RTE_FETCH_INT32(transpose->blobs[0]->blob, 0))
+						{	/* the DENSE took the NCHW order of the NHWC input */
+							W[(size_t)u*K+nhwc_i] = weights[(size_t)u*K+nchw_i];
+						}
+						else
+						{
+							W[(size_t)u*K+nchw_i] = weights[(size_t)u*K+nhwc_i];
+						}
+					}
+				}
+			}
+		}
+		free(*folded);
+		*folded = block;
+	}
+#else
+	(void)nn; (void)layer; (void)folded;
+#endif
+
+	return r;
+}
 
 #ifndef DISABLE_NN_DDO
 #include <sys/stat.h>
@@ -226,9 +450,9 @@ void rte_ddo_save_raw(const nn_t* nn, const layer_t* layer, int i, void* data, s
 
 void rte_ddo_save(const nn_t* nn, const layer_t* layer)
 {
-	size_t sz = layer_get_size(layer);
+	size_t sz = NHWC_SIZE(LAYER_CONTEXT(nn, layer)->nhwc);
 	int i;
-	switch(layer->C->context->dtype) {
+	switch(LAYER_CONTEXT(nn, layer)->dtype) {
 		case L_DT_INT16:
 		case L_DT_UINT16:
 			sz = sz * sizeof(int16_t);
@@ -253,7 +477,7 @@ void rte_ddo_save(const nn_t* nn, const layer_t* layer)
 #endif
 		)
 	{
-		layer_cpu_q_context_t* context = (layer_cpu_q_context_t*)layer->C->context;
+		layer_cpu_q_context_t* context = (layer_cpu_q_context_t*)LAYER_CONTEXT(nn, layer);
 		for(i=0; i<context->nout; i++)
 		{
 			rte_ddo_save_raw(nn, layer, i, context->out[i], sz);
@@ -268,7 +492,7 @@ void rte_ddo_save(const nn_t* nn, const layer_t* layer)
 		void* data = malloc(sz);
 		if(NULL != data)
 		{
-			context = (layer_cl_context_t*)layer->C->context;
+			context = (layer_cl_context_t*)LAYER_CONTEXT(nn, layer);
 			for(i=0; i<context->nout; i++)
 			{
 				if(L_OP_YOLO == layer->op)
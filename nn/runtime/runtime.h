@@ -39,6 +39,30 @@ void rte_destory(const nn_t* nn);
 
 int rte_do_for_each_layer(const nn_t* nn, rte_layer_action_t action);
 int rte_is_layer_consumed_from(const nn_t* nn, const layer_t* layer, const layer_t* from);
+/* how many times the output of layer is an input of the others */
+int rte_get_reader_number(const nn_t* nn, const layer_t* layer);
+/* the BATCHNORM folded into layer, NULL if none */
+const layer_t* rte_get_folded_bn(const nn_t* nn, const layer_t* layer);
+/* TRUE if the BATCHNORM layer is folded into its input, whose output is then its output */
+int rte_is_bn_folded(const nn_t* nn, const layer_t* layer);
+/* the BATCHNORM layer as y = x*a[c] + b[c] */
+void rte_get_bn_affine(const layer_t* layer, float* a, float* b);
+/* the bias (C floats) followed by the weights in the layout of blobs[0] of layer with
+ * the BATCHNORM folded into it, in one malloc block, *folded is NULL if none is folded */
+int rte_fold_bn(const nn_t* nn, const layer_t* layer, float** folded);
+/* the PAD fused into the padding of layer, NULL if none */
+const layer_t* rte_get_fused_pad(const nn_t* nn, const layer_t* layer);
+/* the layer that the PAD layer is fused into, NULL if none, the PAD has nothing to do then */
+const layer_t* rte_get_pad_reader(const nn_t* nn, const layer_t* layer);
+/* the layer whose output layer reads: the input of the PAD fused into it, with the
+ * top and left padding of the PAD added to *padY and *padX, else its own input */
+const layer_t* rte_get_padded_input(const nn_t* nn, const layer_t* layer, int* padY, int* padX);
+/* TRUE if the TRANSPOSE layer is skipped, its output is then its input */
+int rte_is_transpose_skipped(const nn_t* nn, const layer_t* layer);
+/* the bias and weights of the DENSE layer for the input in the order it has before
+ * the TRANSPOSE skipped in front of it, in a block as the one of rte_fold_bn, which
+ * it replaces if there is one, *folded is left as it is if there is no such TRANSPOSE */
+int rte_fold_transpose(const nn_t* nn, const layer_t* layer, float** folded);
 #ifdef __cplusplus
 }
 #endif
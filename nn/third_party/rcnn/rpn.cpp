@@ -79,7 +79,7 @@ static py::object create_array(const layer_blob_t* blob) {
     return py::none();
 }
 
-static py::object create_array(const layer_t* layer) {
+static py::object create_array(const nn_t* nn, const layer_t* layer) {
     int dim = 0;
     const int* dims = layer->dims;
 
@@ -90,9 +90,9 @@ static py::object create_array(const layer_t* layer) {
     };
 
     if(3 == dim) {
-        switch(layer->C->context->dtype) {
+        switch(LAYER_CONTEXT(nn, layer)->dtype) {
         case L_DT_FLOAT:
-            return create_3d_array<float>((float*)layer->C->context->out[0],
+            return create_3d_array<float>((float*)LAYER_CONTEXT(nn, layer)->out[0],
                             (size_t)dims[0], (size_t)dims[1], (size_t)dims[2]);
             break;
         default:
@@ -100,7 +100,7 @@ static py::object create_array(const layer_t* layer) {
         }
     }
 
-    printf("unsupported layer with dim=%d, dtype=%d\n", dim, layer->C->context->dtype);
+    printf("unsupported layer with dim=%d, dtype=%d\n", dim, LAYER_CONTEXT(nn, layer)->dtype);
     assert(0);
 
     return py::none();
@@ -159,10 +159,10 @@ extern "C" int _rpn_proposal_forward(const nn_t* nn, const layer_t* layer, float
 {
   int r = 0;
   pthread_once(&_once, setup_pyenv);
-  layer_context_t* context = layer->C->context;
+  layer_context_t* context = LAYER_CONTEXT(nn, layer);
   auto RPN_BBOX_STD_DEV = create_array(layer->blobs[0]);
-  auto scores = create_array(layer->inputs[0]);
-  auto deltas = create_array(layer->inputs[1]);
+  auto scores = create_array(nn, layer->inputs[0]);
+  auto deltas = create_array(nn, layer->inputs[1]);
   auto anchors_ = create_3d_array<float>(anchors, 1, n_anchors, 4);
   float nms_threshold = RTE_FETCH_FLOAT(layer->blobs[6]->blob, 0);
 
@@ -2,6 +2,7 @@
 # Copyright (C) 2019  Parai Wang <parai@foxmail.com>
 
 import os
+import struct
 import numpy as np
 
 class LWNNBaseC():
@@ -67,6 +68,7 @@ class LWNNBaseC():
     def generate(self):
         self.fpW = self.open('%s_builtin.h'%(self.T))
         self.fpB = self.open('%s.bin'%(self.T), 'wb')
+        self.blobs = []
         self.fpH = self.open('%s.h'%(self.T))
         self.fpC = self.open('%s.c'%(self.T))
         self.fpC.write('#include "nn.h"\n')
@@ -79,6 +81,7 @@ class LWNNBaseC():
         self.close(self.fpC)
         self.close(self.fpW)
         self.close(self.fpB)
+        self.gen_bundle()
         if(('1' == os.getenv('LWNN_GTEST')) and(self.T == 'float')):
             self.gen_goldens_for_gtest()
 
@@ -109,6 +112,27 @@ class LWNNBaseC():
                     n = 'output'
                 v.tofile('%s/%s.raw'%(p, n))
 
+    def gen_bundle(self, align=64):
+        # the weight bundle for nn_map, see nn_bundle_header_t in nn.c
+        dtMap = { 'int8_t':0, 'int16_t':2, 'int32_t':4, 'uint32_t':5, 'float':6 }
+        fp = self.open('%s.bundle'%(self.T), 'wb')
+        offset = 24 + 48*len(self.blobs)
+        entries = []
+        for T, blob in self.blobs:
+            assert(len(blob.shape) <= 7)
+            offset = (offset + align - 1) & ~(align - 1)
+            dims = list(blob.shape) + [0]*(7-len(blob.shape))
+            entries.append(struct.pack('<QQi7i', offset, blob.nbytes, dtMap[T], *dims))
+            offset += blob.nbytes
+        fp.write(struct.pack('<8s4I', b'LWNNBLOB', 1, len(self.blobs), align, 0))
+        for entry in entries:
+            fp.write(entry)
+        for (T, blob), entry in zip(self.blobs, entries):
+            offset = struct.unpack('<Q', entry[:8])[0]
+            fp.write(b'\0'*(offset-fp.tell()))
+            fp.write(blob.tobytes())
+        self.close(fp)
+
     def quantize(self, blob, only_needQ=False):
         if((blob is None) and (only_needQ==True)): # layer fallback to float
             return None,7
@@ -186,6 +210,7 @@ class LWNNBaseC():
         self.fpW.write('#define l_blob_def_%s {'%(name))
         self.fpW.write(', '.join(['%s'%(f) for f in blob.reshape(-1)]))
         blob.tofile(self.fpB)
+        self.blobs.append((T, blob))
         self.fpW.write('}\n')
         self.fpH.write('#ifndef l_blob_def_%s\n'%(name))
         self.fpH.write('#define l_blob_def_%s (%s)\n'%(name, '*'.join(['%s'%(s) for s in blob.shape])))
@@ -195,7 +220,7 @@ class LWNNBaseC():
             name, ','.join(['%s'%(s) for s in blob.shape])))
         if(T.endswith('_t')):
             T=T[:-2]
-        self.fpH.write('static const layer_blob_t l_blob_%s =\n{\n'%(name))
+        self.fpH.write('static L_BLOB_CONST layer_blob_t l_blob_%s =\n{\n'%(name))
         self.fpH.write('\tl_dims_%s,\n'%(name))
         self.fpH.write('\tL_DT_%s,\n'%(T.upper()))
         self.fpH.write('\t(void*)%s,\n'%(name))